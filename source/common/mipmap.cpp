@@ -0,0 +1,247 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains MIP chain generator. Every MIP is made from the previous
+// one by 2x2 box filter. Work is done in 16-bit RGBA, so rounding errors are
+// not accumulated, indexed images are converted back with palette matcher
+//
+
+////////// Includes //////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "util.h"
+#include "types.h"
+#include "palmatch.h"
+#include "mipmap.h"
+
+////////// Defines //////////
+#define MIP_GAMMA		2.2
+
+////////// Functions //////////
+static void MIPInitTables();																	// Fill conversion tables
+static void MIPToWork(const uchar * Src, ushort * Dst, ulong Pixels, int Filter);				// 8-bit RGBA -> 16-bit work format
+static void MIPFromWork(const ushort * Src, uchar * Dst, ulong Pixels, int Filter);				// 16-bit work format -> 8-bit RGBA
+static void MIPHalve(const ushort * Src, uint Width, uint Height, ushort * Dst);				// Make next MIP in work format
+static ushort * MIPBuildChain(const uchar * RGBA, uint Width, uint Height, uchar Count, int Filter);	// Make all MIPs in work format
+
+///////// Variables /////////
+static bool TablesReady = false;
+static ushort ToLinear[256];						// Gamma -> linear
+static uchar FromLinear[0x10000];					// Linear -> gamma (nearest entry of ToLinear)
+
+///////// Code /////////
+static void MIPInitTables()
+{
+	if (TablesReady)
+		return;
+
+	// Keep table strictly increasing, so every 8-bit value has its own linear value
+	for (uint i = 0; i < 256; i++)
+	{
+		ToLinear[i] = (ushort)floor(pow(i / 255.0, MIP_GAMMA) * 65535.0 + 0.5);
+		if (i > 0 && ToLinear[i] <= ToLinear[i - 1])
+			ToLinear[i] = ToLinear[i - 1] + 1;
+	}
+
+	// Inverse: split linear range at midpoints between neighbour entries
+	uint Value = 0;
+	for (ulong i = 0; i < 0x10000; i++)
+	{
+		while (Value < 255 && i * 2 > (ulong)ToLinear[Value] + ToLinear[Value + 1])
+			Value++;
+		FromLinear[i] = (uchar)Value;
+	}
+	for (uint i = 0; i < 256; i++)
+		assert(FromLinear[ToLinear[i]] == i);
+
+	TablesReady = true;
+}
+
+static void MIPToWork(const uchar * Src, ushort * Dst, ulong Pixels, int Filter)
+{
+	for (ulong i = 0; i < Pixels * 4; i++)
+	{
+		if (Filter == MIP_FILTER_GAMMA && (i & 3) != 3)
+			Dst[i] = ToLinear[Src[i]];
+		else
+			Dst[i] = Src[i] * 257;
+	}
+}
+
+static void MIPFromWork(const ushort * Src, uchar * Dst, ulong Pixels, int Filter)
+{
+	for (ulong i = 0; i < Pixels * 4; i++)
+	{
+		if (Filter == MIP_FILTER_GAMMA && (i & 3) != 3)
+			Dst[i] = FromLinear[Src[i]];
+		else
+			Dst[i] = (Src[i] + 128) / 257;
+	}
+}
+
+static void MIPHalve(const ushort * Src, uint Width, uint Height, ushort * Dst)
+{
+	uint NewWidth = Width / 2;
+	uint NewHeight = Height / 2;
+
+	for (uint y = 0; y < NewHeight; y++)
+	{
+		const ushort * Row1 = &Src[(y * 2) * Width * 4];
+		const ushort * Row2 = Row1 + Width * 4;
+		for (uint x = 0; x < NewWidth; x++)
+		{
+			for (uint c = 0; c < 4; c++)
+				*Dst++ = (Row1[c] + Row1[c + 4] + Row2[c] + Row2[c + 4] + 2) >> 2;
+			Row1 += 8;
+			Row2 += 8;
+		}
+	}
+}
+
+static ushort * MIPBuildChain(const uchar * RGBA, uint Width, uint Height, uchar Count, int Filter)
+{
+	ushort * Work;
+	ushort * Prev;
+	ushort * Next;
+	ulong WorkSize = 0;
+
+	MIPInitTables();
+
+	// Base image + all MIPs in one buffer
+	uint w = Width;
+	uint h = Height;
+	for (uchar m = 0; m <= Count; m++)
+	{
+		WorkSize += w * h * 4;
+		w /= 2;
+		h /= 2;
+	}
+	UTIL_MALLOC(ushort *, Work, WorkSize * sizeof(ushort), return NULL);
+
+	// Every MIP is made from previous one
+	MIPToWork(RGBA, Work, Width * Height, Filter);
+	Prev = Work;
+	w = Width;
+	h = Height;
+	for (uchar m = 0; m < Count; m++)
+	{
+		Next = Prev + w * h * 4;
+		MIPHalve(Prev, w, h, Next);
+		Prev = Next;
+		w /= 2;
+		h /= 2;
+	}
+
+	return Work;
+}
+
+uchar MIPCount(uint Width, uint Height, uint MinSize, ulong * MIPSize)
+{
+	uchar Count = 0;
+	ulong Size = 0;
+
+	while (Width > MinSize && Height > MinSize)
+	{
+		Width /= 2;
+		Height /= 2;
+		Size += Width * Height;
+		Count++;
+	}
+
+	if (MIPSize != NULL)
+		*MIPSize = Size;
+
+	return Count;
+}
+
+uchar MIPCreateIndexed(uchar ** Bitmap, ulong * BitmapSize, uint Width, uint Height, const uchar * RGBAPalette, ulong RGBAPaletteSize, uint MinSize, int Filter)
+{
+	ulong MIPSize;
+	uchar Count = MIPCount(Width, Height, MinSize, &MIPSize);
+	ulong BaseSize = Width * Height;
+	uchar * NewBitmap;
+	uchar * RGBA;
+	sPaletteMatcher * Matcher;
+
+	if (Count == 0)
+		return 0;
+
+	// Expand base image to RGBA
+	UTIL_MALLOC(sPaletteMatcher *, Matcher, sizeof(sPaletteMatcher), exit(EXIT_FAILURE));
+	if (RGBAPaletteSize != 0x400 || Matcher->Init(RGBAPalette, RGBAPaletteSize, 4) == false)
+		UTIL_ERR("RGBA palette is required", free(Matcher); return 0);
+	UTIL_MALLOC(uchar *, RGBA, BaseSize * 4, exit(EXIT_FAILURE));
+	for (ulong i = 0; i < BaseSize; i++)
+		memcpy(&RGBA[i * 4], &RGBAPalette[(*Bitmap)[i] * 4], 4);
+
+	// Filter
+	ushort * Work = MIPBuildChain(RGBA, Width, Height, Count, Filter);
+	if (Work == NULL)
+		exit(EXIT_FAILURE);
+
+	// Copy base image and convert MIPs back to indexed format
+	UTIL_MALLOC(uchar *, NewBitmap, BaseSize + MIPSize, exit(EXIT_FAILURE));
+	memcpy(NewBitmap, *Bitmap, BaseSize);
+
+	ushort * pWork = Work + BaseSize * 4;
+	uchar * pOut = NewBitmap + BaseSize;
+	uint w = Width / 2;
+	uint h = Height / 2;
+	for (uchar m = 0; m < Count; m++)
+	{
+		MIPFromWork(pWork, RGBA, w * h, Filter);
+		for (ulong i = 0; i < w * h; i++)
+			*pOut++ = Matcher->Find(RGBA[i * 4 + 0], RGBA[i * 4 + 1], RGBA[i * 4 + 2], RGBA[i * 4 + 3]);
+
+		pWork += w * h * 4;
+		w /= 2;
+		h /= 2;
+	}
+
+	// Free memory
+	free(Work);
+	free(RGBA);
+	free(Matcher);
+	free(*Bitmap);
+
+	// Save new bitmap
+	*Bitmap = NewBitmap;
+	*BitmapSize = BaseSize + MIPSize;
+
+	return Count;
+}
+
+uchar MIPCreateRGBA(uchar ** Bitmap, ulong * BitmapSize, uint Width, uint Height, uint MinSize, int Filter)
+{
+	ulong MIPSize;
+	uchar Count = MIPCount(Width, Height, MinSize, &MIPSize);
+	ulong BaseSize = Width * Height * 4;
+	uchar * NewBitmap;
+
+	if (Count == 0)
+		return 0;
+
+	// Filter
+	ushort * Work = MIPBuildChain(*Bitmap, Width, Height, Count, Filter);
+	if (Work == NULL)
+		exit(EXIT_FAILURE);
+
+	// Copy base image and convert MIPs back to 8-bit
+	UTIL_MALLOC(uchar *, NewBitmap, BaseSize + MIPSize * 4, exit(EXIT_FAILURE));
+	memcpy(NewBitmap, *Bitmap, BaseSize);
+	MIPFromWork(Work + BaseSize, NewBitmap + BaseSize, MIPSize, Filter);
+
+	// Free memory
+	free(Work);
+	free(*Bitmap);
+
+	// Save new bitmap
+	*Bitmap = NewBitmap;
+	*BitmapSize = BaseSize + MIPSize * 4;
+
+	return Count;
+}
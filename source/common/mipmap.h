@@ -0,0 +1,16 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+// MIP filters
+#define MIP_FILTER_BOX		0		// 2x2 box average
+#define MIP_FILTER_GAMMA	1		// 2x2 box average in linear light (alpha is averaged as is)
+
+// MIP Functions
+uchar MIPCount(uint Width, uint Height, uint MinSize, ulong * MIPSize);																			// Count MIPs for image (smallest MIP has at least one side <= MinSize)
+uchar MIPCreateIndexed(uchar ** Bitmap, ulong * BitmapSize, uint Width, uint Height, const uchar * RGBAPalette, ulong RGBAPaletteSize, uint MinSize, int Filter);	// Append MIPs to 8-bit indexed bitmap, returns MIP count
+uchar MIPCreateRGBA(uchar ** Bitmap, ulong * BitmapSize, uint Width, uint Height, uint MinSize, int Filter);										// Append MIPs to 32-bit RGBA bitmap, returns MIP count
+
+#endif // MIPMAP_H
@@ -0,0 +1,118 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains palette conversion between PC and PS2 formats:
+// CLUT swizzle, channel scaling and R/B swap are done with lookup tables in one pass
+//
+
+////////// Includes //////////
+#include <stdio.h>
+#include <string.h>
+#include "types.h"
+#include "palette.h"
+
+////////// Functions //////////
+static void PalInitTables();							// Fill lookup tables
+static const uchar * PalColorTable(uint Flags);			// Select table for color channels
+static const uchar * PalAlphaTable(uint Flags);			// Select table for alpha channel
+
+///////// Variables /////////
+static bool TablesReady = false;
+static uchar TableCopy[256];				// v
+static uchar TableMul[256];					// v * 2 (with overflow, same as old code)
+static uchar TableDiv[256];					// v / 2
+static uchar TableAlphaMulPS2[256];			// min(v, 0x7F) * 2
+static uchar TableAlphaDivPS2[256];			// v / 2, 0x7F -> 0x80
+
+///////// Code /////////
+static void PalInitTables()
+{
+	if (TablesReady)
+		return;
+
+	for (uint v = 0; v < 256; v++)
+	{
+		TableCopy[v] = v;
+		TableMul[v] = (uchar)(v * 2);
+		TableDiv[v] = v / 2;
+		TableAlphaMulPS2[v] = (v > 0x7F ? 0x7F : v) * 2;
+		TableAlphaDivPS2[v] = (v / 2 == 0x7F) ? 0x80 : v / 2;
+	}
+
+	TablesReady = true;
+}
+
+static const uchar * PalColorTable(uint Flags)
+{
+	if (Flags & PAL_COLOR_MUL)
+		return TableMul;
+	if (Flags & PAL_COLOR_DIV)
+		return TableDiv;
+	return TableCopy;
+}
+
+static const uchar * PalAlphaTable(uint Flags)
+{
+	if (Flags & PAL_ALPHA_MUL)
+		return (Flags & PAL_ALPHA_PS2) ? TableAlphaMulPS2 : TableMul;
+	if (Flags & PAL_ALPHA_DIV)
+		return (Flags & PAL_ALPHA_PS2) ? TableAlphaDivPS2 : TableDiv;
+	return TableCopy;
+}
+
+void PaletteTranscode(uchar * Palette, ulong PaletteSize, uint ElementSize, uint Flags)
+{
+	const uchar * Table[4];
+	uint Channel[4] = {0, 1, 2, 3};
+	uchar TempFirst[4];
+	uchar TempSecond[4];
+	ulong Entries = PaletteSize / ElementSize;
+	bool Alpha = ElementSize == 4;
+
+	if (ElementSize != 3 && ElementSize != 4)
+		return;
+
+	// Select conversion for every channel
+	PalInitTables();
+	Table[0] = Table[1] = Table[2] = PalColorTable(Flags);
+	Table[3] = PalAlphaTable(Flags);
+	if (Flags & PAL_SWAP_RB)
+	{
+		Channel[0] = 2;
+		Channel[2] = 0;
+	}
+
+	// Swizzle only swaps pairs of entries, so every pair is converted at once
+	for (ulong e = 0; e < Entries; e++)
+	{
+		ulong Pair = e;
+		if (Flags & PAL_SWIZZLE)
+		{
+			Pair = PAL_SWIZZLE_INDEX(e);
+			if (Pair < e)
+				continue;		// Already done
+			if (Pair >= Entries)
+				Pair = e;		// Incomplete block at the end of palette
+		}
+
+		uchar * First = &Palette[e * ElementSize];
+		uchar * Second = &Palette[Pair * ElementSize];
+		for (uint c = 0; c < ElementSize; c++)
+		{
+			TempFirst[c] = Table[c][First[Channel[c]]];
+			TempSecond[c] = Table[c][Second[Channel[c]]];
+		}
+		memcpy(First, TempSecond, ElementSize);
+		memcpy(Second, TempFirst, ElementSize);
+
+		// Black out transparent entries to avoid possible artifacts
+		if (Alpha && (Flags & PAL_CLEAR_INVISIBLE))
+		{
+			if (First[3] == 0)
+				First[0] = First[1] = First[2] = 0;
+			if (Second[3] == 0)
+				Second[0] = Second[1] = Second[2] = 0;
+		}
+	}
+}
@@ -0,0 +1,24 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+// PS2 CLUT layout: in every block of 32 entries, entries 8-15 and 16-23 are swapped.
+// This is the same as flipping bits 3 and 4 of the index when they are different
+#define PAL_SWIZZLE_INDEX(I)	((I) ^ (((((I) >> 3) ^ ((I) >> 4)) & 1) * 0x18))
+
+// Palette transcode flags
+#define PAL_SWIZZLE				0x01	// Swap CLUT entries (linear <-> PS2 layout, works both ways)
+#define PAL_COLOR_MUL			0x02	// Multiply color channels by 2 (PS2 -> PC)
+#define PAL_COLOR_DIV			0x04	// Divide color channels by 2 (PC -> PS2)
+#define PAL_ALPHA_MUL			0x08	// Multiply alpha by 2
+#define PAL_ALPHA_DIV			0x10	// Divide alpha by 2
+#define PAL_ALPHA_PS2			0x20	// Alpha follows PS2 rules (0x80 - opaque): clamp to 0x7F before multiplication, 0x7F -> 0x80 after division
+#define PAL_CLEAR_INVISIBLE		0x40	// Black out colors of fully transparent entries
+#define PAL_SWAP_RB				0x80	// Swap 1-st and 3-rd channels (RGB <-> BGR)
+
+// Palette functions
+void PaletteTranscode(uchar * Palette, ulong PaletteSize, uint ElementSize, uint Flags);		// Swizzle, scale and reorder channels in one pass (ElementSize: 3 - RGB, 4 - RGBA)
+
+#endif // PALETTE_H
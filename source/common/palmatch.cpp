@@ -0,0 +1,163 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains palette matcher that is used to convert RGBA colors
+// back to 8-bit palette indices (linear resize, mipmaps, etc.)
+//
+
+////////// Includes //////////
+#include <stdio.h>
+#include <string.h>
+#include "types.h"
+#include "palmatch.h"
+
+bool sPaletteMatcher::Init(const uchar * Palette, ulong PaletteSize)
+{
+	// Full RGBA palette is told apart by size, other ones are taken as RGB
+	// (cut palettes come from "PLTE" chunk)
+	if (PaletteSize == PALMATCH_COLORS * 4 || PaletteSize % 3 != 0)
+		return Init(Palette, PaletteSize, 4);
+	return Init(Palette, PaletteSize, 3);
+}
+
+bool sPaletteMatcher::Init(const uchar * Palette, ulong PaletteSize, uint PaletteElementSize)
+{
+	ulong EntryCount;
+
+	// Check palette
+	if (Palette == NULL || (PaletteElementSize != 3 && PaletteElementSize != 4) ||
+		PaletteSize == 0 || PaletteSize % PaletteElementSize != 0 || PaletteSize / PaletteElementSize > PALMATCH_COLORS)
+		return false;
+	ElementSize = PaletteElementSize;
+	EntryCount = PaletteSize / ElementSize;
+
+	// Copy palette, alpha is cleared for RGB palette. Cut palette is completed
+	// with copies of the first entry (lowest index wins, so they are never found)
+	memset(Colors, 0x00, sizeof(Colors));
+	for (uint e = 0; e < EntryCount; e++)
+		memcpy(Colors[e], &Palette[e * ElementSize], ElementSize);
+	for (uint e = EntryCount; e < PALMATCH_COLORS; e++)
+		memcpy(Colors[e], Colors[0], 4);
+
+	// Sort indices by red channel (counting sort keeps equal entries in index order)
+	uint Count[PALMATCH_COLORS + 1];
+	memset(Count, 0x00, sizeof(Count));
+	for (uint e = 0; e < PALMATCH_COLORS; e++)
+		Count[Colors[e][0] + 1]++;
+	for (uint v = 0; v < PALMATCH_COLORS; v++)
+		Count[v + 1] += Count[v];
+	for (uint e = 0; e < PALMATCH_COLORS; e++)
+	{
+		uint Pos = Count[Colors[e][0]]++;
+		Order[Pos] = e;
+		SortedR[Pos] = Colors[e][0];
+	}
+
+	// Clear cache
+	memset(CacheUsed, 0x00, sizeof(CacheUsed));
+
+	return true;
+}
+
+uchar sPaletteMatcher::Find(uchar R, uchar G, uchar B, uchar A)
+{
+	// Erase alpha if not RGBA
+	if (ElementSize == 3)
+		A = 0;
+
+	// Look up cache
+	ulong Key = R | (G << 8) | (B << 16) | ((ulong)A << 24);
+	ulong Slot = (Key ^ (Key >> 11) ^ (Key >> 22)) & (PALMATCH_CACHE_SIZE - 1);
+	if (CacheUsed[Slot] && CacheKey[Slot] == Key)
+		return CacheIndex[Slot];
+
+	// Search and remember result
+	uchar Result = Search(R, G, B, A);
+	CacheKey[Slot] = Key;
+	CacheIndex[Slot] = Result;
+	CacheUsed[Slot] = 1;
+
+	return Result;
+}
+
+uchar sPaletteMatcher::Search(uchar R, uchar G, uchar B, uchar A)
+{
+	short MinDelta = 0x7FFF;
+	uchar Index = PALMATCH_NO_MATCH;
+
+	// Find first entry with red channel >= R
+	int Hi = 0;
+	int Lo = PALMATCH_COLORS;
+	while (Hi < Lo)
+	{
+		int Mid = (Hi + Lo) / 2;
+		if (SortedR[Mid] < R)
+			Hi = Mid + 1;
+		else
+			Lo = Mid;
+	}
+	Lo = Hi - 1;
+
+	// Walk in both directions while red delta alone doesn't exceed best delta.
+	// Entries with equal delta are compared by index to get the same result as full scan
+	while (Lo >= 0 || Hi < PALMATCH_COLORS)
+	{
+		for (int Side = 0; Side < 2; Side++)
+		{
+			int Pos;
+			short DeltaR;
+			if (Side == 0)
+			{
+				if (Hi >= PALMATCH_COLORS)
+					continue;
+				Pos = Hi;
+				DeltaR = SortedR[Pos] - R;
+			}
+			else
+			{
+				if (Lo < 0)
+					continue;
+				Pos = Lo;
+				DeltaR = R - SortedR[Pos];
+			}
+
+			// Rest of this side is too far
+			if (DeltaR > MinDelta)
+			{
+				if (Side == 0)
+					Hi = PALMATCH_COLORS;
+				else
+					Lo = -1;
+				continue;
+			}
+
+			// Compare remaining channels
+			uchar e = Order[Pos];
+			short Delta = DeltaR;
+			short Current;
+			Current = Colors[e][1] > G ? Colors[e][1] - G : G - Colors[e][1];
+			if (Delta < Current)
+				Delta = Current;
+			Current = Colors[e][2] > B ? Colors[e][2] - B : B - Colors[e][2];
+			if (Delta < Current)
+				Delta = Current;
+			Current = Colors[e][3] > A ? Colors[e][3] - A : A - Colors[e][3];
+			if (Delta < Current)
+				Delta = Current;
+
+			if (Delta < MinDelta || (Delta == MinDelta && e < Index))
+			{
+				MinDelta = Delta;
+				Index = e;
+			}
+
+			if (Side == 0)
+				Hi++;
+			else
+				Lo--;
+		}
+	}
+
+	return Index;
+}
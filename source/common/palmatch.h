@@ -0,0 +1,33 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+#ifndef PALMATCH_H
+#define PALMATCH_H
+
+#define PALMATCH_COLORS		256		// Entries in 8-bit palette
+#define PALMATCH_CACHE_SIZE	4096	// Entries in color cache (must be power of 2)
+#define PALMATCH_NO_MATCH	0xFF	// Index returned when palette is unusable
+
+// Palette matcher: finds closest palette entry for RGBA color.
+// Result is the same as with full scan of the palette (biggest channel
+// delta is minimized, lowest index wins), but palette is sorted by red
+// channel once so only entries within current best delta are checked,
+// and already matched colors are taken from cache
+#pragma pack(1)
+struct sPaletteMatcher
+{
+	uchar Colors[PALMATCH_COLORS][4];			// Palette entries in RGBA (alpha = 0 for RGB palette)
+	uchar Order[PALMATCH_COLORS];				// Palette indices sorted by red channel
+	uchar SortedR[PALMATCH_COLORS];				// Red channel values in sorted order
+	uint ElementSize;							// Palette element size: 3 - RGB, 4 - RGBA
+	ulong CacheKey[PALMATCH_CACHE_SIZE];		// Cached colors
+	uchar CacheIndex[PALMATCH_CACHE_SIZE];		// Cached results
+	uchar CacheUsed[PALMATCH_CACHE_SIZE];		// Cache slot is filled
+
+	bool Init(const uchar * Palette, ulong PaletteSize);		// Prepare matcher for RGB or 0x400 (RGBA) palette
+	bool Init(const uchar * Palette, ulong PaletteSize, uint PaletteElementSize);	// Prepare matcher for palette of up to 256 entries (3 - RGB, 4 - RGBA)
+	uchar Find(uchar R, uchar G, uchar B, uchar A);				// Find closest palette index
+	uchar Search(uchar R, uchar G, uchar B, uchar A);			// Find closest palette index without cache
+};
+
+#endif // PALMATCH_H
@@ -443,14 +443,20 @@ sPNGData * PNGReadPalette(FILE ** ptrFile)
 {
 	sPNGData * RGBPalette;
 	sPNGData * Alpha;
-	
+
+	// Read palette and alpha
+	RGBPalette = PNGReadChunk(ptrFile, "PLTE");
+	Alpha = PNGReadChunk(ptrFile, "tRNS");
+
+	return PNGMergePalette(RGBPalette, Alpha);
+}
+
+sPNGData * PNGMergePalette(sPNGData * RGBPalette, sPNGData * Alpha)		// Merge "PLTE" and "tRNS" data into 256 color RGBA palette (input is freed)
+{
 	uchar * FullRGBPalette;
 	uchar * FullAlpha;
 	sPNGData * RGBAPalette;
 
-	// Read palette
-	RGBPalette = PNGReadChunk(ptrFile, "PLTE");
-	
 	// Check if palette is not present
 	if (RGBPalette->Data == NULL)
 	{
@@ -483,9 +489,6 @@ sPNGData * PNGReadPalette(FILE ** ptrFile)
 		}
 	}
 
-	// Read alpha
-	Alpha = PNGReadChunk(ptrFile, "tRNS");
-
 	// Check if alpha is not present
 	if (Alpha->Data == NULL)
 	{
@@ -557,7 +560,9 @@ sPNGData * PNGReadPalette(FILE ** ptrFile)
 	}
 
 	// Free memory
+	free(RGBPalette->Data);
 	free(RGBPalette);
+	free(Alpha->Data);
 	free(Alpha);
 
 	// Return pointer
@@ -566,18 +571,12 @@ sPNGData * PNGReadPalette(FILE ** ptrFile)
 
 sPNGData * PNGReadBitmap(FILE ** ptrFile, uint Width, uint Height, uchar BytesPerPixel, uint BitDepth)
 {
-	sPNGData * PNGImgData;
-	
-	// Allocate memory
-	PNGImgData = (sPNGData *)malloc(sizeof(sPNGData));
-	if (PNGImgData == NULL)
-	{
-		puts("Unable to allocate memory! \n");
-		exit(EXIT_FAILURE);
-	}
-
 	// Read compressed data
-	PNGImgData = PNGReadChunk(ptrFile, "IDAT");
+	return PNGDecodeBitmap(PNGReadChunk(ptrFile, "IDAT"), Width, Height, BytesPerPixel, BitDepth);
+}
+
+sPNGData * PNGDecodeBitmap(sPNGData * PNGImgData, uint Width, uint Height, uchar BytesPerPixel, uint BitDepth)	// Decompress and unfilter "IDAT" data (24 bit bitmap is converted to 32 bit)
+{
 	if (PNGImgData->Data == NULL)
 	{
 		puts("Can't read image data ... \n");
@@ -629,6 +628,92 @@ sPNGData * PNGReadBitmap(FILE ** ptrFile, uint Width, uint Height, uchar BytesPe
 	return PNGImgData;
 }
 
+bool PNGReadImage(FILE ** ptrFile, uint Width, uint Height, uchar BytesPerPixel, uint BitDepth, sPNGData ** RGBAPalette, sPNGData ** Bitmap)	// Read palette (if RGBAPalette is not NULL) and bitmap, file is read once
+{
+	const char * Markers[] = { "PLTE", "tRNS", "IDAT" };
+	sPNGData * Chunks[3];		// Data from all chunks with corresponding marker
+	uchar * FileData;
+	ulong FileDataSize;
+	ulong ChunkSize;
+
+	// Read whole file
+	FileDataSize = FileSize(ptrFile);
+	FileData = (uchar *)malloc(FileDataSize + 1);
+	if (FileData == NULL)
+	{
+		puts("Unable to allocate memory! \n");
+		exit(EXIT_FAILURE);
+	}
+	FileReadBlock(ptrFile, FileData, 0, FileDataSize);
+	for (int c = 0; c < 3; c++)
+	{
+		Chunks[c] = (sPNGData *)malloc(sizeof(sPNGData));
+		if (Chunks[c] == NULL)
+		{
+			puts("Unable to allocate memory! \n");
+			exit(EXIT_FAILURE);
+		}
+		Chunks[c]->Data = NULL;
+		Chunks[c]->DataSize = 0;
+	}
+
+	// Walk through chunks by their sizes (size, marker, data, CRC), signature is skipped
+	for (ulong Position = 8; Position + 12 <= FileDataSize; Position += 12 + ChunkSize)
+	{
+		memcpy(&ChunkSize, &FileData[Position], sizeof(ChunkSize));
+		ChunkSize = UTIL_BSWAP32(ChunkSize);
+		if (ChunkSize > FileDataSize - Position - 12)
+			ChunkSize = FileDataSize - Position - 12;
+		if (!memcmp(&FileData[Position + 4], "IEND", 4))
+			break;
+
+		for (int c = 0; c < 3; c++)
+		{
+			if (memcmp(&FileData[Position + 4], Markers[c], 4) || ChunkSize == 0)
+				continue;
+
+			Chunks[c]->Data = (uchar *)realloc(Chunks[c]->Data, Chunks[c]->DataSize + ChunkSize);
+			if (Chunks[c]->Data == NULL)
+			{
+				puts("Unable to allocate memory! \n");
+				exit(EXIT_FAILURE);
+			}
+			memcpy(Chunks[c]->Data + Chunks[c]->DataSize, &FileData[Position + 8], ChunkSize);
+			Chunks[c]->DataSize += ChunkSize;
+		}
+	}
+	free(FileData);
+
+	// Check if needed chunks are present
+	if (Chunks[2]->Data == NULL || (RGBAPalette != NULL && Chunks[0]->Data == NULL))
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			free(Chunks[c]->Data);
+			free(Chunks[c]);
+		}
+		return false;
+	}
+
+	// Palette
+	if (RGBAPalette != NULL)
+	{
+		*RGBAPalette = PNGMergePalette(Chunks[0], Chunks[1]);
+	}
+	else
+	{
+		free(Chunks[0]->Data);
+		free(Chunks[0]);
+		free(Chunks[1]->Data);
+		free(Chunks[1]);
+	}
+
+	// Bitmap
+	*Bitmap = PNGDecodeBitmap(Chunks[2], Width, Height, BytesPerPixel, BitDepth);
+
+	return true;
+}
+
 void PNGWritePalette(FILE ** ptrFile, sPNGData * RGBAPalette)
 {
 	ulong RGBPaletteSize = 0x300;
@@ -29,6 +29,9 @@ bool PNGFilter(sPNGData * InData, uint Height, uint Width, uint BytesPerPixel, u
 int PaethPredictor(int a, int b, int c);																	// Paeth predictor function
 sPNGData * PNGReadPalette(FILE ** ptrFile);																	// Read palette from PNG file
 sPNGData * PNGReadBitmap(FILE ** ptrFile, uint Width, uint Height, uchar BytesPerPixel, uint BitDepth);		// Read raw bitmap from PNG file
+sPNGData * PNGMergePalette(sPNGData * RGBPalette, sPNGData * Alpha);										// Merge "PLTE" and "tRNS" data into 256 color RGBA palette (input is freed)
+sPNGData * PNGDecodeBitmap(sPNGData * PNGImgData, uint Width, uint Height, uchar BytesPerPixel, uint BitDepth);	// Decompress and unfilter "IDAT" data (24 bit bitmap is converted to 32 bit)
+bool PNGReadImage(FILE ** ptrFile, uint Width, uint Height, uchar BytesPerPixel, uint BitDepth, sPNGData ** RGBAPalette, sPNGData ** Bitmap);	// Read palette (if RGBAPalette is not NULL) and bitmap, file is read once
 void PNGWritePalette(FILE ** ptrFile, sPNGData * RGBAPalette);												// Write palette to PNG file
 void PNGWriteBitmap(FILE ** ptrFile, uint Width, uint Height, uchar BytesPerPixel, sPNGData * RGBABitmap);	// Write bitmap to PNG file
 bool ZDecompress(uchar * InputData, ulong InputDataSize, uchar ** OutputData, ulong * OutputDataSize, ulong StartSize);	// Compress data with Zlib
@@ -0,0 +1,337 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains color quantizer that converts truecolor images to
+// 8-bit indexed ones. Palette is made by median cut over unique colors
+// (alpha is treated as 4th channel), pixels are mapped with palette matcher
+// with optional Floyd-Steinberg dithering
+//
+
+////////// Includes //////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "util.h"
+#include "types.h"
+#include "palmatch.h"
+#include "quantize.h"
+
+////////// Structures //////////
+
+// Median cut box: range of unique colors
+struct sQuantBox
+{
+	ulong Begin;		// First color
+	ulong End;			// Last color + 1
+	ulong Pixels;		// Number of pixels with colors from this box
+	uchar Channel;		// Channel with biggest range
+	uchar Range;		// Range of this channel
+};
+
+////////// Functions //////////
+static int QuantCompareColors(const void * A, const void * B);										// qsort() callback
+static ulong QuantPack(const uchar * Pixel, uint Channels);											// Pixel -> packed RGBA
+static void QuantBoxUpdate(sQuantBox * Box, const ulong * Colors, const ulong * Counts);				// Find biggest channel range
+static bool QuantBoxSplit(sQuantBox * Box, sQuantBox * NewBox, ulong * Colors, ulong * Counts, ulong * TempColors, ulong * TempCounts);	// Split box at median
+static uchar QuantClamp(int Value);																	// Clamp to 0..255
+
+///////// Code /////////
+static int QuantCompareColors(const void * A, const void * B)
+{
+	ulong ColorA = *(const ulong *)A;
+	ulong ColorB = *(const ulong *)B;
+
+	if (ColorA < ColorB)
+		return -1;
+	if (ColorA > ColorB)
+		return 1;
+	return 0;
+}
+
+static ulong QuantPack(const uchar * Pixel, uint Channels)
+{
+	uchar A = Channels == 4 ? Pixel[3] : 0xFF;
+
+	// All fully transparent pixels are the same color
+	if (A == 0)
+		return 0;
+
+	return Pixel[0] | (Pixel[1] << 8) | (Pixel[2] << 16) | ((ulong)A << 24);
+}
+
+static uchar QuantClamp(int Value)
+{
+	if (Value < 0)
+		return 0;
+	if (Value > 0xFF)
+		return 0xFF;
+	return (uchar)Value;
+}
+
+static void QuantBoxUpdate(sQuantBox * Box, const ulong * Colors, const ulong * Counts)
+{
+	uchar Min[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+	uchar Max[4] = {0, 0, 0, 0};
+
+	Box->Pixels = 0;
+	for (ulong i = Box->Begin; i < Box->End; i++)
+	{
+		for (uint c = 0; c < 4; c++)
+		{
+			uchar Value = (Colors[i] >> (c * 8)) & 0xFF;
+			if (Value < Min[c])
+				Min[c] = Value;
+			if (Value > Max[c])
+				Max[c] = Value;
+		}
+		Box->Pixels += Counts[i];
+	}
+
+	Box->Channel = 0;
+	Box->Range = 0;
+	for (uint c = 0; c < 4; c++)
+	{
+		if (Max[c] - Min[c] > Box->Range)
+		{
+			Box->Channel = c;
+			Box->Range = Max[c] - Min[c];
+		}
+	}
+}
+
+static bool QuantBoxSplit(sQuantBox * Box, sQuantBox * NewBox, ulong * Colors, ulong * Counts, ulong * TempColors, ulong * TempCounts)
+{
+	ulong Histogram[257];
+	uint Shift = Box->Channel * 8;
+
+	if (Box->Range == 0)
+		return false;
+
+	// Sort colors by selected channel (counting sort)
+	memset(Histogram, 0x00, sizeof(Histogram));
+	for (ulong i = Box->Begin; i < Box->End; i++)
+		Histogram[((Colors[i] >> Shift) & 0xFF) + 1]++;
+	for (uint v = 0; v < 256; v++)
+		Histogram[v + 1] += Histogram[v];
+	for (ulong i = Box->Begin; i < Box->End; i++)
+	{
+		ulong Pos = Box->Begin + Histogram[(Colors[i] >> Shift) & 0xFF]++;
+		TempColors[Pos] = Colors[i];
+		TempCounts[Pos] = Counts[i];
+	}
+	memcpy(&Colors[Box->Begin], &TempColors[Box->Begin], (Box->End - Box->Begin) * sizeof(ulong));
+	memcpy(&Counts[Box->Begin], &TempCounts[Box->Begin], (Box->End - Box->Begin) * sizeof(ulong));
+
+	// Find median by pixel count
+	ulong Half = Box->Pixels / 2;
+	ulong Sum = 0;
+	ulong Split = Box->Begin + 1;
+	for (ulong i = Box->Begin; i < Box->End - 1; i++)
+	{
+		Sum += Counts[i];
+		if (Sum >= Half)
+		{
+			Split = i + 1;
+			break;
+		}
+	}
+
+	// Move split point to the nearest channel value change
+	ulong Up = Split;
+	while (Up < Box->End && ((Colors[Up] ^ Colors[Up - 1]) >> Shift & 0xFF) == 0)
+		Up++;
+	ulong Down = Split;
+	while (Down > Box->Begin && ((Colors[Down] ^ Colors[Down - 1]) >> Shift & 0xFF) == 0)
+		Down--;
+
+	if (Down == Box->Begin || (Up < Box->End && Up - Split <= Split - Down))
+		Split = Up;
+	else
+		Split = Down;
+
+	// Update boxes
+	NewBox->Begin = Split;
+	NewBox->End = Box->End;
+	Box->End = Split;
+	QuantBoxUpdate(Box, Colors, Counts);
+	QuantBoxUpdate(NewBox, Colors, Counts);
+
+	return true;
+}
+
+bool QuantizeBitmap(const uchar * Src, uint Width, uint Height, uint Channels, uchar * RGBAPalette, uchar * Bitmap, bool Dither)
+{
+	ulong Pixels = Width * Height;
+	ulong * Colors;
+	ulong * Counts;
+	ulong * TempColors;
+	ulong * TempCounts;
+	ulong ColorCount;
+	sQuantBox Boxes[QUANT_COLORS];
+	uint BoxCount;
+
+	if (Channels != 3 && Channels != 4)
+		UTIL_ERR("unsupported bitmap format", return false);
+	if (Pixels == 0)
+		return false;
+
+	UTIL_MALLOC(ulong *, Colors, Pixels * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Counts, Pixels * sizeof(ulong), exit(EXIT_FAILURE));
+
+	// Get unique colors
+	for (ulong i = 0; i < Pixels; i++)
+		Colors[i] = QuantPack(&Src[i * Channels], Channels);
+	qsort(Colors, Pixels, sizeof(ulong), QuantCompareColors);
+	ColorCount = 0;
+	for (ulong i = 0; i < Pixels; i++)
+	{
+		if (ColorCount > 0 && Colors[ColorCount - 1] == Colors[i])
+		{
+			Counts[ColorCount - 1]++;
+		}
+		else
+		{
+			Colors[ColorCount] = Colors[i];
+			Counts[ColorCount] = 1;
+			ColorCount++;
+		}
+	}
+
+	// Median cut: split box with biggest error estimate until palette is full
+	UTIL_MALLOC(ulong *, TempColors, ColorCount * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, TempCounts, ColorCount * sizeof(ulong), exit(EXIT_FAILURE));
+	Boxes[0].Begin = 0;
+	Boxes[0].End = ColorCount;
+	QuantBoxUpdate(&Boxes[0], Colors, Counts);
+	BoxCount = 1;
+	while (BoxCount < QUANT_COLORS)
+	{
+		int Best = -1;
+		double BestScore = 0;
+		for (uint b = 0; b < BoxCount; b++)
+		{
+			double Score = (double)Boxes[b].Range * Boxes[b].Range * Boxes[b].Pixels;
+			if (Boxes[b].Range > 0 && Score > BestScore)
+			{
+				Best = b;
+				BestScore = Score;
+			}
+		}
+		if (Best == -1)
+			break;		// Every box has single color
+
+		QuantBoxSplit(&Boxes[Best], &Boxes[BoxCount], Colors, Counts, TempColors, TempCounts);
+		BoxCount++;
+	}
+
+	// Palette entry = average color of the box
+	memset(RGBAPalette, 0x00, QUANT_COLORS * 4);
+	for (uint b = 0; b < BoxCount; b++)
+	{
+		double Sum[4] = {0, 0, 0, 0};
+		for (ulong i = Boxes[b].Begin; i < Boxes[b].End; i++)
+			for (uint c = 0; c < 4; c++)
+				Sum[c] += (double)((Colors[i] >> (c * 8)) & 0xFF) * Counts[i];
+		for (uint c = 0; c < 4; c++)
+			RGBAPalette[b * 4 + c] = (uchar)floor(Sum[c] / Boxes[b].Pixels + 0.5);
+	}
+	for (uint b = BoxCount; b < QUANT_COLORS; b++)		// Unused entries are copies of the first one
+		memcpy(&RGBAPalette[b * 4], RGBAPalette, 4);
+
+	free(TempCounts);
+	free(TempColors);
+	free(Counts);
+	free(Colors);
+
+	// Map pixels
+	sPaletteMatcher * Matcher;
+	UTIL_MALLOC(sPaletteMatcher *, Matcher, sizeof(sPaletteMatcher), exit(EXIT_FAILURE));
+	Matcher->Init(RGBAPalette, QUANT_COLORS * 4, 4);
+
+	if (Dither == false)
+	{
+		for (ulong i = 0; i < Pixels; i++)
+		{
+			ulong Color = QuantPack(&Src[i * Channels], Channels);
+			Bitmap[i] = Matcher->Find(Color & 0xFF, (Color >> 8) & 0xFF, (Color >> 16) & 0xFF, (Color >> 24) & 0xFF);
+		}
+	}
+	else
+	{
+		// Floyd-Steinberg: error of RGB channels is spread to neighbour pixels,
+		// alpha is not dithered and fully transparent pixels don't spread error
+		int * Error;
+		UTIL_CALLOC(int *, Error, (Width + 2) * 3 * 2, sizeof(int), exit(EXIT_FAILURE));
+		int * ErrCur = Error;
+		int * ErrNext = Error + (Width + 2) * 3;
+
+		for (uint y = 0; y < Height; y++)
+		{
+			memset(ErrNext, 0x00, (Width + 2) * 3 * sizeof(int));
+			for (uint x = 0; x < Width; x++)
+			{
+				ulong i = y * Width + x;
+				ulong Color = QuantPack(&Src[i * Channels], Channels);
+				uchar A = (Color >> 24) & 0xFF;
+
+				if (A == 0)
+				{
+					Bitmap[i] = Matcher->Find(0, 0, 0, 0);
+					continue;
+				}
+
+				int Wanted[3];
+				for (uint c = 0; c < 3; c++)
+					Wanted[c] = QuantClamp(((Color >> (c * 8)) & 0xFF) + ErrCur[(x + 1) * 3 + c] / 16);
+
+				uchar Index = Matcher->Find(Wanted[0], Wanted[1], Wanted[2], A);
+				Bitmap[i] = Index;
+
+				for (uint c = 0; c < 3; c++)
+				{
+					int Delta = Wanted[c] - RGBAPalette[Index * 4 + c];
+					ErrCur[(x + 2) * 3 + c] += Delta * 7;
+					ErrNext[x * 3 + c] += Delta * 3;
+					ErrNext[(x + 1) * 3 + c] += Delta * 5;
+					ErrNext[(x + 2) * 3 + c] += Delta;
+				}
+			}
+
+			int * Swap = ErrCur;
+			ErrCur = ErrNext;
+			ErrNext = Swap;
+		}
+
+		free(Error);
+	}
+
+	free(Matcher);
+
+	return true;
+}
+
+double QuantizePSNR(const uchar * Src, uint Width, uint Height, uint Channels, const uchar * RGBAPalette, const uchar * Bitmap)
+{
+	ulong Pixels = Width * Height;
+	double Error = 0;
+
+	for (ulong i = 0; i < Pixels; i++)
+	{
+		// Compare packed colors, so RGB of transparent pixels is ignored
+		ulong Color = QuantPack(&Src[i * Channels], Channels);
+		const uchar * Entry = &RGBAPalette[Bitmap[i] * 4];
+		for (uint c = 0; c < Channels; c++)
+		{
+			double Delta = (double)((Color >> (c * 8)) & 0xFF) - Entry[c];
+			Error += Delta * Delta;
+		}
+	}
+
+	if (Error == 0 || Pixels == 0)
+		return QUANT_PSNR_LOSSLESS;
+
+	double MSE = Error / ((double)Pixels * Channels);
+	return 10.0 * log10(255.0 * 255.0 / MSE);
+}
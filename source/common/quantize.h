@@ -0,0 +1,14 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+#define QUANT_COLORS		256			// Palette entries
+#define QUANT_PSNR_LOSSLESS	-1.0		// QuantizePSNR() result for identical images
+
+// Quantizer functions
+bool QuantizeBitmap(const uchar * Src, uint Width, uint Height, uint Channels, uchar * RGBAPalette, uchar * Bitmap, bool Dither);			// 24/32-bit bitmap -> 8-bit indexed bitmap + 256 color RGBA palette (median cut)
+double QuantizePSNR(const uchar * Src, uint Width, uint Height, uint Channels, const uchar * RGBAPalette, const uchar * Bitmap);			// Compare quantized bitmap with source, returns PSNR in dB
+
+#endif // QUANTIZE_H
@@ -0,0 +1,317 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains bitmap resampler: per-axis index/weight tables are built
+// once, then image is filtered horizontally and vertically with fixed point math
+//
+
+////////// Includes //////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "util.h"
+#include "types.h"
+#include "resample.h"
+
+////////// Defines //////////
+#define LANCZOS_LOBES 3
+
+////////// Functions //////////
+static double LanczosWeight(double x);														// Lanczos kernel
+static uchar ResampleClamp(int Sum);														// Convert fixed point sum to 8-bit value
+static void ResamplePass(const uchar * Src, uchar * Dst, uint Count, uint SrcStep, uint DstStep, uint SrcPixStep, uint Channels, sResampleTable * Table);	// Filter along one axis
+
+uint * ResampleNearestTable(uint OldSize, uint NewSize)
+{
+	uint * Table;
+
+	UTIL_MALLOC(uint *, Table, sizeof(uint) * NewSize, return NULL);
+
+	// Mapping is the same as in old per-pixel code: first and last pixels are kept in place
+	for (uint n = 0; n < NewSize; n++)
+	{
+		if (NewSize == 1)
+			Table[n] = 0;
+		else
+			Table[n] = (uint)round((double)n / (NewSize - 1) * (OldSize - 1));
+	}
+
+	return Table;
+}
+
+static double LanczosWeight(double x)
+{
+	if (x < 0)
+		x = -x;
+	if (x < 1e-8)
+		return 1.0;
+	if (x >= LANCZOS_LOBES)
+		return 0.0;
+
+	double PiX = M_PI * x;
+	return LANCZOS_LOBES * sin(PiX) * sin(PiX / LANCZOS_LOBES) / (PiX * PiX);
+}
+
+bool sResampleTable::Build(uint OldSize, uint NewSize, int Filter)
+{
+	double Scale = (double)OldSize / (double)NewSize;
+	double Support = 0;
+
+	Index = NULL;
+	Weight = NULL;
+	Size = NewSize;
+
+	if (OldSize == 0 || NewSize == 0)
+		return false;
+
+	// Find how many source pixels contribute to one destination pixel
+	switch (Filter)
+	{
+	case RESAMPLE_NEAREST:
+		Taps = 1;
+		break;
+	case RESAMPLE_BILINEAR:
+		Taps = 2;
+		break;
+	case RESAMPLE_BOX:
+		Taps = (uint)ceil(Scale) + 1;
+		break;
+	case RESAMPLE_LANCZOS:
+		Support = LANCZOS_LOBES * (Scale > 1.0 ? Scale : 1.0);
+		Taps = (uint)ceil(Support) * 2 + 1;
+		break;
+	default:
+		UTIL_ERR("unknown filter", return false);
+	}
+
+	// Allocate table
+	UTIL_CALLOC(uint *, Index, Size * Taps, sizeof(uint), return false);
+	UTIL_CALLOC(int *, Weight, Size * Taps, sizeof(int), Free(); return false);
+	double * Temp;
+	UTIL_MALLOC(double *, Temp, sizeof(double) * Taps, Free(); return false);
+
+	for (uint n = 0; n < Size; n++)
+	{
+		uint * pIndex = &Index[n * Taps];
+		int * pWeight = &Weight[n * Taps];
+		int First = 0;
+
+		memset(Temp, 0x00, sizeof(double) * Taps);
+
+		if (Filter == RESAMPLE_NEAREST)
+		{
+			if (Size == 1)
+				First = 0;
+			else
+				First = (int)round((double)n / (Size - 1) * (OldSize - 1));
+			Temp[0] = 1.0;
+		}
+		else if (Filter == RESAMPLE_BILINEAR)
+		{
+			// Same sample positions as in phdtool's BilinearPixel()
+			float PxSz = (float)OldSize / (float)Size;
+			float Coord = PxSz * ((float)n + 0.5) - 0.5;
+			if (Coord > OldSize - 1)
+				Coord = OldSize - 1;
+			else if (Coord < 0)
+				Coord = 0;
+
+			float Int;
+			float Ratio = modff(Coord, &Int);
+			First = (int)Int;
+			Temp[0] = 1.0 - Ratio;
+			Temp[1] = Ratio;
+		}
+		else if (Filter == RESAMPLE_BOX)
+		{
+			// Weight = part of source pixel covered by destination pixel
+			double Start = n * Scale;
+			double End = (n + 1) * Scale;
+			First = (int)floor(Start);
+			for (uint t = 0; t < Taps; t++)
+			{
+				double Left = First + t;
+				double Right = Left + 1.0;
+				if (Left < Start)
+					Left = Start;
+				if (Right > End)
+					Right = End;
+				if (Right > Left)
+					Temp[t] = Right - Left;
+			}
+		}
+		else if (Filter == RESAMPLE_LANCZOS)
+		{
+			double Stretch = Scale > 1.0 ? Scale : 1.0;
+			double Center = (n + 0.5) * Scale;
+			First = (int)floor(Center - Support);
+			for (uint t = 0; t < Taps; t++)
+				Temp[t] = LanczosWeight((First + t + 0.5 - Center) / Stretch);
+		}
+
+		// Normalize and convert weights to fixed point
+		double Sum = 0;
+		for (uint t = 0; t < Taps; t++)
+			Sum += Temp[t];
+		if (Sum == 0)
+		{
+			Temp[0] = 1.0;
+			Sum = 1.0;
+		}
+
+		int FixedSum = 0;
+		uint Biggest = 0;
+		for (uint t = 0; t < Taps; t++)
+		{
+			int Src = First + t;
+			if (Src < 0)
+				Src = 0;
+			else if (Src > (int)OldSize - 1)
+				Src = OldSize - 1;
+
+			pIndex[t] = Src;
+			pWeight[t] = (int)floor(Temp[t] / Sum * RESAMPLE_ONE + 0.5);
+			FixedSum += pWeight[t];
+			if (pWeight[t] > pWeight[Biggest])
+				Biggest = t;
+		}
+
+		// Rounding error goes to the biggest weight
+		pWeight[Biggest] += RESAMPLE_ONE - FixedSum;
+	}
+
+	free(Temp);
+
+	return true;
+}
+
+void sResampleTable::Free()
+{
+	free(Index);
+	free(Weight);
+	Index = NULL;
+	Weight = NULL;
+}
+
+static uchar ResampleClamp(int Sum)
+{
+	if (Sum <= 0)
+		return 0;
+
+	Sum = (Sum + RESAMPLE_ONE / 2) >> RESAMPLE_FRAC_BITS;
+	if (Sum > 0xFF)
+		return 0xFF;
+
+	return (uchar)Sum;
+}
+
+// Args:
+// Src, Dst - first line of source and destination
+// Count - number of lines
+// SrcStep, DstStep - distance between lines (in bytes)
+// SrcPixStep - distance between neighbour source pixels along filtered axis (in bytes)
+// Channels - bytes per pixel
+// Table - table for filtered axis
+static void ResamplePass(const uchar * Src, uchar * Dst, uint Count, uint SrcStep, uint DstStep, uint SrcPixStep, uint Channels, sResampleTable * Table)
+{
+	for (uint Line = 0; Line < Count; Line++)
+	{
+		const uchar * pSrc = Src + Line * SrcStep;
+		uchar * pDst = Dst + Line * DstStep;
+
+		const uint * pIndex = Table->Index;
+		const int * pWeight = Table->Weight;
+		for (uint n = 0; n < Table->Size; n++)
+		{
+			for (uint c = 0; c < Channels; c++)
+			{
+				int Sum = 0;
+				for (uint t = 0; t < Table->Taps; t++)
+					Sum += pWeight[t] * pSrc[pIndex[t] * SrcPixStep + c];
+				*pDst++ = ResampleClamp(Sum);
+			}
+
+			pIndex += Table->Taps;
+			pWeight += Table->Taps;
+		}
+	}
+}
+
+bool ResampleBitmap(const uchar * Src, uint OldWidth, uint OldHeight, uchar * Dst, uint NewWidth, uint NewHeight, uint Channels, int Filter)
+{
+	// Nearest - just copy pixels using index tables
+	if (Filter == RESAMPLE_NEAREST)
+	{
+		uint * TableX = ResampleNearestTable(OldWidth, NewWidth);
+		uint * TableY = ResampleNearestTable(OldHeight, NewHeight);
+		if (TableX == NULL || TableY == NULL)
+		{
+			free(TableX);
+			free(TableY);
+			return false;
+		}
+
+		uchar * pDst = Dst;
+		for (uint y = 0; y < NewHeight; y++)
+		{
+			const uchar * pRow = Src + TableY[y] * OldWidth * Channels;
+			if (Channels == 1)
+			{
+				for (uint x = 0; x < NewWidth; x++)
+					*pDst++ = pRow[TableX[x]];
+			}
+			else
+			{
+				for (uint x = 0; x < NewWidth; x++)
+				{
+					memcpy(pDst, &pRow[TableX[x] * Channels], Channels);
+					pDst += Channels;
+				}
+			}
+		}
+
+		free(TableX);
+		free(TableY);
+		return true;
+	}
+
+	// Other filters - horizontal pass to temporary bitmap, then vertical pass
+	sResampleTable TableX, TableY;
+	if (TableX.Build(OldWidth, NewWidth, Filter) == false)
+		return false;
+	if (TableY.Build(OldHeight, NewHeight, Filter) == false)
+	{
+		TableX.Free();
+		return false;
+	}
+
+	uchar * Temp;
+	UTIL_MALLOC(uchar *, Temp, NewWidth * OldHeight * Channels, TableX.Free(); TableY.Free(); return false);
+
+	ResamplePass(Src, Temp, OldHeight, OldWidth * Channels, NewWidth * Channels, Channels, Channels, &TableX);
+
+	// Vertical pass: every destination column is filtered as a line
+	uint RowSize = NewWidth * Channels;
+	for (uint y = 0; y < NewHeight; y++)
+	{
+		const uint * pIndex = &TableY.Index[y * TableY.Taps];
+		const int * pWeight = &TableY.Weight[y * TableY.Taps];
+		uchar * pDst = Dst + y * RowSize;
+
+		for (uint i = 0; i < RowSize; i++)
+		{
+			int Sum = 0;
+			for (uint t = 0; t < TableY.Taps; t++)
+				Sum += pWeight[t] * Temp[pIndex[t] * RowSize + i];
+			pDst[i] = ResampleClamp(Sum);
+		}
+	}
+
+	free(Temp);
+	TableX.Free();
+	TableY.Free();
+
+	return true;
+}
@@ -0,0 +1,33 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+// Filters
+#define RESAMPLE_NEAREST	0		// Nearest pixel (same mapping as old per-pixel resize code)
+#define RESAMPLE_BILINEAR	1		// Bilinear, pixel centers are aligned
+#define RESAMPLE_BOX		2		// Box (area average), good for downscaling
+#define RESAMPLE_LANCZOS	3		// Lanczos (3 lobes)
+
+// Fixed point weights
+#define RESAMPLE_FRAC_BITS	16
+#define RESAMPLE_ONE		(1 << RESAMPLE_FRAC_BITS)
+
+// Per-axis resample table: source indices and weights for each destination pixel
+struct sResampleTable
+{
+	uint Size;			// Destination size
+	uint Taps;			// Source pixels per destination pixel
+	uint * Index;		// Source indices [Size * Taps]
+	int * Weight;		// Fixed point weights [Size * Taps], sum of weights for each pixel = RESAMPLE_ONE
+
+	bool Build(uint OldSize, uint NewSize, int Filter);		// Fill table for specified filter
+	void Free();											// Free table memory
+};
+
+// Resample functions
+uint * ResampleNearestTable(uint OldSize, uint NewSize);																				// Get source index for each destination pixel (nearest)
+bool ResampleBitmap(const uchar * Src, uint OldWidth, uint OldHeight, uchar * Dst, uint NewWidth, uint NewHeight, uint Channels, int Filter);	// Resize 8-bit per channel bitmap
+
+#endif // RESAMPLE_H
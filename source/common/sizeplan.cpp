@@ -0,0 +1,103 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains stored size planner for images that are upscaled by game
+// at draw time (sprite frames, decals). Every candidate size is rated by error
+// of downscaling image and upscaling it back, then levels are lowered one by one
+// where error grows least per saved byte until set fits into byte budget
+//
+
+////////// Includes //////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util.h"
+#include "types.h"
+#include "resample.h"
+#include "sizeplan.h"
+
+////////// Defines //////////
+#define PLAN_WEIGHT_R 0.299		// Luma weights (BT.601), alpha is weighted as luma
+#define PLAN_WEIGHT_G 0.587
+#define PLAN_WEIGHT_B 0.114
+#define PLAN_WEIGHT_A 1.0
+
+////////// Code //////////
+double PlanImageError(const uchar * RGBA, uint Width, uint Height, uint StoredWidth, uint StoredHeight)
+{
+	uchar * Stored;
+	uchar * Restored;
+	double Error = 0;
+
+	if (StoredWidth >= Width && StoredHeight >= Height)
+		return 0;
+
+	UTIL_MALLOC(uchar *, Stored, StoredWidth * StoredHeight * 4, exit(EXIT_FAILURE));
+	UTIL_MALLOC(uchar *, Restored, Width * Height * 4, exit(EXIT_FAILURE));
+	if (ResampleBitmap(RGBA, Width, Height, Stored, StoredWidth, StoredHeight, 4, RESAMPLE_BOX) == false ||
+		ResampleBitmap(Stored, StoredWidth, StoredHeight, Restored, Width, Height, 4, RESAMPLE_BILINEAR) == false)
+	{
+		UTIL_WAIT_KEY("Unable to resize bitmap ...");
+		exit(EXIT_FAILURE);
+	}
+
+	// Colors are compared premultiplied, so changes of transparent pixels don't count
+	for (ulong i = 0; i < Width * Height * 4; i += 4)
+	{
+		double DR = (RGBA[i + 0] * RGBA[i + 3] - Restored[i + 0] * Restored[i + 3]) / 255.0;
+		double DG = (RGBA[i + 1] * RGBA[i + 3] - Restored[i + 1] * Restored[i + 3]) / 255.0;
+		double DB = (RGBA[i + 2] * RGBA[i + 3] - Restored[i + 2] * Restored[i + 3]) / 255.0;
+		double DA = RGBA[i + 3] - Restored[i + 3];
+
+		Error += PLAN_WEIGHT_R * DR * DR + PLAN_WEIGHT_G * DG * DG + PLAN_WEIGHT_B * DB * DB + PLAN_WEIGHT_A * DA * DA;
+	}
+
+	free(Stored);
+	free(Restored);
+
+	return Error / (255.0 * 255.0);
+}
+
+bool PlanBudget(sPlanAsset * Assets, uint Count, ulong Budget, ulong * Total)
+{
+	ulong Sum = 0;
+
+	for (uint i = 0; i < Count; i++)
+	{
+		Assets[i].Level = 0;
+		Sum += Assets[i].Size[0];
+	}
+
+	// Lower level of asset with smallest error growth per saved byte
+	while (Sum > Budget)
+	{
+		int Best = -1;
+		double BestCost = 0;
+
+		for (uint i = 0; i < Count; i++)
+		{
+			sPlanAsset * Asset = &Assets[i];
+
+			if (Asset->Level + 1 >= Asset->LevelCount || Asset->Size[Asset->Level + 1] >= Asset->Size[Asset->Level])
+				continue;
+
+			double Cost = (Asset->Error[Asset->Level + 1] - Asset->Error[Asset->Level]) / (double)(Asset->Size[Asset->Level] - Asset->Size[Asset->Level + 1]);
+			if (Best == -1 || Cost < BestCost)
+			{
+				Best = i;
+				BestCost = Cost;
+			}
+		}
+		if (Best == -1)
+			break;
+
+		Sum -= Assets[Best].Size[Assets[Best].Level] - Assets[Best].Size[Assets[Best].Level + 1];
+		Assets[Best].Level++;
+	}
+
+	if (Total != NULL)
+		*Total = Sum;
+
+	return Sum <= Budget;
+}
@@ -0,0 +1,40 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+#ifndef SIZEPLAN_H
+#define SIZEPLAN_H
+
+#define PLAN_MAX_LEVELS 8		// Stored sizes per asset: proper size and up to 7 halvings
+
+// Asset of size plan. Level 0 is proper size, every next level halves stored
+// dimensions (or sampling frequency of sound), original size stays as upscale target
+#pragma pack(1)
+struct sPlanAsset
+{
+	uint LevelCount;						// How many levels can be used
+	ulong Size[PLAN_MAX_LEVELS];			// Stored bytes on every level
+	double Error[PLAN_MAX_LEVELS];			// Error on every level
+	uint Level;								// Chosen level
+
+	void Initialize()
+	{
+		LevelCount = 0;
+		Level = 0;
+	}
+
+	void AddLevel(ulong NewSize, double NewError)		// Add next level
+	{
+		if (LevelCount >= PLAN_MAX_LEVELS)
+			return;
+
+		Size[LevelCount] = NewSize;
+		Error[LevelCount] = NewError;
+		LevelCount++;
+	}
+};
+
+// Size plan functions
+double PlanImageError(const uchar * RGBA, uint Width, uint Height, uint StoredWidth, uint StoredHeight);	// Error of image stored with smaller size and upscaled back (weighted squared error sum)
+bool PlanBudget(sPlanAsset * Assets, uint Count, ulong Budget, ulong * Total);							// Pick levels with smallest error within budget (false - budget can't be reached)
+
+#endif // SIZEPLAN_H
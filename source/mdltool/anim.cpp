@@ -0,0 +1,409 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains animation data reduction for MDL -> DOL conversion:
+// every animation channel (bone position or rotation) is decoded, runs of
+// frames that stay within position/angle error are replaced with a single
+// value and the channel is encoded again. Format has no interpolation
+// between stored values, so longer runs are the only way to make the
+// run-length encoding shorter. Channels that stay near zero are dropped.
+// Only animations that are stored in the model file are reduced (sequence
+// files are left as is)
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Structures //////////
+
+// Animation data of a sequence
+struct sAnimBlock
+{
+	ulong Seq;				// Sequence index
+	ulong Offset;			// Location of animation data
+	ulong End;				// End of animation data
+};
+
+////////// Functions //////////
+static bool AnimDecode(sModel * Model, ulong Offset, ulong Frames, short * Values, ulong * End);	// Decode animation channel
+static ulong AnimReduceChannel(short * Values, ulong Frames, double Tolerance);					// Merge runs of frames (returns max error)
+static ulong AnimEncode(const short * Values, ulong Frames, uchar * Out);						// Encode animation channel (returns size)
+static int AnimCompareBlocks(const void * A, const void * B);									// qsort() callback
+
+///////// Code /////////
+static bool AnimDecode(sModel * Model, ulong Offset, ulong Frames, short * Values, ulong * End)
+{
+	ulong Frame = 0;
+
+	while (Frame < Frames)
+	{
+		if (!Model->CheckBounds(Offset, 2))
+			return false;
+
+		uchar Valid = Model->Data[Offset];
+		uchar Total = Model->Data[Offset + 1];
+		if (Valid == 0 || Total == 0 || !Model->CheckBounds(Offset + 2, Valid * sizeof(short)))
+			return false;
+
+		// Last value is repeated until the end of run
+		short * Chunk = (short *)&Model->Data[Offset + 2];
+		for (uint i = 0; i < Total && Frame < Frames; i++)
+			Values[Frame++] = Chunk[i < Valid ? i : Valid - 1];
+
+		Offset += (Valid + 1) * sizeof(short);
+	}
+	*End = Offset;
+
+	return true;
+}
+
+static ulong AnimReduceChannel(short * Values, ulong Frames, double Tolerance)
+{
+	long Limit = Tolerance < 32767 ? (long)Tolerance : 32767;
+	ulong MaxError = 0;
+
+	if (Limit < 1)
+		return 0;
+
+	// Channel that stays near zero is dropped
+	bool Zero = true;
+	for (ulong i = 0; i < Frames; i++)
+		if (labs(Values[i]) > Limit)
+			Zero = false;
+	if (Zero == true)
+	{
+		for (ulong i = 0; i < Frames; i++)
+		{
+			if ((ulong)labs(Values[i]) > MaxError)
+				MaxError = labs(Values[i]);
+			Values[i] = 0;
+		}
+		return MaxError;
+	}
+
+	// Greedy runs: difference between min and max must be within 2x limit,
+	// so middle value is within limit from every frame of the run
+	for (ulong Start = 0; Start < Frames;)
+	{
+		long Min = Values[Start];
+		long Max = Values[Start];
+		ulong Stop = Start + 1;
+
+		while (Stop < Frames)
+		{
+			long NewMin = Values[Stop] < Min ? Values[Stop] : Min;
+			long NewMax = Values[Stop] > Max ? Values[Stop] : Max;
+			if (NewMax - NewMin > 2 * Limit)
+				break;
+			Min = NewMin;
+			Max = NewMax;
+			Stop++;
+		}
+
+		short Middle = (short)(Min + (Max - Min) / 2);
+		for (ulong i = Start; i < Stop; i++)
+		{
+			if ((ulong)labs(Values[i] - Middle) > MaxError)
+				MaxError = labs(Values[i] - Middle);
+			Values[i] = Middle;
+		}
+		Start = Stop;
+	}
+
+	return MaxError;
+}
+
+static ulong AnimEncode(const short * Values, ulong Frames, uchar * Out)
+{
+	ulong Size = 0;
+	ulong Frame = 0;
+
+	while (Frame < Frames)
+	{
+		uchar * Chunk = &Out[Size];
+		uint Valid = 0;
+		uint Total = 0;
+
+		Size += 2;
+		while (Frame < Frames && Total < 255)
+		{
+			ulong Run = 1;
+			while (Frame + Run < Frames && Values[Frame + Run] == Values[Frame])
+				Run++;
+
+			*(short *)&Out[Size] = Values[Frame];
+			Size += sizeof(short);
+			Valid++;
+
+			// Repeated value closes the chunk (new chunk costs one short)
+			if (Run >= 3 || Frame + Run == Frames)
+			{
+				ulong Take = Run < 255 - Total ? Run : 255 - Total;
+				Total += Take;
+				Frame += Take;
+				break;
+			}
+			Total++;
+			Frame++;
+		}
+		Chunk[0] = Valid;
+		Chunk[1] = Total;
+	}
+
+	return Size;
+}
+
+static int AnimCompareBlocks(const void * A, const void * B)
+{
+	const sAnimBlock * BlockA = (const sAnimBlock *)A;
+	const sAnimBlock * BlockB = (const sAnimBlock *)B;
+
+	if (BlockA->Offset < BlockB->Offset)
+		return -1;
+	if (BlockA->Offset > BlockB->Offset)
+		return 1;
+	return 0;
+}
+
+ulong AnimSeqSize(sModel * Model, sModelSeq * Seq)
+{
+	ulong Structs = Seq->BlendCount * Model->Header->BoneCount;
+	ulong End = Seq->AnimOffset + Structs * sizeof(sModelAnim);
+	short * Values;
+
+	if (Seq->FrameCount <= 0 || Seq->BlendCount <= 0 || Seq->AnimOffset < (int)sizeof(sModelHeader) ||
+		!Model->CheckBounds(Seq->AnimOffset, Structs * sizeof(sModelAnim)))
+		return 0;
+
+	// Data ends with the last value of the last channel
+	UTIL_MALLOC(short *, Values, Seq->FrameCount * sizeof(short), exit(EXIT_FAILURE));
+	for (ulong i = 0; i < Structs; i++)
+	{
+		ulong Struct = Seq->AnimOffset + i * sizeof(sModelAnim);
+		sModelAnim * Anim = (sModelAnim *)&Model->Data[Struct];
+
+		for (int c = 0; c < 6; c++)
+		{
+			ulong ChannelEnd;
+
+			if (Anim->Offset[c] == 0)
+				continue;
+			if (!AnimDecode(Model, Struct + Anim->Offset[c], Seq->FrameCount, Values, &ChannelEnd))
+			{
+				free(Values);
+				return 0;
+			}
+			if (ChannelEnd > End)
+				End = ChannelEnd;
+		}
+	}
+	free(Values);
+
+	return End - Seq->AnimOffset;
+}
+
+bool AnimReduce(sModel * Model, double PosError, double AngleError)
+{
+	sModelHeader * Header = Model->Header;
+	sModelSeq * Seqs;
+	sModelBone * Bones;
+	sAnimBlock * Blocks;
+	ulong BlockCount = 0;
+	ulong Begin, End;
+	ulong MaxFrames = 0;
+	ulong MaxSize = 0;
+
+	if (Header->SeqCount == 0 || !Model->CheckBounds(Header->SeqTableOffset, Header->SeqCount * sizeof(sModelSeq)))
+	{
+		puts("Model has no sequences ...");
+		return false;
+	}
+	if (Header->BoneCount == 0 || !Model->CheckBounds(Header->BoneTableOffset, Header->BoneCount * sizeof(sModelBone)))
+	{
+		puts("Bone table is damaged ...");
+		return false;
+	}
+	Seqs = (sModelSeq *)&Model->Data[Header->SeqTableOffset];
+	Bones = (sModelBone *)&Model->Data[Header->BoneTableOffset];
+
+	// Offsets of first sequence file are relative to its data base (always 0 for models made by studiomdl)
+	if (Header->SubmodelCount > 0 && (!Model->CheckBounds(Header->SubmodelTableOffset, sizeof(sModelSeqGroup)) ||
+		((sModelSeqGroup *)&Model->Data[Header->SubmodelTableOffset])->Data != 0))
+	{
+		puts("Sequence group table is not supported ...");
+		return false;
+	}
+
+	// Find animation data of every sequence
+	UTIL_MALLOC(sAnimBlock *, Blocks, Header->SeqCount * sizeof(sAnimBlock), exit(EXIT_FAILURE));
+	for (ulong s = 0; s < Header->SeqCount; s++)
+	{
+		sModelSeq * Seq = &Seqs[s];
+		ulong Structs = Seq->BlendCount * Header->BoneCount;
+
+		if (Seq->Num != 0)
+		{
+			printf("%-32.32s animation is located in sequence file, unchanged\n", Seq->Name);
+			continue;
+		}
+		ulong Size = AnimSeqSize(Model, Seq);
+		if (Size == 0)
+		{
+			printf("Animation of sequence %.32s is damaged ...\n", Seq->Name);
+			free(Blocks);
+			return false;
+		}
+		Blocks[BlockCount].Seq = s;
+		Blocks[BlockCount].Offset = Seq->AnimOffset;
+		Blocks[BlockCount].End = Seq->AnimOffset + Size;
+
+		// Worst case: header for every value
+		if ((ulong)Seq->FrameCount > MaxFrames)
+			MaxFrames = Seq->FrameCount;
+		MaxSize += Structs * (sizeof(sModelAnim) + 6 * 2 * Seq->FrameCount * sizeof(short)) + 4;
+		BlockCount++;
+	}
+	if (BlockCount == 0)
+	{
+		puts("Model has no animations ...");
+		free(Blocks);
+		return false;
+	}
+
+	// Animation data must be one piece of model data that is referenced only by sequences
+	qsort(Blocks, BlockCount, sizeof(sAnimBlock), AnimCompareBlocks);
+	Begin = Blocks[0].Offset;
+	End = Blocks[0].End;
+	for (ulong b = 1; b < BlockCount; b++)
+	{
+		// Same animation can be used by several sequences (stubs made by diet)
+		if (Blocks[b].Offset == Blocks[b - 1].Offset && Blocks[b].End == Blocks[b - 1].End)
+			continue;
+		if (Blocks[b].Offset < Blocks[b - 1].End)
+		{
+			puts("Animation data is shared between sequences ...");
+			free(Blocks);
+			return false;
+		}
+		if (Blocks[b].End > End)
+			End = Blocks[b].End;
+	}
+	if (End > Header->TextureTableOffset || Model->CountOffsets(Begin, End - Begin) != BlockCount)
+	{
+		puts("Animation data is mixed with other model data ...");
+		free(Blocks);
+		return false;
+	}
+
+	// Rebuild animation data
+	uchar * NewData;
+	ulong NewSize = 0;
+	ulong * NewOffsets;
+	short * Values;
+	short * Reduced;
+	if (MaxSize < End - Begin)
+		MaxSize = End - Begin;
+	UTIL_CALLOC(uchar *, NewData, MaxSize, 1, exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, NewOffsets, BlockCount * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(short *, Values, MaxFrames * sizeof(short), exit(EXIT_FAILURE));
+	UTIL_MALLOC(short *, Reduced, MaxFrames * sizeof(short), exit(EXIT_FAILURE));
+	for (ulong b = 0; b < BlockCount; b++)
+	{
+		sModelSeq * Seq = &Seqs[Blocks[b].Seq];
+		ulong Structs = Seq->BlendCount * Header->BoneCount;
+		ulong BlockStart = (NewSize + 3) & ~3;
+		ulong ValueOffset = BlockStart + Structs * sizeof(sModelAnim);
+		double MaxPosError = 0;
+		double MaxAngleError = 0;
+
+		if (b > 0 && Blocks[b].Offset == Blocks[b - 1].Offset)
+		{
+			NewOffsets[b] = NewOffsets[b - 1];
+			continue;
+		}
+
+		for (ulong i = 0; i < Structs; i++)
+		{
+			ulong Struct = Seq->AnimOffset + i * sizeof(sModelAnim);
+			ulong NewStruct = BlockStart + i * sizeof(sModelAnim);
+			sModelAnim * Anim = (sModelAnim *)&Model->Data[Struct];
+			sModelAnim * NewAnim = (sModelAnim *)&NewData[NewStruct];
+			sModelBone * Bone = &Bones[i % Header->BoneCount];
+
+			for (int c = 0; c < 6; c++)
+			{
+				ulong ChannelEnd;
+				double Scale = fabs(Bone->Scale[c]);
+				double Error = c < 3 ? PosError : AngleError * M_PI / 180.0;
+				double Tolerance = Scale > 0 ? Error / Scale : 32767;
+				ulong ChannelError;
+
+				NewAnim->Offset[c] = 0;
+				if (Anim->Offset[c] == 0)
+					continue;
+				AnimDecode(Model, Struct + Anim->Offset[c], Seq->FrameCount, Values, &ChannelEnd);
+				memcpy(Reduced, Values, Seq->FrameCount * sizeof(short));
+				ChannelError = AnimReduceChannel(Reduced, Seq->FrameCount, Tolerance);
+				if (c < 3 && ChannelError * Scale > MaxPosError)
+					MaxPosError = ChannelError * Scale;
+				if (c >= 3 && ChannelError * Scale * 180.0 / M_PI > MaxAngleError)
+					MaxAngleError = ChannelError * Scale * 180.0 / M_PI;
+
+				// Zero channel has no data
+				bool Zero = true;
+				for (long f = 0; f < Seq->FrameCount; f++)
+					if (Reduced[f] != 0)
+						Zero = false;
+				if (Zero == true)
+					continue;
+
+				if (ValueOffset - NewStruct > 0xFFFF)
+				{
+					printf("Animation of sequence %.32s is too big ...\n", Seq->Name);
+					free(Reduced);
+					free(Values);
+					free(NewOffsets);
+					free(NewData);
+					free(Blocks);
+					return false;
+				}
+				NewAnim->Offset[c] = ValueOffset - NewStruct;
+				ValueOffset += AnimEncode(Reduced, Seq->FrameCount, &NewData[ValueOffset]);
+			}
+		}
+
+		NewOffsets[b] = Begin + BlockStart;
+		NewSize = ValueOffset;
+		printf("%-32.32s frames: %4i, %6u -> %6u bytes, max error: %.3f units, %.3f deg\n", Seq->Name, Seq->FrameCount,
+			(uint)(Blocks[b].End - Blocks[b].Offset), (uint)(NewSize - BlockStart), MaxPosError, MaxAngleError);
+	}
+	free(Reduced);
+	free(Values);
+
+	if (NewSize >= End - Begin)
+	{
+		puts("Animation data can't be reduced ...");
+		free(NewOffsets);
+		free(NewData);
+		free(Blocks);
+		return false;
+	}
+	printf("Animation data: %u -> %u bytes\n", (uint)(End - Begin), (uint)NewSize);
+
+	// Model data that follows animations is moved by multiple of 16 bytes to keep alignment
+	NewSize = (End - Begin) - ((End - Begin) - NewSize) / 16 * 16;
+	Model->ResizeBody(Begin, End - Begin, NewData, NewSize);
+
+	// Sequence table may be moved
+	Seqs = (sModelSeq *)&Model->Data[Model->Header->SeqTableOffset];
+	for (ulong b = 0; b < BlockCount; b++)
+		Seqs[Blocks[b].Seq].AnimOffset = NewOffsets[b];
+
+	free(NewOffsets);
+	free(NewData);
+	free(Blocks);
+
+	return true;
+}
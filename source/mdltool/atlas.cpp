@@ -0,0 +1,637 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains texture atlas builder for MDL -> DOL conversion: textures
+// of skin references are packed into one or two atlases (skyline packer, edges
+// are padded against bilinear bleeding), texture coordinates are moved to the
+// new location and texture/skin tables are rebuilt. Every skin family gets its
+// own atlas with the same layout. Palettes are merged if they are the same,
+// otherwise atlas is quantized to a new palette
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+#include "quantize.h"
+
+////////// Structures //////////
+
+// Skin reference that can be placed into atlas
+struct sAtlasSlot
+{
+	ulong SkinRef;			// Skin reference
+	ulong Width;			// Size with padding
+	ulong Height;
+	ulong X;				// Location in atlas
+	ulong Y;
+	int Atlas;				// Atlas number (-1 - not placed)
+};
+
+// Skyline segment
+struct sAtlasSkyline
+{
+	ulong X;
+	ulong Y;
+	ulong Width;
+};
+
+////////// Functions //////////
+static int AtlasCompareSlots(const void * A, const void * B);										// qsort() callback (bigger first)
+static bool AtlasCheckTriCmds(sModel * Model, ulong Offset, ulong Width, ulong Height);				// Check that texture coordinates don't wrap
+static void AtlasMoveTriCmds(sModel * Model, ulong Offset, ulong X, ulong Y);						// Move texture coordinates
+static ulong AtlasPack(sAtlasSlot * Slots, ulong Count, ulong Width, ulong Height, int Atlas, bool Partial);	// Place slots with skyline packer (returns how many were placed)
+static bool AtlasFindSize(sAtlasSlot * Slots, ulong Count, int Atlas, ulong * Width, ulong * Height);	// Find smallest atlas that fits all slots
+static ulong AtlasFindFamily(sAtlasSlot * Slots, ulong SlotCount, int Atlas, const short * Skins, ulong SkinRefs, ulong Family);	// Find first skin family with the same textures in atlas
+static ulong AtlasVRAM(ulong Width, ulong Height);													// VRAM used by texture after conversion
+static void AtlasBuild(sModel * Model, sAtlasSlot * Slots, ulong SlotCount, int Atlas, const short * Textures, ulong Width, ulong Height, sTexture * Result);	// Draw atlas
+
+///////// Code /////////
+static int AtlasCompareSlots(const void * A, const void * B)
+{
+	const sAtlasSlot * SlotA = (const sAtlasSlot *)A;
+	const sAtlasSlot * SlotB = (const sAtlasSlot *)B;
+
+	if (SlotA->Height != SlotB->Height)
+		return SlotA->Height > SlotB->Height ? -1 : 1;
+	if (SlotA->Width != SlotB->Width)
+		return SlotA->Width > SlotB->Width ? -1 : 1;
+	return SlotA->SkinRef < SlotB->SkinRef ? -1 : 1;
+}
+
+static bool AtlasCheckTriCmds(sModel * Model, ulong Offset, ulong Width, ulong Height)
+{
+	while (1)
+	{
+		short Count;
+
+		if (!Model->CheckBounds(Offset, sizeof(short)))
+			return false;
+		Count = *(short *)&Model->Data[Offset];
+		Offset += sizeof(short);
+		if (Count == 0)
+			return true;
+		if (Count < 0)
+			Count = -Count;
+		if (!Model->CheckBounds(Offset, Count * sizeof(sModelTriVert)))
+			return false;
+
+		sModelTriVert * Cmds = (sModelTriVert *)&Model->Data[Offset];
+		Offset += Count * sizeof(sModelTriVert);
+
+		for (int i = 0; i < Count; i++)
+			if (Cmds[i].S < 0 || Cmds[i].T < 0 || (ulong)Cmds[i].S > Width || (ulong)Cmds[i].T > Height)
+				return false;
+	}
+}
+
+static void AtlasMoveTriCmds(sModel * Model, ulong Offset, ulong X, ulong Y)
+{
+	while (1)
+	{
+		short Count;
+
+		if (!Model->CheckBounds(Offset, sizeof(short)))
+			break;
+		Count = *(short *)&Model->Data[Offset];
+		Offset += sizeof(short);
+		if (Count == 0)
+			break;
+		if (Count < 0)
+			Count = -Count;
+		if (!Model->CheckBounds(Offset, Count * sizeof(sModelTriVert)))
+			break;
+
+		sModelTriVert * Cmds = (sModelTriVert *)&Model->Data[Offset];
+		Offset += Count * sizeof(sModelTriVert);
+
+		for (int i = 0; i < Count; i++)
+		{
+			Cmds[i].S += X;
+			Cmds[i].T += Y;
+		}
+	}
+}
+
+static ulong AtlasPack(sAtlasSlot * Slots, ulong Count, ulong Width, ulong Height, int Atlas, bool Partial)
+{
+	sAtlasSkyline * Line;
+	ulong LineCount = 1;
+	ulong Placed = 0;
+
+	UTIL_MALLOC(sAtlasSkyline *, Line, (Count * 2 + 2) * sizeof(sAtlasSkyline), exit(EXIT_FAILURE));
+	Line[0].X = 0;
+	Line[0].Y = 0;
+	Line[0].Width = Width;
+
+	for (ulong s = 0; s < Count; s++)
+	{
+		sAtlasSlot * Slot = &Slots[s];
+		long Best = -1;
+		ulong BestX = 0;
+		ulong BestY = 0;
+
+		if (Slot->Atlas != Atlas)
+			continue;
+
+		// Bottom-left rule: lowest position, then leftmost
+		for (ulong i = 0; i < LineCount; i++)
+		{
+			ulong X = Line[i].X;
+			ulong Y = 0;
+			ulong Covered = 0;
+
+			if (X + Slot->Width > Width)
+				break;
+			for (ulong j = i; j < LineCount && Covered < Slot->Width; j++)
+			{
+				if (Line[j].Y > Y)
+					Y = Line[j].Y;
+				Covered += Line[j].Width;
+			}
+			if (Y + Slot->Height > Height)
+				continue;
+			if (Best == -1 || Y < BestY)
+			{
+				Best = i;
+				BestX = X;
+				BestY = Y;
+			}
+		}
+
+		if (Best == -1)
+		{
+			if (Partial == false)
+				break;
+			Slot->Atlas = -1;		// Left for the next atlas
+			continue;
+		}
+
+		// Place slot and update skyline
+		Slot->X = BestX;
+		Slot->Y = BestY;
+		Placed++;
+
+		sAtlasSkyline New = {BestX, BestY + Slot->Height, Slot->Width};
+		ulong Right = BestX + Slot->Width;
+		ulong i = Best;
+		while (i < LineCount && Line[i].X < Right)
+		{
+			if (Line[i].X + Line[i].Width <= Right)
+			{
+				memmove(&Line[i], &Line[i + 1], (LineCount - i - 1) * sizeof(sAtlasSkyline));
+				LineCount--;
+			}
+			else
+			{
+				Line[i].Width -= Right - Line[i].X;
+				Line[i].X = Right;
+				break;
+			}
+		}
+		memmove(&Line[Best + 1], &Line[Best], (LineCount - Best) * sizeof(sAtlasSkyline));
+		Line[Best] = New;
+		LineCount++;
+
+		// Merge segments of the same height
+		for (ulong j = 0; j + 1 < LineCount; )
+		{
+			if (Line[j].Y == Line[j + 1].Y)
+			{
+				Line[j].Width += Line[j + 1].Width;
+				memmove(&Line[j + 1], &Line[j + 2], (LineCount - j - 2) * sizeof(sAtlasSkyline));
+				LineCount--;
+			}
+			else
+			{
+				j++;
+			}
+		}
+	}
+
+	free(Line);
+
+	return Placed;
+}
+
+static bool AtlasFindSize(sAtlasSlot * Slots, ulong Count, int Atlas, ulong * Width, ulong * Height)
+{
+	ulong Area = 0;
+	ulong Members = 0;
+
+	for (ulong s = 0; s < Count; s++)
+	{
+		if (Slots[s].Atlas == Atlas)
+		{
+			Area += Slots[s].Width * Slots[s].Height;
+			Members++;
+		}
+	}
+
+	// Try sizes from smaller to bigger ones (square-like first)
+	for (ulong Size = PSI_MIN_DIMENSION * PSI_MIN_DIMENSION; Size <= ATLAS_MAX_SIZE * ATLAS_MAX_SIZE; Size <<= 1)
+	{
+		if (Size < Area)
+			continue;
+		for (ulong W = ATLAS_MAX_SIZE; W >= PSI_MIN_DIMENSION; W >>= 1)
+		{
+			ulong H = Size / W;
+			if (H < PSI_MIN_DIMENSION || H > ATLAS_MAX_SIZE || W < H)
+				continue;
+			for (int Flip = 0; Flip < 2; Flip++)
+			{
+				ulong TryW = Flip ? H : W;
+				ulong TryH = Flip ? W : H;
+
+				if (AtlasPack(Slots, Count, TryW, TryH, Atlas, false) == Members)
+				{
+					*Width = TryW;
+					*Height = TryH;
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+static ulong AtlasFindFamily(sAtlasSlot * Slots, ulong SlotCount, int Atlas, const short * Skins, ulong SkinRefs, ulong Family)
+{
+	for (ulong f = 0; f < Family; f++)
+	{
+		bool Equal = true;
+		for (ulong s = 0; s < SlotCount; s++)
+			if (Slots[s].Atlas == Atlas && Skins[f * SkinRefs + Slots[s].SkinRef] != Skins[Family * SkinRefs + Slots[s].SkinRef])
+				Equal = false;
+		if (Equal == true)
+			return f;
+	}
+
+	return Family;
+}
+
+static ulong AtlasVRAM(ulong Width, ulong Height)
+{
+	return PSIProperSize(Width, false) * PSIProperSize(Height, false) + PSI_PALETTE_VRAM;
+}
+
+static void AtlasBuild(sModel * Model, sAtlasSlot * Slots, ulong SlotCount, int Atlas, const short * Textures, ulong Width, ulong Height, sTexture * Result)
+{
+	uchar * RGB;
+	uchar * Palette = NULL;
+	bool SamePalette = true;
+
+	Result->Initialize();
+	Result->Width = Width;
+	Result->Height = Height;
+	Result->PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * MDL_PALETTE_ELEMENT_SIZE;
+	UTIL_CALLOC(uchar *, Result->Bitmap, Width * Height, 1, exit(EXIT_FAILURE));
+	UTIL_MALLOC(uchar *, Result->Palette, Result->PaletteSize, exit(EXIT_FAILURE));
+	UTIL_CALLOC(uchar *, RGB, Width * Height * 3, 1, exit(EXIT_FAILURE));
+
+	// Check palettes
+	for (ulong s = 0; s < SlotCount; s++)
+	{
+		if (Slots[s].Atlas != Atlas)
+			continue;
+		sTexture * Texture = &Model->Textures[Textures[Slots[s].SkinRef]];
+		if (Palette == NULL)
+			Palette = Texture->Palette;
+		else if (memcmp(Palette, Texture->Palette, Result->PaletteSize))
+			SamePalette = false;
+	}
+	memcpy(Result->Palette, Palette, Result->PaletteSize);
+
+	// Copy textures, edges are extended into padding
+	for (ulong s = 0; s < SlotCount; s++)
+	{
+		if (Slots[s].Atlas != Atlas)
+			continue;
+		sTexture * Texture = &Model->Textures[Textures[Slots[s].SkinRef]];
+
+		for (ulong y = 0; y < Slots[s].Height; y++)
+		{
+			long SrcY = (long)y - ATLAS_PADDING;
+			SrcY = SrcY < 0 ? 0 : (SrcY >= (long)Texture->Height ? Texture->Height - 1 : SrcY);
+			for (ulong x = 0; x < Slots[s].Width; x++)
+			{
+				long SrcX = (long)x - ATLAS_PADDING;
+				SrcX = SrcX < 0 ? 0 : (SrcX >= (long)Texture->Width ? Texture->Width - 1 : SrcX);
+
+				uchar Index = Texture->Bitmap[SrcY * Texture->Width + SrcX];
+				ulong Dst = (Slots[s].Y + y) * Width + Slots[s].X + x;
+				Result->Bitmap[Dst] = Index;
+				memcpy(&RGB[Dst * 3], &Texture->Palette[Index * 3], 3);
+			}
+		}
+	}
+
+	// Different palettes - make new one
+	if (SamePalette == false)
+	{
+		uchar RGBAPalette[QUANT_COLORS * 4];
+
+		QuantizeBitmap(RGB, Width, Height, 3, RGBAPalette, Result->Bitmap, false);
+		for (ulong e = 0; e < EIGHT_BIT_PALETTE_ELEMENTS_COUNT; e++)
+			memcpy(&Result->Palette[e * 3], &RGBAPalette[e * 4], 3);
+
+		double PSNR = QuantizePSNR(RGB, Width, Height, 3, RGBAPalette, Result->Bitmap);
+		if (PSNR == QUANT_PSNR_LOSSLESS)
+			printf("Atlas #%i: new palette (lossless)\n", Atlas + 1);
+		else
+			printf("Atlas #%i: new palette (PSNR %.1f dB)\n", Atlas + 1, PSNR);
+	}
+
+	free(RGB);
+}
+
+bool AtlasTextures(sModel * Model)
+{
+	sModelHeader * Header = Model->Header;
+	ulong TextureCount = Header->TextureCount;
+	ulong SkinRefs = Header->SkinCount;
+	ulong Families = Header->SkinEntrySize;
+	short * Skins = (short *)Model->SkinTable;
+	sModelMesh ** Meshes;
+	ulong MeshCount;
+	sAtlasSlot * Slots;
+	ulong SlotCount = 0;
+	bool * Usable;
+	int AtlasCount = 0;
+	ulong AtlasWidth[ATLAS_COUNT];
+	ulong AtlasHeight[ATLAS_COUNT];
+
+	if (TextureCount < 2 || Model->Textures == NULL)
+		return false;
+
+	// Check skin table
+	if (SkinRefs * Families * sizeof(short) > Model->SkinTableSize)
+	{
+		puts("Skin table is damaged, atlas is not created ...");
+		return false;
+	}
+	for (ulong i = 0; i < SkinRefs * Families; i++)
+	{
+		if (Skins[i] < 0 || (ulong)Skins[i] >= TextureCount)
+		{
+			puts("Skin table is damaged, atlas is not created ...");
+			return false;
+		}
+	}
+
+	// Skin reference can be moved to atlas if it's used by meshes, textures of all
+	// families have the same size, no special render flags, no wrapping and
+	// triangle commands are not shared with other skin references
+	Meshes = Model->CollectMeshes(&MeshCount);
+	UTIL_CALLOC(bool *, Usable, SkinRefs + 1, sizeof(bool), exit(EXIT_FAILURE));
+	for (ulong m = 0; m < MeshCount; m++)
+		Usable[Meshes[m]->SkinRef] = true;
+	for (ulong r = 0; r < SkinRefs; r++)
+	{
+		sTexture * First = &Model->Textures[Skins[r]];
+
+		for (ulong f = 0; f < Families && Usable[r] == true; f++)
+		{
+			ulong Index = Skins[f * SkinRefs + r];
+			if (Model->Textures[Index].Width != First->Width || Model->Textures[Index].Height != First->Height ||
+				*(int *)&Model->TextureTable[Index].Name[MDL_TEXTURE_FLAGS] != 0 ||
+				First->Width + ATLAS_PADDING * 2 > ATLAS_MAX_SIZE || First->Height + ATLAS_PADDING * 2 > ATLAS_MAX_SIZE)
+				Usable[r] = false;
+		}
+	}
+	for (ulong m = 0; m < MeshCount; m++)
+	{
+		ulong Ref = Meshes[m]->SkinRef;
+
+		if (m > 0 && Meshes[m - 1]->TriCmdOffset == Meshes[m]->TriCmdOffset && (ulong)Meshes[m - 1]->SkinRef != Ref)
+			Usable[Ref] = Usable[Meshes[m - 1]->SkinRef] = false;
+		if (Usable[Ref] == true && !AtlasCheckTriCmds(Model, Meshes[m]->TriCmdOffset, Model->Textures[Skins[Ref]].Width, Model->Textures[Skins[Ref]].Height))
+			Usable[Ref] = false;
+	}
+
+	// Pack
+	UTIL_CALLOC(sAtlasSlot *, Slots, SkinRefs + 1, sizeof(sAtlasSlot), exit(EXIT_FAILURE));
+	for (ulong r = 0; r < SkinRefs; r++)
+	{
+		if (Usable[r] == false)
+			continue;
+		Slots[SlotCount].SkinRef = r;
+		Slots[SlotCount].Width = Model->Textures[Skins[r]].Width + ATLAS_PADDING * 2;
+		Slots[SlotCount].Height = Model->Textures[Skins[r]].Height + ATLAS_PADDING * 2;
+		Slots[SlotCount].Atlas = -1;
+		SlotCount++;
+	}
+	qsort(Slots, SlotCount, sizeof(sAtlasSlot), AtlasCompareSlots);
+
+	while (AtlasCount < ATLAS_COUNT)
+	{
+		ulong Members = 0;
+
+		// Everything that is left goes to the next atlas
+		for (ulong s = 0; s < SlotCount; s++)
+		{
+			if (Slots[s].Atlas == -1)
+			{
+				Slots[s].Atlas = AtlasCount;
+				Members++;
+			}
+		}
+		if (Members < 2)
+			break;
+
+		// Doesn't fit - take what fits into the biggest atlas
+		if (AtlasFindSize(Slots, SlotCount, AtlasCount, &AtlasWidth[AtlasCount], &AtlasHeight[AtlasCount]) == false)
+		{
+			Members = AtlasPack(Slots, SlotCount, ATLAS_MAX_SIZE, ATLAS_MAX_SIZE, AtlasCount, true);
+			if (Members < 2 || AtlasFindSize(Slots, SlotCount, AtlasCount, &AtlasWidth[AtlasCount], &AtlasHeight[AtlasCount]) == false)
+				break;
+		}
+
+		AtlasCount++;
+	}
+	for (ulong s = 0; s < SlotCount; s++)
+		if (Slots[s].Atlas >= AtlasCount)
+			Slots[s].Atlas = -1;
+
+	// Atlas is dropped if it needs more VRAM than textures it replaces (this
+	// happens with power of 2 textures because of padding)
+	bool * Counted;
+	UTIL_MALLOC(bool *, Counted, TextureCount, exit(EXIT_FAILURE));
+	for (int a = 0; a < AtlasCount; a++)
+	{
+		ulong Versions = 0;
+		ulong Separate = 0;
+
+		memset(Counted, 0x00, TextureCount);
+		for (ulong f = 0; f < Families; f++)
+		{
+			if (AtlasFindFamily(Slots, SlotCount, a, Skins, SkinRefs, f) == f)
+				Versions++;
+			for (ulong s = 0; s < SlotCount; s++)
+			{
+				ulong Index = Skins[f * SkinRefs + Slots[s].SkinRef];
+				if (Slots[s].Atlas == a && Counted[Index] == false)
+				{
+					Counted[Index] = true;
+					Separate += AtlasVRAM(Model->Textures[Index].Width, Model->Textures[Index].Height);
+				}
+			}
+		}
+
+		if (Versions * AtlasVRAM(AtlasWidth[a], AtlasHeight[a]) > Separate)
+		{
+			printf("Atlas %ix%i needs more VRAM than separate textures, skipped ...\n", (int)AtlasWidth[a], (int)AtlasHeight[a]);
+
+			// Move next atlases down
+			for (ulong s = 0; s < SlotCount; s++)
+			{
+				if (Slots[s].Atlas == a)
+					Slots[s].Atlas = -1;
+				else if (Slots[s].Atlas > a)
+					Slots[s].Atlas--;
+			}
+			for (int b = a; b + 1 < AtlasCount; b++)
+			{
+				AtlasWidth[b] = AtlasWidth[b + 1];
+				AtlasHeight[b] = AtlasHeight[b + 1];
+			}
+			AtlasCount--;
+			a--;
+		}
+	}
+	free(Counted);
+
+	if (AtlasCount == 0)
+	{
+		puts("Nothing to put into atlas ...");
+		free(Slots);
+		free(Usable);
+		free(Meshes);
+		return false;
+	}
+
+	// Move texture coordinates
+	for (ulong m = 0; m < MeshCount; m++)
+	{
+		if (m > 0 && Meshes[m - 1]->TriCmdOffset == Meshes[m]->TriCmdOffset)
+			continue;
+		for (ulong s = 0; s < SlotCount; s++)
+			if (Slots[s].Atlas != -1 && Slots[s].SkinRef == (ulong)Meshes[m]->SkinRef)
+				AtlasMoveTriCmds(Model, Meshes[m]->TriCmdOffset, Slots[s].X + ATLAS_PADDING, Slots[s].Y + ATLAS_PADDING);
+	}
+
+	// New skin table: textures that are left + atlases (one per skin family unless families share all textures)
+	short * NewSkins;
+	long * NewIndex;
+	ulong MaxCount = TextureCount + ATLAS_COUNT * Families;
+	ulong NewCount = 0;
+	sTexture * NewTextures;
+	sModelTextureEntry * NewTable;
+	ulong OldVRAM = 0;
+	ulong NewVRAM = 0;
+
+	UTIL_MALLOC(short *, NewSkins, Model->SkinTableSize + sizeof(short), exit(EXIT_FAILURE));
+	UTIL_MALLOC(long *, NewIndex, TextureCount * sizeof(long), exit(EXIT_FAILURE));
+	UTIL_MALLOC(sTexture *, NewTextures, MaxCount * sizeof(sTexture), exit(EXIT_FAILURE));
+	UTIL_CALLOC(sModelTextureEntry *, NewTable, MaxCount, sizeof(sModelTextureEntry), exit(EXIT_FAILURE));
+	memcpy(NewSkins, Skins, Model->SkinTableSize);
+
+	for (ulong i = 0; i < TextureCount; i++)
+	{
+		NewIndex[i] = -1;
+		OldVRAM += AtlasVRAM(Model->Textures[i].Width, Model->Textures[i].Height);
+	}
+	for (ulong r = 0; r < SkinRefs; r++)
+	{
+		bool InAtlas = false;
+
+		for (ulong s = 0; s < SlotCount; s++)
+			if (Slots[s].Atlas != -1 && Slots[s].SkinRef == r)
+				InAtlas = true;
+		if (InAtlas == true)
+			continue;
+
+		for (ulong f = 0; f < Families; f++)
+		{
+			ulong Index = Skins[f * SkinRefs + r];
+			if (NewIndex[Index] == -1)
+			{
+				NewIndex[Index] = NewCount;
+				NewTextures[NewCount] = Model->Textures[Index];
+				NewTable[NewCount] = Model->TextureTable[Index];
+				NewCount++;
+			}
+			NewSkins[f * SkinRefs + r] = NewIndex[Index];
+		}
+	}
+	for (int a = 0; a < AtlasCount; a++)
+	{
+		ulong FirstAtlas = NewCount;
+		ulong Members = 0;
+		long Member = -1;
+
+		for (ulong s = 0; s < SlotCount; s++)
+		{
+			if (Slots[s].Atlas == a)
+			{
+				Member = s;
+				Members++;
+			}
+		}
+
+		for (ulong f = 0; f < Families; f++)
+		{
+			long Index;
+			ulong Same = AtlasFindFamily(Slots, SlotCount, a, Skins, SkinRefs, f);
+
+			// Reuse atlas of other skin family if it has the same textures, otherwise draw new one
+			if (Same != f)
+			{
+				Index = NewSkins[Same * SkinRefs + Slots[Member].SkinRef];
+			}
+			else
+			{
+				Index = NewCount;
+				AtlasBuild(Model, Slots, SlotCount, a, &Skins[f * SkinRefs], AtlasWidth[a], AtlasHeight[a], &NewTextures[Index]);
+				if (Index == (long)FirstAtlas)
+					snprintf(NewTextures[Index].Name, sizeof(NewTextures[Index].Name), "atlas%i.bmp", a + 1);
+				else
+					snprintf(NewTextures[Index].Name, sizeof(NewTextures[Index].Name), "atlas%i_%i.bmp", a + 1, (int)(Index - FirstAtlas + 1));
+				strcpy(NewTable[Index].Name, NewTextures[Index].Name);
+				NewTable[Index].Width = AtlasWidth[a];
+				NewTable[Index].Height = AtlasHeight[a];
+				NewVRAM += AtlasVRAM(AtlasWidth[a], AtlasHeight[a]);
+				NewCount++;
+			}
+
+			for (ulong s = 0; s < SlotCount; s++)
+				if (Slots[s].Atlas == a)
+					NewSkins[f * SkinRefs + Slots[s].SkinRef] = Index;
+		}
+
+		if (NewCount - FirstAtlas > 1)
+			printf("Atlas #%i: %ix%i, %i textures, %i versions for skin families\n", a + 1, (int)AtlasWidth[a], (int)AtlasHeight[a], (int)Members, (int)(NewCount - FirstAtlas));
+		else
+			printf("Atlas #%i: %ix%i, %i textures\n", a + 1, (int)AtlasWidth[a], (int)AtlasHeight[a], (int)Members);
+	}
+	for (ulong i = 0; i < TextureCount; i++)
+	{
+		if (NewIndex[i] != -1)
+			NewVRAM += AtlasVRAM(Model->Textures[i].Width, Model->Textures[i].Height);
+		else
+			Model->Textures[i].Free();		// Only in atlas now
+	}
+
+	printf("Textures: %i -> %i, VRAM: %i -> %i bytes\n", (int)TextureCount, (int)NewCount, (int)OldVRAM, (int)NewVRAM);
+	Model->ReplaceTextures(NewTextures, NewTable, NewCount, (uchar *)NewSkins);
+
+	free(NewTable);
+	free(NewIndex);
+	free(NewSkins);
+	free(Slots);
+	free(Usable);
+	free(Meshes);
+
+	return true;
+}
@@ -0,0 +1,585 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains removal of unused model data: usage list (sequence
+// names, body values and skins that are used by maps) is loaded, other
+// sequences lose their events, pivots and animations and become stubs that
+// share one still frame (sequences after the last used one are removed from
+// sequence table), unused body parts become blank (so sequence numbers and
+// body values of maps stay the same) and unused skin families (after the
+// last used one) are removed together with textures that aren't needed
+// anymore. Data that isn't referenced anymore is cut out of the model, everything
+// after it is moved by a multiple of 16 bytes
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Structures //////////
+
+// Usage list
+struct sDietList
+{
+	char (* Seqs)[32];		// Sequence names
+	ulong SeqCount;
+	ulong * Bodies;			// Body values
+	ulong BodyCount;
+	ulong * Skins;			// Skin families
+	ulong SkinCount;
+};
+
+// Block of model data that isn't needed anymore
+struct sDietBlock
+{
+	ulong Offset;
+	ulong Size;
+};
+
+// List of blocks
+struct sDietBlocks
+{
+	sDietBlock * Items;
+	ulong Count;
+};
+
+////////// Functions //////////
+static bool DietLoadList(const char * FileName, sDietList * List);								// Load usage list
+static void DietFreeList(sDietList * List);														// Free usage list
+static bool DietFindSeq(sDietList * List, const char * Name);									// Check if sequence is in usage list (case insensitive)
+static void DietAddBlock(sModel * Model, sDietBlocks * Blocks, long Offset, ulong Size);		// Add block to list (empty and damaged blocks are skipped)
+static ulong DietTriCmdSize(sModel * Model, ulong Offset);										// Size of triangle commands
+static int DietCompareBlocks(const void * A, const void * B);									// qsort() callback
+static void DietRemoveBlocks(sModel * Model, sDietBlocks * Blocks);								// Cut out blocks that aren't referenced anymore
+static ulong DietSequences(sModel * Model, sDietList * List, sDietBlocks * Blocks, ulong * Kept, ulong * Stubs);	// Select sequences, unused ones become stubs (returns new size of sequence table)
+static ulong DietBodyParts(sModel * Model, sDietList * List, sDietBlocks * Blocks, sDOLExtraSection * DOLExtraSect, sDOLLODEntry * LODTable, ulong * Total);	// Blank unused body parts (returns how many are kept)
+static void DietSkins(sModel * Model, sDietList * List);										// Remove unused skin families and textures
+
+///////// Code /////////
+static bool DietLoadList(const char * FileName, sDietList * List)
+{
+	FILE * ptrFile;
+	char Buffer[128];
+
+	memset(List, 0x00, sizeof(sDietList));
+
+	ptrFile = fopen(FileName, "rb");
+	if (ptrFile == NULL)
+	{
+		printf("Can't open usage list %s ...\n", FileName);
+		return false;
+	}
+
+	while (fgets(Buffer, sizeof(Buffer), ptrFile) != NULL)
+	{
+		char * Value;
+		char * End;
+
+		// Skip comments, empty lines and lines without []
+		if (Buffer[0] == '/' && Buffer[1] == '/')
+			continue;
+		Value = strchr(Buffer, '[');
+		End = strchr(Buffer, ']');
+		if (Value == NULL || End == NULL || End < Value)
+			continue;
+		*Value++ = '\0';
+		*End = '\0';
+
+		if (!strcmp(Buffer, KWD_SEQUENCE))
+		{
+			List->Seqs = (char (*)[32])realloc(List->Seqs, (List->SeqCount + 1) * 32);
+			if (List->Seqs == NULL)
+			{
+				UTIL_WAIT_KEY("Unable to allocate memory ...");
+				exit(EXIT_FAILURE);
+			}
+			memset(List->Seqs[List->SeqCount], 0x00, 32);
+			strncpy(List->Seqs[List->SeqCount], Value, 31);
+			List->SeqCount++;
+		}
+		else if (!strcmp(Buffer, KWD_BODY))
+		{
+			List->Bodies = (ulong *)realloc(List->Bodies, (List->BodyCount + 1) * sizeof(ulong));
+			if (List->Bodies == NULL)
+			{
+				UTIL_WAIT_KEY("Unable to allocate memory ...");
+				exit(EXIT_FAILURE);
+			}
+			List->Bodies[List->BodyCount++] = atoi(Value);
+		}
+		else if (!strcmp(Buffer, KWD_SKIN))
+		{
+			List->Skins = (ulong *)realloc(List->Skins, (List->SkinCount + 1) * sizeof(ulong));
+			if (List->Skins == NULL)
+			{
+				UTIL_WAIT_KEY("Unable to allocate memory ...");
+				exit(EXIT_FAILURE);
+			}
+			List->Skins[List->SkinCount++] = atoi(Value);
+		}
+		else
+		{
+			printf("Unknown parameter in usage list: %s\n", Buffer);
+		}
+	}
+	fclose(ptrFile);
+
+	return true;
+}
+
+static void DietFreeList(sDietList * List)
+{
+	free(List->Seqs);
+	free(List->Bodies);
+	free(List->Skins);
+	memset(List, 0x00, sizeof(sDietList));
+}
+
+static bool DietFindSeq(sDietList * List, const char * Name)
+{
+	for (ulong i = 0; i < List->SeqCount; i++)
+	{
+		ulong c;
+
+		for (c = 0; c < 32 && Name[c] != '\0'; c++)
+			if (tolower(Name[c]) != tolower(List->Seqs[i][c]))
+				break;
+		if (c == 32 || (Name[c] == '\0' && List->Seqs[i][c] == '\0'))
+			return true;
+	}
+
+	return false;
+}
+
+static void DietAddBlock(sModel * Model, sDietBlocks * Blocks, long Offset, ulong Size)
+{
+	// Header and extra section are never removed, model data only
+	if (Size == 0 || Offset < (long)(sizeof(sModelHeader) + sizeof(sDOLExtraSection)) ||
+		!Model->CheckBounds(Offset, Size) || Offset + Size > Model->Header->TextureTableOffset)
+		return;
+
+	Blocks->Items = (sDietBlock *)realloc(Blocks->Items, (Blocks->Count + 1) * sizeof(sDietBlock));
+	if (Blocks->Items == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	Blocks->Items[Blocks->Count].Offset = Offset;
+	Blocks->Items[Blocks->Count].Size = Size;
+	Blocks->Count++;
+}
+
+static ulong DietTriCmdSize(sModel * Model, ulong Offset)
+{
+	ulong Start = Offset;
+
+	while (1)
+	{
+		short Count;
+
+		if (!Model->CheckBounds(Offset, sizeof(short)))
+			return 0;
+		Count = *(short *)&Model->Data[Offset];
+		Offset += sizeof(short);
+		if (Count == 0)
+			break;
+		if (Count < 0)
+			Count = -Count;
+		if (!Model->CheckBounds(Offset, Count * sizeof(sModelTriVert)))
+			return 0;
+		Offset += Count * sizeof(sModelTriVert);
+	}
+
+	return Offset - Start;
+}
+
+static int DietCompareBlocks(const void * A, const void * B)
+{
+	const sDietBlock * BlockA = (const sDietBlock *)A;
+	const sDietBlock * BlockB = (const sDietBlock *)B;
+
+	if (BlockA->Offset < BlockB->Offset)
+		return -1;
+	if (BlockA->Offset > BlockB->Offset)
+		return 1;
+	return 0;
+}
+
+static void DietRemoveBlocks(sModel * Model, sDietBlocks * Blocks)
+{
+	ulong Count = 0;
+
+	if (Blocks->Count == 0)
+		return;
+
+	// Blocks that are still used (shared with data that is kept) can't be removed
+	for (ulong i = 0; i < Blocks->Count; i++)
+		if (Model->CountOffsets(Blocks->Items[i].Offset, Blocks->Items[i].Size) == 0)
+			Blocks->Items[Count++] = Blocks->Items[i];
+
+	// Merge overlapping blocks and blocks that are separated by padding
+	qsort(Blocks->Items, Count, sizeof(sDietBlock), DietCompareBlocks);
+	ulong Merged = 0;
+	for (ulong i = 1; i < Count; i++)
+	{
+		sDietBlock * Last = &Blocks->Items[Merged];
+		sDietBlock * Next = &Blocks->Items[i];
+		ulong LastEnd = Last->Offset + Last->Size;
+
+		if (Next->Offset <= LastEnd ||
+			(Next->Offset - LastEnd < 16 && Model->CountOffsets(LastEnd, Next->Offset - LastEnd) == 0))
+		{
+			if (Next->Offset + Next->Size > LastEnd)
+				Last->Size = Next->Offset + Next->Size - Last->Offset;
+		}
+		else
+		{
+			Blocks->Items[++Merged] = *Next;
+		}
+	}
+	if (Count > 0)
+		Count = Merged + 1;
+
+	// Cut out from the end, so offsets of blocks stay valid. Size is
+	// rounded down to keep alignment of data that follows
+	for (ulong i = Count; i-- > 0;)
+	{
+		ulong Size = Blocks->Items[i].Size / 16 * 16;
+		if (Size != 0)
+			Model->ResizeBody(Blocks->Items[i].Offset, Size, NULL, 0);
+	}
+}
+
+static ulong DietSequences(sModel * Model, sDietList * List, sDietBlocks * Blocks, ulong * Kept, ulong * Stubs)
+{
+	sModelHeader * Header = Model->Header;
+	sModelSeq * Seqs = (sModelSeq *)&Model->Data[Header->SeqTableOffset];
+	ulong ZeroSize = Header->BoneCount * sizeof(sModelAnim);
+	long ZeroAnim = 0;
+	bool AnimBase = true;
+	bool * Keep;
+	long * AnimOffsets;
+	ulong * AnimSizes;
+	ulong NewCount = 0;
+
+	// Animation offsets of first sequence file are relative to its data base
+	if (Header->SubmodelCount > 0 && (!Model->CheckBounds(Header->SubmodelTableOffset, sizeof(sModelSeqGroup)) ||
+		((sModelSeqGroup *)&Model->Data[Header->SubmodelTableOffset])->Data != 0))
+		AnimBase = false;
+
+	// First sequence is default one, so it is always kept. Sequences after
+	// the last used one are removed, other unused ones become stubs (maps
+	// select sequences by number)
+	UTIL_CALLOC(bool *, Keep, Header->SeqCount, sizeof(bool), exit(EXIT_FAILURE));
+	UTIL_CALLOC(long *, AnimOffsets, Header->SeqCount, sizeof(long), exit(EXIT_FAILURE));
+	UTIL_CALLOC(ulong *, AnimSizes, Header->SeqCount, sizeof(ulong), exit(EXIT_FAILURE));
+	*Kept = 0;
+	for (ulong s = 0; s < Header->SeqCount; s++)
+	{
+		Keep[s] = s == 0 || List->SeqCount == 0 || DietFindSeq(List, Seqs[s].Name);
+		if (Keep[s] == true)
+		{
+			NewCount = s + 1;
+			(*Kept)++;
+		}
+	}
+	*Stubs = NewCount - *Kept;
+
+	for (ulong s = 0; s < Header->SeqCount; s++)
+	{
+		sModelSeq * Seq = &Seqs[s];
+
+		if (Keep[s] == true)
+			continue;
+
+		// References are cleared, so data isn't counted as used
+		if (Seq->EventCount > 0)
+			DietAddBlock(Model, Blocks, Seq->EventOffset, Seq->EventCount * sizeof(sModelEvent));
+		if (Seq->PivotCount > 0)
+			DietAddBlock(Model, Blocks, Seq->PivotOffset, Seq->PivotCount * sizeof(sModelPivot));
+		Seq->EventCount = 0;
+		Seq->EventOffset = 0;
+		Seq->PivotCount = 0;
+		Seq->PivotOffset = 0;
+		if (Seq->Num == 0 && AnimBase == true)
+		{
+			AnimOffsets[s] = Seq->AnimOffset;
+			AnimSizes[s] = AnimSeqSize(Model, Seq);
+			Seq->AnimOffset = 0;
+		}
+	}
+
+	// Beginning of the first animation that isn't shared with kept sequences
+	// is cleared and shared by all stubs (bones stay in default position)
+	for (ulong s = 0; s < Header->SeqCount && *Stubs > 0 && ZeroAnim == 0; s++)
+	{
+		if (AnimSizes[s] >= ZeroSize && ZeroSize > 0 && Model->CountOffsets(AnimOffsets[s], AnimSizes[s]) == 0)
+		{
+			ZeroAnim = AnimOffsets[s];
+			memset(&Model->Data[ZeroAnim], 0x00, ZeroSize);
+			AnimOffsets[s] += ZeroSize;
+			AnimSizes[s] -= ZeroSize;
+		}
+	}
+	for (ulong s = 0; s < Header->SeqCount; s++)
+	{
+		sModelSeq * Seq = &Seqs[s];
+
+		if (Keep[s] == true)
+			continue;
+
+		if (s >= NewCount || ZeroAnim != 0)
+		{
+			if (AnimSizes[s] > 0)
+				DietAddBlock(Model, Blocks, AnimOffsets[s], AnimSizes[s]);
+		}
+		else if (AnimSizes[s] > 0)
+		{
+			// Nothing to share, so stub keeps its animation
+			Seq->AnimOffset = AnimOffsets[s];
+		}
+		if (s >= NewCount)
+			continue;
+
+		// Stub isn't selected by activity
+		Seq->Activity = 0;
+		Seq->ActWeight = 0;
+		if (ZeroAnim != 0)
+		{
+			// One still frame
+			Seq->MotionType = 0;
+			Seq->LinearMovement[0] = Seq->LinearMovement[1] = Seq->LinearMovement[2] = 0;
+			Seq->FrameCount = 1;
+			Seq->BlendCount = 1;
+			Seq->Num = 0;
+			Seq->AnimOffset = ZeroAnim;
+		}
+	}
+	free(AnimSizes);
+	free(AnimOffsets);
+	free(Keep);
+
+	return NewCount;
+}
+
+static ulong DietBodyParts(sModel * Model, sDietList * List, sDietBlocks * Blocks, sDOLExtraSection * DOLExtraSect, sDOLLODEntry * LODTable, ulong * Total)
+{
+	sModelHeader * Header = Model->Header;
+	sModelBodyGroup * Groups;
+	ulong Kept = 0;
+
+	*Total = 0;
+	if (!Model->CheckBounds(Header->SubmeshTableOffset, Header->SubmeshCount * sizeof(sModelBodyGroup)))
+		return 0;
+	Groups = (sModelBodyGroup *)&Model->Data[Header->SubmeshTableOffset];
+
+	for (ulong g = 0; g < Header->SubmeshCount; g++)
+	{
+		sModelBodyGroup * Group = &Groups[g];
+		sModelBodyPart * Parts;
+		ulong * Logical;			// Body part number without LODs
+		ulong LogicalCount = 0;
+
+		if (Group->PartCount <= 0 || !Model->CheckBounds(Group->PartTableOffset, Group->PartCount * sizeof(sModelBodyPart)))
+			continue;
+		Parts = (sModelBodyPart *)&Model->Data[Group->PartTableOffset];
+
+		// LODs are located after their body part
+		UTIL_MALLOC(ulong *, Logical, Group->PartCount * sizeof(ulong), exit(EXIT_FAILURE));
+		for (int p = 0; p < Group->PartCount; LogicalCount++)
+		{
+			ulong LODCount = 0;
+
+			if (LODTable != NULL && DOLExtraSect != NULL && g < DOLExtraSect->NumBodyGroups && (ulong)p < DOLExtraSect->MaxBodyParts)
+				LODCount = LODTable[g * DOLExtraSect->MaxBodyParts + p].LODCount;
+			for (ulong l = 0; l <= LODCount && p < Group->PartCount; l++)
+				Logical[p++] = LogicalCount;
+		}
+
+		for (int p = 0; p < Group->PartCount; p++)
+		{
+			sModelBodyPart * Part = &Parts[p];
+			bool Used = List->BodyCount == 0 || Logical[p] == 0;
+
+			// Same as body part selection of the engine
+			for (ulong b = 0; b < List->BodyCount && Used == false; b++)
+				if ((List->Bodies[b] / (Group->Base > 0 ? Group->Base : 1)) % LogicalCount == Logical[p])
+					Used = true;
+
+			if (Part->MeshCount > 0 || Part->VertCount > 0)
+				(*Total)++;
+			if (Used == true)
+			{
+				if (Part->MeshCount > 0 || Part->VertCount > 0)
+					Kept++;
+				continue;
+			}
+
+			// Unused body part becomes blank
+			if (Part->MeshCount > 0 && Model->CheckBounds(Part->MeshTableOffset, Part->MeshCount * sizeof(sModelMesh)))
+			{
+				sModelMesh * Meshes = (sModelMesh *)&Model->Data[Part->MeshTableOffset];
+				for (int m = 0; m < Part->MeshCount; m++)
+					DietAddBlock(Model, Blocks, Meshes[m].TriCmdOffset, DietTriCmdSize(Model, Meshes[m].TriCmdOffset));
+				DietAddBlock(Model, Blocks, Part->MeshTableOffset, Part->MeshCount * sizeof(sModelMesh));
+			}
+			if (Part->VertCount > 0)
+			{
+				DietAddBlock(Model, Blocks, Part->VertBoneOffset, Part->VertCount);
+				DietAddBlock(Model, Blocks, Part->VertOffset, Part->VertCount * 3 * sizeof(float));
+			}
+			if (Part->NormCount > 0)
+			{
+				DietAddBlock(Model, Blocks, Part->NormBoneOffset, Part->NormCount);
+				DietAddBlock(Model, Blocks, Part->NormOffset, Part->NormCount * 3 * sizeof(float));
+			}
+			Part->MeshCount = 0;
+			Part->MeshTableOffset = 0;
+			Part->VertCount = 0;
+			Part->VertBoneOffset = 0;
+			Part->VertOffset = 0;
+			Part->NormCount = 0;
+			Part->NormBoneOffset = 0;
+			Part->NormOffset = 0;
+		}
+		free(Logical);
+	}
+
+	return Kept;
+}
+
+static void DietSkins(sModel * Model, sDietList * List)
+{
+	sModelHeader * Header = Model->Header;
+	ulong TextureCount = Header->TextureCount;
+	ulong SkinRefs = Header->SkinCount;
+	ulong Families = Header->SkinEntrySize;
+	ulong NewFamilies = 1;
+	short * Skins = (short *)Model->SkinTable;
+	sModelMesh ** Meshes;
+	ulong MeshCount;
+	long * Remap;
+	ulong NewCount = 0;
+
+	if (TextureCount == 0 || Families == 0 || SkinRefs == 0)
+		return;
+	for (ulong i = 0; i < SkinRefs * Families; i++)
+	{
+		if (Skins[i] < 0 || (ulong)Skins[i] >= TextureCount)
+		{
+			puts("Skin table is damaged, skins are kept ...");
+			return;
+		}
+	}
+
+	// Skin numbers of maps must stay the same, so only families after the last used one are removed
+	if (List->SkinCount == 0)
+		NewFamilies = Families;
+	for (ulong i = 0; i < List->SkinCount; i++)
+		if (List->Skins[i] + 1 > NewFamilies)
+			NewFamilies = List->Skins[i] + 1;
+	if (NewFamilies > Families)
+		NewFamilies = Families;
+
+	// Textures of meshes that are left
+	UTIL_MALLOC(long *, Remap, TextureCount * sizeof(long), exit(EXIT_FAILURE));
+	for (ulong i = 0; i < TextureCount; i++)
+		Remap[i] = -1;
+	Meshes = Model->CollectMeshes(&MeshCount);
+	for (ulong m = 0; m < MeshCount; m++)
+		for (ulong f = 0; f < NewFamilies; f++)
+			Remap[Skins[f * SkinRefs + Meshes[m]->SkinRef]] = 0;
+	free(Meshes);
+	if (MeshCount == 0)
+		Remap[0] = 0;
+	for (ulong i = 0; i < TextureCount; i++)
+		if (Remap[i] == 0)
+			Remap[i] = NewCount++;
+		else
+			Remap[i] = -1;
+
+	printf("Skin families: %u -> %u, textures: %u -> %u\n", (uint)Families, (uint)NewFamilies, (uint)TextureCount, (uint)NewCount);
+	if (NewFamilies == Families && NewCount == TextureCount)
+	{
+		free(Remap);
+		return;
+	}
+
+	// New tables (skins that reference removed textures aren't used by any mesh)
+	sTexture * NewTextures;
+	sModelTextureEntry * NewTable;
+	short * NewSkins;
+	UTIL_MALLOC(sTexture *, NewTextures, NewCount * sizeof(sTexture), exit(EXIT_FAILURE));
+	UTIL_MALLOC(sModelTextureEntry *, NewTable, NewCount * sizeof(sModelTextureEntry), exit(EXIT_FAILURE));
+	UTIL_MALLOC(short *, NewSkins, NewFamilies * SkinRefs * sizeof(short), exit(EXIT_FAILURE));
+	for (ulong i = 0; i < TextureCount; i++)
+	{
+		if (Remap[i] == -1)
+		{
+			Model->Textures[i].Free();
+			continue;
+		}
+		NewTextures[Remap[i]] = Model->Textures[i];
+		NewTable[Remap[i]] = Model->TextureTable[i];
+	}
+	for (ulong i = 0; i < NewFamilies * SkinRefs; i++)
+		NewSkins[i] = Remap[Skins[i]] == -1 ? 0 : Remap[Skins[i]];
+
+	Model->SkinTableSize = NewFamilies * SkinRefs * sizeof(short);
+	Model->Header->SkinEntrySize = NewFamilies;
+	Model->ReplaceTextures(NewTextures, NewTable, NewCount, (uchar *)NewSkins);
+
+	free(NewSkins);
+	free(NewTable);
+	free(Remap);
+}
+
+bool DietModel(sModel * Model, const char * UsageFile, sDOLExtraSection * DOLExtraSect, sDOLLODEntry * LODTable)
+{
+	sModelHeader * Header = Model->Header;
+	sDietList List;
+	sDietBlocks Blocks;
+	ulong OldSize = Model->BodySize;
+	ulong SeqCount = Header->SeqCount;
+	ulong NewSeqCount;
+	ulong KeptSeqs;
+	ulong StubSeqs;
+	ulong PartCount;
+	ulong KeptParts;
+
+	if (!Model->CheckBounds(Header->SeqTableOffset, Header->SeqCount * sizeof(sModelSeq)))
+	{
+		puts("Sequence table is damaged ...");
+		return false;
+	}
+	if (DietLoadList(UsageFile, &List) == false)
+		return false;
+
+	// Clear references to unused data
+	Blocks.Items = NULL;
+	Blocks.Count = 0;
+	NewSeqCount = DietSequences(Model, &List, &Blocks, &KeptSeqs, &StubSeqs);
+	KeptParts = DietBodyParts(Model, &List, &Blocks, DOLExtraSect, LODTable, &PartCount);
+
+	// Cut out data
+	DietRemoveBlocks(Model, &Blocks);
+	free(Blocks.Items);
+
+	// Cut unused sequences from the end of sequence table, numbers of other
+	// sequences stay the same (size of entry is a multiple of 16, so alignment is kept)
+	if (NewSeqCount != SeqCount)
+	{
+		Model->Header->SeqCount = NewSeqCount;
+		Model->ResizeBody(Model->Header->SeqTableOffset + NewSeqCount * sizeof(sModelSeq), (SeqCount - NewSeqCount) * sizeof(sModelSeq), NULL, 0);
+	}
+
+	printf("Sequences: %u -> %u (%u used, %u stubs)\n", (uint)SeqCount, (uint)NewSeqCount, (uint)KeptSeqs, (uint)StubSeqs);
+	printf("Body parts: %u -> %u\n", (uint)PartCount, (uint)KeptParts);
+	DietSkins(Model, &List);
+	printf("Model data: %u -> %u bytes\n", (uint)OldSize, (uint)Model->BodySize);
+
+	DietFreeList(&List);
+
+	return true;
+}
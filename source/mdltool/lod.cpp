@@ -0,0 +1,883 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains LOD generator for PS2 models: meshes of body parts
+// are simplified with quadric error metrics (edge collapse into existing
+// vertex, so vertex and normal arrays are shared with original body part),
+// results are added as extra body parts after original ones and LOD table
+// is filled with distances derived from model size (body parts that already
+// have LODs in *.INF file are kept)
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Structures //////////
+
+// Unique mesh vertex (position + normal + texture coordinates)
+struct sLODVert
+{
+	sModelTriVert Src;		// Triangle command vertex
+	double Pos[3];			// Position in model space
+	double Q[10];			// Error quadric (upper triangle of 4x4 matrix)
+	bool Locked;			// Border or seam vertex, can't be moved
+	bool Dead;				// Removed by collapse
+	bool Touched;			// Changed during current pass
+	ulong Stamp;			// Helper for neighbour search
+};
+
+// Mesh triangle
+struct sLODTri
+{
+	ulong V[3];				// Vertices (CCW order as in triangle commands)
+	bool Dead;				// Removed by collapse
+};
+
+// Edge collapse candidate
+struct sLODCandidate
+{
+	double Cost;
+	ulong From;
+	ulong To;
+};
+
+// Mesh loaded for simplification
+struct sLODMesh
+{
+	sLODVert * Verts;
+	ulong VertCount;
+	sLODTri * Tris;
+	ulong TriCount;
+	ulong AliveTris;
+	ulong * AdjStart;		// Triangles around vertex: Adj[AdjStart[v]] ... Adj[AdjStart[v + 1] - 1]
+	ulong * Adj;
+	sModelMesh Src;			// Original mesh
+};
+
+// Growing output buffer
+struct sLODBuffer
+{
+	uchar * Data;
+	ulong Size;
+	ulong Slots;
+};
+
+////////// Functions //////////
+static ulong LODBufferAdd(sLODBuffer * Buffer, const void * Data, ulong Size);					// Add data to buffer, returns position
+static void LODBoneMatrices(sModel * Model, double (*Matrices)[3][4]);							// Calculate bone transformations in default pose
+static bool LODLoadMesh(sModel * Model, sModelBodyPart * Part, sModelMesh * Src, double (*Matrices)[3][4], sLODMesh * Mesh);	// Load mesh triangles
+static void LODFreeMesh(sLODMesh * Mesh);														// Free memory
+static void LODBuildAdjacency(sLODMesh * Mesh);													// Find triangles around vertices
+static void LODInitQuadrics(sLODMesh * Mesh);													// Calculate quadrics, lock border vertices
+static double LODCost(const double * Q, const double * Pos);									// Quadric error at position
+static void LODTriNormal(const double * A, const double * B, const double * C, double * Normal);	// Triangle normal (not normalized)
+static bool LODCanCollapse(sLODMesh * Mesh, ulong From, ulong To);								// Check if collapse keeps mesh valid
+static void LODCollapse(sLODMesh * Mesh, ulong From, ulong To);									// Move vertex From into To
+static int LODCompareCandidates(const void * A, const void * B);								// qsort() callback
+static void LODSimplify(sLODMesh * Mesh, ulong TargetTris);										// Remove triangles until target count is reached
+static void LODWriteStrips(sLODMesh * Mesh, sLODBuffer * Buffer);								// Write triangle commands (strips)
+
+///////// Code /////////
+static ulong LODBufferAdd(sLODBuffer * Buffer, const void * Data, ulong Size)
+{
+	ulong Position = Buffer->Size;
+
+	// Nothing to add (padding of aligned data)
+	if (Size == 0)
+		return Position;
+
+	if (Buffer->Size + Size > Buffer->Slots)
+	{
+		while (Buffer->Size + Size > Buffer->Slots)
+			Buffer->Slots = Buffer->Slots ? Buffer->Slots * 2 : 4096;
+		Buffer->Data = (uchar *)realloc(Buffer->Data, Buffer->Slots);
+		if (Buffer->Data == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (Data != NULL)
+		memcpy(&Buffer->Data[Position], Data, Size);
+	else
+		memset(&Buffer->Data[Position], 0x00, Size);
+	Buffer->Size += Size;
+
+	return Position;
+}
+
+static void LODBoneMatrices(sModel * Model, double (*Matrices)[3][4])
+{
+	sModelBone * Bones = (sModelBone *)&Model->Data[Model->Header->BoneTableOffset];
+
+	for (ulong b = 0; b < Model->Header->BoneCount; b++)
+	{
+		double Local[3][4];
+		double q[4];
+		double sr, sp, sy, cr, cp, cy;
+
+		// Angles -> quaternion -> matrix (same as in HL SDK)
+		sy = sin(Bones[b].Value[5] * 0.5);	cy = cos(Bones[b].Value[5] * 0.5);
+		sp = sin(Bones[b].Value[4] * 0.5);	cp = cos(Bones[b].Value[4] * 0.5);
+		sr = sin(Bones[b].Value[3] * 0.5);	cr = cos(Bones[b].Value[3] * 0.5);
+		q[0] = sr * cp * cy - cr * sp * sy;
+		q[1] = cr * sp * cy + sr * cp * sy;
+		q[2] = cr * cp * sy - sr * sp * cy;
+		q[3] = cr * cp * cy + sr * sp * sy;
+
+		Local[0][0] = 1.0 - 2.0 * q[1] * q[1] - 2.0 * q[2] * q[2];
+		Local[1][0] = 2.0 * q[0] * q[1] + 2.0 * q[3] * q[2];
+		Local[2][0] = 2.0 * q[0] * q[2] - 2.0 * q[3] * q[1];
+		Local[0][1] = 2.0 * q[0] * q[1] - 2.0 * q[3] * q[2];
+		Local[1][1] = 1.0 - 2.0 * q[0] * q[0] - 2.0 * q[2] * q[2];
+		Local[2][1] = 2.0 * q[1] * q[2] + 2.0 * q[3] * q[0];
+		Local[0][2] = 2.0 * q[0] * q[2] + 2.0 * q[3] * q[1];
+		Local[1][2] = 2.0 * q[1] * q[2] - 2.0 * q[3] * q[0];
+		Local[2][2] = 1.0 - 2.0 * q[0] * q[0] - 2.0 * q[1] * q[1];
+		Local[0][3] = Bones[b].Value[0];
+		Local[1][3] = Bones[b].Value[1];
+		Local[2][3] = Bones[b].Value[2];
+
+		// Concatenate with parent
+		if (Bones[b].Parent < 0 || (ulong)Bones[b].Parent >= b)
+		{
+			memcpy(Matrices[b], Local, sizeof(Local));
+		}
+		else
+		{
+			double (*Parent)[4] = Matrices[Bones[b].Parent];
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 4; j++)
+					Matrices[b][i][j] = Parent[i][0] * Local[0][j] + Parent[i][1] * Local[1][j] + Parent[i][2] * Local[2][j];
+				Matrices[b][i][3] += Parent[i][3];
+			}
+		}
+	}
+}
+
+static bool LODLoadMesh(sModel * Model, sModelBodyPart * Part, sModelMesh * Src, double (*Matrices)[3][4], sLODMesh * Mesh)
+{
+	ulong Offset = Src->TriCmdOffset;
+	ulong TriSlots = 0;
+	long * Chain;		// Vertices with same position index (hash chains)
+	long * First;
+	sModelTriVert Cmd[3];
+	ulong Index[3];
+
+	memset(Mesh, 0x00, sizeof(sLODMesh));
+	memcpy(&Mesh->Src, Src, sizeof(sModelMesh));
+
+	if (!Model->CheckBounds(Part->VertOffset, Part->VertCount * 12) || !Model->CheckBounds(Part->VertBoneOffset, Part->VertCount) || Part->VertCount <= 0)
+		return false;
+
+	UTIL_CALLOC(long *, First, Part->VertCount, sizeof(long), exit(EXIT_FAILURE));
+	for (int v = 0; v < Part->VertCount; v++)
+		First[v] = -1;
+	Chain = NULL;
+
+	// Go through triangle commands
+	while (1)
+	{
+		short Count;
+		bool Fan;
+
+		if (!Model->CheckBounds(Offset, sizeof(short)))
+			break;
+		Count = *(short *)&Model->Data[Offset];
+		Offset += sizeof(short);
+		if (Count == 0)
+			break;
+		Fan = Count < 0;
+		if (Fan)
+			Count = -Count;
+		if (!Model->CheckBounds(Offset, Count * sizeof(sModelTriVert)))
+			break;
+
+		sModelTriVert * Cmds = (sModelTriVert *)&Model->Data[Offset];
+		Offset += Count * sizeof(sModelTriVert);
+
+		for (int i = 0; i + 2 < Count; i++)
+		{
+			// Same order as in GL triangle strips/fans
+			if (Fan)
+			{
+				Cmd[0] = Cmds[0];		Cmd[1] = Cmds[i + 1];	Cmd[2] = Cmds[i + 2];
+			}
+			else if (i % 2 == 0)
+			{
+				Cmd[0] = Cmds[i];		Cmd[1] = Cmds[i + 1];	Cmd[2] = Cmds[i + 2];
+			}
+			else
+			{
+				Cmd[0] = Cmds[i + 1];	Cmd[1] = Cmds[i];		Cmd[2] = Cmds[i + 2];
+			}
+
+			// Find or add vertices
+			bool Valid = true;
+			for (int c = 0; c < 3 && Valid; c++)
+			{
+				if (Cmd[c].Vert < 0 || Cmd[c].Vert >= Part->VertCount || Cmd[c].Norm < 0 || Cmd[c].Norm >= Part->NormCount)
+				{
+					Valid = false;
+					break;
+				}
+
+				long v;
+				for (v = First[Cmd[c].Vert]; v != -1; v = Chain[v])
+					if (!memcmp(&Mesh->Verts[v].Src, &Cmd[c], sizeof(sModelTriVert)))
+						break;
+
+				if (v == -1)
+				{
+					if ((Mesh->VertCount & 255) == 0)
+					{
+						Mesh->Verts = (sLODVert *)realloc(Mesh->Verts, (Mesh->VertCount + 256) * sizeof(sLODVert));
+						Chain = (long *)realloc(Chain, (Mesh->VertCount + 256) * sizeof(long));
+						if (Mesh->Verts == NULL || Chain == NULL)
+						{
+							UTIL_WAIT_KEY("Unable to allocate memory ...");
+							exit(EXIT_FAILURE);
+						}
+					}
+
+					v = Mesh->VertCount++;
+					sLODVert * Vert = &Mesh->Verts[v];
+					memset(Vert, 0x00, sizeof(sLODVert));
+					Vert->Src = Cmd[c];
+					Chain[v] = First[Cmd[c].Vert];
+					First[Cmd[c].Vert] = v;
+
+					// Transform to model space
+					float * Pos = (float *)&Model->Data[Part->VertOffset + Cmd[c].Vert * 12];
+					uchar Bone = Model->Data[Part->VertBoneOffset + Cmd[c].Vert];
+					if (Bone < Model->Header->BoneCount)
+					{
+						for (int k = 0; k < 3; k++)
+							Vert->Pos[k] = Matrices[Bone][k][0] * Pos[0] + Matrices[Bone][k][1] * Pos[1] + Matrices[Bone][k][2] * Pos[2] + Matrices[Bone][k][3];
+					}
+					else
+					{
+						for (int k = 0; k < 3; k++)
+							Vert->Pos[k] = Pos[k];
+					}
+				}
+
+				Index[c] = v;
+			}
+
+			// Skip broken and degenerate triangles
+			if (!Valid || Index[0] == Index[1] || Index[1] == Index[2] || Index[0] == Index[2])
+				continue;
+
+			if (Mesh->TriCount == TriSlots)
+			{
+				TriSlots = TriSlots ? TriSlots * 2 : 256;
+				Mesh->Tris = (sLODTri *)realloc(Mesh->Tris, TriSlots * sizeof(sLODTri));
+				if (Mesh->Tris == NULL)
+				{
+					UTIL_WAIT_KEY("Unable to allocate memory ...");
+					exit(EXIT_FAILURE);
+				}
+			}
+			memcpy(Mesh->Tris[Mesh->TriCount].V, Index, sizeof(Index));
+			Mesh->Tris[Mesh->TriCount].Dead = false;
+			Mesh->TriCount++;
+		}
+	}
+
+	free(First);
+	free(Chain);
+
+	Mesh->AliveTris = Mesh->TriCount;
+
+	// Triangles around vertices (+ 1 - empty meshes are allowed)
+	UTIL_MALLOC(ulong *, Mesh->AdjStart, (Mesh->VertCount + 1) * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Mesh->Adj, (Mesh->TriCount * 3 + 1) * sizeof(ulong), exit(EXIT_FAILURE));
+	LODInitQuadrics(Mesh);
+
+	return true;
+}
+
+static void LODFreeMesh(sLODMesh * Mesh)
+{
+	free(Mesh->Verts);
+	free(Mesh->Tris);
+	free(Mesh->AdjStart);
+	free(Mesh->Adj);
+	memset(Mesh, 0x00, sizeof(sLODMesh));
+}
+
+static void LODBuildAdjacency(sLODMesh * Mesh)
+{
+	memset(Mesh->AdjStart, 0x00, (Mesh->VertCount + 1) * sizeof(ulong));
+
+	// Count triangles around every vertex
+	for (ulong t = 0; t < Mesh->TriCount; t++)
+		if (!Mesh->Tris[t].Dead)
+			for (int c = 0; c < 3; c++)
+				Mesh->AdjStart[Mesh->Tris[t].V[c] + 1]++;
+	for (ulong v = 0; v < Mesh->VertCount; v++)
+		Mesh->AdjStart[v + 1] += Mesh->AdjStart[v];
+
+	// Fill lists (AdjStart is shifted during filling and restored after)
+	for (ulong t = 0; t < Mesh->TriCount; t++)
+		if (!Mesh->Tris[t].Dead)
+			for (int c = 0; c < 3; c++)
+				Mesh->Adj[Mesh->AdjStart[Mesh->Tris[t].V[c]]++] = t;
+	for (ulong v = Mesh->VertCount; v > 0; v--)
+		Mesh->AdjStart[v] = Mesh->AdjStart[v - 1];
+	Mesh->AdjStart[0] = 0;
+}
+
+static void LODTriNormal(const double * A, const double * B, const double * C, double * Normal)
+{
+	double U[3], V[3];
+
+	for (int k = 0; k < 3; k++)
+	{
+		U[k] = B[k] - A[k];
+		V[k] = C[k] - A[k];
+	}
+	Normal[0] = U[1] * V[2] - U[2] * V[1];
+	Normal[1] = U[2] * V[0] - U[0] * V[2];
+	Normal[2] = U[0] * V[1] - U[1] * V[0];
+}
+
+static void LODInitQuadrics(sLODMesh * Mesh)
+{
+	LODBuildAdjacency(Mesh);
+
+	for (ulong t = 0; t < Mesh->TriCount; t++)
+	{
+		sLODTri * Tri = &Mesh->Tris[t];
+		double N[3];
+		double Q[10];
+
+		// Plane of triangle (weighted by area)
+		LODTriNormal(Mesh->Verts[Tri->V[0]].Pos, Mesh->Verts[Tri->V[1]].Pos, Mesh->Verts[Tri->V[2]].Pos, N);
+		double Len = sqrt(N[0] * N[0] + N[1] * N[1] + N[2] * N[2]);
+		if (Len == 0)
+			continue;
+		double Area = Len / 2;
+		for (int k = 0; k < 3; k++)
+			N[k] /= Len;
+		double D = -(N[0] * Mesh->Verts[Tri->V[0]].Pos[0] + N[1] * Mesh->Verts[Tri->V[0]].Pos[1] + N[2] * Mesh->Verts[Tri->V[0]].Pos[2]);
+
+		Q[0] = N[0] * N[0];	Q[1] = N[0] * N[1];	Q[2] = N[0] * N[2];	Q[3] = N[0] * D;
+		Q[4] = N[1] * N[1];	Q[5] = N[1] * N[2];	Q[6] = N[1] * D;
+		Q[7] = N[2] * N[2];	Q[8] = N[2] * D;
+		Q[9] = D * D;
+
+		for (int c = 0; c < 3; c++)
+			for (int k = 0; k < 10; k++)
+				Mesh->Verts[Tri->V[c]].Q[k] += Q[k] * Area;
+	}
+
+	// Lock vertices on open edges: mesh borders and seams (vertices with different normals or
+	// texture coordinates are different vertices), so outline and texture mapping are preserved
+	for (ulong v = 0; v < Mesh->VertCount; v++)
+	{
+		for (ulong a = Mesh->AdjStart[v]; a < Mesh->AdjStart[v + 1] && !Mesh->Verts[v].Locked; a++)
+		{
+			sLODTri * Tri = &Mesh->Tris[Mesh->Adj[a]];
+			for (int c = 0; c < 3; c++)
+			{
+				ulong Next = Tri->V[c];
+				if (Next == v)
+					continue;
+
+				// Count triangles that share edge v-Next
+				int Shared = 0;
+				for (ulong b = Mesh->AdjStart[v]; b < Mesh->AdjStart[v + 1]; b++)
+				{
+					sLODTri * Other = &Mesh->Tris[Mesh->Adj[b]];
+					if (Other->V[0] == Next || Other->V[1] == Next || Other->V[2] == Next)
+						Shared++;
+				}
+				if (Shared != 2)
+				{
+					Mesh->Verts[v].Locked = true;
+					Mesh->Verts[Next].Locked = true;
+				}
+			}
+		}
+	}
+}
+
+static double LODCost(const double * Q, const double * Pos)
+{
+	double x = Pos[0], y = Pos[1], z = Pos[2];
+
+	return Q[0] * x * x + 2 * Q[1] * x * y + 2 * Q[2] * x * z + 2 * Q[3] * x +
+			Q[4] * y * y + 2 * Q[5] * y * z + 2 * Q[6] * y +
+			Q[7] * z * z + 2 * Q[8] * z +
+			Q[9];
+}
+
+static bool LODCanCollapse(sLODMesh * Mesh, ulong From, ulong To)
+{
+	static ulong Stamp = 0;
+	int Shared = 0;
+	int Common = 0;
+
+	// Link condition: common neighbours of From and To are only the ones from shared triangles
+	Stamp++;
+	for (ulong a = Mesh->AdjStart[From]; a < Mesh->AdjStart[From + 1]; a++)
+	{
+		sLODTri * Tri = &Mesh->Tris[Mesh->Adj[a]];
+		if (Tri->Dead)
+			continue;
+		if (Tri->V[0] == To || Tri->V[1] == To || Tri->V[2] == To)
+			Shared++;
+		for (int c = 0; c < 3; c++)
+			Mesh->Verts[Tri->V[c]].Stamp = Stamp;
+	}
+	if (Shared == 0)
+		return false;
+	for (ulong a = Mesh->AdjStart[To]; a < Mesh->AdjStart[To + 1]; a++)
+	{
+		sLODTri * Tri = &Mesh->Tris[Mesh->Adj[a]];
+		if (Tri->Dead)
+			continue;
+		for (int c = 0; c < 3; c++)
+		{
+			ulong v = Tri->V[c];
+			if (v != From && v != To && Mesh->Verts[v].Stamp == Stamp)
+			{
+				Common++;
+				Mesh->Verts[v].Stamp = 0;		// Count once
+			}
+		}
+	}
+	if (Common != Shared)
+		return false;
+
+	// Triangles that are left must not flip or degenerate
+	for (ulong a = Mesh->AdjStart[From]; a < Mesh->AdjStart[From + 1]; a++)
+	{
+		sLODTri * Tri = &Mesh->Tris[Mesh->Adj[a]];
+		if (Tri->Dead || Tri->V[0] == To || Tri->V[1] == To || Tri->V[2] == To)
+			continue;
+
+		const double * Old[3];
+		const double * New[3];
+		double OldNormal[3], NewNormal[3];
+		for (int c = 0; c < 3; c++)
+		{
+			Old[c] = Mesh->Verts[Tri->V[c]].Pos;
+			New[c] = Tri->V[c] == From ? Mesh->Verts[To].Pos : Old[c];
+		}
+		LODTriNormal(Old[0], Old[1], Old[2], OldNormal);
+		LODTriNormal(New[0], New[1], New[2], NewNormal);
+
+		double Dot = OldNormal[0] * NewNormal[0] + OldNormal[1] * NewNormal[1] + OldNormal[2] * NewNormal[2];
+		double OldLen = sqrt(OldNormal[0] * OldNormal[0] + OldNormal[1] * OldNormal[1] + OldNormal[2] * OldNormal[2]);
+		double NewLen = sqrt(NewNormal[0] * NewNormal[0] + NewNormal[1] * NewNormal[1] + NewNormal[2] * NewNormal[2]);
+		if (NewLen <= OldLen * 0.01 || Dot < 0.2 * OldLen * NewLen)
+			return false;
+	}
+
+	return true;
+}
+
+static void LODCollapse(sLODMesh * Mesh, ulong From, ulong To)
+{
+	for (ulong a = Mesh->AdjStart[From]; a < Mesh->AdjStart[From + 1]; a++)
+	{
+		sLODTri * Tri = &Mesh->Tris[Mesh->Adj[a]];
+		if (Tri->Dead)
+			continue;
+
+		for (int c = 0; c < 3; c++)
+			Mesh->Verts[Tri->V[c]].Touched = true;
+
+		if (Tri->V[0] == To || Tri->V[1] == To || Tri->V[2] == To)
+		{
+			Tri->Dead = true;
+			Mesh->AliveTris--;
+		}
+		else
+		{
+			for (int c = 0; c < 3; c++)
+				if (Tri->V[c] == From)
+					Tri->V[c] = To;
+		}
+	}
+
+	for (int k = 0; k < 10; k++)
+		Mesh->Verts[To].Q[k] += Mesh->Verts[From].Q[k];
+	Mesh->Verts[From].Dead = true;
+}
+
+static int LODCompareCandidates(const void * A, const void * B)
+{
+	double CostA = ((const sLODCandidate *)A)->Cost;
+	double CostB = ((const sLODCandidate *)B)->Cost;
+
+	if (CostA < CostB)
+		return -1;
+	if (CostA > CostB)
+		return 1;
+	return 0;
+}
+
+static void LODSimplify(sLODMesh * Mesh, ulong TargetTris)
+{
+	sLODCandidate * Candidates;
+
+	UTIL_MALLOC(sLODCandidate *, Candidates, (Mesh->TriCount * 6 + 1) * sizeof(sLODCandidate), exit(EXIT_FAILURE));
+
+	// Every pass collapses cheapest edges that don't touch each other, then costs are updated
+	while (Mesh->AliveTris > TargetTris)
+	{
+		ulong CandidateCount = 0;
+		ulong Collapsed = 0;
+
+		LODBuildAdjacency(Mesh);
+		for (ulong t = 0; t < Mesh->TriCount; t++)
+		{
+			sLODTri * Tri = &Mesh->Tris[t];
+			if (Tri->Dead)
+				continue;
+
+			for (int c = 0; c < 3; c++)
+			{
+				for (int d = 1; d < 3; d++)
+				{
+					ulong From = Tri->V[c];
+					ulong To = Tri->V[(c + d) % 3];
+					if (Mesh->Verts[From].Locked)
+						continue;
+
+					double Q[10];
+					for (int k = 0; k < 10; k++)
+						Q[k] = Mesh->Verts[From].Q[k] + Mesh->Verts[To].Q[k];
+					Candidates[CandidateCount].Cost = LODCost(Q, Mesh->Verts[To].Pos);
+					Candidates[CandidateCount].From = From;
+					Candidates[CandidateCount].To = To;
+					CandidateCount++;
+				}
+			}
+		}
+		qsort(Candidates, CandidateCount, sizeof(sLODCandidate), LODCompareCandidates);
+
+		for (ulong v = 0; v < Mesh->VertCount; v++)
+			Mesh->Verts[v].Touched = false;
+		for (ulong i = 0; i < CandidateCount && Mesh->AliveTris > TargetTris; i++)
+		{
+			ulong From = Candidates[i].From;
+			ulong To = Candidates[i].To;
+
+			if (Mesh->Verts[From].Touched || Mesh->Verts[To].Touched || Mesh->Verts[From].Dead || Mesh->Verts[To].Dead)
+				continue;
+			if (!LODCanCollapse(Mesh, From, To))
+				continue;
+
+			LODCollapse(Mesh, From, To);
+			Collapsed++;
+		}
+
+		if (Collapsed == 0)
+			break;		// Nothing left to remove
+	}
+
+	free(Candidates);
+}
+
+static void LODWriteStrips(sLODMesh * Mesh, sLODBuffer * Buffer)
+{
+	bool * Used;
+	ulong * Strip;
+	short Count;
+
+	UTIL_CALLOC(bool *, Used, Mesh->TriCount + 1, sizeof(bool), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Strip, (Mesh->AliveTris + 2) * sizeof(ulong), exit(EXIT_FAILURE));
+	LODBuildAdjacency(Mesh);
+
+	for (ulong t = 0; t < Mesh->TriCount; t++)
+	{
+		if (Mesh->Tris[t].Dead || Used[t])
+			continue;
+
+		// Start new strip
+		ulong Len = 3;
+		memcpy(Strip, Mesh->Tris[t].V, 3 * sizeof(ulong));
+		Used[t] = true;
+
+		// Extend strip with neighbour triangles, winding alternates: even triangles use edge A->B, odd ones - B->A
+		while (Len < 0x7FFF)
+		{
+			ulong A = Strip[Len - 2];
+			ulong B = Strip[Len - 1];
+			if ((Len - 2) % 2 == 1)
+			{
+				ulong Swap = A;
+				A = B;
+				B = Swap;
+			}
+
+			bool Found = false;
+			for (ulong a = Mesh->AdjStart[A]; a < Mesh->AdjStart[A + 1] && !Found; a++)
+			{
+				ulong n = Mesh->Adj[a];
+				if (Used[n])
+					continue;
+				for (int c = 0; c < 3; c++)
+				{
+					if (Mesh->Tris[n].V[c] == A && Mesh->Tris[n].V[(c + 1) % 3] == B)
+					{
+						Strip[Len++] = Mesh->Tris[n].V[(c + 2) % 3];
+						Used[n] = true;
+						Found = true;
+						break;
+					}
+				}
+			}
+			if (!Found)
+				break;
+		}
+
+		// Write strip
+		Count = (short)Len;
+		LODBufferAdd(Buffer, &Count, sizeof(short));
+		for (ulong i = 0; i < Len; i++)
+			LODBufferAdd(Buffer, &Mesh->Verts[Strip[i]].Src, sizeof(sModelTriVert));
+	}
+
+	// End of commands
+	Count = 0;
+	LODBufferAdd(Buffer, &Count, sizeof(short));
+
+	free(Strip);
+	free(Used);
+}
+
+bool LODGenerate(sModel * Model, sDOLExtraSection * DOLExtraSect, sDOLLODEntry ** LODTable)
+{
+	const double Ratios[LOD_LEVELS] = LOD_RATIOS;
+	sModelHeader * Header = Model->Header;
+	sModelBodyGroup * Groups;
+	ulong GroupCount = Header->SubmeshCount;
+	sLODBuffer Extra = {NULL, 0, 0};
+	sLODBuffer Entries = {NULL, 0, 0};		// LOD entries of all body parts (including new ones)
+	ulong * GroupEntries;					// Number of body parts in every group after generation
+	double (*Matrices)[3][4];
+	ulong Base = Header->TextureTableOffset;
+	ulong MaxParts = 0;
+	ulong Generated = 0;
+	ulong Present = 0;						// Body parts that already have LODs
+
+	// Check tables
+	if (GroupCount == 0 || GroupCount > 0xFF || !Model->CheckBounds(Header->SubmeshTableOffset, GroupCount * sizeof(sModelBodyGroup)) ||
+		Header->SubmeshTableOffset + GroupCount * sizeof(sModelBodyGroup) > Base)
+	{
+		puts("Can't find body groups ...");
+		return false;
+	}
+	if (!Model->CheckBounds(Header->BoneTableOffset, Header->BoneCount * sizeof(sModelBone)))
+	{
+		puts("Bone table is out of file bounds ...");
+		return false;
+	}
+	Groups = (sModelBodyGroup *)&Model->Data[Header->SubmeshTableOffset];
+
+	// Model size -> LOD distances
+	double Size = 0;
+	for (int k = 0; k < 3; k++)
+		Size += (Header->BBMax[k] - Header->BBMin[k]) * (Header->BBMax[k] - Header->BBMin[k]);
+	Size = sqrt(Size);
+	if (Size < 1)
+		Size = LOD_DEFAULT_SIZE;
+
+	UTIL_CALLOC(double (*)[3][4], Matrices, Header->BoneCount + 1, sizeof(double[3][4]), exit(EXIT_FAILURE));
+	LODBoneMatrices(Model, Matrices);
+	UTIL_CALLOC(ulong *, GroupEntries, GroupCount, sizeof(ulong), exit(EXIT_FAILURE));
+
+	// New data is placed after model data (before texture table), align it
+	LODBufferAdd(&Extra, NULL, (4 - Base % 4) % 4);
+
+	puts("Generating LODs ...");
+	for (ulong g = 0; g < GroupCount; g++)
+	{
+		sModelBodyGroup * Group = &Groups[g];
+		sLODBuffer Parts = {NULL, 0, 0};		// New body part table
+		bool Changed = false;
+		ulong OldLODs = 0;					// LODs of present body part that are left to copy
+
+		if (Group->PartCount <= 0 || !Model->CheckBounds(Group->PartTableOffset, Group->PartCount * sizeof(sModelBodyPart)))
+		{
+			printf("Body group %i is damaged, skipping ...\n", (int)g);
+			GroupEntries[g] = Group->PartCount > 0 ? Group->PartCount : 0;
+			for (ulong p = 0; p < GroupEntries[g]; p++)
+				LODBufferAdd(&Entries, NULL, sizeof(sDOLLODEntry));
+			continue;
+		}
+
+		for (int p = 0; p < Group->PartCount; p++)
+		{
+			sModelBodyPart Part;
+			sModelBodyPart LODParts[LOD_LEVELS];
+			sDOLLODEntry Entry;
+			sLODMesh * Meshes = NULL;
+			int MeshCount = 0;
+			ulong SrcTris = 0;
+			ulong LODCount = 0;
+
+			memcpy(&Part, &Model->Data[Group->PartTableOffset + p * sizeof(sModelBodyPart)], sizeof(sModelBodyPart));
+			memset(&Entry, 0x00, sizeof(Entry));
+
+			// LODs from *.INF file are kept, so LODs aren't made from LODs
+			if (*LODTable != NULL && g < DOLExtraSect->NumBodyGroups && (ulong)p < DOLExtraSect->MaxBodyParts)
+				memcpy(&Entry, &(*LODTable)[g * DOLExtraSect->MaxBodyParts + p], sizeof(sDOLLODEntry));
+			if (OldLODs > 0 || Entry.LODCount > 0)
+			{
+				if (OldLODs > 0)
+				{
+					OldLODs--;
+				}
+				else
+				{
+					printf(" %.64s / %.64s: LODs are present, skipping\n", Group->Name, Part.Name);
+					OldLODs = Entry.LODCount;
+					Present++;
+				}
+				LODBufferAdd(&Parts, &Part, sizeof(sModelBodyPart));
+				LODBufferAdd(&Entries, &Entry, sizeof(sDOLLODEntry));
+				continue;
+			}
+
+			// Load meshes
+			if (Part.MeshCount > 0 && Model->CheckBounds(Part.MeshTableOffset, Part.MeshCount * sizeof(sModelMesh)))
+			{
+				UTIL_CALLOC(sLODMesh *, Meshes, Part.MeshCount, sizeof(sLODMesh), exit(EXIT_FAILURE));
+				for (MeshCount = 0; MeshCount < Part.MeshCount; MeshCount++)
+				{
+					sModelMesh * Src = (sModelMesh *)&Model->Data[Part.MeshTableOffset + MeshCount * sizeof(sModelMesh)];
+					if (!LODLoadMesh(Model, &Part, Src, Matrices, &Meshes[MeshCount]))
+						break;
+					SrcTris += Meshes[MeshCount].TriCount;
+				}
+			}
+
+			// Simplify
+			if (MeshCount == Part.MeshCount && SrcTris >= LOD_MIN_TRIS)
+			{
+				ulong PrevTris = SrcTris;
+				printf(" %.64s / %.64s: %u", Group->Name, Part.Name, (uint)SrcTris);
+
+				for (ulong l = 0; l < LOD_LEVELS; l++)
+				{
+					ulong LODTris = 0;
+					for (int m = 0; m < MeshCount; m++)
+					{
+						LODSimplify(&Meshes[m], (ulong)ceil(Meshes[m].TriCount * Ratios[l]));
+						LODTris += Meshes[m].AliveTris;
+					}
+					if (LODTris > PrevTris * LOD_MIN_GAIN)
+						break;		// Not worth it
+
+					// Triangle commands
+					sModelMesh * NewMeshes;
+					UTIL_MALLOC(sModelMesh *, NewMeshes, MeshCount * sizeof(sModelMesh), exit(EXIT_FAILURE));
+					for (int m = 0; m < MeshCount; m++)
+					{
+						memcpy(&NewMeshes[m], &Meshes[m].Src, sizeof(sModelMesh));
+						NewMeshes[m].TriCount = Meshes[m].AliveTris;
+						NewMeshes[m].TriCmdOffset = Base + Extra.Size;
+						LODWriteStrips(&Meshes[m], &Extra);
+						LODBufferAdd(&Extra, NULL, (4 - Extra.Size % 4) % 4);
+					}
+
+					// Mesh table and body part
+					memcpy(&LODParts[LODCount], &Part, sizeof(sModelBodyPart));
+					snprintf(LODParts[LODCount].Name, sizeof(LODParts[LODCount].Name), "%.56s_lod%u", Part.Name, (uint)LODCount + 1);
+					LODParts[LODCount].MeshTableOffset = Base + LODBufferAdd(&Extra, NewMeshes, MeshCount * sizeof(sModelMesh));
+					free(NewMeshes);
+
+					Entry.LODDistances[LODCount] = (ulong)(Size * LOD_DISTANCE_SCALE) << LODCount;
+					LODCount++;
+					PrevTris = LODTris;
+					printf(" -> %u", (uint)LODTris);
+				}
+				printf(" triangles\n");
+			}
+
+			for (int m = 0; m < MeshCount; m++)
+				LODFreeMesh(&Meshes[m]);
+			free(Meshes);
+
+			// Body part is followed by its LODs
+			Entry.LODCount = LODCount;
+			LODBufferAdd(&Parts, &Part, sizeof(sModelBodyPart));
+			LODBufferAdd(&Entries, &Entry, sizeof(sDOLLODEntry));
+			memset(&Entry, 0x00, sizeof(Entry));
+			for (ulong l = 0; l < LODCount; l++)
+			{
+				LODBufferAdd(&Parts, &LODParts[l], sizeof(sModelBodyPart));
+				LODBufferAdd(&Entries, &Entry, sizeof(sDOLLODEntry));
+			}
+			if (LODCount != 0)
+				Changed = true;
+			Generated += LODCount;
+		}
+
+		// Update group
+		GroupEntries[g] = Parts.Size / sizeof(sModelBodyPart);
+		if (Changed == true)
+		{
+			if (GroupEntries[g] > 0xFF)
+			{
+				printf("Too many body parts in group %.64s ...\n", Group->Name);
+				free(Parts.Data);
+				free(Extra.Data);
+				free(Entries.Data);
+				free(GroupEntries);
+				free(Matrices);
+				return false;
+			}
+			Group->PartTableOffset = Base + LODBufferAdd(&Extra, Parts.Data, Parts.Size);
+			Group->PartCount = GroupEntries[g];
+		}
+		free(Parts.Data);
+	}
+	free(Matrices);
+
+	if (Generated == 0)
+	{
+		if (Present > 0)
+			puts("Model already has LODs ...");
+		else
+			puts("Model is too simple for LODs ...");
+		free(Extra.Data);
+		free(Entries.Data);
+		free(GroupEntries);
+		return false;
+	}
+
+	// LOD table: entry for every body part of every group
+	for (ulong g = 0; g < GroupCount; g++)
+		if (GroupEntries[g] > MaxParts)
+			MaxParts = GroupEntries[g];
+	free(*LODTable);
+	UTIL_CALLOC(sDOLLODEntry *, *LODTable, GroupCount * MaxParts, sizeof(sDOLLODEntry), exit(EXIT_FAILURE));
+	sDOLLODEntry * Entry = (sDOLLODEntry *)Entries.Data;
+	for (ulong g = 0; g < GroupCount; g++)
+		for (ulong p = 0; p < GroupEntries[g]; p++)
+			memcpy(&(*LODTable)[g * MaxParts + p], Entry++, sizeof(sDOLLODEntry));
+	DOLExtraSect->NumBodyGroups = GroupCount;
+	DOLExtraSect->MaxBodyParts = MaxParts;
+
+	// Add new data to model
+	Model->AppendBody(Extra.Data, Extra.Size);
+	printf("Added %u LOD body part(s), %u bytes\n", (uint)Generated, (uint)Extra.Size);
+
+	free(Extra.Data);
+	free(Entries.Data);
+	free(GroupEntries);
+
+	return true;
+}
@@ -17,7 +17,7 @@
 #include <ctype.h>		// tolower()
 
 ////////// Definitions //////////
-#define PROG_TITLE "\nPS2 HL model tool v1.15\n"
+#define PROG_TITLE "\nPS2 HL model tool v1.25\n"
 #define PROG_INFO "\
 Developed by supadupaplex, 2017-2021\n\
 License: BSD-3-Clause (check out license.txt)\n\
@@ -28,6 +28,17 @@ How to use:\n\
 Optional features:\n\
  - extract textures: mdltool extract [filename]\n\
  - report sequences: mdltool seqrep [filename]\n\
+ - convert *.MDL with generated LODs: mdltool lod [filename]\n\
+ - convert *.MDL with resampled textures: mdltool scale [filename] [budget in KB]\n\
+ - convert *.MDL with texture atlases: mdltool atlas [filename]\n\
+ - convert *.MDL with rebuilt triangle strips: mdltool restrip [filename]\n\
+ - convert *.MDL with reduced animations: mdltool anim [filename] [position error] [angle error]\n\
+ - convert *.MDL without unused data: mdltool diet [filename] [usage list]\n\
+ - report memory footprint: mdltool profile [files and folders]\n\
+ - report duplicate textures: mdltool texdup [files and folders]\n\
+ - convert *.MDL with merged duplicate textures: mdltool texmerge [filename]\n\
+ - convert folder (*.MDL -> *.DOL): mdltool batch [folder]\n\
+ - convert folder (*.DOL -> *.MDL): mdltool batch [folder] dol\n\
 \n\
 For more info check out readme.txt\n\
 "
@@ -46,6 +57,29 @@ For more info check out readme.txt\n\
 #define MDL_DEF_REF_SZ 0x68
 #define MDL_FILE_REF_SZ 0x48
 #define MDL_FILE_REF_SPACE 0x20
+#define LOD_LEVELS 2						// How many LODs are generated for every body part (4 is the max)
+#define LOD_RATIOS {0.5, 0.25}				// Triangle count of every LOD (relative to original body part)
+#define LOD_MIN_TRIS 64						// Don't generate LODs for simpler body parts
+#define LOD_MIN_GAIN 0.9					// Stop if LOD has more than 90% of triangles of previous one
+#define LOD_DISTANCE_SCALE 8				// Distance of first LOD = model size (clipping box diagonal) * scale, every next LOD is 2x farther
+#define LOD_DEFAULT_SIZE 72.0				// Model size if clipping box is not set
+#define MDL_TEXTURE_FLAGS 64				// Texture flags location (inside of texture name field)
+#define MDL_TEXTURE_MASKED 0x40				// Texture flag: color #255 is transparent
+#define PSI_PALETTE_VRAM 0x400				// VRAM used by PS2 texture palette (256 x RGBA)
+#define ATLAS_COUNT 2						// Max number of atlases per model
+#define ATLAS_MAX_SIZE 256					// Max atlas width/height
+#define ATLAS_PADDING 2						// Texture edges are repeated to avoid bleeding with bilinear filtering
+#define ANIM_POS_ERROR 0.05					// Default position error of animation reduction (units)
+#define ANIM_ANGLE_ERROR 0.1				// Default angle error of animation reduction (degrees)
+#define MDL_BONECONTROLLER_SIZE 24			// Size of bone controller table entry
+#define MDL_HITBOX_SIZE 32					// Size of hitbox table entry
+#define MDL_ATTACHMENT_SIZE 88				// Size of attachment table entry
+#define MDL_SEQ_HEADER_SIZE 76				// Size of sequence file header
+#define PROFILE_FILE "mdltool-profile"		// Footprint report (+ ".csv" and ".json")
+#define BATCH_CACHE_FILE "mdltool-batch"		// Batch conversion cache in every output folder (+ source format + ".txt")
+#define BATCH_CONVERTED 0
+#define BATCH_SKIPPED 1
+#define BATCH_FAILED 2
 
 // Keywords
 #define KWD_FADESTART "fadestart"
@@ -55,12 +89,21 @@ For more info check out readme.txt\n\
 #define KWD_GROUP "group"
 #define KWD_PART "part"
 #define KWD_BLANK "blank"
+#define KWD_SEQUENCE "sequence"
+#define KWD_BODY "body"
+#define KWD_SKIN "skin"
+
+// Parts of model footprint
+enum eProfilePart { PROFILE_HEADER = 0, PROFILE_BONES, PROFILE_BODYPARTS, PROFILE_MESHES, PROFILE_SEQUENCES, PROFILE_ANIMATIONS, PROFILE_TEXTURES, PROFILE_PALETTES, PROFILE_LOD, PROFILE_PADDING, PROFILE_POTWASTE, PROFILE_PARTS };
 
 ////////// Typedefs //////////
 #include "types.h"
 
 ////////// Functions //////////
 #include "fops.h"
+#include "resample.h"
+#include "palmatch.h"
+#include "palette.h"
 
 ////////// Structures //////////
 
@@ -72,7 +115,18 @@ struct sModelHeader
 	ulong Version;				// 0xA - GoldSrc model
 	char Name[64];				// Internal model name
 	ulong FileSize;				// Model file size
-	char SomeData1[88];			// Data that is not important for conversion
+	float EyePosition[3];		// Data that is not important for conversion
+	float Min[3];
+	float Max[3];
+	float BBMin[3];				// Clipping box
+	float BBMax[3];
+	ulong Flags;
+	ulong BoneCount;			// How many bones
+	ulong BoneTableOffset;		// Location of bone table
+	ulong BoneControllerCount;	// How many bone controllers
+	ulong BoneControllerOffset;	// Location of bone controller table
+	ulong HitboxCount;			// How many hitboxes
+	ulong HitboxOffset;			// Location of hitbox table
 	ulong SeqCount;				// How many sequences
 	ulong SeqTableOffset;		// Location of sequence table 
 	ulong SubmodelCount;		// How many submodels
@@ -83,9 +137,16 @@ struct sModelHeader
 	ulong SkinCount;			// How many skins
 	ulong SkinEntrySize;		// Size of entry in skin table (measured in shorts)
 	ulong SkinTableOffset;		// Location of skin table
-	ulong SubmeshCount;			// How many submeshes
+	ulong SubmeshCount;			// How many submeshes (body parts)
 	ulong SubmeshTableOffset;	// Location of submesh table
-	char SomeData2[32];			// Data that is not important for conversion
+	ulong AttachmentCount;		// How many attachments
+	ulong AttachmentOffset;		// Location of attachment table
+	ulong SoundTable;			// Unused
+	ulong SoundOffset;
+	ulong SoundGroups;
+	ulong SoundGroupOffset;
+	ulong TransitionCount;		// Size of transition table
+	ulong TransitionOffset;		// Location of transition table
 
 	void UpdateFromFile(FILE ** ptrFile)	// Update header from file
 	{
@@ -130,11 +191,131 @@ struct sModelHeader
 struct sModelSeq
 {
 	char Name[32];			// Sequence name
-	char SomeData1[124];
+	float FPS;				// Frames per second
+	int Flags;
+	int Activity;
+	int ActWeight;
+	int EventCount;			// How many events
+	int EventOffset;		// Location of event table
+	int FrameCount;			// How many frames
+	int PivotCount;			// How many pivots
+	int PivotOffset;		// Location of pivot table
+	int MotionType;
+	int MotionBone;
+	float LinearMovement[3];
+	int AutoMovePosOffset;
+	int AutoMoveAngleOffset;
+	float BBMin[3];
+	float BBMax[3];
+	int BlendCount;			// How many blends
+	int AnimOffset;			// Location of animation data (in sequence file)
+	char SomeData1[24];		// Blend types and ranges
+	int BlendParent;
 	int Num;				// Sequence file number
 	char SomeData2[16];
 };
 
+// MDL/DOL animation event
+#pragma pack(1)					// No padding/spacers
+struct sModelEvent
+{
+	int Frame;
+	int Event;
+	int Type;
+	char Options[64];
+};
+
+// MDL/DOL sequence pivot
+#pragma pack(1)					// No padding/spacers
+struct sModelPivot
+{
+	float Org[3];
+	int Start;
+	int End;
+};
+
+// MDL/DOL sequence file (group) descriptor
+#pragma pack(1)					// No padding/spacers
+struct sModelSeqGroup
+{
+	char Label[32];
+	char Name[64];			// File name
+	int Cache;
+	int Data;				// Base of animation offsets
+};
+
+// MDL/DOL bone animation: offsets of animation values for every channel (X, Y, Z, rotation X, Y, Z),
+// offsets are relative to this structure, 0 - channel is always 0.
+// Values are run-length encoded: header (byte: how many values, byte: how many frames) + values (shorts),
+// last value is repeated until frame count is reached
+#pragma pack(1)					// No padding/spacers
+struct sModelAnim
+{
+	ushort Offset[6];
+};
+
+// MDL/DOL bone
+#pragma pack(1)					// No padding/spacers
+struct sModelBone
+{
+	char Name[32];			// Bone name
+	int Parent;				// Parent bone (-1 - root)
+	int Flags;
+	int Controllers[6];
+	float Value[6];			// Default position (X, Y, Z) and rotation (X, Y, Z, radians)
+	float Scale[6];
+};
+
+// MDL/DOL body group (submesh table entry)
+#pragma pack(1)					// No padding/spacers
+struct sModelBodyGroup
+{
+	char Name[64];			// Body group name
+	int PartCount;			// How many body parts
+	int Base;				// Body value multiplier
+	int PartTableOffset;	// Location of body part table
+};
+
+// MDL/DOL body part (model)
+#pragma pack(1)					// No padding/spacers
+struct sModelBodyPart
+{
+	char Name[64];			// Body part name
+	int Type;
+	float BoundingRadius;
+	int MeshCount;			// How many meshes
+	int MeshTableOffset;	// Location of mesh table
+	int VertCount;			// How many vertices
+	int VertBoneOffset;		// Location of vertex bone indices (1 byte per vertex)
+	int VertOffset;			// Location of vertices (3 floats per vertex)
+	int NormCount;			// How many normals
+	int NormBoneOffset;		// Location of normal bone indices
+	int NormOffset;			// Location of normals
+	int GroupCount;
+	int GroupOffset;
+};
+
+// MDL/DOL mesh
+#pragma pack(1)					// No padding/spacers
+struct sModelMesh
+{
+	int TriCount;			// How many triangles
+	int TriCmdOffset;		// Location of triangle commands
+	int SkinRef;			// Texture
+	int NormCount;
+	int NormOffset;
+};
+
+// MDL/DOL triangle command vertex (commands are: short count (> 0 - strip, < 0 - fan, 0 - end) + vertices)
+#pragma pack(1)					// No padding/spacers
+struct sModelTriVert
+{
+	short Vert;				// Vertex index
+	short Norm;				// Normal index
+	short S;				// Texture coordinates
+	short T;
+};
+
 
 // Extra section of DOL model headers
 #pragma pack(1)					// Eliminate unwanted 0x00 bytes
@@ -298,6 +479,40 @@ struct sTexture
 		this->PaletteSize = FilePaletteSize;
 	}
 
+	void UpdateFromMemory(const uchar * Data, ulong BitmapOffset, ulong BitmapSize, ulong PaletteOffset, ulong NewPaletteSize, const char * NewName, ulong NewWidth, ulong NewHeight)	// Update from model loaded to memory
+	{
+		// Destroy old palette and bitmap
+		free(Palette);
+		free(Bitmap);
+
+		// Allocate memory for new ones
+		Palette = (uchar *) malloc(NewPaletteSize);
+		Bitmap = (uchar *) malloc(BitmapSize);
+		if (Palette == NULL || Bitmap == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+
+		// Copy data
+		memcpy(Palette, &Data[PaletteOffset], NewPaletteSize);
+		memcpy(Bitmap, &Data[BitmapOffset], BitmapSize);
+
+		// Update other fields
+		strcpy(this->Name, NewName);
+		this->Width = NewWidth;
+		this->Height = NewHeight;
+		this->PaletteSize = NewPaletteSize;
+	}
+
+	void Free()					// Free bitmap and palette
+	{
+		free(Palette);
+		free(Bitmap);
+		Palette = NULL;
+		Bitmap = NULL;
+	}
+
 	/*void Rename(const char * NewName)
 	{
 		// Clear name from garbage and leftovers
@@ -327,16 +542,12 @@ struct sTexture
 		}
 
 		// Copy resized old bitmap to new one
-		for (int NewY = 0; NewY < NewHeight; NewY++)
-			for (int NewX = 0; NewX < NewWidth; NewX++)
-			{
-				int OldY = (int) round((double) NewY / (NewHeight - 1) * (this->Height - 1));
-				int OldX = (int) round((double) NewX / (NewWidth - 1) * (this->Width - 1));
-
-				NewBitmap[(NewWidth * NewY) + NewX] = this->Bitmap[(this->Width * OldY) + OldX];
-			}
+		if (ResampleBitmap(this->Bitmap, this->Width, this->Height, (uchar *)NewBitmap, NewWidth, NewHeight, 1, RESAMPLE_NEAREST) == false)
+		{
+			UTIL_WAIT_KEY("Unable to resize bitmap ...");
+			exit(EXIT_FAILURE);
+		}
 
-		
 		// Destroy old bitmap
 		free(this->Bitmap);
 
@@ -348,6 +559,59 @@ struct sTexture
 		this->Height = NewHeight;
 	}
 
+	void FilterResize(ulong NewWidth, ulong NewHeight)			// Resize bitmap with filtering (in RGB), result is matched to the same palette. Palette must be in MDL format.
+	{
+		uchar * OldRGB;
+		uchar * NewRGB;
+		sPaletteMatcher * Matcher;
+
+		// Allocate memory
+		OldRGB = (uchar *)malloc(this->Width * this->Height * 3);
+		NewRGB = (uchar *)malloc(NewWidth * NewHeight * 3);
+		Matcher = (sPaletteMatcher *)malloc(sizeof(sPaletteMatcher));
+		if (OldRGB == NULL || NewRGB == NULL || Matcher == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		if (Matcher->Init(this->Palette, this->PaletteSize) == false)
+		{
+			UTIL_WAIT_KEY("Unknown palette format ...");
+			exit(EXIT_FAILURE);
+		}
+
+		// Indexed -> RGB
+		for (ulong i = 0; i < this->Width * this->Height; i++)
+			memcpy(&OldRGB[i * 3], &this->Palette[this->Bitmap[i] * 3], 3);
+
+		// Resize (area average for downscaling, bilinear for upscaling)
+		int Filter = (NewWidth <= this->Width && NewHeight <= this->Height) ? RESAMPLE_BOX : RESAMPLE_BILINEAR;
+		if (ResampleBitmap(OldRGB, this->Width, this->Height, NewRGB, NewWidth, NewHeight, 3, Filter) == false)
+		{
+			UTIL_WAIT_KEY("Unable to resize bitmap ...");
+			exit(EXIT_FAILURE);
+		}
+
+		// RGB -> indexed
+		free(this->Bitmap);
+		this->Bitmap = (uchar *)malloc(NewWidth * NewHeight);
+		if (this->Bitmap == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		for (ulong i = 0; i < NewWidth * NewHeight; i++)
+			this->Bitmap[i] = Matcher->Find(NewRGB[i * 3], NewRGB[i * 3 + 1], NewRGB[i * 3 + 2], 0);
+
+		// Update bitmap size
+		this->Width = NewWidth;
+		this->Height = NewHeight;
+
+		free(Matcher);
+		free(NewRGB);
+		free(OldRGB);
+	}
+
 	void TileResize(ulong NewWidth, ulong NewHeight)			// Resize bitmap by tiling old in new one. Used for MDL to DOL conversion.
 	{
 		char * NewBitmap;
@@ -360,31 +624,17 @@ struct sTexture
 			exit(EXIT_FAILURE);
 		}
 
-		// Tile new bitmap with old one
-		uint NewX, NewY, OldX, OldY;
-		OldX = 0;
-		OldY = 0;
-		for (int NewY = 0; NewY < NewHeight; NewY++)
+		// Tile new bitmap with old one (whole row pieces are copied at once)
+		for (ulong NewY = 0; NewY < NewHeight; NewY++)
 		{
-			for (int NewX = 0; NewX < NewWidth; NewX++)
+			uchar * OldRow = &this->Bitmap[this->Width * (NewY % this->Height)];
+			for (ulong NewX = 0; NewX < NewWidth; NewX += this->Width)
 			{
-				if (NewX == 0)
-					OldX = 0;
-
-				NewBitmap[(NewWidth * NewY) + NewX] = this->Bitmap[(this->Width * OldY) + OldX];
-
-				OldX++;
-				if (OldX >= this->Width)
-					OldX = 0;
+				ulong Piece = NewWidth - NewX < this->Width ? NewWidth - NewX : this->Width;
+				memcpy(&NewBitmap[(NewWidth * NewY) + NewX], OldRow, Piece);
 			}
-			OldY++;
-			if (OldY >= this->Height)
-				OldY = 0;
-
 		}
 
-
-
 		// Destroy old bitmap
 		free(this->Bitmap);
 
@@ -422,20 +672,7 @@ struct sTexture
 
 	void PaletteReformat(uint PaletteElementSize)			// Reposition color table elements. Used for DOL to MDL and MDL to DOL conversions.
 	{
-		uchar Remainder;
-		uchar Temp;
-
-		for (ulong i = 0; i < this->PaletteSize; i++)
-		{
-			Remainder = i % (0x20 * PaletteElementSize);
-
-			if (((0x10 * PaletteElementSize) <= Remainder) && (Remainder < (0x18 * PaletteElementSize)))
-			{
-				Temp = this->Palette[i];
-				this->Palette[i] = this->Palette[i - (0x08 * PaletteElementSize)];
-				this->Palette[i - (0x08 * PaletteElementSize)] = Temp;
-			}
-		}
+		PaletteTranscode(this->Palette, this->PaletteSize, PaletteElementSize, PAL_SWIZZLE);
 	}
 
 	/*
@@ -545,15 +782,110 @@ struct sTexture
 
 	void PaletteSwapRedAndGreen(int ElementSize)		// Needed for MDL/DOL to BMP conversion and vice versa.
 	{
-		char Temp;
+		PaletteTranscode(this->Palette, EIGHT_BIT_PALETTE_ELEMENTS_COUNT * ElementSize, ElementSize, PAL_SWAP_RB);
+	}
+};
 
-		for (int Element = 0; Element < EIGHT_BIT_PALETTE_ELEMENTS_COUNT; Element++)	// Swap 1-st and 3-rd bytes in element
-		{
-			Temp = this->Palette[Element * ElementSize];
-			this->Palette[Element * ElementSize] = this->Palette[Element * ElementSize + 2];
-			this->Palette[Element * ElementSize + 2] = Temp;
-		}
+// Whole model file loaded to memory. Header, model data, texture table and
+// skin table point into file buffer, textures are decoded to separate buffers.
+// Output layout is calculated before writing, so result is written at once
+struct sModel
+{
+	uchar * Data;							// Model file
+	ulong DataSize;							// Model file size
+	sModelHeader * Header;					// Model header
+	uchar * Body;							// Model data (between header and texture table)
+	ulong BodySize;							// Model data size
+	sModelTextureEntry * TextureTable;		// Texture table
+	uchar * SkinTable;						// Skin table
+	ulong SkinTableSize;					// Skin table size
+	sTexture * Textures;					// Decoded textures (empty until LoadTexture() is called)
+
+	void Initialize();																		// Initialize structure (must be called before anything else)
+	bool LoadFromFile(const char * FileName);												// Load model file and check tables (false - not a model with textures or damaged model)
+	bool CheckBounds(long Offset, ulong Size);												// Check that data is inside of loaded file
+	sModelMesh ** CollectMeshes(ulong * Count);												// List meshes of all body parts (sorted by triangle commands location, must be freed)
+	bool LoadTexture(ulong Index, bool DOL);												// Decode texture (DOL - PS2 layout, otherwise PC layout)
+	bool LoadTextures(bool DOL);															// Decode all textures
+	bool SaveMDL(const char * FileName);													// Write PC model
+	bool SaveDOL(const char * FileName, sDOLExtraSection * DOLExtraSect, sDOLLODEntry * LODTable);	// Write PS2 model (DOLExtraSect = NULL - no *.INF data)
+	void AppendBody(const void * Extra, ulong ExtraSize);									// Add data after model data (before texture table)
+	ulong CountOffsets(ulong Offset, ulong Size);											// How many offsets in model tables point inside of block
+	void ResizeBody(ulong Offset, ulong OldSize, const void * NewData, ulong NewSize);		// Replace block of model data and move offsets that point after it
+	void ReplaceTextures(sTexture * NewTextures, const sModelTextureEntry * NewTable, ulong NewCount, const uchar * NewSkinTable);	// Set new textures and tables (new skin table must have SkinTableSize bytes)
+	void Free();																			// Free memory
+};
+
+// LOD generator (lod.cpp)
+bool LODGenerate(sModel * Model, sDOLExtraSection * DOLExtraSect, sDOLLODEntry ** LODTable);	// Add simplified body parts and fill LOD table
+
+// Texture scaling (texscale.cpp)
+uint PSIProperSize(uint Size, bool ToLower);												// Calculate nearest appropriate size of PS2 DOL texture (mdltool.cpp)
+bool ScaleTextures(sModel * Model, ulong VRAMBudget);										// Resample textures to PS2 proper sizes and fix texture coordinates (VRAMBudget = 0 - no limit)
+
+// Texture atlases (atlas.cpp)
+bool AtlasTextures(sModel * Model);														// Pack textures into atlases, fix texture coordinates and rebuild texture and skin tables
+
+// Triangle command optimizer (restrip.cpp)
+bool RestripMeshes(sModel * Model);														// Rebuild triangle commands of all meshes as long strips/fans
+
+// Animation data reduction (anim.cpp)
+bool AnimReduce(sModel * Model, double PosError, double AngleError);						// Merge frames of animation channels within error (position - units, angle - degrees)
+ulong AnimSeqSize(sModel * Model, sModelSeq * Seq);											// Size of animation data of sequence from model file (0 - damaged)
+
+// Removal of unused data (diet.cpp)
+bool DietModel(sModel * Model, const char * UsageFile, sDOLExtraSection * DOLExtraSect, sDOLLODEntry * LODTable);	// Remove sequences, body parts and skins that aren't in usage list (LOD table can be NULL)
+
+// Memory footprint profiler (profile.cpp)
+void ProfileModels(int Count, char ** Paths);												// Report footprint of models (paths can be folders)
+
+// Texture deduplication (texdup.cpp)
+void TexDupCensus(int Count, char ** Paths);												// Report identical textures of models (paths can be folders)
+bool MergeTextures(sModel * Model);															// Replace identical textures of model with one texture and fix skin table
+
+// MDL -> DOL conversion options
+struct sConvertOptions
+{
+	bool GenerateLODs;						// Add simplified body parts
+	bool ScaleTextures;						// Resample textures instead of tiling
+	ulong VRAMBudget;						// Texture memory limit for scaling (bytes, 0 - no limit)
+	bool AtlasTextures;						// Pack textures into atlases
+	bool MergeTextures;						// Merge identical textures
+	bool RestripMeshes;						// Rebuild triangle commands
+	bool ReduceAnims;						// Merge animation frames
+	double AnimPosError;					// Position error for animation reduction (units)
+	double AnimAngleError;					// Angle error for animation reduction (degrees)
+	const char * DietList;					// Usage list for removal of unused data (NULL - keep everything)
+
+	void Initialize()
+	{
+		GenerateLODs = false;
+		ScaleTextures = false;
+		VRAMBudget = 0;
+		AtlasTextures = false;
+		MergeTextures = false;
+		RestripMeshes = false;
+		ReduceAnims = false;
+		AnimPosError = ANIM_POS_ERROR;
+		AnimAngleError = ANIM_ANGLE_ERROR;
+		DietList = NULL;
 	}
 };
 
+// File entry for batch conversion
+struct sBatchFile
+{
+	char Path[PATH_LEN];					// File path
+	char Name[64];							// Short name without extension (lower case), used to resolve submodel references
+	char Cache[PATH_LEN];					// Cache file (in folder of output file)
+	int Type;								// Model type
+	int Head;								// Index of main model of the family (-1 - file is a main model or a standalone one)
+	bool Done;								// Processed
+	bool Cached;							// Found in cache file
+	uint CachedSrcHash;						// Hashes from cache file
+	uint CachedOutHash;
+	uint SrcHash;							// Hash of input file (+ *.INF file and program version)
+	uint OutHash;							// Hash of output file (0 - not converted)
+};
+
 #endif // MAIN_H
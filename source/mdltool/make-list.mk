@@ -1,2 +1,2 @@
-OBJS=$(COMOBJ)/fops.o $(OBJDIR)/mdltool.o
+OBJS=$(COMOBJ)/fops.o $(COMOBJ)/resample.o $(COMOBJ)/palette.o $(COMOBJ)/palmatch.o $(COMOBJ)/quantize.o $(OBJDIR)/model.o $(OBJDIR)/lod.o $(OBJDIR)/texscale.o $(OBJDIR)/atlas.o $(OBJDIR)/restrip.o $(OBJDIR)/anim.o $(OBJDIR)/diet.o $(OBJDIR)/profile.o $(OBJDIR)/texdup.o $(OBJDIR)/mdltool.o
 LIBS=
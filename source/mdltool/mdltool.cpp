@@ -13,14 +13,13 @@
 
 
 ////////// Functions //////////
-uint PSIProperSize(uint Size, bool ToLower);																		// Calculate nearest appropriate size of PS2 DOL texture
 void ExtractDOLTextures(const char * FileName);																		// Extract textures from PS2 model
 void ExtractMDLTextures(const char * FileName);																		// Extract textures from PC model
-void ConvertMDLToDOL(const char * FileName);																		// Convert model from PC to PS2 format
+void ConvertMDLToDOL(const char * FileName, sConvertOptions * Options);													// Convert model from PC to PS2 format
 void ConvertDOLToMDL(const char * FileName);																		// Convert model from PS2 to PC format
 void ConvertSubmodel(const char * FileName, char * OriginalExtension, char * TargetExtension);						// Convert submodel
 void ConvertDummySubmodel(const char * FileName, char * OriginalExtension, char * TargetExtension);					// Convert submodel which consists of signature and name only
-void GetExtraDOLData(const char * FileName);																		// Extract extra data from DOL model
+void GetExtraDOLData(const char * FileName, sModel * Model);														// Extract extra data from DOL model
 bool AddTerminator(char * Buffer, char Symbol);																		// Helper for CheckExtraFile()
 ushort CountSymbols(char * Buffer, char Symbol);																	// Counts symbols in line
 bool CheckExtraFile(const char * FileName);																			// Check if extra *.INF file is valid
@@ -31,6 +30,13 @@ int CheckModel(const char * FileName);																				// Check model type
 void PatchDOLExtraSection(char * ModelData, ulong ModelDataSize, ulong LODDataOffseet, uchar MaxBodyParts, uchar NumBodyGroups, ulong FadeStart, ulong FadeEnd);
 		// Write extra data to DOL model file (this is needed to allow correct body part part switching and to stop crashing on PS2).
 void SeqReport(const char * FileName);																				// Sequence report
+bool ConvertModelFile(const char * FileName);																		// Convert model or submodel (direction is selected by extension)
+uint BatchHashFile(const char * FileName, uint Hash);																// Add file contents to FNV-1a hash
+int BatchCompareFiles(const void * A, const void * B);																// qsort() callback
+int BatchFindFile(sBatchFile * Files, int FileCount, const char * Name);											// Find file by short name
+int BatchFindCache(sBatchFile * Files, int Index);																	// Find first file with the same cache
+int BatchConvertFile(sBatchFile * File, const char * DstExt);														// Convert file if it was changed since last batch
+void BatchConvert(const char * Dir, const char * SrcExt, const char * DstExt);									// Convert all models in folder
 
 
 // Write extra data to DOL model file (this is needed to allow correct body part switching and to stop crashing on PS2)
@@ -90,304 +96,152 @@ int CheckModel(const char * FileName)	// Check model type
 
 void ConvertDOLToMDL(const char * FileName)		// Convert model from PS2 to PC format 
 {
-	sModelHeader ModelHeader;					// Model file header
-	sModelTextureEntry * ModelTextureTable;		// Model texture table
-	ulong ModelTextureTableSize;				// Model texture table size (how many textures)
-	sTexture * Textures;						// Pointer to textures data
+	sModel Model;								// Model loaded to memory
 
-	FILE * ptrInFile;
-	char cNewModelName[64];
-	FILE * ptrOutFile;
 	char cOutFileName[PATH_LEN];
 
-	ulong ModelSize;
-
-	// Open file
-	SafeFileOpen(&ptrInFile, FileName, "rb");
-
-	// Get header from file
-	ModelHeader.UpdateFromFile(&ptrInFile);
-
-	// Check model
-	if (ModelHeader.CheckModel() == NORMAL_MODEL)
+	// Load model
+	Model.Initialize();
+	if (Model.LoadFromFile(FileName) == true)
 	{
-		printf("Internal name: %s \nTextures: %i, Texture table offset: 0x%X \n", ModelHeader.Name, ModelHeader.TextureCount, ModelHeader.TextureTableOffset);
+		printf("Internal name: %s \nTextures: %i, Texture table offset: 0x%X \n", Model.Header->Name, Model.Header->TextureCount, Model.Header->TextureTableOffset);
 	}
 	else
 	{
 		puts("Incorrect model file.");
+		Model.Free();
 		return;
 	}
 
 	// Save extra *.DOL data to *.INF file
-	if (ModelHeader.TextureTableOffset - sizeof(sModelHeader) > sizeof(sDOLExtraSection))	// Do not extract data from texture submodels
-		GetExtraDOLData(FileName);
-
-	// Allocate memory for textures
-	ModelTextureTableSize = ModelHeader.TextureCount * sizeof(sModelTextureEntry);
-	ModelTextureTable = (sModelTextureEntry *)malloc(ModelTextureTableSize);
-	Textures = (sTexture *)malloc(sizeof(sTexture) * ModelHeader.TextureCount);
+	if (Model.BodySize > sizeof(sDOLExtraSection))	// Do not extract data from texture submodels
+		GetExtraDOLData(FileName, &Model);
 
 	// Load and convert textures
-	uint BitmapOffset;
-	uint BitmapSize;
-	uint PaletteOffset;
-	uint PaletteSize;
-	for (int i = 0; i < ModelHeader.TextureCount; i++)
+	if (Model.LoadTextures(true) == false)
 	{
-		ModelTextureTable[i].UpdateFromFile(&ptrInFile, ModelHeader.TextureTableOffset, i);
-		//printf(" Texture #%i \n Name: %s \n Width: %i \n Height: %i \n Offset: 0x%X \n\n", i + 1, ModelTextureTable[i].Name, ModelTextureTable[i].Width, ModelTextureTable[i].Height, ModelTextureTable[i].Offset);
-
-		BitmapOffset = ModelTextureTable[i].Offset + DOL_TEXTURE_HEADER_SIZE + EIGHT_BIT_PALETTE_ELEMENTS_COUNT * DOL_BMP_PALETTE_ELEMENT_SIZE;
-		BitmapSize = ModelTextureTable[i].Height * ModelTextureTable[i].Width;
-		PaletteOffset = ModelTextureTable[i].Offset + DOL_TEXTURE_HEADER_SIZE;
-		PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * DOL_BMP_PALETTE_ELEMENT_SIZE;
-
-		// Load texture
-		Textures[i].Initialize();
-		Textures[i].UpdateFromFile(&ptrInFile, BitmapOffset, BitmapSize, PaletteOffset, PaletteSize, ModelTextureTable[i].Name, ModelTextureTable[i].Width, ModelTextureTable[i].Height);
-		
-		// Convert texture
-		Textures[i].PaletteReformat(DOL_BMP_PALETTE_ELEMENT_SIZE);
-		Textures[i].PaletteRemoveSpacers();
+		puts("Incorrect model file.");
+		Model.Free();
+		return;
 	}
-
-	// Write results to output file
-	// Open output file
-	FileGetFullName(FileName, cOutFileName, sizeof(cOutFileName));
-	strcat(cOutFileName, ".mdl");
-	SafeFileOpen(&ptrOutFile, cOutFileName, "wb");
-
-	// Write modified header
-	FileGetName(cOutFileName, cNewModelName, sizeof(cNewModelName), false);
-	strcat(cNewModelName, ".mdl");
-	ModelHeader.Rename(cNewModelName);
-	ModelHeader.TextureDataOffset = ModelHeader.TextureTableOffset + sizeof(sModelTextureEntry) * ModelHeader.TextureCount + ModelHeader.SkinCount * ModelHeader.SkinEntrySize * 2; // HotFix
-	FileWriteBlock(&ptrOutFile, (char *)&ModelHeader, sizeof(sModelHeader));
-
-	// Write patched model data
-	uchar * ModelData;
-	ModelData = (uchar *)malloc(ModelHeader.TextureTableOffset - sizeof(sModelHeader));
-	FileReadBlock(&ptrInFile, (char *)ModelData, sizeof(sModelHeader), ModelHeader.TextureTableOffset - sizeof(sModelHeader));
-	PatchDOLExtraSection((char *)ModelData, ModelHeader.TextureTableOffset - sizeof(sModelHeader), 0x00504453, 0, 0, 0, 0);		// Clear extra field
-	PatchSubmodelRef(&ModelHeader, (char *)ModelData, ModelHeader.TextureTableOffset - sizeof(sModelHeader), ".mdl");			// Patch internal submodel references
-	FileWriteBlock(&ptrOutFile, (char *)ModelData, ModelHeader.TextureTableOffset - sizeof(sModelHeader));
-	free(ModelData);
-
-	// Write modified texture table
-	uint Offset = ModelHeader.TextureTableOffset + sizeof(sModelTextureEntry) * ModelHeader.TextureCount + ModelHeader.SkinCount * ModelHeader.SkinEntrySize * 2;
-	for (int i = 0; i < ModelHeader.TextureCount; i++)
+	for (ulong i = 0; i < Model.Header->TextureCount; i++)
 	{
-		ModelTextureTable[i].Width = Textures[i].Width;
-		ModelTextureTable[i].Height = Textures[i].Height;
-		ModelTextureTable[i].Offset = Offset;
-
-		Offset += Textures[i].Width * Textures[i].Height + Textures[i].PaletteSize;
+		Model.Textures[i].PaletteReformat(DOL_BMP_PALETTE_ELEMENT_SIZE);
+		Model.Textures[i].PaletteRemoveSpacers();
 	}
-	FileWriteBlock(&ptrOutFile, (char *)ModelTextureTable, ModelTextureTableSize);
-
-	// Write skin data
-	uchar * SkinTable;
-	ulong SkinTableSize = ModelHeader.SkinCount * ModelHeader.SkinEntrySize * 2;
-	SkinTable = (uchar *)malloc(SkinTableSize);
-	FileReadBlock(&ptrInFile, SkinTable, ModelHeader.SkinTableOffset, SkinTableSize);
-	FileWriteBlock(&ptrOutFile, SkinTable, SkinTableSize);
-	free(SkinTable);
 
-	// Write textures
-	for (int i = 0; i < ModelHeader.TextureCount; i++)
-	{
-		FileWriteBlock(&ptrOutFile, (char *)Textures[i].Bitmap, Textures[i].Width * Textures[i].Height);		
-		FileWriteBlock(&ptrOutFile, (char *)Textures[i].Palette, Textures[i].PaletteSize);
-	}
+	// Patch model data
+	PatchDOLExtraSection((char *)Model.Body, Model.BodySize, 0x00504453, 0, 0, 0, 0);		// Clear extra field
+	PatchSubmodelRef(Model.Header, (char *)Model.Body, Model.BodySize, ".mdl");			// Patch internal submodel references
 
-	// Update model size field
-	ModelSize = FileSize(&ptrOutFile);
-	FileWriteBlock(&ptrOutFile, &ModelSize, 0x48, sizeof(ModelSize));	// 0x48 - address of model size field
+	// Write results to output file
+	FileGetFullName(FileName, cOutFileName, sizeof(cOutFileName));
+	strcat(cOutFileName, ".mdl");
+	Model.SaveMDL(cOutFileName);
 
 	// Free memory
-	free(ModelTextureTable);
-	free(Textures);
-	
-	// Close files
-	fclose(ptrInFile);
-	fclose(ptrOutFile);
+	Model.Free();
 
 	puts("Done!\n\n");
 }
 
-void ConvertMDLToDOL(const char * FileName)	// Convert model from PC to PS2 format 
+void ConvertMDLToDOL(const char * FileName, sConvertOptions * Options)	// Convert model from PC to PS2 format 
 {
-	sModelHeader ModelHeader;					// Model file header
-	sModelTextureEntry * ModelTextureTable;		// Model texture table
-	ulong ModelTextureTableSize;				// Model texture table size (how many textures)
-	sDOLTextureHeader DOLTextureHeader;			// DOL Texture Header
-	sTexture * Textures;						// Pointer to textures data
+	sModel Model;								// Model loaded to memory
+	sDOLExtraSection DOLXS;						// Extra section from *.INF file
+	sDOLLODEntry * LODTable = NULL;				// LOD table from *.INF file
+	bool ExtraData = false;
 	
-	FILE * ptrInFile;
-	FILE * ptrOutFile;
 	char cOutFileName[PATH_LEN];
-	char cNewModelName[64];
-	char cTextureName[64];
-
-	ulong ModelSize;
-
-	// Open file
-	SafeFileOpen(&ptrInFile, FileName, "rb");
-
-	// Get header from file
-	ModelHeader.UpdateFromFile(&ptrInFile);
+	char TexExtension[5];
 
-	// Check model
-	if (ModelHeader.CheckModel() == NORMAL_MODEL)
+	// Load model
+	Model.Initialize();
+	if (Model.LoadFromFile(FileName) == true)
 	{
-		printf("Internal name: %s \nTextures: %i, Texture table offset: 0x%X \n", ModelHeader.Name, ModelHeader.TextureCount, ModelHeader.TextureTableOffset);
+		printf("Internal name: %s \nTextures: %i, Texture table offset: 0x%X \n", Model.Header->Name, Model.Header->TextureCount, Model.Header->TextureTableOffset);
 	}
 	else
 	{
 		puts("Incorrect model file.");
+		Model.Free();
 		return;
 	}
 
-	// Allocate memory for texture tables
-	ModelTextureTableSize = ModelHeader.TextureCount * sizeof(sModelTextureEntry);
-	ModelTextureTable = (sModelTextureEntry *)malloc(ModelTextureTableSize);
-	Textures = (sTexture *)malloc(sizeof(sTexture) * ModelHeader.TextureCount);
-
-	// Convert textures
-	uint BitmapOffset;
-	uint BitmapSize;
-	uint PaletteOffset;
-	uint PaletteSize;
-	for (int i = 0; i < ModelHeader.TextureCount; i++)
+	// PVR check
+	for (ulong i = 0; i < Model.Header->TextureCount; i++)
 	{
-		ModelTextureTable[i].UpdateFromFile(&ptrInFile, ModelHeader.TextureTableOffset, i);
-		//printf(" Texture #%i \n Name: %s \n Width: %i \n Height: %i \n Offset: 0x%X \n\n", i + 1, ModelTextureTable[i].Name, ModelTextureTable[i].Width, ModelTextureTable[i].Height, ModelTextureTable[i].Offset);
-
-		// PVR check
-		char TexExtension[5];
-		FileGetExtension(ModelTextureTable[i].Name, TexExtension, sizeof(TexExtension));
+		FileGetExtension(Model.TextureTable[i].Name, TexExtension, sizeof(TexExtension));
 		if (!strcmp(TexExtension, ".pvr") == true)
 		{
 			UTIL_WAIT_KEY("Dreamcast model conversion is not suppotred ...");
 			exit(EXIT_FAILURE);
 		}
+	}
 
-		BitmapOffset = ModelTextureTable[i].Offset + MDL_TEXTURE_HEADER_SIZE;
-		BitmapSize = ModelTextureTable[i].Height * ModelTextureTable[i].Width;
-		PaletteOffset = ModelTextureTable[i].Offset + ModelTextureTable[i].Width * ModelTextureTable[i].Height;
-		PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * MDL_PALETTE_ELEMENT_SIZE;
-
-		// Load texture
-		Textures[i].Initialize();
-		Textures[i].UpdateFromFile(&ptrInFile, BitmapOffset, BitmapSize, PaletteOffset, PaletteSize, ModelTextureTable[i].Name, ModelTextureTable[i].Width, ModelTextureTable[i].Height);
-		
+	// Load and convert textures
+	if (Model.LoadTextures(false) == false)
+	{
+		puts("Incorrect model file.");
+		Model.Free();
+		return;
+	}
+	if (Options->MergeTextures == true)
+		MergeTextures(&Model);
+	if (Options->ScaleTextures == true)
+		ScaleTextures(&Model, Options->VRAMBudget);		// Textures that can't be scaled are left for tiling
+	if (Options->AtlasTextures == true)
+		AtlasTextures(&Model);
+	for (ulong i = 0; i < Model.Header->TextureCount; i++)
+	{
 		// Resize texture
-		Textures[i].TileResize(PSIProperSize(Textures[i].Width, false), PSIProperSize(Textures[i].Height, false));
+		Model.Textures[i].TileResize(PSIProperSize(Model.Textures[i].Width, false), PSIProperSize(Model.Textures[i].Height, false));
 		
 		// Convert texture
-		Textures[i].PaletteReformat(MDL_PALETTE_ELEMENT_SIZE);
-		Textures[i].PaletteAddSpacers(0x80);
+		Model.Textures[i].PaletteReformat(MDL_PALETTE_ELEMENT_SIZE);
+		Model.Textures[i].PaletteAddSpacers(0x80);
 	}
 
-	// Write results to output file
-	// Open output file
-	FileGetFullName(FileName, cOutFileName, sizeof(cOutFileName));
-	strcat(cOutFileName, ".dol");
-	SafeFileOpen(&ptrOutFile, cOutFileName, "wb");
-
-	// Write modified header
-	FileGetName(cOutFileName, cNewModelName, sizeof(cNewModelName), false);
-	strcat(cNewModelName, ".dol");
-	ModelHeader.Rename(cNewModelName);
-	ModelHeader.TextureDataOffset = ModelHeader.TextureTableOffset + sizeof(sModelTextureEntry) * ModelHeader.TextureCount + ModelHeader.SkinCount * ModelHeader.SkinEntrySize * 2; // HotFix
-	ModelHeader.TextureDataOffset = (((ModelHeader.TextureDataOffset / 16) + ((ModelHeader.TextureDataOffset % 16) && 1)) * 16); // Fix for hotfix
-	FileWriteBlock(&ptrOutFile, (char *)&ModelHeader, sizeof(sModelHeader));
+	// Patch model data
+	PatchDOLExtraSection((char *)Model.Body, Model.BodySize, 0, 0, 0, 0, 0);			// Reset extra section to it's default state
+	PatchSubmodelRef(Model.Header, (char *)Model.Body, Model.BodySize, ".dol");		// Patch internal submodel references
 
-	// Write patched model data
-	uchar * ModelData;
-	ModelData = (uchar *) malloc(ModelHeader.TextureTableOffset - sizeof(sModelHeader));
-	FileReadBlock(&ptrInFile, (char *) ModelData, sizeof(sModelHeader), ModelHeader.TextureTableOffset - sizeof(sModelHeader));
-	PatchDOLExtraSection((char *)ModelData, ModelHeader.TextureTableOffset - sizeof(sModelHeader), 0, 0, 0, 0, 0);			// Reset extra section to it's default state
-	PatchSubmodelRef(&ModelHeader, (char *)ModelData, ModelHeader.TextureTableOffset - sizeof(sModelHeader), ".dol");		// Patch internal submodel references
-	FileWriteBlock(&ptrOutFile, (char *) ModelData, ModelHeader.TextureTableOffset - sizeof(sModelHeader));
-	free(ModelData);
-
-	// Write modified texture table
-	uint Offset = ModelHeader.TextureTableOffset + sizeof(sModelTextureEntry) * ModelHeader.TextureCount + ModelHeader.SkinCount * ModelHeader.SkinEntrySize * 2;
-	Offset = ((Offset / 16) + ((Offset % 16) && 1)) * 16; // Hotfix
-	for (int i = 0; i < ModelHeader.TextureCount; i++)
+	// Fetch data from external *.INF file (if present)
+	if (CheckExtraFile(FileName) == true)
 	{
-		ModelTextureTable[i].Width = Textures[i].Width;
-		ModelTextureTable[i].Height = Textures[i].Height;
-		ModelTextureTable[i].Offset = Offset;
-
-		Offset += sizeof(sDOLTextureHeader) + Textures[i].PaletteSize + Textures[i].Width * Textures[i].Height;
+		TranslateExtraFile(FileName, &DOLXS, &LODTable);
+		ExtraData = true;
 	}
-	FileWriteBlock(&ptrOutFile, (char *) ModelTextureTable, ModelTextureTableSize);
 
-	// Write skin data
-	uchar * SkinTable;
-	ulong SkinTableSize = ModelHeader.SkinCount * ModelHeader.SkinEntrySize * 2;
-	SkinTable = (uchar *)malloc(SkinTableSize);
-	FileReadBlock(&ptrInFile, SkinTable, ModelHeader.SkinTableOffset, SkinTableSize);
-	FileWriteBlock(&ptrOutFile, SkinTable, SkinTableSize);
-	free(SkinTable);
+	// Remove data that isn't used by maps (before LOD generation, so LODs aren't generated for removed body parts)
+	if (Options->DietList != NULL)
+		DietModel(&Model, Options->DietList, ExtraData == true ? &DOLXS : NULL, LODTable);
 
-	// Write blank bytes to fill 16-byte block (PS2 HL likes everything to be alligned)
-	char Spacer = 0x00;
-	int SpacersCount = (FileSize(&ptrOutFile) / 16 + ((FileSize(&ptrOutFile) % 16) && 1)) * 16 - FileSize(&ptrOutFile);	// Fix for hotfix
-	for (int i = 0; i < SpacersCount ; i++)
-		FileWriteBlock(&ptrOutFile, &Spacer, 1);
+	// Reduce animations
+	if (Options->ReduceAnims == true)
+		AnimReduce(&Model, Options->AnimPosError, Options->AnimAngleError);
 
-	// Write textures
-	for (int i = 0; i < ModelHeader.TextureCount; i++)
+	// Generate LODs (fade distances from *.INF file are kept)
+	if (Options->GenerateLODs == true)
 	{
-		// Remove ".bmp" in texture name
-		FileGetName(Textures[i].Name, cTextureName, sizeof(cTextureName), false);
-		DOLTextureHeader.Update(cTextureName, Textures[i].Width, Textures[i].Height);
-
-		FileWriteBlock(&ptrOutFile, &DOLTextureHeader, sizeof(sDOLTextureHeader));
-		FileWriteBlock(&ptrOutFile, (char *) Textures[i].Palette, Textures[i].PaletteSize);
-		FileWriteBlock(&ptrOutFile, (char *) Textures[i].Bitmap, Textures[i].Width * Textures[i].Height);
+		if (ExtraData == false)
+			memset(&DOLXS, 0x00, sizeof(DOLXS));
+		if (LODGenerate(&Model, &DOLXS, &LODTable) == true)
+			ExtraData = true;
 	}
 
-	// Fetch data from external *.INI file (if present) and write it to DOL file
-	sDOLExtraSection DOLXS;
-	sDOLLODEntry * LODTable;
-	if (CheckExtraFile(FileName) == true)
-	{
-		// Get data from *.INI
-		TranslateExtraFile(FileName, &DOLXS, &LODTable);
-
-		// Rewrite extra section
-		DOLXS.LODDataOffset = FileSize(&ptrOutFile);
-		FileWriteBlock(&ptrOutFile, &DOLXS, sizeof(sModelHeader), sizeof(DOLXS));
-
-		// Write LOD table
-		if (LODTable != NULL)
-		{
-			FileWriteBlock(&ptrOutFile, LODTable, FileSize(&ptrOutFile), DOLXS.NumBodyGroups * DOLXS.MaxBodyParts * sizeof(sDOLLODEntry));
-			free(LODTable);
-		}
-
-		// Align data
-		uchar Align = (FileSize(&ptrOutFile) % 16) == 0 ? 0 : 16 - (FileSize(&ptrOutFile) % 16);
-		for (uchar i = 0; i < Align; i++)
-			fputc(0x11, ptrOutFile);
-	}
+	// Optimize triangle commands (after LOD generation, so LODs are optimized too)
+	if (Options->RestripMeshes == true)
+		RestripMeshes(&Model);
 
-	// Update model size field
-	ModelSize = FileSize(&ptrOutFile);
-	FileWriteBlock(&ptrOutFile, &ModelSize, 0x48, sizeof(ModelSize));	// 0x48 - address of model size field
+	// Write results to output file
+	FileGetFullName(FileName, cOutFileName, sizeof(cOutFileName));
+	strcat(cOutFileName, ".dol");
+	Model.SaveDOL(cOutFileName, ExtraData == true ? &DOLXS : NULL, LODTable);
 
 	// Free memory
-	free(ModelTextureTable);
-	free(Textures);
-
-	// Close files
-	fclose(ptrInFile);
-	fclose(ptrOutFile);
+	free(LODTable);
+	Model.Free();
 
 	puts("Done!\n\n");
 }
@@ -451,8 +305,9 @@ void ConvertSubmodel(const char * FileName, char * OriginalExtension, char * Tar
 	// Free memory
 	free(ModelData);
 
-	// Close file
+	// Close files
 	fclose(ptrModelFile);
+	fclose(ptrOutputFile);
 
 	puts("Done!\n\n");
 }
@@ -491,24 +346,21 @@ void ConvertDummySubmodel(const char * FileName, char * OriginalExtension, char
 	// Free memory
 	free(ModelData);
 
-	// Close file
+	// Close files
 	fclose(ptrModelFile);
+	fclose(ptrOutputFile);
 
 	puts("Done!\n\n");
 }
 
-void GetExtraDOLData(const char * FileName)
+void GetExtraDOLData(const char * FileName, sModel * Model)
 {
-	FILE * ptrInFile;
 	FILE * ptrOutFile;
 	char cOutFileName[PATH_LEN];
 	sDOLExtraSection DOLExtraSect;
 
-	// Open input file
-	SafeFileOpen(&ptrInFile, FileName, "rb");
-
-	// Read extra section
-	FileReadBlock(&ptrInFile, &DOLExtraSect, sizeof(sModelHeader), sizeof(sDOLExtraSection));
+	// Get extra section (model data is already in memory)
+	memcpy(&DOLExtraSect, Model->Body, sizeof(sDOLExtraSection));
 	
 	// Check if *.INF file is needed
 	ulong LODTableSize = DOLExtraSect.MaxBodyParts * DOLExtraSect.NumBodyGroups * sizeof(sDOLLODEntry);
@@ -547,15 +399,14 @@ void GetExtraDOLData(const char * FileName)
 			fprintf(ptrOutFile, "\\\\ If you plan to use this model on PC then consider\r\n");
 			fprintf(ptrOutFile, "\\\\ decompiling the model and removing LOD body parts.\r\n\r\n");
 
-			// Read LOD table
-			LODTable = (sDOLLODEntry *)malloc(LODTableSize);
-			if (LODTable == NULL)
+			// Get LOD table
+			if (DOLExtraSect.LODDataOffset > Model->DataSize || LODTableSize > Model->DataSize - DOLExtraSect.LODDataOffset)
 			{
-				puts("Can't allocate memory!");
-				fclose(ptrInFile);
+				puts("LOD table is out of file bounds ...");
+				fclose(ptrOutFile);
 				return;
 			}
-			FileReadBlock(&ptrInFile, LODTable, DOLExtraSect.LODDataOffset, LODTableSize);
+			LODTable = (sDOLLODEntry *)&Model->Data[DOLExtraSect.LODDataOffset];
 
 			// Parse LOD table
 			for (ushort Group = 0, Entry = 0; Group < DOLExtraSect.NumBodyGroups; Group++)
@@ -584,9 +435,6 @@ void GetExtraDOLData(const char * FileName)
 		//// Close output file
 		fclose(ptrOutFile);
 	}
-
-	// Close input file
-	fclose(ptrInFile);
 }
 
 ///////////////////////////////////////
@@ -1101,147 +949,106 @@ uint PSIProperSize(uint Size, bool ToLower)	// Function returns closest proper d
 
 void ExtractDOLTextures(const char * FileName)	// Extract textures from PS2 model
 {
-	sModelHeader ModelHeader;					// Model file header
-	sModelTextureEntry * ModelTextureTable;		// Model texture table
-	ulong ModelTextureTableSize;				// Model texture table size (how many textures)
-	sTexture * Textures;						// Pointer to texturs data
+	sModel Model;								// Model loaded to memory
 
-	FILE * ptrInFile;
 	sBMPHeader BMPHeader;						// BMP header
 	FILE * ptrBMPOutput;
 	char cOutFileName[PATH_LEN];
 	char cOutFolderName[PATH_LEN];
 
-	// Open file
-	SafeFileOpen(&ptrInFile, FileName, "rb");
-
-	// Load model header
-	ModelHeader.UpdateFromFile(&ptrInFile);
-
-	// Check model
-	if (ModelHeader.CheckModel() == NORMAL_MODEL)
+	// Load model
+	Model.Initialize();
+	if (Model.LoadFromFile(FileName) == true)
 	{
-		printf("Internal name: %s \nTextures: %i, Texture table offset: 0x%X \n", ModelHeader.Name, ModelHeader.TextureCount, ModelHeader.TextureTableOffset);
+		printf("Internal name: %s \nTextures: %i, Texture table offset: 0x%X \n", Model.Header->Name, Model.Header->TextureCount, Model.Header->TextureTableOffset);
 	}
 	else
 	{
 		puts("Can't extract textures.");
+		Model.Free();
 		return;
 	}
 
-	// Allocate memory for textures
-	ModelTextureTable = (sModelTextureEntry *)malloc(ModelHeader.TextureCount * sizeof(sModelTextureEntry));
-	Textures = (sTexture *)malloc(sizeof(sTexture) * ModelHeader.TextureCount);
-
 	// Prepare folder for output files
 	strcpy(cOutFolderName, FileName);
 	strcat(cOutFolderName, "-textures");
 	strcat(cOutFolderName, DIR_DELIM);
 	NewDir(cOutFolderName);
 
-	uint BitmapOffset;
-	uint BitmapSize;
-	uint PaletteOffset;
-	uint PaletteSize;
-	for (int i = 0; i < ModelHeader.TextureCount; i++)
+	for (ulong i = 0; i < Model.Header->TextureCount; i++)
 	{
-		ModelTextureTable[i].UpdateFromFile(&ptrInFile, ModelHeader.TextureTableOffset, i);
-		printf(" Texture #%i \n Name: %s \n Width: %i \n Height: %i \n Offset: %x \n\n", i + 1, ModelTextureTable[i].Name, ModelTextureTable[i].Width, ModelTextureTable[i].Height, ModelTextureTable[i].Offset);
-
-		BitmapOffset = ModelTextureTable[i].Offset + DOL_TEXTURE_HEADER_SIZE + EIGHT_BIT_PALETTE_ELEMENTS_COUNT * DOL_BMP_PALETTE_ELEMENT_SIZE;
-		BitmapSize = ModelTextureTable[i].Height * ModelTextureTable[i].Width;
-		PaletteOffset = ModelTextureTable[i].Offset + DOL_TEXTURE_HEADER_SIZE;
-		PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * DOL_BMP_PALETTE_ELEMENT_SIZE;
+		sModelTextureEntry * Entry = &Model.TextureTable[i];
+		printf(" Texture #%i \n Name: %s \n Width: %i \n Height: %i \n Offset: %x \n\n", (int)i + 1, Entry->Name, Entry->Width, Entry->Height, Entry->Offset);
 
 		// Load texture
-		Textures[i].Initialize();
-		Textures[i].UpdateFromFile(&ptrInFile, BitmapOffset, BitmapSize, PaletteOffset, PaletteSize, ModelTextureTable[i].Name, ModelTextureTable[i].Width, ModelTextureTable[i].Height);
+		if (Model.LoadTexture(i, true) == false)
+			break;
 
 		// Convert texture
-		Textures[i].FlipBitmap();
-		Textures[i].PaletteReformat(DOL_BMP_PALETTE_ELEMENT_SIZE);
-		Textures[i].PaletteRemoveSpacers();
-		Textures[i].PaletteAddSpacers(0x00);
-		Textures[i].PaletteSwapRedAndGreen(DOL_BMP_PALETTE_ELEMENT_SIZE);
+		Model.Textures[i].FlipBitmap();
+		Model.Textures[i].PaletteReformat(DOL_BMP_PALETTE_ELEMENT_SIZE);
+		Model.Textures[i].PaletteRemoveSpacers();
+		Model.Textures[i].PaletteAddSpacers(0x00);
+		Model.Textures[i].PaletteSwapRedAndGreen(DOL_BMP_PALETTE_ELEMENT_SIZE);
 
 		// Save texture to *.bmp
 		strcpy(cOutFileName, cOutFolderName);
-		strcat(cOutFileName, ModelTextureTable[i].Name);
+		strcat(cOutFileName, Entry->Name);
 		SafeFileOpen(&ptrBMPOutput, cOutFileName, "wb");
 
-		BMPHeader.Update(Textures[i].Width, Textures[i].Height);
+		BMPHeader.Update(Model.Textures[i].Width, Model.Textures[i].Height);
 		FileWriteBlock(&ptrBMPOutput, (char *) &BMPHeader, sizeof(sBMPHeader));
-		FileWriteBlock(&ptrBMPOutput, (char *) Textures[i].Palette, Textures[i].PaletteSize);
-		FileWriteBlock(&ptrBMPOutput, (char *) Textures[i].Bitmap, Textures[i].Width * Textures[i].Height);
+		FileWriteBlock(&ptrBMPOutput, (char *) Model.Textures[i].Palette, Model.Textures[i].PaletteSize);
+		FileWriteBlock(&ptrBMPOutput, (char *) Model.Textures[i].Bitmap, Model.Textures[i].Width * Model.Textures[i].Height);
 
 		fclose(ptrBMPOutput);
 	}
 
 	// Free memory
-	free(ModelTextureTable);
-	free(Textures);
-
-	// Close files
-	fclose(ptrInFile);
+	Model.Free();
 
 	puts("Done!\n\n");
 }
 
 void ExtractMDLTextures(const char * FileName)	// Extract textures from PC model
 {
-	sModelHeader ModelHeader;					// Model file header
-	sModelTextureEntry * ModelTextureTable;		// Model texture table
-	ulong ModelTextureTableSize;				// Model texture table size (how many textures)
-	sTexture * Textures;						// Pointer to textures data
+	sModel Model;								// Model loaded to memory
 
-	FILE * ptrInFile;
 	sBMPHeader BMPHeader;						// BMP header
 	FILE * ptrBMPOutput;
 	char cOutFileName[PATH_LEN];
 	char cOutFolderName[PATH_LEN];
 
-	// Open file
-	SafeFileOpen(&ptrInFile, FileName, "rb");
-
-	// Load model header
-	ModelHeader.UpdateFromFile(&ptrInFile);
-
-	// Check model
-	if (ModelHeader.CheckModel() == NORMAL_MODEL)
+	// Load model
+	Model.Initialize();
+	if (Model.LoadFromFile(FileName) == true)
 	{
-		printf("Internal name: %s \nTextures: %i, Texture table offset: 0x%X \n", ModelHeader.Name, ModelHeader.TextureCount, ModelHeader.TextureTableOffset);
+		printf("Internal name: %s \nTextures: %i, Texture table offset: 0x%X \n", Model.Header->Name, Model.Header->TextureCount, Model.Header->TextureTableOffset);
 	}
 	else
 	{
 		puts("Can't extract textures.");
+		Model.Free();
 		return;
 	}
 
-	// Allocate memory for textutes
-	ModelTextureTable = (sModelTextureEntry *)malloc(ModelHeader.TextureCount * sizeof(sModelTextureEntry));
-	Textures = (sTexture *)malloc(sizeof(sTexture) * ModelHeader.TextureCount);
-
 	// Prepare folder for output files
 	strcpy(cOutFolderName, FileName);
 	strcat(cOutFolderName, "-textures");
 	strcat(cOutFolderName, DIR_DELIM);
 	NewDir(cOutFolderName);
 
-	uint BitmapOffset;
-	uint BitmapSize;
-	uint PaletteOffset;
-	uint PaletteSize;
 	bool RawExtract = false;
 	char TexExtension[5];
-	for (int i = 0; i < ModelHeader.TextureCount; i++)
+	for (ulong i = 0; i < Model.Header->TextureCount; i++)
 	{
-		ModelTextureTable[i].UpdateFromFile(&ptrInFile, ModelHeader.TextureTableOffset, i);
-		printf(" Texture #%i \n Name: %s \n Width: %i \n Height: %i \n Offset: %x \n\n", i + 1, ModelTextureTable[i].Name, ModelTextureTable[i].Width, ModelTextureTable[i].Height, ModelTextureTable[i].Offset);
+		sModelTextureEntry * Entry = &Model.TextureTable[i];
+		printf(" Texture #%i \n Name: %s \n Width: %i \n Height: %i \n Offset: %x \n\n", (int)i + 1, Entry->Name, Entry->Width, Entry->Height, Entry->Offset);
 
 		// PVR check
 		if (RawExtract == false)
 		{
-			FileGetExtension(ModelTextureTable[i].Name, TexExtension, sizeof(TexExtension));
+			FileGetExtension(Entry->Name, TexExtension, sizeof(TexExtension));
 			if (!strcmp(TexExtension, ".pvr") == true)
 			{
 				RawExtract = true;
@@ -1254,69 +1061,51 @@ void ExtractMDLTextures(const char * FileName)	// Extract textures from PC model
 		{
 			// Normal texture //
 
-			BitmapOffset = ModelTextureTable[i].Offset + MDL_TEXTURE_HEADER_SIZE;
-			BitmapSize = ModelTextureTable[i].Height * ModelTextureTable[i].Width;
-			PaletteOffset = ModelTextureTable[i].Offset + ModelTextureTable[i].Width * ModelTextureTable[i].Height;
-			PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * MDL_PALETTE_ELEMENT_SIZE;
-
 			// Load texture
-			Textures[i].Initialize();
-			Textures[i].UpdateFromFile(&ptrInFile, BitmapOffset, BitmapSize, PaletteOffset, PaletteSize, ModelTextureTable[i].Name, ModelTextureTable[i].Width, ModelTextureTable[i].Height);
+			if (Model.LoadTexture(i, false) == false)
+				break;
 
 			// Convert texture
-			Textures[i].FlipBitmap();
-			Textures[i].PaletteSwapRedAndGreen(MDL_PALETTE_ELEMENT_SIZE);
-			Textures[i].PaletteAddSpacers(0x00);
+			Model.Textures[i].FlipBitmap();
+			Model.Textures[i].PaletteSwapRedAndGreen(MDL_PALETTE_ELEMENT_SIZE);
+			Model.Textures[i].PaletteAddSpacers(0x00);
 
 			// Save texture to *.bmp file
 			strcpy(cOutFileName, cOutFolderName);
-			strcat(cOutFileName, ModelTextureTable[i].Name);
+			strcat(cOutFileName, Entry->Name);
 			SafeFileOpen(&ptrBMPOutput, cOutFileName, "wb");
 
-			BMPHeader.Update(Textures[i].Width, Textures[i].Height);
+			BMPHeader.Update(Model.Textures[i].Width, Model.Textures[i].Height);
 			FileWriteBlock(&ptrBMPOutput, (char *)&BMPHeader, sizeof(sBMPHeader));
-			FileWriteBlock(&ptrBMPOutput, (char *)Textures[i].Palette, Textures[i].PaletteSize);
-			FileWriteBlock(&ptrBMPOutput, (char *)Textures[i].Bitmap, Textures[i].Width * Textures[i].Height);
+			FileWriteBlock(&ptrBMPOutput, (char *)Model.Textures[i].Palette, Model.Textures[i].PaletteSize);
+			FileWriteBlock(&ptrBMPOutput, (char *)Model.Textures[i].Bitmap, Model.Textures[i].Width * Model.Textures[i].Height);
 		}
 		else
 		{
 			// PVR texture (raw extract) //
 
-			uchar * pPVR;
-			uint PVRSize;
+			ulong PVRSize;
 
 			// Get size
-			if (i != ModelHeader.TextureCount - 1)
-			{
-				ModelTextureTable[i + 1].UpdateFromFile(&ptrInFile, ModelHeader.TextureTableOffset, i + 1);
-				PVRSize = ModelTextureTable[i + 1].Offset - ModelTextureTable[i].Offset;
-			}
+			if (i != Model.Header->TextureCount - 1)
+				PVRSize = Model.TextureTable[i + 1].Offset - Entry->Offset;
 			else
-			{
-				PVRSize = FileSize(&ptrInFile) - ModelTextureTable[i].Offset;	// Last entry in the texture table
-			}
+				PVRSize = Model.DataSize - Entry->Offset;	// Last entry in the texture table
 
-			// Allocate memory
-			pPVR = (uchar *)malloc(PVRSize);
-			if (pPVR == NULL)
+			// Check bounds
+			if (Entry->Offset > Model.DataSize || PVRSize > Model.DataSize - Entry->Offset)
 			{
-				puts("Unable to allocate memory ...");
-				exit(EXIT_FAILURE);
+				printf("Texture #%i is out of file bounds ...\n", (int)i + 1);
+				break;
 			}
-			
-			// Read texture
-			FileReadBlock(&ptrInFile, pPVR, ModelTextureTable[i].Offset, PVRSize);
 
 			// Open output file
 			strcpy(cOutFileName, cOutFolderName);
-			strcat(cOutFileName, ModelTextureTable[i].Name);
+			strcat(cOutFileName, Entry->Name);
 			SafeFileOpen(&ptrBMPOutput, cOutFileName, "wb");
 
-			// Write texture
-			FileWriteBlock(&ptrBMPOutput, pPVR, PVRSize);
-
-			// Free memory
-			free(pPVR);
+			// Write texture (directly from loaded file)
+			FileWriteBlock(&ptrBMPOutput, &Model.Data[Entry->Offset], PVRSize);
 		}
 
 		// Close output file
@@ -1324,11 +1113,7 @@ void ExtractMDLTextures(const char * FileName)	// Extract textures from PC model
 	}
 
 	// Free memory
-	free(ModelTextureTable);
-	free(Textures);
-
-	// Close files
-	fclose(ptrInFile);
+	Model.Free();
 
 	puts("Done!\n\n");
 }
@@ -1391,6 +1176,375 @@ void SeqReport(const char * FileName)
 	puts("Done!\n\n");
 }
 
+bool ConvertModelFile(const char * FileName)	// Convert model or submodel (direction is selected by extension)
+{
+	char cFileExtension[5];
+	char cTargetExtension[5];
+	sConvertOptions Options;
+
+	Options.Initialize();
+	FileGetExtension(FileName, cFileExtension, 5);
+	if (!strcmp(".mdl", cFileExtension))
+	{
+		strcpy(cTargetExtension, ".dol");
+	}
+	else if (!strcmp(".dol", cFileExtension))
+	{
+		strcpy(cTargetExtension, ".mdl");
+	}
+	else
+	{
+		puts("Wrong file extension.");
+		return false;
+	}
+
+	switch (CheckModel(FileName))
+	{
+	case NORMAL_MODEL:
+		if (!strcmp(".mdl", cFileExtension))
+			ConvertMDLToDOL(FileName, &Options);
+		else
+			ConvertDOLToMDL(FileName);
+		break;
+	case SEQ_MODEL:
+	case NOTEXTURES_MODEL:
+		ConvertSubmodel(FileName, cFileExtension, cTargetExtension);
+		break;
+	case DUMMY_MODEL:
+		// Patch dummy model's extension and internal name
+		ConvertDummySubmodel(FileName, cFileExtension, cTargetExtension);
+		break;
+	default:
+		puts("Can't recognise model file ...");
+		return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////
+//////////////////////////////////////////
+////////////////////////////////////////////
+
+uint BatchHashFile(const char * FileName, uint Hash)	// Add file contents to FNV-1a hash
+{
+	FILE * ptrFile;
+	uchar Buffer[4096];
+	size_t Count;
+
+	ptrFile = fopen(FileName, "rb");
+	if (ptrFile == NULL)
+		return Hash;
+
+	while ((Count = fread(Buffer, 1, sizeof(Buffer), ptrFile)) != 0)
+	{
+		for (size_t i = 0; i < Count; i++)
+		{
+			Hash ^= Buffer[i];
+			Hash *= 16777619;
+		}
+	}
+
+	fclose(ptrFile);
+
+	return Hash;
+}
+
+int BatchCompareFiles(const void * A, const void * B)	// qsort() callback
+{
+	return strcmp(((const sBatchFile *)A)->Path, ((const sBatchFile *)B)->Path);
+}
+
+int BatchFindFile(sBatchFile * Files, int FileCount, const char * Name)	// Find file by short name
+{
+	for (int i = 0; i < FileCount; i++)
+		if (!strcmp(Files[i].Name, Name))
+			return i;
+
+	return -1;
+}
+
+int BatchFindCache(sBatchFile * Files, int Index)	// Find first file with the same cache
+{
+	for (int i = 0; i < Index; i++)
+		if (!strcmp(Files[i].Cache, Files[Index].Cache))
+			return i;
+
+	return Index;
+}
+
+int BatchConvertFile(sBatchFile * File, const char * DstExt)	// Convert file if it was changed since last batch
+{
+	char cOutFileName[PATH_LEN];
+	char cInfFileName[PATH_LEN];
+
+	// Input hash: model, *.INF file (used by *.MDL -> *.DOL conversion) and program version
+	FileGetFullName(File->Path, cOutFileName, sizeof(cOutFileName));
+	strcpy(cInfFileName, cOutFileName);
+	strcat(cOutFileName, DstExt);
+	strcat(cInfFileName, ".inf");
+	File->SrcHash = 2166136261u;
+	for (const char * c = PROG_TITLE; *c != '\0'; c++)
+	{
+		File->SrcHash ^= (uchar)*c;
+		File->SrcHash *= 16777619;
+	}
+	File->SrcHash = BatchHashFile(File->Path, File->SrcHash);
+	if (File->Type == NORMAL_MODEL && !strcmp(DstExt, ".dol"))
+		File->SrcHash = BatchHashFile(cInfFileName, File->SrcHash);
+
+	// Skip if neither input nor output was changed
+	if (File->Cached == true && File->CachedSrcHash == File->SrcHash && CheckFile(cOutFileName) == true &&
+		BatchHashFile(cOutFileName, 2166136261u) == File->CachedOutHash)
+	{
+		printf("\nSkipping unchanged file: %s\n", File->Path);
+		File->OutHash = File->CachedOutHash;
+		return BATCH_SKIPPED;
+	}
+
+	// Convert
+	printf("\nProcessing file: %s\n", File->Path);
+	remove(cOutFileName);
+	if (ConvertModelFile(File->Path) == false || CheckFile(cOutFileName) == false)
+	{
+		File->OutHash = 0;
+		return BATCH_FAILED;
+	}
+	File->OutHash = BatchHashFile(cOutFileName, 2166136261u);
+
+	return BATCH_CONVERTED;
+}
+
+void BatchConvert(const char * Dir, const char * SrcExt, const char * DstExt)	// Convert all models in folder
+{
+	sBatchFile * Files = NULL;
+	int FileCount = 0;
+	int FileSlots = 0;
+	const char * Path;
+	char cFileExtension[5];
+	char Line[PATH_LEN + 32];
+	FILE * ptrCacheFile;
+
+	sModelHeader ModelHeader;
+	FILE * ptrModelFile;
+	char Ref[MDL_FILE_REF_SZ + 1];
+	char RefName[64];
+
+	int Families = 0;
+	int Converted = 0;
+	int Skipped = 0;
+	int Failed = 0;
+	int Missing = 0;
+
+	// Collect models
+	DirIterInit(Dir);
+	while ((Path = DirIterGet()) != NULL)
+	{
+		FileGetExtension(Path, cFileExtension, sizeof(cFileExtension));
+		if (strcmp(cFileExtension, SrcExt) || strlen(Path) >= PATH_LEN)
+			continue;
+
+		if (FileCount == FileSlots)
+		{
+			FileSlots = FileSlots ? FileSlots * 2 : 64;
+			Files = (sBatchFile *)realloc(Files, FileSlots * sizeof(sBatchFile));
+			if (Files == NULL)
+			{
+				UTIL_WAIT_KEY("Unable to allocate memory ...");
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		strcpy(Files[FileCount].Path, Path);
+		FileCount++;
+	}
+	DirIterClose();
+
+	if (FileCount == 0)
+	{
+		puts("No models found.");
+		return;
+	}
+	qsort(Files, FileCount, sizeof(sBatchFile), BatchCompareFiles);
+
+	for (int i = 0; i < FileCount; i++)
+	{
+		FileGetName(Files[i].Path, Files[i].Name, sizeof(Files[i].Name), false);
+		for (char * c = Files[i].Name; *c != '\0'; c++)
+			*c = tolower(*c);
+		FileGetPath(Files[i].Path, Files[i].Cache, sizeof(Files[i].Cache));
+		snprintf(&Files[i].Cache[strlen(Files[i].Cache)], sizeof(Files[i].Cache) - strlen(Files[i].Cache), "%s-%s.txt", BATCH_CACHE_FILE, &SrcExt[1]);
+		Files[i].Type = CheckModel(Files[i].Path);
+		Files[i].Head = -1;
+		Files[i].Cached = false;
+		Files[i].Done = false;
+		Files[i].OutHash = 0;
+	}
+
+	// Load caches: outputs are placed next to inputs, so every folder has its own cache
+	for (int i = 0; i < FileCount; i++)
+	{
+		if (BatchFindCache(Files, i) != i)
+			continue;
+
+		ptrCacheFile = fopen(Files[i].Cache, "r");
+		if (ptrCacheFile == NULL)
+			continue;
+
+		uint SrcHash, OutHash;
+		int NameStart;
+
+		while (fgets(Line, sizeof(Line), ptrCacheFile) != NULL)
+		{
+			Line[strcspn(Line, "\r\n")] = '\0';
+			if (sscanf(Line, "%X %X %n", &SrcHash, &OutHash, &NameStart) != 2)
+				continue;
+
+			for (int j = i; j < FileCount; j++)
+			{
+				if (!strcmp(Files[j].Path, &Line[NameStart]))
+				{
+					Files[j].Cached = true;
+					Files[j].CachedSrcHash = SrcHash;
+					Files[j].CachedOutHash = OutHash;
+					break;
+				}
+			}
+		}
+
+		fclose(ptrCacheFile);
+	}
+
+	// Find families: main model references sequence groups, texture model has "T" suffix
+	for (int i = 0; i < FileCount; i++)
+	{
+		if (Files[i].Type != NORMAL_MODEL && Files[i].Type != NOTEXTURES_MODEL)
+			continue;
+
+		// Texture model
+		int NameLen = strlen(Files[i].Name);
+		if (NameLen > 1 && Files[i].Name[NameLen - 1] == 't')
+		{
+			strcpy(RefName, Files[i].Name);
+			RefName[NameLen - 1] = '\0';
+			int Main = BatchFindFile(Files, FileCount, RefName);
+			if (Main != -1 && (Files[Main].Type == NORMAL_MODEL || Files[Main].Type == NOTEXTURES_MODEL))
+			{
+				Files[i].Head = Main;
+				continue;
+			}
+		}
+
+		// Sequence groups
+		SafeFileOpen(&ptrModelFile, Files[i].Path, "rb");
+		ModelHeader.UpdateFromFile(&ptrModelFile);
+		ulong ModelFileSize = FileSize(&ptrModelFile);
+		ulong Offset = ModelHeader.SubmodelTableOffset + MDL_DEF_REF_SZ + MDL_FILE_REF_SPACE;
+		for (ulong r = 1; r < ModelHeader.SubmodelCount; r++, Offset += MDL_FILE_REF_SZ + MDL_FILE_REF_SPACE)
+		{
+			if (Offset + MDL_FILE_REF_SZ > ModelFileSize)
+				break;
+
+			FileReadBlock(&ptrModelFile, Ref, Offset, MDL_FILE_REF_SZ);
+			Ref[MDL_FILE_REF_SZ] = '\0';
+
+			// Reference name without path and extension (both slashes are used in references)
+			char * Start = Ref;
+			for (char * c = Ref; *c != '\0'; c++)
+				if (*c == '/' || *c == '\\')
+					Start = c + 1;
+			char * Dot = strrchr(Start, '.');
+			if (Dot != NULL)
+				*Dot = '\0';
+			strncpy(RefName, Start, sizeof(RefName) - 1);
+			RefName[sizeof(RefName) - 1] = '\0';
+			for (char * c = RefName; *c != '\0'; c++)
+				*c = tolower(*c);
+
+			int Member = BatchFindFile(Files, FileCount, RefName);
+			if (Member == -1)
+			{
+				printf("Warning: %s references missing submodel %s\n", Files[i].Path, RefName);
+				Missing++;
+			}
+			else if (Member != i)
+			{
+				Files[Member].Head = i;
+			}
+		}
+		fclose(ptrModelFile);
+	}
+
+	// Nested references: submodel belongs to family of the topmost main model
+	// (circular references are left as they are)
+	for (int i = 0; i < FileCount; i++)
+	{
+		int Head = Files[i].Head;
+
+		for (int Steps = 0; Head != -1 && Files[Head].Head != -1 && Steps < FileCount; Steps++)
+			Head = Files[Head].Head;
+		if (Head != -1 && Files[Head].Head == -1)
+			Files[i].Head = Head;
+	}
+
+	// Convert families (main model first, then its submodels), files are processed one by one.
+	// Files that were not reached from main model (circular references) are converted separately
+	for (int Pass = 0; Pass < 2; Pass++)
+	{
+		for (int i = 0; i < FileCount; i++)
+		{
+			if (Files[i].Done == true || (Pass == 0 && Files[i].Head != -1))
+				continue;
+
+			// Main model (j == -1) and submodels that sort before or after it
+			Families++;
+			for (int j = -1; j < FileCount; j++)
+			{
+				int File = j == -1 ? i : j;
+
+				if (Files[File].Done == true || (j != -1 && Files[File].Head != i))
+					continue;
+
+				switch (BatchConvertFile(&Files[File], DstExt))
+				{
+				case BATCH_CONVERTED:	Converted++;	break;
+				case BATCH_SKIPPED:		Skipped++;		break;
+				default:				Failed++;		break;
+				}
+				Files[File].Done = true;
+			}
+		}
+	}
+
+	// Save caches
+	for (int i = 0; i < FileCount; i++)
+	{
+		if (BatchFindCache(Files, i) != i)
+			continue;
+
+		ptrCacheFile = fopen(Files[i].Cache, "w");
+		if (ptrCacheFile == NULL)
+		{
+			printf("Can't write cache file: %s\n", Files[i].Cache);
+			continue;
+		}
+		for (int j = i; j < FileCount; j++)
+			if (Files[j].OutHash != 0 && !strcmp(Files[j].Cache, Files[i].Cache))
+				fprintf(ptrCacheFile, "%08X %08X %s\n", Files[j].SrcHash, Files[j].OutHash, Files[j].Path);
+		fclose(ptrCacheFile);
+	}
+
+	// Summary
+	printf("\nBatch summary: %s\n", Dir);
+	printf(" Model families: %i (%i files)\n", Families, FileCount);
+	printf(" Converted: %i\n", Converted);
+	printf(" Skipped (unchanged): %i\n", Skipped);
+	printf(" Failed: %i\n", Failed);
+	printf(" Missing submodels: %i\n\n", Missing);
+
+	free(Files);
+}
+
 int main(int argc, char * argv[])
 {
 	FILE * ptrInputFile;
@@ -1398,6 +1552,7 @@ int main(int argc, char * argv[])
 	char ConfigFilePath[PATH_LEN];
 	char Line[80];
 	char cFileExtension[5];
+	sConvertOptions Options;
 
 	// Output info
 	puts(PROG_TITLE);
@@ -1411,53 +1566,27 @@ int main(int argc, char * argv[])
 	}
 	else if (argc == 2)		// Convert model
 	{
-		FileGetExtension(argv[1], cFileExtension, 5);
-
 		printf("\nProcessing file: %s\n", argv[1]);
 
-		if (!strcmp(".mdl", cFileExtension))
+		ConvertModelFile(argv[1]);
+	}
+	else if ((argc == 3 || argc == 4) && !strcmp(argv[1], "batch") == true)		// Convert all models in folder
+	{
+		if (CheckDir(argv[2]) == false)
 		{
-			if (CheckModel(argv[1]) == NORMAL_MODEL)
-			{
-				ConvertMDLToDOL(argv[1]);
-			}
-			else if (CheckModel(argv[1]) == SEQ_MODEL || CheckModel(argv[1]) == NOTEXTURES_MODEL)
-			{
-				ConvertSubmodel(argv[1], ".mdl", ".dol");
-			}
-			else if (CheckModel(argv[1]) == DUMMY_MODEL)
-			{
-				// Patch dummy model's extension and internal name
-				ConvertDummySubmodel(argv[1], ".mdl", ".dol");
-			}
-			else
-			{
-				puts("Can't recognise model file ...");
-			}
+			puts("Can't find folder.");
 		}
-		else if (!strcmp(".dol", cFileExtension))
+		else if (argc == 3 || !strcmp(argv[3], "mdl"))
 		{
-			if (CheckModel(argv[1]) == NORMAL_MODEL)
-			{
-				ConvertDOLToMDL(argv[1]);
-			}
-			else if (CheckModel(argv[1]) == SEQ_MODEL || CheckModel(argv[1]) == NOTEXTURES_MODEL)
-			{
-				ConvertSubmodel(argv[1], ".dol", ".mdl");
-			}
-			else if (CheckModel(argv[1]) == DUMMY_MODEL)
-			{
-				// Patch dummy model's extension and internal name
-				ConvertDummySubmodel(argv[1], ".dol", ".mdl");
-			}
-			else
-			{
-				puts("Can't recognise model file ...");
-			}
+			BatchConvert(argv[2], ".mdl", ".dol");
+		}
+		else if (!strcmp(argv[3], "dol"))
+		{
+			BatchConvert(argv[2], ".dol", ".mdl");
 		}
 		else
 		{
-			puts("Wrong file extension.");
+			puts("Can't recognise arguments.");
 		}
 	}
 	else if (argc == 3 && !strcmp(argv[1], "extract") == true)		// Extract textures from model
@@ -1485,6 +1614,141 @@ int main(int argc, char * argv[])
 			puts("Wrong file extension.");
 		}
 	}
+	else if (argc == 3 && !strcmp(argv[1], "lod") == true)		// Convert model with generated LODs
+	{
+		FileGetExtension(argv[2], cFileExtension, 5);
+
+		printf("\nProcessing file: %s\n", argv[2]);
+
+		if (strcmp(".mdl", cFileExtension))
+		{
+			puts("Wrong file extension.");
+		}
+		else if (CheckModel(argv[2]) == NORMAL_MODEL)
+		{
+			Options.Initialize();
+			Options.GenerateLODs = true;
+			ConvertMDLToDOL(argv[2], &Options);
+		}
+		else
+		{
+			puts("Can't generate LODs for this model ...");
+		}
+	}
+	else if (argc == 3 && !strcmp(argv[1], "restrip") == true)		// Convert model with rebuilt triangle commands
+	{
+		FileGetExtension(argv[2], cFileExtension, 5);
+
+		printf("\nProcessing file: %s\n", argv[2]);
+
+		Options.Initialize();
+		Options.RestripMeshes = true;
+
+		if (strcmp(".mdl", cFileExtension))
+			puts("Wrong file extension.");
+		else if (CheckModel(argv[2]) == NORMAL_MODEL)
+			ConvertMDLToDOL(argv[2], &Options);
+		else
+			puts("Can't find texture data ...");
+	}
+	else if (argc == 4 && !strcmp(argv[1], "diet") == true)		// Convert model without unused data
+	{
+		FileGetExtension(argv[2], cFileExtension, 5);
+
+		printf("\nProcessing file: %s\n", argv[2]);
+
+		Options.Initialize();
+		Options.DietList = argv[3];
+
+		if (strcmp(".mdl", cFileExtension))
+			puts("Wrong file extension.");
+		else if (CheckModel(argv[2]) == NORMAL_MODEL)
+			ConvertMDLToDOL(argv[2], &Options);
+		else
+			puts("Can't find texture data ...");
+	}
+	else if (argc >= 3 && argc <= 5 && !strcmp(argv[1], "anim") == true)		// Convert model with reduced animations
+	{
+		FileGetExtension(argv[2], cFileExtension, 5);
+
+		printf("\nProcessing file: %s\n", argv[2]);
+
+		Options.Initialize();
+		Options.ReduceAnims = true;
+		if (argc >= 4)
+			Options.AnimPosError = atof(argv[3]);
+		if (argc == 5)
+			Options.AnimAngleError = atof(argv[4]);
+
+		if (strcmp(".mdl", cFileExtension))
+			puts("Wrong file extension.");
+		else if (Options.AnimPosError < 0 || Options.AnimAngleError < 0)
+			puts("Wrong animation error.");
+		else if (CheckModel(argv[2]) == NORMAL_MODEL)
+			ConvertMDLToDOL(argv[2], &Options);
+		else
+			puts("Can't find texture data ...");
+	}
+	else if (argc == 3 && !strcmp(argv[1], "atlas") == true)		// Convert model with texture atlases
+	{
+		FileGetExtension(argv[2], cFileExtension, 5);
+
+		printf("\nProcessing file: %s\n", argv[2]);
+
+		Options.Initialize();
+		Options.AtlasTextures = true;
+
+		if (strcmp(".mdl", cFileExtension))
+			puts("Wrong file extension.");
+		else if (CheckModel(argv[2]) == NORMAL_MODEL)
+			ConvertMDLToDOL(argv[2], &Options);
+		else
+			puts("Can't find texture data ...");
+	}
+	else if ((argc == 3 || argc == 4) && !strcmp(argv[1], "scale") == true)		// Convert model with resampled textures
+	{
+		FileGetExtension(argv[2], cFileExtension, 5);
+
+		printf("\nProcessing file: %s\n", argv[2]);
+
+		Options.Initialize();
+		Options.ScaleTextures = true;
+		if (argc == 4)
+			Options.VRAMBudget = atoi(argv[3]) * 1024;
+
+		if (strcmp(".mdl", cFileExtension))
+			puts("Wrong file extension.");
+		else if (argc == 4 && atoi(argv[3]) <= 0)
+			puts("Wrong VRAM budget.");
+		else if (CheckModel(argv[2]) == NORMAL_MODEL)
+			ConvertMDLToDOL(argv[2], &Options);
+		else
+			puts("Can't find texture data ...");
+	}
+	else if (argc >= 3 && !strcmp(argv[1], "profile") == true)		// Report memory footprint
+	{
+		ProfileModels(argc - 2, &argv[2]);
+	}
+	else if (argc >= 3 && !strcmp(argv[1], "texdup") == true)		// Report duplicate textures
+	{
+		TexDupCensus(argc - 2, &argv[2]);
+	}
+	else if (argc == 3 && !strcmp(argv[1], "texmerge") == true)		// Convert model with merged duplicate textures
+	{
+		FileGetExtension(argv[2], cFileExtension, 5);
+
+		printf("\nProcessing file: %s\n", argv[2]);
+
+		Options.Initialize();
+		Options.MergeTextures = true;
+
+		if (strcmp(".mdl", cFileExtension))
+			puts("Wrong file extension.");
+		else if (CheckModel(argv[2]) == NORMAL_MODEL)
+			ConvertMDLToDOL(argv[2], &Options);
+		else
+			puts("Can't find texture data ...");
+	}
 	else if (argc == 3 && !strcmp(argv[1], "seqrep") == true)		// Report sequences
 	{
 		FileGetExtension(argv[2], cFileExtension, 5);
@@ -0,0 +1,576 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains in-memory model: file is read at once, output is
+// assembled in memory and written at once
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Functions //////////
+static ulong ModelAlign(ulong Offset);		// Align offset to 16 bytes (PS2 HL likes everything to be alligned)
+static int ModelCompareMeshes(const void * A, const void * B);		// qsort() callback
+static void ModelMoveOffset(int * Offset, ulong Begin, ulong End, long Delta, ulong * Inside);	// Move offset that points after changed block
+static ulong ModelMoveOffsets(sModel * Model, ulong Begin, ulong End, long Delta);	// Move all offsets that point after changed block (returns number of offsets that point inside)
+
+static ulong ModelAlign(ulong Offset)
+{
+	return ((Offset / 16) + ((Offset % 16) && 1)) * 16;
+}
+
+static int ModelCompareMeshes(const void * A, const void * B)
+{
+	const sModelMesh * MeshA = *(const sModelMesh **)A;
+	const sModelMesh * MeshB = *(const sModelMesh **)B;
+
+	if (MeshA->TriCmdOffset < MeshB->TriCmdOffset)
+		return -1;
+	if (MeshA->TriCmdOffset > MeshB->TriCmdOffset)
+		return 1;
+	return 0;
+}
+
+static void ModelMoveOffset(int * Offset, ulong Begin, ulong End, long Delta, ulong * Inside)
+{
+	// 0 - no data
+	if (*Offset <= 0)
+		return;
+
+	if ((ulong)*Offset >= End)
+		*Offset += Delta;
+	else if ((ulong)*Offset >= Begin)
+		(*Inside)++;
+}
+
+static ulong ModelMoveOffsets(sModel * Model, ulong Begin, ulong End, long Delta)
+{
+	sModelHeader * Header = Model->Header;
+	ulong Inside = 0;
+
+	// Header
+	ModelMoveOffset((int *)&Header->BoneTableOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->BoneControllerOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->HitboxOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->SeqTableOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->SubmodelTableOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->TextureTableOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->TextureDataOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->SkinTableOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->SubmeshTableOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->AttachmentOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->SoundOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->SoundGroupOffset, Begin, End, Delta, &Inside);
+	ModelMoveOffset((int *)&Header->TransitionOffset, Begin, End, Delta, &Inside);
+
+	// Sequences (animations from sequence files aren't located in this file)
+	if (Model->CheckBounds(Header->SeqTableOffset, Header->SeqCount * sizeof(sModelSeq)))
+	{
+		sModelSeq * Seqs = (sModelSeq *)&Model->Data[Header->SeqTableOffset];
+		for (ulong i = 0; i < Header->SeqCount; i++)
+		{
+			ModelMoveOffset(&Seqs[i].EventOffset, Begin, End, Delta, &Inside);
+			ModelMoveOffset(&Seqs[i].PivotOffset, Begin, End, Delta, &Inside);
+			ModelMoveOffset(&Seqs[i].AutoMovePosOffset, Begin, End, Delta, &Inside);
+			ModelMoveOffset(&Seqs[i].AutoMoveAngleOffset, Begin, End, Delta, &Inside);
+			if (Seqs[i].Num == 0)
+				ModelMoveOffset(&Seqs[i].AnimOffset, Begin, End, Delta, &Inside);
+		}
+	}
+
+	// Body parts
+	if (Model->CheckBounds(Header->SubmeshTableOffset, Header->SubmeshCount * sizeof(sModelBodyGroup)))
+	{
+		sModelBodyGroup * Groups = (sModelBodyGroup *)&Model->Data[Header->SubmeshTableOffset];
+		for (ulong g = 0; g < Header->SubmeshCount; g++)
+		{
+			ModelMoveOffset(&Groups[g].PartTableOffset, Begin, End, Delta, &Inside);
+			if (Groups[g].PartCount <= 0 || !Model->CheckBounds(Groups[g].PartTableOffset, Groups[g].PartCount * sizeof(sModelBodyPart)))
+				continue;
+
+			sModelBodyPart * Parts = (sModelBodyPart *)&Model->Data[Groups[g].PartTableOffset];
+			for (int p = 0; p < Groups[g].PartCount; p++)
+			{
+				ModelMoveOffset(&Parts[p].MeshTableOffset, Begin, End, Delta, &Inside);
+				ModelMoveOffset(&Parts[p].VertBoneOffset, Begin, End, Delta, &Inside);
+				ModelMoveOffset(&Parts[p].VertOffset, Begin, End, Delta, &Inside);
+				ModelMoveOffset(&Parts[p].NormBoneOffset, Begin, End, Delta, &Inside);
+				ModelMoveOffset(&Parts[p].NormOffset, Begin, End, Delta, &Inside);
+				ModelMoveOffset(&Parts[p].GroupOffset, Begin, End, Delta, &Inside);
+				if (Parts[p].MeshCount <= 0 || !Model->CheckBounds(Parts[p].MeshTableOffset, Parts[p].MeshCount * sizeof(sModelMesh)))
+					continue;
+
+				sModelMesh * Meshes = (sModelMesh *)&Model->Data[Parts[p].MeshTableOffset];
+				for (int m = 0; m < Parts[p].MeshCount; m++)
+				{
+					ModelMoveOffset(&Meshes[m].TriCmdOffset, Begin, End, Delta, &Inside);
+					ModelMoveOffset(&Meshes[m].NormOffset, Begin, End, Delta, &Inside);
+				}
+			}
+		}
+	}
+
+	// Textures
+	if (Model->CheckBounds(Header->TextureTableOffset, Header->TextureCount * sizeof(sModelTextureEntry)))
+	{
+		sModelTextureEntry * Table = (sModelTextureEntry *)&Model->Data[Header->TextureTableOffset];
+		for (ulong i = 0; i < Header->TextureCount; i++)
+			ModelMoveOffset((int *)&Table[i].Offset, Begin, End, Delta, &Inside);
+	}
+
+	return Inside;
+}
+
+void sModel::Initialize()
+{
+	Data = NULL;
+	DataSize = 0;
+	Header = NULL;
+	Body = NULL;
+	BodySize = 0;
+	TextureTable = NULL;
+	SkinTable = NULL;
+	SkinTableSize = 0;
+	Textures = NULL;
+}
+
+bool sModel::LoadFromFile(const char * FileName)
+{
+	FILE * ptrFile;
+
+	// Destroy old data
+	Free();
+
+	// Read whole file
+	SafeFileOpen(&ptrFile, FileName, "rb");
+	DataSize = FileSize(&ptrFile);
+	if (DataSize < sizeof(sModelHeader))
+	{
+		fclose(ptrFile);
+		return false;
+	}
+	Data = (uchar *)malloc(DataSize);
+	if (Data == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	FileReadBlock(&ptrFile, Data, 0, DataSize);
+	fclose(ptrFile);
+
+	// Header
+	Header = (sModelHeader *)Data;
+	Header->Name[63] = '\0';		// Fix for long non null terminated names (same as in sModelHeader::UpdateFromFile())
+	if (Header->CheckModel() != NORMAL_MODEL)
+		return false;
+
+	// Check tables
+	if (Header->TextureTableOffset < sizeof(sModelHeader) || Header->TextureTableOffset > DataSize ||
+		Header->TextureCount > (DataSize - Header->TextureTableOffset) / sizeof(sModelTextureEntry))
+	{
+		puts("Texture table is out of file bounds ...");
+		return false;
+	}
+	SkinTableSize = Header->SkinCount * Header->SkinEntrySize * 2;
+	if (Header->SkinTableOffset > DataSize || SkinTableSize > DataSize - Header->SkinTableOffset)
+	{
+		puts("Skin table is out of file bounds ...");
+		return false;
+	}
+
+	// Set pointers
+	Body = &Data[sizeof(sModelHeader)];
+	BodySize = Header->TextureTableOffset - sizeof(sModelHeader);
+	TextureTable = (sModelTextureEntry *)&Data[Header->TextureTableOffset];
+	SkinTable = &Data[Header->SkinTableOffset];
+
+	// Prepare texture slots
+	Textures = (sTexture *)malloc(sizeof(sTexture) * Header->TextureCount);
+	if (Textures == NULL && Header->TextureCount != 0)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	for (ulong i = 0; i < Header->TextureCount; i++)
+		Textures[i].Initialize();
+
+	return true;
+}
+
+bool sModel::CheckBounds(long Offset, ulong Size)
+{
+	return Offset >= 0 && (ulong)Offset <= DataSize && Size <= DataSize - Offset;
+}
+
+sModelMesh ** sModel::CollectMeshes(ulong * Count)
+{
+	sModelMesh ** Meshes = NULL;
+
+	// First pass - count, second - fill the list
+	for (int Pass = 0; Pass < 2; Pass++)
+	{
+		*Count = 0;
+		if (!CheckBounds(Header->SubmeshTableOffset, Header->SubmeshCount * sizeof(sModelBodyGroup)))
+			break;
+
+		sModelBodyGroup * Groups = (sModelBodyGroup *)&Data[Header->SubmeshTableOffset];
+		for (ulong g = 0; g < Header->SubmeshCount; g++)
+		{
+			if (Groups[g].PartCount <= 0 || !CheckBounds(Groups[g].PartTableOffset, Groups[g].PartCount * sizeof(sModelBodyPart)))
+				continue;
+
+			sModelBodyPart * Parts = (sModelBodyPart *)&Data[Groups[g].PartTableOffset];
+			for (int p = 0; p < Groups[g].PartCount; p++)
+			{
+				if (Parts[p].MeshCount <= 0 || !CheckBounds(Parts[p].MeshTableOffset, Parts[p].MeshCount * sizeof(sModelMesh)))
+					continue;
+
+				sModelMesh * PartMeshes = (sModelMesh *)&Data[Parts[p].MeshTableOffset];
+				for (int m = 0; m < Parts[p].MeshCount; m++)
+				{
+					if (PartMeshes[m].SkinRef < 0 || (ulong)PartMeshes[m].SkinRef >= Header->SkinCount)
+						continue;
+					if (Meshes != NULL)
+						Meshes[*Count] = &PartMeshes[m];
+					(*Count)++;
+				}
+			}
+		}
+
+		if (Pass == 0)
+			UTIL_MALLOC(sModelMesh **, Meshes, (*Count + 1) * sizeof(sModelMesh *), exit(EXIT_FAILURE));
+	}
+
+	qsort(Meshes, *Count, sizeof(sModelMesh *), ModelCompareMeshes);
+
+	return Meshes;
+}
+
+bool sModel::LoadTexture(ulong Index, bool DOL)
+{
+	ulong BitmapOffset;
+	ulong BitmapSize;
+	ulong PaletteOffset;
+	ulong PaletteSize;
+	sModelTextureEntry * Entry = &TextureTable[Index];
+
+	BitmapSize = Entry->Height * Entry->Width;
+	if (DOL == true)
+	{
+		PaletteOffset = Entry->Offset + DOL_TEXTURE_HEADER_SIZE;
+		PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * DOL_BMP_PALETTE_ELEMENT_SIZE;
+		BitmapOffset = PaletteOffset + PaletteSize;
+	}
+	else
+	{
+		BitmapOffset = Entry->Offset + MDL_TEXTURE_HEADER_SIZE;
+		PaletteOffset = Entry->Offset + BitmapSize;
+		PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * MDL_PALETTE_ELEMENT_SIZE;
+	}
+
+	// Check bounds
+	if (BitmapOffset > DataSize || BitmapSize > DataSize - BitmapOffset ||
+		PaletteOffset > DataSize || PaletteSize > DataSize - PaletteOffset)
+	{
+		printf("Texture #%i is out of file bounds ...\n", (int)Index + 1);
+		return false;
+	}
+
+	Textures[Index].UpdateFromMemory(Data, BitmapOffset, BitmapSize, PaletteOffset, PaletteSize, Entry->Name, Entry->Width, Entry->Height);
+
+	return true;
+}
+
+bool sModel::LoadTextures(bool DOL)
+{
+	for (ulong i = 0; i < Header->TextureCount; i++)
+		if (LoadTexture(i, DOL) == false)
+			return false;
+
+	return true;
+}
+
+bool sModel::SaveMDL(const char * FileName)
+{
+	sModelHeader NewHeader;
+	sModelTextureEntry * NewTable;
+	char NewName[64];
+	FILE * ptrFile;
+	uchar * Out;
+	ulong OutSize;
+	ulong Offset;
+	ulong TableSize = Header->TextureCount * sizeof(sModelTextureEntry);
+
+	// Calculate layout: header, model data, texture table, skin table, textures
+	ulong TextureDataOffset = Header->TextureTableOffset + TableSize + SkinTableSize;
+	OutSize = TextureDataOffset;
+	for (ulong i = 0; i < Header->TextureCount; i++)
+		OutSize += Textures[i].Width * Textures[i].Height + Textures[i].PaletteSize;
+
+	// Allocate memory
+	Out = (uchar *)calloc(1, OutSize);
+	if (Out == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+
+	// Header
+	memcpy(&NewHeader, Header, sizeof(sModelHeader));
+	FileGetName(FileName, NewName, sizeof(NewName), false);
+	strcat(NewName, ".mdl");
+	NewHeader.Rename(NewName);
+	NewHeader.TextureDataOffset = TextureDataOffset;
+	NewHeader.FileSize = OutSize;
+	memcpy(Out, &NewHeader, sizeof(sModelHeader));
+
+	// Model data
+	memcpy(&Out[sizeof(sModelHeader)], Body, BodySize);
+
+	// Texture table and textures
+	NewTable = (sModelTextureEntry *)&Out[Header->TextureTableOffset];
+	memcpy(NewTable, TextureTable, TableSize);
+	Offset = TextureDataOffset;
+	for (ulong i = 0; i < Header->TextureCount; i++)
+	{
+		ulong BitmapSize = Textures[i].Width * Textures[i].Height;
+
+		NewTable[i].Width = Textures[i].Width;
+		NewTable[i].Height = Textures[i].Height;
+		NewTable[i].Offset = Offset;
+
+		memcpy(&Out[Offset], Textures[i].Bitmap, BitmapSize);
+		memcpy(&Out[Offset + BitmapSize], Textures[i].Palette, Textures[i].PaletteSize);
+		Offset += BitmapSize + Textures[i].PaletteSize;
+	}
+
+	// Skin table
+	memcpy(&Out[Header->TextureTableOffset + TableSize], SkinTable, SkinTableSize);
+
+	// Write file
+	SafeFileOpen(&ptrFile, FileName, "wb");
+	FileWriteBlock(&ptrFile, Out, OutSize);
+	fclose(ptrFile);
+
+	free(Out);
+
+	return true;
+}
+
+bool sModel::SaveDOL(const char * FileName, sDOLExtraSection * DOLExtraSect, sDOLLODEntry * LODTable)
+{
+	sModelHeader NewHeader;
+	sModelTextureEntry * NewTable;
+	sDOLTextureHeader DOLTextureHeader;
+	char NewName[64];
+	char TextureName[64];
+	FILE * ptrFile;
+	uchar * Out;
+	ulong OutSize;
+	ulong Offset;
+	ulong TableSize = Header->TextureCount * sizeof(sModelTextureEntry);
+	ulong LODTableSize = 0;
+
+	// Calculate layout: header, model data, texture table, skin table, (align), textures, LOD table, (align)
+	ulong TextureDataOffset = ModelAlign(Header->TextureTableOffset + TableSize + SkinTableSize);
+	OutSize = TextureDataOffset;
+	for (ulong i = 0; i < Header->TextureCount; i++)
+		OutSize += sizeof(sDOLTextureHeader) + Textures[i].PaletteSize + Textures[i].Width * Textures[i].Height;
+	ulong LODDataOffset = OutSize;
+	if (DOLExtraSect != NULL)
+	{
+		if (LODTable != NULL)
+			LODTableSize = DOLExtraSect->NumBodyGroups * DOLExtraSect->MaxBodyParts * sizeof(sDOLLODEntry);
+		OutSize = ModelAlign(OutSize + LODTableSize);
+	}
+
+	// Allocate memory (zeroes are used as spacers after skin table)
+	Out = (uchar *)calloc(1, OutSize);
+	if (Out == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+
+	// Header
+	memcpy(&NewHeader, Header, sizeof(sModelHeader));
+	FileGetName(FileName, NewName, sizeof(NewName), false);
+	strcat(NewName, ".dol");
+	NewHeader.Rename(NewName);
+	NewHeader.TextureDataOffset = TextureDataOffset;
+	NewHeader.FileSize = OutSize;
+	memcpy(Out, &NewHeader, sizeof(sModelHeader));
+
+	// Model data
+	memcpy(&Out[sizeof(sModelHeader)], Body, BodySize);
+
+	// Texture table and textures
+	NewTable = (sModelTextureEntry *)&Out[Header->TextureTableOffset];
+	memcpy(NewTable, TextureTable, TableSize);
+	Offset = TextureDataOffset;
+	for (ulong i = 0; i < Header->TextureCount; i++)
+	{
+		NewTable[i].Width = Textures[i].Width;
+		NewTable[i].Height = Textures[i].Height;
+		NewTable[i].Offset = Offset;
+
+		// Remove ".bmp" in texture name
+		FileGetName(Textures[i].Name, TextureName, sizeof(TextureName), false);
+		DOLTextureHeader.Update(TextureName, Textures[i].Width, Textures[i].Height);
+
+		memcpy(&Out[Offset], &DOLTextureHeader, sizeof(sDOLTextureHeader));
+		Offset += sizeof(sDOLTextureHeader);
+		memcpy(&Out[Offset], Textures[i].Palette, Textures[i].PaletteSize);
+		Offset += Textures[i].PaletteSize;
+		memcpy(&Out[Offset], Textures[i].Bitmap, Textures[i].Width * Textures[i].Height);
+		Offset += Textures[i].Width * Textures[i].Height;
+	}
+
+	// Skin table
+	memcpy(&Out[Header->TextureTableOffset + TableSize], SkinTable, SkinTableSize);
+
+	// Data from *.INF file
+	if (DOLExtraSect != NULL)
+	{
+		// Extra section
+		DOLExtraSect->LODDataOffset = LODDataOffset;
+		memcpy(&Out[sizeof(sModelHeader)], DOLExtraSect, sizeof(sDOLExtraSection));
+
+		// LOD table
+		if (LODTable != NULL)
+			memcpy(&Out[LODDataOffset], LODTable, LODTableSize);
+
+		// Align data
+		memset(&Out[LODDataOffset + LODTableSize], 0x11, OutSize - (LODDataOffset + LODTableSize));
+	}
+
+	// Write file
+	SafeFileOpen(&ptrFile, FileName, "wb");
+	FileWriteBlock(&ptrFile, Out, OutSize);
+	fclose(ptrFile);
+
+	free(Out);
+
+	return true;
+}
+
+void sModel::AppendBody(const void * Extra, ulong ExtraSize)
+{
+	ulong Offset = Header->TextureTableOffset;
+	uchar * NewData;
+
+	// Insert data
+	NewData = (uchar *)malloc(DataSize + ExtraSize);
+	if (NewData == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(NewData, Data, Offset);
+	memcpy(&NewData[Offset], Extra, ExtraSize);
+	memcpy(&NewData[Offset + ExtraSize], &Data[Offset], DataSize - Offset);
+	free(Data);
+	Data = NewData;
+	DataSize += ExtraSize;
+
+	// Move everything that is located after model data
+	Header = (sModelHeader *)Data;
+	Header->TextureTableOffset += ExtraSize;
+	if (Header->SkinTableOffset >= Offset)
+		Header->SkinTableOffset += ExtraSize;
+	if (Header->TextureDataOffset >= Offset)
+		Header->TextureDataOffset += ExtraSize;
+	Body = &Data[sizeof(sModelHeader)];
+	BodySize += ExtraSize;
+	TextureTable = (sModelTextureEntry *)&Data[Header->TextureTableOffset];
+	for (ulong i = 0; i < Header->TextureCount; i++)
+		if (TextureTable[i].Offset >= Offset)
+			TextureTable[i].Offset += ExtraSize;
+	SkinTable = &Data[Header->SkinTableOffset];
+}
+
+ulong sModel::CountOffsets(ulong Offset, ulong Size)
+{
+	return ModelMoveOffsets(this, Offset, Offset + Size, 0);
+}
+
+void sModel::ResizeBody(ulong Offset, ulong OldSize, const void * NewData, ulong NewSize)
+{
+	uchar * NewFile;
+	ulong NewFileSize = DataSize - OldSize + NewSize;
+
+	// Replace data
+	NewFile = (uchar *)malloc(NewFileSize);
+	if (NewFile == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(NewFile, Data, Offset);
+	if (NewSize > 0)
+		memcpy(&NewFile[Offset], NewData, NewSize);
+	memcpy(&NewFile[Offset + NewSize], &Data[Offset + OldSize], DataSize - (Offset + OldSize));
+	free(Data);
+	Data = NewFile;
+	DataSize = NewFileSize;
+
+	// Move everything that is located after changed block
+	Header = (sModelHeader *)Data;
+	ModelMoveOffsets(this, Offset, Offset + OldSize, (long)NewSize - (long)OldSize);
+	Body = &Data[sizeof(sModelHeader)];
+	BodySize = BodySize - OldSize + NewSize;
+	TextureTable = (sModelTextureEntry *)&Data[Header->TextureTableOffset];
+	SkinTable = &Data[Header->SkinTableOffset];
+}
+
+void sModel::ReplaceTextures(sTexture * NewTextures, const sModelTextureEntry * NewTable, ulong NewCount, const uchar * NewSkinTable)
+{
+	ulong Offset = Header->TextureTableOffset;
+	ulong TableSize = NewCount * sizeof(sModelTextureEntry);
+	uchar * NewData;
+
+	// Texture data is not needed anymore (textures are decoded), so new
+	// tables are placed right after model data
+	NewData = (uchar *)malloc(Offset + TableSize + SkinTableSize);
+	if (NewData == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(NewData, Data, Offset);
+	memcpy(&NewData[Offset], NewTable, TableSize);
+	memcpy(&NewData[Offset + TableSize], NewSkinTable, SkinTableSize);
+	free(Data);
+	Data = NewData;
+	DataSize = Offset + TableSize + SkinTableSize;
+
+	// Update header and pointers
+	Header = (sModelHeader *)Data;
+	Header->TextureCount = NewCount;
+	Header->SkinTableOffset = Offset + TableSize;
+	Header->TextureDataOffset = DataSize;
+	Body = &Data[sizeof(sModelHeader)];
+	TextureTable = (sModelTextureEntry *)&Data[Offset];
+	for (ulong i = 0; i < NewCount; i++)
+		TextureTable[i].Offset = 0;
+	SkinTable = &Data[Header->SkinTableOffset];
+
+	// Old textures are moved to new array or freed by caller
+	free(Textures);
+	Textures = NewTextures;
+}
+
+void sModel::Free()
+{
+	if (Textures != NULL)
+	{
+		for (ulong i = 0; i < Header->TextureCount; i++)
+			Textures[i].Free();
+		free(Textures);
+	}
+	free(Data);
+
+	Initialize();
+}
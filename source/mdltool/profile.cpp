@@ -0,0 +1,391 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains memory footprint profiler: every model is split into
+// bytes of header, bones, body parts, meshes, sequences, animations,
+// textures, palettes and LOD section. Bytes that don't belong to any
+// table are counted as padding, bytes that would be added by resizing
+// textures to PS2 proper sizes (*.MDL only) are counted separately.
+// Results are sorted by file size and saved as *.CSV and *.JSON
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Structures //////////
+
+// Footprint of a model
+struct sProfile
+{
+	char Path[PATH_LEN];
+	ulong Size;						// File size
+	ulong Bytes[PROFILE_PARTS];		// Bytes of every part
+	bool Valid;						// Model is loaded
+};
+
+// Offsets of tables that are already counted (tables can be shared)
+struct sProfileSeen
+{
+	long * Offsets;
+	ulong Count;
+};
+
+////////// Functions //////////
+static ulong ProfileOnce(sProfileSeen * Seen, long Offset, ulong Size);						// Size of table if it isn't counted yet (0 - counted)
+static ulong ProfileTriCmdSize(sModel * Model, ulong Offset);								// Size of triangle commands
+static void ProfileModel(const char * FileName, sProfile * Profile);						// Split model into parts
+static void ProfileAddFile(sProfile ** Files, int * Count, int * Slots, const char * Path);	// Add model to list
+static int ProfileCompare(const void * A, const void * B);									// qsort() callback (bigger first)
+static void ProfileWriteString(FILE * ptrFile, const char * String);						// Write JSON string
+
+static const char * ProfileNames[PROFILE_PARTS] = { "header", "bones", "bodyparts", "meshes", "sequences", "animations", "textures", "palettes", "lod", "padding", "potwaste" };
+
+///////// Code /////////
+static ulong ProfileOnce(sProfileSeen * Seen, long Offset, ulong Size)
+{
+	if (Offset <= 0 || Size == 0)
+		return 0;
+	for (ulong i = 0; i < Seen->Count; i++)
+		if (Seen->Offsets[i] == Offset)
+			return 0;
+
+	Seen->Offsets = (long *)realloc(Seen->Offsets, (Seen->Count + 1) * sizeof(long));
+	if (Seen->Offsets == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	Seen->Offsets[Seen->Count++] = Offset;
+
+	return Size;
+}
+
+static ulong ProfileTriCmdSize(sModel * Model, ulong Offset)
+{
+	ulong Start = Offset;
+
+	while (1)
+	{
+		short Count;
+
+		if (!Model->CheckBounds(Offset, sizeof(short)))
+			return 0;
+		Count = *(short *)&Model->Data[Offset];
+		Offset += sizeof(short);
+		if (Count == 0)
+			break;
+		if (Count < 0)
+			Count = -Count;
+		if (!Model->CheckBounds(Offset, Count * sizeof(sModelTriVert)))
+			return 0;
+		Offset += Count * sizeof(sModelTriVert);
+	}
+
+	return Offset - Start;
+}
+
+static void ProfileModel(const char * FileName, sProfile * Profile)
+{
+	FILE * ptrFile;
+	sModel Model;
+	sModelHeader * Header;
+	sProfileSeen Seen;
+	ulong * Bytes = Profile->Bytes;
+	char Extension[5];
+	bool DOL;
+	long Padding;
+
+	memset(Profile, 0x00, sizeof(sProfile));
+	strcpy(Profile->Path, FileName);
+	FileGetExtension(FileName, Extension, sizeof(Extension));
+	DOL = !strcmp(Extension, ".dol");
+
+	// Read whole file
+	Model.Initialize();
+	ptrFile = fopen(FileName, "rb");
+	if (ptrFile == NULL)
+		return;
+	Model.DataSize = FileSize(&ptrFile);
+	Profile->Size = Model.DataSize;
+	if (Model.DataSize < sizeof(sModelHeader))
+	{
+		fclose(ptrFile);
+		return;
+	}
+	UTIL_MALLOC(uchar *, Model.Data, Model.DataSize, exit(EXIT_FAILURE));
+	FileReadBlock(&ptrFile, Model.Data, 0, Model.DataSize);
+	fclose(ptrFile);
+	Header = Model.Header = (sModelHeader *)Model.Data;
+
+	// Sequence group file: header and animations
+	if (Header->CheckModel() == SEQ_MODEL)
+	{
+		Bytes[PROFILE_HEADER] = MDL_SEQ_HEADER_SIZE;
+		Bytes[PROFILE_ANIMATIONS] = Model.DataSize - MDL_SEQ_HEADER_SIZE;
+		Profile->Valid = true;
+		Model.Free();
+		return;
+	}
+	if (Header->CheckModel() != NORMAL_MODEL && Header->CheckModel() != NOTEXTURES_MODEL)
+	{
+		Model.Free();
+		return;
+	}
+	Profile->Valid = true;
+	Seen.Offsets = NULL;
+	Seen.Count = 0;
+
+	// Header (extra section of *.DOL is a part of LOD section)
+	Bytes[PROFILE_HEADER] = sizeof(sModelHeader);
+	if (DOL == true && Header->TextureTableOffset >= sizeof(sModelHeader) + sizeof(sDOLExtraSection) && Model.CheckBounds(sizeof(sModelHeader), sizeof(sDOLExtraSection)))
+	{
+		sDOLExtraSection * Extra = (sDOLExtraSection *)&Model.Data[sizeof(sModelHeader)];
+		ulong LODSize = Extra->NumBodyGroups * Extra->MaxBodyParts * sizeof(sDOLLODEntry);
+
+		Bytes[PROFILE_LOD] = sizeof(sDOLExtraSection);
+		if (LODSize != 0 && Model.CheckBounds(Extra->LODDataOffset, LODSize))
+			Bytes[PROFILE_LOD] += LODSize;
+	}
+
+	// Bones, bone controllers, hitboxes and attachments
+	if (Model.CheckBounds(Header->BoneTableOffset, Header->BoneCount * sizeof(sModelBone)))
+		Bytes[PROFILE_BONES] += Header->BoneCount * sizeof(sModelBone);
+	if (Model.CheckBounds(Header->BoneControllerOffset, Header->BoneControllerCount * MDL_BONECONTROLLER_SIZE))
+		Bytes[PROFILE_BONES] += Header->BoneControllerCount * MDL_BONECONTROLLER_SIZE;
+	if (Model.CheckBounds(Header->HitboxOffset, Header->HitboxCount * MDL_HITBOX_SIZE))
+		Bytes[PROFILE_BONES] += Header->HitboxCount * MDL_HITBOX_SIZE;
+	if (Model.CheckBounds(Header->AttachmentOffset, Header->AttachmentCount * MDL_ATTACHMENT_SIZE))
+		Bytes[PROFILE_BONES] += Header->AttachmentCount * MDL_ATTACHMENT_SIZE;
+
+	// Sequences, sequence groups, transitions and animations
+	if (Model.CheckBounds(Header->SeqTableOffset, Header->SeqCount * sizeof(sModelSeq)))
+	{
+		sModelSeq * Seqs = (sModelSeq *)&Model.Data[Header->SeqTableOffset];
+
+		Bytes[PROFILE_SEQUENCES] += Header->SeqCount * sizeof(sModelSeq);
+		for (ulong s = 0; s < Header->SeqCount; s++)
+		{
+			if (Seqs[s].EventCount > 0 && Model.CheckBounds(Seqs[s].EventOffset, Seqs[s].EventCount * sizeof(sModelEvent)))
+				Bytes[PROFILE_SEQUENCES] += ProfileOnce(&Seen, Seqs[s].EventOffset, Seqs[s].EventCount * sizeof(sModelEvent));
+			if (Seqs[s].PivotCount > 0 && Model.CheckBounds(Seqs[s].PivotOffset, Seqs[s].PivotCount * sizeof(sModelPivot)))
+				Bytes[PROFILE_SEQUENCES] += ProfileOnce(&Seen, Seqs[s].PivotOffset, Seqs[s].PivotCount * sizeof(sModelPivot));
+			if (Seqs[s].Num == 0 && Model.CheckBounds(Header->BoneTableOffset, Header->BoneCount * sizeof(sModelBone)))
+				Bytes[PROFILE_ANIMATIONS] += ProfileOnce(&Seen, Seqs[s].AnimOffset, AnimSeqSize(&Model, &Seqs[s]));
+		}
+	}
+	if (Model.CheckBounds(Header->SubmodelTableOffset, Header->SubmodelCount * sizeof(sModelSeqGroup)))
+		Bytes[PROFILE_SEQUENCES] += Header->SubmodelCount * sizeof(sModelSeqGroup);
+	if (Model.CheckBounds(Header->TransitionOffset, Header->TransitionCount * Header->TransitionCount))
+		Bytes[PROFILE_SEQUENCES] += Header->TransitionCount * Header->TransitionCount;
+
+	// Body parts (vertices and normals) and meshes (triangle commands)
+	if (Model.CheckBounds(Header->SubmeshTableOffset, Header->SubmeshCount * sizeof(sModelBodyGroup)))
+	{
+		sModelBodyGroup * Groups = (sModelBodyGroup *)&Model.Data[Header->SubmeshTableOffset];
+
+		Bytes[PROFILE_BODYPARTS] += Header->SubmeshCount * sizeof(sModelBodyGroup);
+		for (ulong g = 0; g < Header->SubmeshCount; g++)
+		{
+			if (Groups[g].PartCount <= 0 || !Model.CheckBounds(Groups[g].PartTableOffset, Groups[g].PartCount * sizeof(sModelBodyPart)))
+				continue;
+
+			sModelBodyPart * Parts = (sModelBodyPart *)&Model.Data[Groups[g].PartTableOffset];
+			Bytes[PROFILE_BODYPARTS] += ProfileOnce(&Seen, Groups[g].PartTableOffset, Groups[g].PartCount * sizeof(sModelBodyPart));
+			for (int p = 0; p < Groups[g].PartCount; p++)
+			{
+				sModelBodyPart * Part = &Parts[p];
+
+				if (Part->VertCount > 0 && Model.CheckBounds(Part->VertOffset, Part->VertCount * 3 * sizeof(float)))
+				{
+					Bytes[PROFILE_BODYPARTS] += ProfileOnce(&Seen, Part->VertBoneOffset, Part->VertCount);
+					Bytes[PROFILE_BODYPARTS] += ProfileOnce(&Seen, Part->VertOffset, Part->VertCount * 3 * sizeof(float));
+				}
+				if (Part->NormCount > 0 && Model.CheckBounds(Part->NormOffset, Part->NormCount * 3 * sizeof(float)))
+				{
+					Bytes[PROFILE_BODYPARTS] += ProfileOnce(&Seen, Part->NormBoneOffset, Part->NormCount);
+					Bytes[PROFILE_BODYPARTS] += ProfileOnce(&Seen, Part->NormOffset, Part->NormCount * 3 * sizeof(float));
+				}
+				if (Part->MeshCount <= 0 || !Model.CheckBounds(Part->MeshTableOffset, Part->MeshCount * sizeof(sModelMesh)))
+					continue;
+
+				sModelMesh * Meshes = (sModelMesh *)&Model.Data[Part->MeshTableOffset];
+				Bytes[PROFILE_MESHES] += ProfileOnce(&Seen, Part->MeshTableOffset, Part->MeshCount * sizeof(sModelMesh));
+				for (int m = 0; m < Part->MeshCount; m++)
+					Bytes[PROFILE_MESHES] += ProfileOnce(&Seen, Meshes[m].TriCmdOffset, ProfileTriCmdSize(&Model, Meshes[m].TriCmdOffset));
+			}
+		}
+	}
+
+	// Textures and palettes
+	if (Model.CheckBounds(Header->TextureTableOffset, Header->TextureCount * sizeof(sModelTextureEntry)))
+	{
+		sModelTextureEntry * Table = (sModelTextureEntry *)&Model.Data[Header->TextureTableOffset];
+		ulong PaletteSize = DOL == true ? DOL_TEXTURE_HEADER_SIZE + EIGHT_BIT_PALETTE_ELEMENTS_COUNT * DOL_BMP_PALETTE_ELEMENT_SIZE : EIGHT_BIT_PALETTE_ELEMENTS_COUNT * MDL_PALETTE_ELEMENT_SIZE;
+
+		Bytes[PROFILE_TEXTURES] += Header->TextureCount * sizeof(sModelTextureEntry);
+		for (ulong i = 0; i < Header->TextureCount; i++)
+		{
+			ulong BitmapSize = Table[i].Width * Table[i].Height;
+
+			if (!Model.CheckBounds(Table[i].Offset, BitmapSize + PaletteSize))
+				continue;
+			Bytes[PROFILE_TEXTURES] += BitmapSize;
+			Bytes[PROFILE_PALETTES] += PaletteSize;
+			if (DOL == false)
+				Bytes[PROFILE_POTWASTE] += PSIProperSize(Table[i].Width, false) * PSIProperSize(Table[i].Height, false) - BitmapSize;
+		}
+	}
+	if (Model.CheckBounds(Header->SkinTableOffset, Header->SkinCount * Header->SkinEntrySize * sizeof(short)))
+		Bytes[PROFILE_TEXTURES] += Header->SkinCount * Header->SkinEntrySize * sizeof(short);
+
+	// Everything else is alignment or unknown data
+	Padding = Profile->Size;
+	for (int i = 0; i < PROFILE_PARTS; i++)
+		if (i != PROFILE_PADDING && i != PROFILE_POTWASTE)
+			Padding -= Bytes[i];
+	Bytes[PROFILE_PADDING] = Padding > 0 ? Padding : 0;
+
+	free(Seen.Offsets);
+	Model.Free();
+}
+
+static void ProfileAddFile(sProfile ** Files, int * Count, int * Slots, const char * Path)
+{
+	char Extension[5];
+
+	FileGetExtension(Path, Extension, sizeof(Extension));
+	if ((strcmp(Extension, ".mdl") && strcmp(Extension, ".dol")) || strlen(Path) >= PATH_LEN)
+		return;
+
+	if (*Count == *Slots)
+	{
+		*Slots = *Slots ? *Slots * 2 : 64;
+		*Files = (sProfile *)realloc(*Files, *Slots * sizeof(sProfile));
+		if (*Files == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	ProfileModel(Path, &(*Files)[*Count]);
+	(*Count)++;
+}
+
+static int ProfileCompare(const void * A, const void * B)
+{
+	const sProfile * ProfileA = (const sProfile *)A;
+	const sProfile * ProfileB = (const sProfile *)B;
+
+	if (ProfileA->Size > ProfileB->Size)
+		return -1;
+	if (ProfileA->Size < ProfileB->Size)
+		return 1;
+	return strcmp(ProfileA->Path, ProfileB->Path);
+}
+
+static void ProfileWriteString(FILE * ptrFile, const char * String)
+{
+	fputc('"', ptrFile);
+	for (const char * c = String; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			fputc('\\', ptrFile);
+		fputc(*c, ptrFile);
+	}
+	fputc('"', ptrFile);
+}
+
+void ProfileModels(int Count, char ** Paths)
+{
+	sProfile * Files = NULL;
+	int FileCount = 0;
+	int FileSlots = 0;
+	ulong Total[PROFILE_PARTS];
+	ulong TotalSize = 0;
+	bool First = true;
+	FILE * ptrCSV;
+	FILE * ptrJSON;
+
+	// Collect models (folders are searched including subfolders)
+	for (int i = 0; i < Count; i++)
+	{
+		if (CheckDir(Paths[i]) == true)
+		{
+			const char * Path;
+
+			DirIterInit(Paths[i]);
+			while ((Path = DirIterGet()) != NULL)
+				ProfileAddFile(&Files, &FileCount, &FileSlots, Path);
+			DirIterClose();
+		}
+		else
+		{
+			ProfileAddFile(&Files, &FileCount, &FileSlots, Paths[i]);
+		}
+	}
+	if (FileCount == 0)
+	{
+		puts("No models found.");
+		return;
+	}
+	qsort(Files, FileCount, sizeof(sProfile), ProfileCompare);
+
+	// Report
+	SafeFileOpen(&ptrCSV, PROFILE_FILE ".csv", "wb");
+	SafeFileOpen(&ptrJSON, PROFILE_FILE ".json", "wb");
+	fprintf(ptrCSV, "file,size");
+	for (int p = 0; p < PROFILE_PARTS; p++)
+		fprintf(ptrCSV, ",%s", ProfileNames[p]);
+	fprintf(ptrCSV, "\r\n");
+	fprintf(ptrJSON, "[\r\n");
+	memset(Total, 0x00, sizeof(Total));
+	for (int i = 0; i < FileCount; i++)
+	{
+		sProfile * Profile = &Files[i];
+
+		if (Profile->Valid == false)
+		{
+			printf("%s: can't read model ...\n", Profile->Path);
+			continue;
+		}
+		printf("%s: %u bytes\n", Profile->Path, (uint)Profile->Size);
+		for (int p = 0; p < PROFILE_PARTS; p++)
+			if (Profile->Bytes[p] != 0)
+				printf("\t%-12s %8u (%.1f%%)\n", ProfileNames[p], (uint)Profile->Bytes[p], 100.0 * Profile->Bytes[p] / Profile->Size);
+
+		// CSV (paths with commas are quoted)
+		if (strchr(Profile->Path, ',') != NULL)
+			fprintf(ptrCSV, "\"%s\",%u", Profile->Path, (uint)Profile->Size);
+		else
+			fprintf(ptrCSV, "%s,%u", Profile->Path, (uint)Profile->Size);
+		for (int p = 0; p < PROFILE_PARTS; p++)
+			fprintf(ptrCSV, ",%u", (uint)Profile->Bytes[p]);
+		fprintf(ptrCSV, "\r\n");
+
+		// JSON
+		fprintf(ptrJSON, "%s\t{\"file\": ", First == true ? "" : ",\r\n");
+		First = false;
+		ProfileWriteString(ptrJSON, Profile->Path);
+		fprintf(ptrJSON, ", \"size\": %u", (uint)Profile->Size);
+		for (int p = 0; p < PROFILE_PARTS; p++)
+			fprintf(ptrJSON, ", \"%s\": %u", ProfileNames[p], (uint)Profile->Bytes[p]);
+		fprintf(ptrJSON, "}");
+
+		TotalSize += Profile->Size;
+		for (int p = 0; p < PROFILE_PARTS; p++)
+			Total[p] += Profile->Bytes[p];
+	}
+	fprintf(ptrJSON, "\r\n]\r\n");
+	fclose(ptrJSON);
+	fclose(ptrCSV);
+
+	printf("\nTotal: %u bytes\n", (uint)TotalSize);
+	for (int p = 0; p < PROFILE_PARTS && TotalSize != 0; p++)
+		printf("\t%-12s %8u (%.1f%%)\n", ProfileNames[p], (uint)Total[p], 100.0 * Total[p] / TotalSize);
+	printf("Saved to %s.csv and %s.json\n", PROFILE_FILE, PROFILE_FILE);
+
+	free(Files);
+}
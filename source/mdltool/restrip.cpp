@@ -0,0 +1,479 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains triangle command optimizer for PS2 models: triangles
+// of every mesh are decoded and put back as long strips/fans (every start
+// triangle is tried with 3 rotations for both command types, strips grow in
+// both directions, the longest command wins). Next command starts near the
+// end of previous one, so vertices are reused while they are still in cache.
+// Commands are written in place, so mesh offsets don't change
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Structures //////////
+
+// Mesh triangles with unique vertices
+struct sStripMesh
+{
+	sModelTriVert * Verts;		// Unique vertices (position + normal + texture coordinates)
+	ulong VertCount;
+	ulong (*Tris)[3];			// Triangles (CCW order as in triangle commands)
+	ulong TriCount;
+	ulong * AdjStart;			// Triangles around vertex: Adj[AdjStart[v]] ... Adj[AdjStart[v + 1] - 1]
+	ulong * Adj;
+	long * Mark;				// 0 - free, -1 - written, other - used by trial command
+	ulong OldCmds;				// Statistics of original commands
+	ulong OldVerts;
+	ulong OldSize;				// Size in bytes (including terminator)
+};
+
+// Triangle command that is being built
+struct sStripCmd
+{
+	ulong * Verts;
+	ulong VertCount;
+	ulong * Back;				// Vertices added before start triangle (in reverse order)
+	ulong * Tris;
+	ulong TriCount;
+	bool Fan;
+};
+
+////////// Functions //////////
+static ulong StripAddVert(sStripMesh * Mesh, const sModelTriVert * Vert, long * Hash, ulong HashSize);	// Find or add unique vertex
+static bool StripLoad(sModel * Model, ulong Offset, sStripMesh * Mesh);									// Decode triangle commands
+static void StripFree(sStripMesh * Mesh);																// Free memory
+static long StripFindTri(sStripMesh * Mesh, ulong A, ulong B, long Trial, ulong * Third);				// Find free triangle with edge A->B
+static ulong StripFreeNeighbours(sStripMesh * Mesh, ulong Tri);										// How many free triangles share edges with triangle
+static void StripGrow(sStripMesh * Mesh, ulong Start, int Rotation, bool Fan, long Trial, sStripCmd * Cmd);	// Build command from start triangle
+static ulong StripWrite(sStripMesh * Mesh, uchar * Out, ulong * Cmds, ulong * Verts);					// Build new commands (returns size)
+
+///////// Code /////////
+static ulong StripAddVert(sStripMesh * Mesh, const sModelTriVert * Vert, long * Hash, ulong HashSize)
+{
+	ulong Key = ((ulong)(ushort)Vert->Vert * 31 + (ushort)Vert->Norm) * 31 + (ushort)Vert->S * 17 + (ushort)Vert->T;
+	ulong Slot = (Key * 2654435761u) & (HashSize - 1);
+
+	// Open addressing, table is always bigger than number of vertices
+	while (Hash[Slot] != -1)
+	{
+		if (!memcmp(&Mesh->Verts[Hash[Slot]], Vert, sizeof(sModelTriVert)))
+			return Hash[Slot];
+		Slot = (Slot + 1) & (HashSize - 1);
+	}
+
+	Hash[Slot] = Mesh->VertCount;
+	Mesh->Verts[Mesh->VertCount] = *Vert;
+	return Mesh->VertCount++;
+}
+
+static bool StripLoad(sModel * Model, ulong Offset, sStripMesh * Mesh)
+{
+	ulong Start = Offset;
+	ulong Corners = 0;
+	long * Hash;
+	ulong HashSize = 16;
+
+	memset(Mesh, 0x00, sizeof(sStripMesh));
+
+	// Count triangles
+	while (1)
+	{
+		short Count;
+
+		if (!Model->CheckBounds(Offset, sizeof(short)))
+			return false;
+		Count = *(short *)&Model->Data[Offset];
+		Offset += sizeof(short);
+		if (Count == 0)
+			break;
+		if (Count < 0)
+			Count = -Count;
+		if (!Model->CheckBounds(Offset, Count * sizeof(sModelTriVert)))
+			return false;
+		Offset += Count * sizeof(sModelTriVert);
+
+		Mesh->OldCmds++;
+		Mesh->OldVerts += Count;
+		if (Count > 2)
+			Mesh->TriCount += Count - 2;
+	}
+	Mesh->OldSize = Offset - Start;
+	Corners = Mesh->TriCount * 3;
+
+	UTIL_MALLOC(sModelTriVert *, Mesh->Verts, (Corners + 1) * sizeof(sModelTriVert), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong (*)[3], Mesh->Tris, (Mesh->TriCount + 1) * sizeof(ulong[3]), exit(EXIT_FAILURE));
+	UTIL_CALLOC(long *, Mesh->Mark, Mesh->TriCount + 1, sizeof(long), exit(EXIT_FAILURE));
+	while (HashSize < Corners * 2)
+		HashSize <<= 1;
+	UTIL_MALLOC(long *, Hash, HashSize * sizeof(long), exit(EXIT_FAILURE));
+	for (ulong i = 0; i < HashSize; i++)
+		Hash[i] = -1;
+
+	// Decode triangles (same order as in GL triangle strips/fans)
+	ulong Tri = 0;
+	Offset = Start;
+	while (1)
+	{
+		short Count = *(short *)&Model->Data[Offset];
+		Offset += sizeof(short);
+		if (Count == 0)
+			break;
+		bool Fan = Count < 0;
+		if (Fan)
+			Count = -Count;
+
+		sModelTriVert * Cmds = (sModelTriVert *)&Model->Data[Offset];
+		Offset += Count * sizeof(sModelTriVert);
+
+		for (int i = 0; i + 2 < Count; i++)
+		{
+			const sModelTriVert * Corner[3];
+
+			if (Fan)
+			{
+				Corner[0] = &Cmds[0];
+				Corner[1] = &Cmds[i + 1];
+				Corner[2] = &Cmds[i + 2];
+			}
+			else if (i % 2 == 0)
+			{
+				Corner[0] = &Cmds[i];
+				Corner[1] = &Cmds[i + 1];
+				Corner[2] = &Cmds[i + 2];
+			}
+			else
+			{
+				Corner[0] = &Cmds[i + 1];
+				Corner[1] = &Cmds[i];
+				Corner[2] = &Cmds[i + 2];
+			}
+
+			for (int c = 0; c < 3; c++)
+				Mesh->Tris[Tri][c] = StripAddVert(Mesh, Corner[c], Hash, HashSize);
+			Tri++;
+		}
+	}
+	free(Hash);
+
+	// Triangles around vertices
+	UTIL_CALLOC(ulong *, Mesh->AdjStart, Mesh->VertCount + 2, sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Mesh->Adj, (Corners + 1) * sizeof(ulong), exit(EXIT_FAILURE));
+	for (ulong t = 0; t < Mesh->TriCount; t++)
+		for (int c = 0; c < 3; c++)
+			Mesh->AdjStart[Mesh->Tris[t][c] + 2]++;
+	for (ulong v = 0; v < Mesh->VertCount; v++)
+		Mesh->AdjStart[v + 2] += Mesh->AdjStart[v + 1];
+	for (ulong t = 0; t < Mesh->TriCount; t++)
+		for (int c = 0; c < 3; c++)
+			Mesh->Adj[Mesh->AdjStart[Mesh->Tris[t][c] + 1]++] = t;
+
+	return true;
+}
+
+static void StripFree(sStripMesh * Mesh)
+{
+	free(Mesh->Verts);
+	free(Mesh->Tris);
+	free(Mesh->AdjStart);
+	free(Mesh->Adj);
+	free(Mesh->Mark);
+}
+
+static long StripFindTri(sStripMesh * Mesh, ulong A, ulong B, long Trial, ulong * Third)
+{
+	for (ulong a = Mesh->AdjStart[A]; a < Mesh->AdjStart[A + 1]; a++)
+	{
+		ulong t = Mesh->Adj[a];
+
+		if (Mesh->Mark[t] == -1 || (Trial != 0 && Mesh->Mark[t] == Trial))
+			continue;
+		for (int c = 0; c < 3; c++)
+		{
+			if (Mesh->Tris[t][c] == A && Mesh->Tris[t][(c + 1) % 3] == B)
+			{
+				*Third = Mesh->Tris[t][(c + 2) % 3];
+				return t;
+			}
+		}
+	}
+
+	return -1;
+}
+
+static ulong StripFreeNeighbours(sStripMesh * Mesh, ulong Tri)
+{
+	ulong Count = 0;
+	ulong Third;
+
+	for (int c = 0; c < 3; c++)
+		if (StripFindTri(Mesh, Mesh->Tris[Tri][(c + 1) % 3], Mesh->Tris[Tri][c], 0, &Third) != -1)
+			Count++;
+
+	return Count;
+}
+
+static void StripGrow(sStripMesh * Mesh, ulong Start, int Rotation, bool Fan, long Trial, sStripCmd * Cmd)
+{
+	Cmd->Fan = Fan;
+	Cmd->VertCount = 3;
+	Cmd->TriCount = 1;
+	for (int c = 0; c < 3; c++)
+		Cmd->Verts[c] = Mesh->Tris[Start][(c + Rotation) % 3];
+	Cmd->Tris[0] = Start;
+	Mesh->Mark[Start] = Trial;
+
+	while (Cmd->VertCount < 0x7FFF)
+	{
+		ulong A;
+		ulong B;
+		ulong Third;
+		ulong Last = Cmd->VertCount - 1;
+
+		// Strip: even triangles use edge A->B, odd ones - B->A. Fan: center -> last vertex
+		if (Fan)
+		{
+			A = Cmd->Verts[0];
+			B = Cmd->Verts[Last];
+		}
+		else if ((Cmd->VertCount - 2) % 2 == 0)
+		{
+			A = Cmd->Verts[Last - 1];
+			B = Cmd->Verts[Last];
+		}
+		else
+		{
+			A = Cmd->Verts[Last];
+			B = Cmd->Verts[Last - 1];
+		}
+
+		long Next = StripFindTri(Mesh, A, B, Trial, &Third);
+		if (Next == -1)
+			break;
+		Cmd->Verts[Cmd->VertCount++] = Third;
+		Cmd->Tris[Cmd->TriCount++] = Next;
+		Mesh->Mark[Next] = Trial;
+	}
+
+	// Strip can be extended backwards by 2 triangles at once (otherwise winding is changed):
+	// (X, W, V0) + (V0, W, V1) are added before (V0, V1, V2)
+	if (Fan == false)
+	{
+		ulong Added = 0;
+
+		while (Cmd->VertCount + Added + 2 <= 0x7FFF)
+		{
+			ulong V0 = Added ? Cmd->Back[Added - 1] : Cmd->Verts[0];
+			ulong V1 = Added ? Cmd->Back[Added - 2] : Cmd->Verts[1];
+			ulong W;
+			ulong X;
+
+			long First = StripFindTri(Mesh, V1, V0, Trial, &W);
+			if (First == -1)
+				break;
+			Mesh->Mark[First] = Trial;
+			long Second = StripFindTri(Mesh, W, V0, Trial, &X);
+			if (Second == -1)
+			{
+				Mesh->Mark[First] = 0;
+				break;
+			}
+			Mesh->Mark[Second] = Trial;
+
+			Cmd->Back[Added++] = W;
+			Cmd->Back[Added++] = X;
+			Cmd->Tris[Cmd->TriCount++] = First;
+			Cmd->Tris[Cmd->TriCount++] = Second;
+		}
+
+		if (Added > 0)
+		{
+			memmove(&Cmd->Verts[Added], Cmd->Verts, Cmd->VertCount * sizeof(ulong));
+			for (ulong i = 0; i < Added; i++)
+				Cmd->Verts[i] = Cmd->Back[Added - 1 - i];
+			Cmd->VertCount += Added;
+		}
+	}
+
+	// Release triangles, they are taken only by chosen command
+	for (ulong t = 0; t < Cmd->TriCount; t++)
+		Mesh->Mark[Cmd->Tris[t]] = 0;
+}
+
+static ulong StripWrite(sStripMesh * Mesh, uchar * Out, ulong * Cmds, ulong * Verts)
+{
+	sStripCmd Best;
+	sStripCmd Try;
+	ulong Size = 0;
+	ulong Left = Mesh->TriCount;
+	long Near = -1;			// Vertex where previous command ended
+
+	UTIL_MALLOC(ulong *, Best.Verts, (Mesh->TriCount + 3) * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Best.Tris, (Mesh->TriCount + 1) * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Try.Verts, (Mesh->TriCount + 3) * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Try.Tris, (Mesh->TriCount + 1) * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Best.Back, (Mesh->TriCount + 1) * sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_MALLOC(ulong *, Try.Back, (Mesh->TriCount + 1) * sizeof(ulong), exit(EXIT_FAILURE));
+	*Cmds = 0;
+	*Verts = 0;
+
+	while (Left > 0)
+	{
+		long Start = -1;
+		ulong StartScore = 4;
+
+		// Start from triangle with fewest free neighbours (ends of runs), first look around previous command
+		if (Near != -1)
+		{
+			for (ulong a = Mesh->AdjStart[Near]; a < Mesh->AdjStart[Near + 1]; a++)
+			{
+				ulong t = Mesh->Adj[a];
+				if (Mesh->Mark[t] != 0)
+					continue;
+				ulong Score = StripFreeNeighbours(Mesh, t);
+				if (Start == -1 || Score < StartScore)
+				{
+					Start = t;
+					StartScore = Score;
+				}
+			}
+		}
+		if (Start == -1)
+		{
+			for (ulong t = 0; t < Mesh->TriCount && StartScore > 0; t++)
+			{
+				if (Mesh->Mark[t] != 0)
+					continue;
+				ulong Score = StripFreeNeighbours(Mesh, t);
+				if (Start == -1 || Score < StartScore)
+				{
+					Start = t;
+					StartScore = Score;
+				}
+			}
+		}
+
+		// Try every rotation for strip and fan, take the longest
+		Best.Fan = false;
+		Best.VertCount = 0;
+		Best.TriCount = 0;
+		for (int Type = 0; Type < 2; Type++)
+		{
+			for (int r = 0; r < 3; r++)
+			{
+				StripGrow(Mesh, Start, r, Type == 1, 1 + Type * 3 + r, &Try);
+				if (Try.TriCount > Best.TriCount)
+				{
+					sStripCmd Swap = Best;
+					Best = Try;
+					Try = Swap;
+				}
+			}
+		}
+
+		// Write command
+		short Count = Best.Fan ? -(short)Best.VertCount : (short)Best.VertCount;
+		memcpy(&Out[Size], &Count, sizeof(short));
+		Size += sizeof(short);
+		for (ulong v = 0; v < Best.VertCount; v++)
+		{
+			memcpy(&Out[Size], &Mesh->Verts[Best.Verts[v]], sizeof(sModelTriVert));
+			Size += sizeof(sModelTriVert);
+		}
+		for (ulong t = 0; t < Best.TriCount; t++)
+			Mesh->Mark[Best.Tris[t]] = -1;
+		Left -= Best.TriCount;
+		Near = Best.Verts[Best.VertCount - 1];
+		(*Cmds)++;
+		*Verts += Best.VertCount;
+	}
+
+	// End of commands
+	short Count = 0;
+	memcpy(&Out[Size], &Count, sizeof(short));
+	Size += sizeof(short);
+
+	free(Best.Verts);
+	free(Best.Tris);
+	free(Try.Verts);
+	free(Try.Tris);
+	free(Best.Back);
+	free(Try.Back);
+
+	return Size;
+}
+
+bool RestripMeshes(sModel * Model)
+{
+	sModelMesh ** Meshes;
+	ulong MeshCount;
+	ulong Number = 0;
+	ulong OldCmds = 0;
+	ulong OldVerts = 0;
+	ulong NewCmds = 0;
+	ulong NewVerts = 0;
+
+	Meshes = Model->CollectMeshes(&MeshCount);
+	if (MeshCount == 0)
+	{
+		puts("Can't find meshes ...");
+		free(Meshes);
+		return false;
+	}
+
+	puts("Rebuilding triangle commands ...");
+	for (ulong m = 0; m < MeshCount; m++)
+	{
+		sStripMesh Mesh;
+		uchar * Out;
+		ulong Cmds;
+		ulong Verts;
+
+		// Meshes with same triangle commands are processed once
+		if (m > 0 && Meshes[m - 1]->TriCmdOffset == Meshes[m]->TriCmdOffset)
+			continue;
+		Number++;
+
+		if (StripLoad(Model, Meshes[m]->TriCmdOffset, &Mesh) == false)
+		{
+			printf("Mesh #%i: triangle commands are out of file bounds ...\n", (int)Number);
+			StripFree(&Mesh);
+			continue;
+		}
+
+		// Worst case: every triangle is separate command
+		UTIL_MALLOC(uchar *, Out, Mesh.TriCount * (sizeof(short) + 3 * sizeof(sModelTriVert)) + sizeof(short), exit(EXIT_FAILURE));
+		ulong Size = StripWrite(&Mesh, Out, &Cmds, &Verts);
+
+		// Commands are written in place, keep original ones if new ones are not better
+		if (Size <= Mesh.OldSize && (Cmds < Mesh.OldCmds || Verts < Mesh.OldVerts))
+		{
+			memcpy(&Model->Data[Meshes[m]->TriCmdOffset], Out, Size);
+			memset(&Model->Data[Meshes[m]->TriCmdOffset + Size], 0x00, Mesh.OldSize - Size);
+			printf("Mesh #%i: %i tris, commands: %i -> %i, vertices: %i -> %i\n", (int)Number, (int)Mesh.TriCount,
+				(int)Mesh.OldCmds, (int)Cmds, (int)Mesh.OldVerts, (int)Verts);
+		}
+		else
+		{
+			printf("Mesh #%i: %i tris, commands: %i, vertices: %i (kept)\n", (int)Number, (int)Mesh.TriCount, (int)Mesh.OldCmds, (int)Mesh.OldVerts);
+			Cmds = Mesh.OldCmds;
+			Verts = Mesh.OldVerts;
+		}
+
+		OldCmds += Mesh.OldCmds;
+		OldVerts += Mesh.OldVerts;
+		NewCmds += Cmds;
+		NewVerts += Verts;
+
+		free(Out);
+		StripFree(&Mesh);
+	}
+
+	printf("Total: commands: %i -> %i, vertices: %i -> %i\n", (int)OldCmds, (int)NewCmds, (int)OldVerts, (int)NewVerts);
+	free(Meshes);
+
+	return true;
+}
@@ -0,0 +1,350 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains texture deduplication: census hashes every texture
+// (bitmap + palette as stored in file) of every model, candidates with
+// same hash are compared byte by byte and groups of duplicates are reported
+// with bytes they waste. Engine derives texture model name ("...T") from
+// the model name, so textures can't be shared between different models,
+// but duplicates inside of one model can be merged during conversion
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Structures //////////
+
+// Texture of census
+struct sTexDup
+{
+	int File;				// Model number
+	ulong Index;			// Texture number
+	char Name[64];			// Texture name
+	ulong Width;
+	ulong Height;
+	ulong BitmapOffset;		// Location of bitmap in file
+	ulong BitmapSize;
+	ulong PaletteOffset;	// Location of palette in file
+	ulong PaletteSize;
+	uint Hash;				// FNV-1a hash of bitmap and palette
+	bool DOL;				// Stored in PS2 layout
+	int Group;				// Duplicate group (-1 - unique)
+};
+
+////////// Functions //////////
+static uint TexDupHash(const uchar * Data, ulong Size, uint Hash);							// Add data to FNV-1a hash
+static void TexDupAddFile(char (** Files)[PATH_LEN], int * Count, int * Slots, const char * Path);	// Add model to list
+static int TexDupCompare(const void * A, const void * B);									// qsort() callback
+static uchar * TexDupRead(const char * Path, sTexDup * Entry);								// Read bitmap and palette of texture (must be freed)
+
+///////// Code /////////
+static uint TexDupHash(const uchar * Data, ulong Size, uint Hash)
+{
+	for (ulong i = 0; i < Size; i++)
+	{
+		Hash ^= Data[i];
+		Hash *= 16777619;
+	}
+
+	return Hash;
+}
+
+static void TexDupAddFile(char (** Files)[PATH_LEN], int * Count, int * Slots, const char * Path)
+{
+	char Extension[5];
+
+	FileGetExtension(Path, Extension, sizeof(Extension));
+	if ((strcmp(Extension, ".mdl") && strcmp(Extension, ".dol")) || strlen(Path) >= PATH_LEN)
+		return;
+
+	if (*Count == *Slots)
+	{
+		*Slots = *Slots ? *Slots * 2 : 64;
+		*Files = (char (*)[PATH_LEN])realloc(*Files, *Slots * PATH_LEN);
+		if (*Files == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	strcpy((*Files)[*Count], Path);
+	(*Count)++;
+}
+
+static int TexDupCompare(const void * A, const void * B)
+{
+	const sTexDup * TexA = (const sTexDup *)A;
+	const sTexDup * TexB = (const sTexDup *)B;
+
+	if (TexA->DOL != TexB->DOL)
+		return TexA->DOL < TexB->DOL ? -1 : 1;
+	if (TexA->Hash != TexB->Hash)
+		return TexA->Hash < TexB->Hash ? -1 : 1;
+	if (TexA->Width != TexB->Width)
+		return TexA->Width < TexB->Width ? -1 : 1;
+	if (TexA->Height != TexB->Height)
+		return TexA->Height < TexB->Height ? -1 : 1;
+	if (TexA->File != TexB->File)
+		return TexA->File < TexB->File ? -1 : 1;
+	if (TexA->Index != TexB->Index)
+		return TexA->Index < TexB->Index ? -1 : 1;
+	return 0;
+}
+
+static uchar * TexDupRead(const char * Path, sTexDup * Entry)
+{
+	FILE * ptrFile;
+	uchar * Data;
+
+	UTIL_MALLOC(uchar *, Data, Entry->BitmapSize + Entry->PaletteSize, exit(EXIT_FAILURE));
+	SafeFileOpen(&ptrFile, Path, "rb");
+	FileReadBlock(&ptrFile, Data, Entry->BitmapOffset, Entry->BitmapSize);
+	FileReadBlock(&ptrFile, &Data[Entry->BitmapSize], Entry->PaletteOffset, Entry->PaletteSize);
+	fclose(ptrFile);
+
+	return Data;
+}
+
+void TexDupCensus(int Count, char ** Paths)
+{
+	char (* Files)[PATH_LEN] = NULL;
+	int FileCount = 0;
+	int FileSlots = 0;
+	sTexDup * Textures = NULL;
+	ulong TextureCount = 0;
+	int GroupCount = 0;
+	ulong Wasted = 0;
+	ulong Merge = 0;
+
+	// Collect models (folders are searched including subfolders)
+	for (int i = 0; i < Count; i++)
+	{
+		if (CheckDir(Paths[i]) == true)
+		{
+			const char * Path;
+
+			DirIterInit(Paths[i]);
+			while ((Path = DirIterGet()) != NULL)
+				TexDupAddFile(&Files, &FileCount, &FileSlots, Path);
+			DirIterClose();
+		}
+		else
+		{
+			TexDupAddFile(&Files, &FileCount, &FileSlots, Paths[i]);
+		}
+	}
+
+	// Hash textures
+	for (int f = 0; f < FileCount; f++)
+	{
+		sModel Model;
+		FILE * ptrFile;
+		char Extension[5];
+		bool DOL;
+
+		ptrFile = fopen(Files[f], "rb");
+		if (ptrFile == NULL)
+		{
+			printf("%s: can't read model ...\n", Files[f]);
+			continue;
+		}
+		fclose(ptrFile);
+
+		// Models without textures are skipped
+		Model.Initialize();
+		if (Model.LoadFromFile(Files[f]) == false)
+		{
+			Model.Free();
+			continue;
+		}
+		FileGetExtension(Files[f], Extension, sizeof(Extension));
+		DOL = !strcmp(Extension, ".dol");
+
+		Textures = (sTexDup *)realloc(Textures, (TextureCount + Model.Header->TextureCount) * sizeof(sTexDup));
+		if (Textures == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		for (ulong i = 0; i < Model.Header->TextureCount; i++)
+		{
+			sModelTextureEntry * Entry = &Model.TextureTable[i];
+			sTexDup * Texture = &Textures[TextureCount];
+
+			// Same layout as in sModel::LoadTexture()
+			Texture->BitmapSize = Entry->Width * Entry->Height;
+			if (DOL == true)
+			{
+				Texture->PaletteOffset = Entry->Offset + DOL_TEXTURE_HEADER_SIZE;
+				Texture->PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * DOL_BMP_PALETTE_ELEMENT_SIZE;
+				Texture->BitmapOffset = Texture->PaletteOffset + Texture->PaletteSize;
+			}
+			else
+			{
+				Texture->BitmapOffset = Entry->Offset + MDL_TEXTURE_HEADER_SIZE;
+				Texture->PaletteOffset = Entry->Offset + Texture->BitmapSize;
+				Texture->PaletteSize = EIGHT_BIT_PALETTE_ELEMENTS_COUNT * MDL_PALETTE_ELEMENT_SIZE;
+			}
+			if (!Model.CheckBounds(Texture->BitmapOffset, Texture->BitmapSize) || !Model.CheckBounds(Texture->PaletteOffset, Texture->PaletteSize))
+			{
+				printf("%s: texture #%i is out of file bounds ...\n", Files[f], (int)i + 1);
+				continue;
+			}
+
+			Texture->File = f;
+			Texture->Index = i;
+			memcpy(Texture->Name, Entry->Name, sizeof(Texture->Name));
+			Texture->Name[63] = '\0';
+			Texture->Width = Entry->Width;
+			Texture->Height = Entry->Height;
+			Texture->Hash = TexDupHash(&Model.Data[Texture->BitmapOffset], Texture->BitmapSize, 2166136261U);
+			Texture->Hash = TexDupHash(&Model.Data[Texture->PaletteOffset], Texture->PaletteSize, Texture->Hash);
+			Texture->DOL = DOL;
+			Texture->Group = -1;
+			TextureCount++;
+		}
+		Model.Free();
+	}
+	if (TextureCount == 0)
+	{
+		puts("No textures found.");
+		free(Files);
+		return;
+	}
+	qsort(Textures, TextureCount, sizeof(sTexDup), TexDupCompare);
+
+	// Textures with same hash are compared byte by byte
+	for (ulong i = 0; i < TextureCount; i++)
+	{
+		uchar * First = NULL;
+		ulong Copies = 1;
+		int LastFile = Textures[i].File;
+
+		if (Textures[i].Group != -1)
+			continue;
+		for (ulong j = i + 1; j < TextureCount; j++)
+		{
+			// Candidates are next to each other after sorting
+			if (Textures[j].Width != Textures[i].Width || Textures[j].Height != Textures[i].Height || Textures[j].Hash != Textures[i].Hash || Textures[j].DOL != Textures[i].DOL)
+				break;
+			if (Textures[j].Group != -1)
+				continue;
+			if (First == NULL)
+				First = TexDupRead(Files[Textures[i].File], &Textures[i]);
+
+			uchar * Other = TexDupRead(Files[Textures[j].File], &Textures[j]);
+			if (!memcmp(First, Other, Textures[i].BitmapSize + Textures[i].PaletteSize))
+			{
+				if (Copies == 1)
+				{
+					Textures[i].Group = GroupCount;
+					printf("Group #%i: %ux%u, %u bytes\n", GroupCount + 1, (uint)Textures[i].Width, (uint)Textures[i].Height, (uint)(Textures[i].BitmapSize + Textures[i].PaletteSize));
+					printf("\t%s: %s (#%u)\n", Files[Textures[i].File], Textures[i].Name, (uint)Textures[i].Index + 1);
+				}
+				Textures[j].Group = GroupCount;
+				printf("\t%s: %s (#%u)\n", Files[Textures[j].File], Textures[j].Name, (uint)Textures[j].Index + 1);
+				Copies++;
+				if (Textures[j].File == LastFile)		// Members of group are sorted by model
+					Merge += Textures[j].BitmapSize + Textures[j].PaletteSize;
+				LastFile = Textures[j].File;
+			}
+			free(Other);
+		}
+		free(First);
+
+		if (Copies > 1)
+		{
+			Wasted += (Copies - 1) * (Textures[i].BitmapSize + Textures[i].PaletteSize);
+			GroupCount++;
+		}
+	}
+
+	printf("\nModels: %i, textures: %u, duplicate groups: %i\n", FileCount, (uint)TextureCount, GroupCount);
+	printf("Wasted: %u bytes (%u bytes inside of same models can be merged with \"texmerge\" option)\n", (uint)Wasted, (uint)Merge);
+
+	free(Textures);
+	free(Files);
+}
+
+bool MergeTextures(sModel * Model)
+{
+	ulong TextureCount = Model->Header->TextureCount;
+	ulong SkinEntries = Model->SkinTableSize / sizeof(short);
+	short * Skins = (short *)Model->SkinTable;
+	long * Remap;
+	ulong NewCount = 0;
+	ulong Saved = 0;
+
+	if (TextureCount < 2 || Model->Textures == NULL)
+		return false;
+	for (ulong i = 0; i < SkinEntries; i++)
+	{
+		if (Skins[i] < 0 || (ulong)Skins[i] >= TextureCount)
+		{
+			puts("Skin table is damaged, textures aren't merged ...");
+			return false;
+		}
+	}
+
+	// Duplicate is replaced with first texture that has same size, flags, bitmap and palette
+	UTIL_MALLOC(long *, Remap, TextureCount * sizeof(long), exit(EXIT_FAILURE));
+	for (ulong i = 0; i < TextureCount; i++)
+	{
+		sTexture * Texture = &Model->Textures[i];
+
+		Remap[i] = -1;
+		for (ulong j = 0; j < i && Remap[i] == -1; j++)
+		{
+			sTexture * Other = &Model->Textures[j];
+
+			if (Remap[j] < 0 || Other->Width != Texture->Width || Other->Height != Texture->Height || Other->PaletteSize != Texture->PaletteSize ||
+				*(int *)&Model->TextureTable[i].Name[MDL_TEXTURE_FLAGS] != *(int *)&Model->TextureTable[j].Name[MDL_TEXTURE_FLAGS] ||
+				memcmp(Other->Palette, Texture->Palette, Texture->PaletteSize) || memcmp(Other->Bitmap, Texture->Bitmap, Texture->Width * Texture->Height))
+				continue;
+			Remap[i] = -2 - (long)j;		// Points to original
+		}
+		if (Remap[i] == -1)
+			Remap[i] = NewCount++;
+	}
+	if (NewCount == TextureCount)
+	{
+		puts("No duplicate textures found ...");
+		free(Remap);
+		return false;
+	}
+
+	// New tables
+	sTexture * NewTextures;
+	sModelTextureEntry * NewTable;
+	short * NewSkins;
+	UTIL_MALLOC(sTexture *, NewTextures, NewCount * sizeof(sTexture), exit(EXIT_FAILURE));
+	UTIL_MALLOC(sModelTextureEntry *, NewTable, NewCount * sizeof(sModelTextureEntry), exit(EXIT_FAILURE));
+	UTIL_MALLOC(short *, NewSkins, Model->SkinTableSize, exit(EXIT_FAILURE));
+	for (ulong i = 0; i < TextureCount; i++)
+	{
+		if (Remap[i] < 0)
+		{
+			printf("Texture #%u is same as #%u\n", (uint)i + 1, (uint)(-2 - Remap[i]) + 1);
+			Saved += Model->Textures[i].Width * Model->Textures[i].Height + Model->Textures[i].PaletteSize;
+			Model->Textures[i].Free();
+			Remap[i] = Remap[-2 - Remap[i]];
+			continue;
+		}
+		NewTextures[Remap[i]] = Model->Textures[i];
+		NewTable[Remap[i]] = Model->TextureTable[i];
+	}
+	for (ulong i = 0; i < SkinEntries; i++)
+		NewSkins[i] = Remap[Skins[i]];
+	printf("Textures: %u -> %u (%u bytes saved)\n", (uint)TextureCount, (uint)NewCount, (uint)Saved);
+
+	Model->ReplaceTextures(NewTextures, NewTable, NewCount, (uchar *)NewSkins);
+
+	free(NewSkins);
+	free(NewTable);
+	free(Remap);
+
+	return true;
+}
@@ -0,0 +1,255 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains texture scaling for MDL -> DOL conversion: instead of
+// tiling texture to the next proper size, texture is resampled to the nearest
+// (or smaller if VRAM budget is set) proper size and texture coordinates in
+// triangle commands are scaled by the same ratio. Textures that aren't used
+// by any mesh or are used with different ratios (skin families) are tiled
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Functions //////////
+static uint ScaleNearestSize(uint Size);														// Nearest PS2 proper dimension (ties are rounded up)
+static bool ScaleSameRatio(sModel * Model, ulong * NewW, ulong * NewH, ulong A, ulong B);		// Check if textures are scaled by the same ratio
+static ulong ScaleVRAM(ulong * NewW, ulong * NewH, ulong Count);								// VRAM used by textures
+static void ScaleTriCmds(sModel * Model, ulong Offset, double RatioS, double RatioT);			// Scale texture coordinates in triangle commands
+
+///////// Code /////////
+static uint ScaleNearestSize(uint Size)
+{
+	uint Upper = PSIProperSize(Size, false);
+	uint Lower = PSIProperSize(Size, true);
+
+	if (Size - Lower < Upper - Size)
+		return Lower;
+	return Upper;
+}
+
+static bool ScaleSameRatio(sModel * Model, ulong * NewW, ulong * NewH, ulong A, ulong B)
+{
+	return NewW[A] * Model->Textures[B].Width == NewW[B] * Model->Textures[A].Width &&
+		NewH[A] * Model->Textures[B].Height == NewH[B] * Model->Textures[A].Height;
+}
+
+static ulong ScaleVRAM(ulong * NewW, ulong * NewH, ulong Count)
+{
+	ulong Size = 0;
+
+	for (ulong i = 0; i < Count; i++)
+		Size += NewW[i] * NewH[i] + PSI_PALETTE_VRAM;
+
+	return Size;
+}
+
+static void ScaleTriCmds(sModel * Model, ulong Offset, double RatioS, double RatioT)
+{
+	while (1)
+	{
+		short Count;
+
+		if (!Model->CheckBounds(Offset, sizeof(short)))
+			break;
+		Count = *(short *)&Model->Data[Offset];
+		Offset += sizeof(short);
+		if (Count == 0)
+			break;
+		if (Count < 0)
+			Count = -Count;
+		if (!Model->CheckBounds(Offset, Count * sizeof(sModelTriVert)))
+			break;
+
+		sModelTriVert * Cmds = (sModelTriVert *)&Model->Data[Offset];
+		Offset += Count * sizeof(sModelTriVert);
+
+		for (int i = 0; i < Count; i++)
+		{
+			double S = floor(Cmds[i].S * RatioS + 0.5);
+			double T = floor(Cmds[i].T * RatioT + 0.5);
+			Cmds[i].S = (short)(S < -32768 ? -32768 : (S > 32767 ? 32767 : S));
+			Cmds[i].T = (short)(T < -32768 ? -32768 : (T > 32767 ? 32767 : T));
+		}
+	}
+}
+
+bool ScaleTextures(sModel * Model, ulong VRAMBudget)
+{
+	sModelHeader * Header = Model->Header;
+	ulong TextureCount = Header->TextureCount;
+	ulong SkinRefs = Header->SkinCount;
+	ulong Families = Header->SkinEntrySize;
+	short * Skins = (short *)Model->SkinTable;
+	sModelMesh ** Meshes;
+	ulong MeshCount;
+	ulong * NewW;
+	ulong * NewH;
+	bool * Scalable;
+	bool Changed;
+
+	if (TextureCount == 0 || Model->Textures == NULL)
+		return false;
+
+	// Check skin table
+	if (SkinRefs * Families * sizeof(short) > Model->SkinTableSize)
+	{
+		puts("Skin table is damaged, textures will be tiled ...");
+		return false;
+	}
+	for (ulong i = 0; i < SkinRefs * Families; i++)
+	{
+		if (Skins[i] < 0 || (ulong)Skins[i] >= TextureCount)
+		{
+			puts("Skin table is damaged, textures will be tiled ...");
+			return false;
+		}
+	}
+
+	// Find meshes, same triangle commands are scaled once
+	Meshes = Model->CollectMeshes(&MeshCount);
+
+	UTIL_CALLOC(ulong *, NewW, TextureCount, sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_CALLOC(ulong *, NewH, TextureCount, sizeof(ulong), exit(EXIT_FAILURE));
+	UTIL_CALLOC(bool *, Scalable, TextureCount, sizeof(bool), exit(EXIT_FAILURE));
+
+	// Only textures that are used by meshes can be scaled
+	for (ulong m = 0; m < MeshCount; m++)
+		for (ulong f = 0; f < Families; f++)
+			Scalable[Skins[f * SkinRefs + Meshes[m]->SkinRef]] = true;
+
+	// Meshes with same triangle commands and different textures share texture
+	// coordinates, so these textures are tiled
+	for (ulong m = 1; m < MeshCount; m++)
+	{
+		if (Meshes[m - 1]->TriCmdOffset != Meshes[m]->TriCmdOffset)
+			continue;
+		for (ulong f = 0; f < Families; f++)
+		{
+			short * Refs = &Skins[f * SkinRefs];
+
+			if (Refs[Meshes[m - 1]->SkinRef] != Refs[Meshes[m]->SkinRef])
+			{
+				for (ulong g = 0; g < Families; g++)
+					Scalable[Skins[g * SkinRefs + Meshes[m - 1]->SkinRef]] = Scalable[Skins[g * SkinRefs + Meshes[m]->SkinRef]] = false;
+				break;
+			}
+		}
+	}
+
+	do
+	{
+		// Select sizes
+		for (ulong i = 0; i < TextureCount; i++)
+		{
+			if (Scalable[i] == true)
+			{
+				NewW[i] = ScaleNearestSize(Model->Textures[i].Width);
+				NewH[i] = ScaleNearestSize(Model->Textures[i].Height);
+			}
+			else
+			{
+				NewW[i] = PSIProperSize(Model->Textures[i].Width, false);
+				NewH[i] = PSIProperSize(Model->Textures[i].Height, false);
+			}
+		}
+
+		// Fit into VRAM budget: halve the biggest texture (bigger side first)
+		while (VRAMBudget > 0 && ScaleVRAM(NewW, NewH, TextureCount) > VRAMBudget)
+		{
+			long Biggest = -1;
+			for (ulong i = 0; i < TextureCount; i++)
+			{
+				if (Scalable[i] == false || (NewW[i] <= PSI_MIN_DIMENSION && NewH[i] <= PSI_MIN_DIMENSION))
+					continue;
+				if (Biggest == -1 || NewW[i] * NewH[i] > NewW[Biggest] * NewH[Biggest])
+					Biggest = i;
+			}
+			if (Biggest == -1)
+			{
+				puts("Can't fit textures into VRAM budget ...");
+				break;
+			}
+			if (NewW[Biggest] >= NewH[Biggest] && NewW[Biggest] > PSI_MIN_DIMENSION)
+				NewW[Biggest] >>= 1;
+			else
+				NewH[Biggest] >>= 1;
+		}
+
+		// All textures of a mesh (every skin family) must be resampled by the
+		// same ratio, otherwise tile them
+		Changed = false;
+		for (ulong m = 0; m < MeshCount; m++)
+		{
+			ulong First = Skins[Meshes[m]->SkinRef];
+			bool Same = true;
+
+			for (ulong f = 1; f < Families; f++)
+			{
+				ulong Other = Skins[f * SkinRefs + Meshes[m]->SkinRef];
+
+				if (Scalable[First] != Scalable[Other] || !ScaleSameRatio(Model, NewW, NewH, First, Other))
+					Same = false;
+			}
+
+			if (Same == false)
+			{
+				for (ulong f = 0; f < Families; f++)
+				{
+					if (Scalable[Skins[f * SkinRefs + Meshes[m]->SkinRef]] == true)
+						Changed = true;
+					Scalable[Skins[f * SkinRefs + Meshes[m]->SkinRef]] = false;
+				}
+			}
+		}
+	} while (Changed == true);
+
+	// Fix texture coordinates
+	for (ulong m = 0; m < MeshCount; m++)
+	{
+		ulong Texture = Skins[Meshes[m]->SkinRef];
+
+		if (m > 0 && Meshes[m - 1]->TriCmdOffset == Meshes[m]->TriCmdOffset)
+			continue;
+		if (Scalable[Texture] == false)
+			continue;
+		if (NewW[Texture] != Model->Textures[Texture].Width || NewH[Texture] != Model->Textures[Texture].Height)
+			ScaleTriCmds(Model, Meshes[m]->TriCmdOffset, (double)NewW[Texture] / Model->Textures[Texture].Width, (double)NewH[Texture] / Model->Textures[Texture].Height);
+	}
+
+	// Resample textures and report
+	ulong OldVRAM = 0;
+	for (ulong i = 0; i < TextureCount; i++)
+		OldVRAM += PSIProperSize(Model->Textures[i].Width, false) * PSIProperSize(Model->Textures[i].Height, false) + PSI_PALETTE_VRAM;
+	ulong NewVRAM = ScaleVRAM(NewW, NewH, TextureCount);
+
+	for (ulong i = 0; i < TextureCount; i++)
+	{
+		sTexture * Texture = &Model->Textures[i];
+
+		if (Scalable[i] == false)
+		{
+			printf("Texture #%i: %ix%i -> %ix%i (tiled)\n", (int)i + 1, (int)Texture->Width, (int)Texture->Height, (int)NewW[i], (int)NewH[i]);
+			continue;
+		}
+		printf("Texture #%i: %ix%i -> %ix%i\n", (int)i + 1, (int)Texture->Width, (int)Texture->Height, (int)NewW[i], (int)NewH[i]);
+		if (NewW[i] == Texture->Width && NewH[i] == Texture->Height)
+			continue;
+
+		// Masked textures are resized without filtering to keep transparent color
+		if (*(int *)&Model->TextureTable[i].Name[MDL_TEXTURE_FLAGS] & MDL_TEXTURE_MASKED)
+			Texture->ScaleResize(NewW[i], NewH[i]);
+		else
+			Texture->FilterResize(NewW[i], NewH[i]);
+	}
+	printf("VRAM: %i -> %i bytes (%i bytes saved)\n", (int)OldVRAM, (int)NewVRAM, (int)(OldVRAM - NewVRAM));
+
+	free(Scalable);
+	free(NewH);
+	free(NewW);
+	free(Meshes);
+
+	return true;
+}
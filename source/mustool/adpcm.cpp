@@ -0,0 +1,580 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains PS-ADPCM (SPU2) encoder and decoder: PCM WAV is split into blocks
+// of 28 samples, every block is stored in 16 bytes (filter/shift byte,
+// flags byte and 28 4-bit residuals). Each block is encoded with all
+// filter and shift pairs and the pair with least squared error against
+// source is kept. Encoder follows decoder state (it predicts from decoded
+// samples), so error doesn't build up between blocks. Decoder reads VAG
+// block by block, so memory use doesn't depend on VAG size
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Definitions //////////
+#define ADPCM_FILTERS 5
+#define ADPCM_MAX_SHIFT 12
+
+// SPU2 prediction filters (coefficients are multiplied by 64)
+static const int ADPCMFilter[ADPCM_FILTERS][2] = { { 0, 0 }, { 60, 0 }, { 115, -52 }, { 98, -55 }, { 122, -60 } };
+
+////////// Functions //////////
+static int ADPCMClamp(int Sample);																					// Clamp sample to 16 bits
+static double ADPCMTryBlock(const short * Samples, int Filter, int Shift, int Hist1, int Hist2, double Limit, uchar * Nibbles, int * NewHist1, int * NewHist2);	// Encode block with given filter and shift, returns squared error
+static void ADPCMEncodeBlock(const short * Samples, uchar Flags, int * Hist1, int * Hist2, uchar * Block);		// Encode 28 samples into 16 byte block
+static ulong ADPCMLoopLead(bool Looped, ulong LoopStart);															// Silent samples that move loop start to block boundary
+static bool VAGOpen(const char * FileName, FILE ** ptrFile, ulong * SamplingF);									// Open VAG (normal or PS2 HL format) and seek to ADPCM data
+static bool VAGNextBlock(FILE ** ptrFile, ulong * BlockNum, int * Hist1, int * Hist2, short * Samples, uchar * Flags);	// Read and decode next block, returns false on end
+
+static int ADPCMClamp(int Sample)
+{
+	if (Sample > 32767)
+		return 32767;
+	if (Sample < -32768)
+		return -32768;
+	return Sample;
+}
+
+static double ADPCMTryBlock(const short * Samples, int Filter, int Shift, int Hist1, int Hist2, double Limit, uchar * Nibbles, int * NewHist1, int * NewHist2)
+{
+	double Error = 0;
+
+	for (int i = 0; i < VAG_BLOCK_SAMPLES; i++)
+	{
+		// Predict from decoded samples like SPU does
+		int Predicted = (Hist1 * ADPCMFilter[Filter][0] + Hist2 * ADPCMFilter[Filter][1] + 32) >> 6;
+
+		// Quantize residual to 4 bits (rounded)
+		int Nibble = ((Samples[i] - Predicted) * (1 << Shift) + 0x800) >> 12;
+		if (Nibble > 7)
+			Nibble = 7;
+		else if (Nibble < -8)
+			Nibble = -8;
+
+		// Decode it back
+		int Decoded = ADPCMClamp(((short)(Nibble << 12) >> Shift) + Predicted);
+		double Diff = Decoded - Samples[i];
+
+		Error += Diff * Diff;
+		if (Error >= Limit)			// Worse than best candidate already
+			return Error;
+
+		Nibbles[i] = Nibble & 0x0F;
+		Hist2 = Hist1;
+		Hist1 = Decoded;
+	}
+
+	*NewHist1 = Hist1;
+	*NewHist2 = Hist2;
+	return Error;
+}
+
+static void ADPCMEncodeBlock(const short * Samples, uchar Flags, int * Hist1, int * Hist2, uchar * Block)
+{
+	uchar Nibbles[VAG_BLOCK_SAMPLES];
+	uchar BestNibbles[VAG_BLOCK_SAMPLES];
+	int BestFilter = 0;
+	int BestShift = 0;
+	int BestHist1 = 0;
+	int BestHist2 = 0;
+	double BestError = HUGE_VAL;
+
+	// Try every filter and shift
+	for (int Filter = 0; Filter < ADPCM_FILTERS; Filter++)
+	{
+		for (int Shift = 0; Shift <= ADPCM_MAX_SHIFT; Shift++)
+		{
+			int NewHist1 = 0;
+			int NewHist2 = 0;
+			double Error = ADPCMTryBlock(Samples, Filter, Shift, *Hist1, *Hist2, BestError, Nibbles, &NewHist1, &NewHist2);
+
+			if (Error < BestError)
+			{
+				BestError = Error;
+				BestFilter = Filter;
+				BestShift = Shift;
+				BestHist1 = NewHist1;
+				BestHist2 = NewHist2;
+				memcpy(BestNibbles, Nibbles, sizeof(Nibbles));
+			}
+		}
+	}
+
+	// Pack block
+	Block[0] = (BestFilter << 4) | BestShift;
+	Block[1] = Flags;
+	for (int i = 0; i < VAG_BLOCK_SAMPLES / 2; i++)
+		Block[2 + i] = BestNibbles[i * 2] | (BestNibbles[i * 2 + 1] << 4);
+
+	*Hist1 = BestHist1;
+	*Hist2 = BestHist2;
+}
+
+short * LoadWAVSamples(const char * FileName, ulong * SampleCount, ulong * SamplingF, bool * Looped, ulong * LoopStart)	// Load PCM WAV as 16 bit mono samples
+{
+	FILE * ptrInFile;		// Input file stream
+
+	uWAVHeader WAVHeader;	// WAV file header
+	uchar * AudioData;		// Audio data pointer
+	ulong AudioDataSize;	// Size of audio data
+	short * Samples;
+	ulong Channels;
+	ulong BytesPerSample;
+
+	// Open file and read header
+	SafeFileOpen(&ptrInFile, FileName, "rb");
+	WAVHeader.UpdateFromNormal(&ptrInFile);
+	if (WAVHeader.CheckType(FileSize(&ptrInFile)) != WAV_NORMAL && WAVHeader.CheckType(FileSize(&ptrInFile)) != WAV_UNSUPPORTED)
+	{
+		fclose(ptrInFile);
+		return NULL;
+	}
+	Channels = WAVHeader.Normal.WaveChunk.Channels;
+	BytesPerSample = WAVHeader.Normal.WaveChunk.BitsPerSample / 8;
+	if (WAVHeader.Normal.WaveChunk.Format != 1 || Channels == 0 || (BytesPerSample != 1 && BytesPerSample != 2))
+	{
+		puts("8 or 16 bit PCM WAV required ...");
+		fclose(ptrInFile);
+		return NULL;
+	}
+
+	// Read audio data (cut it if file is shorter than data chunk says)
+	AudioDataSize = WAVHeader.Normal.DataChunk.DataSize;
+	if (WAVHeader.Normal.DataOffset + AudioDataSize > FileSize(&ptrInFile))
+		AudioDataSize = FileSize(&ptrInFile) - WAVHeader.Normal.DataOffset;
+	AudioData = (uchar *)malloc(AudioDataSize);
+	*SampleCount = AudioDataSize / (Channels * BytesPerSample);
+	Samples = (short *)malloc(*SampleCount * sizeof(short));
+	if (AudioData == NULL || Samples == NULL)
+	{
+		puts("Can't allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	FileReadBlock(&ptrInFile, AudioData, WAVHeader.Normal.DataOffset, AudioDataSize);
+	fclose(ptrInFile);
+
+	// Convert to 16 bit mono (8 bit WAV is unsigned, channels are mixed)
+	for (ulong s = 0; s < *SampleCount; s++)
+	{
+		long Sum = 0;
+
+		for (ulong c = 0; c < Channels; c++)
+		{
+			const uchar * Ptr = &AudioData[(s * Channels + c) * BytesPerSample];
+
+			if (BytesPerSample == 1)
+				Sum += (Ptr[0] - 0x80) << 8;
+			else
+				Sum += (short)(Ptr[0] | (Ptr[1] << 8));
+		}
+
+		Samples[s] = Sum / (long)Channels;
+	}
+	free(AudioData);
+
+	*SamplingF = WAVHeader.Normal.WaveChunk.SamplingF;
+	*Looped = WAVHeader.Normal.Looped && WAVHeader.Normal.LoopStart < *SampleCount;
+	*LoopStart = WAVHeader.Normal.LoopStart;
+
+	return Samples;
+}
+
+static ulong ADPCMLoopLead(bool Looped, ulong LoopStart)
+{
+	return Looped ? (VAG_BLOCK_SAMPLES - LoopStart % VAG_BLOCK_SAMPLES) % VAG_BLOCK_SAMPLES : 0;
+}
+
+bool EncodeVAG(const char * FileName)	// Encode PCM WAV to VAG (normal format)
+{
+	FILE * ptrOutFile;		// Output file stream
+
+	sVAGHeader VAGHeader;	// VAG file header
+	char cNewVAGName[64];	// New internal VAG Name
+	char cOutFile[PATH_LEN];
+	short * Samples;
+	ulong SampleCount;
+	ulong SamplingF;
+	bool Looped;
+	ulong LoopStart;
+
+	short * Stream;			// Samples aligned to blocks
+	ulong Lead;				// Silent samples before sound
+	ulong LoopLength = 0;
+	ulong Repeats = 1;		// How many times loop is stored
+	ulong Padding;			// Samples that make loop longer
+	ulong BlockCount;
+	uchar * AudioData;		// Audio data pointer
+	ulong AudioDataSize;	// Size of audio data
+	int Hist1 = 0;
+	int Hist2 = 0;
+
+	// Load samples
+	Samples = LoadWAVSamples(FileName, &SampleCount, &SamplingF, &Looped, &LoopStart);
+	if (Samples == NULL)
+		return false;
+	if (SampleCount == 0)
+	{
+		puts("WAV has no samples ...");
+		free(Samples);
+		return false;
+	}
+	printf("Samples: %u, Sampling frequency: %u \n", (uint)SampleCount, (uint)SamplingF);
+
+	// Align loop start to block with silence in front. Loop is repeated until
+	// it ends at block boundary, if that takes too much space then the last
+	// block is completed with samples from loop start (loop gets longer)
+	Lead = ADPCMLoopLead(Looped, LoopStart);
+	if (Looped == true)
+	{
+		LoopLength = SampleCount - LoopStart;
+		while ((Repeats * LoopLength) % VAG_BLOCK_SAMPLES != 0)
+			Repeats++;
+		if ((Repeats - 1) * LoopLength > VAG_UNROLL_MAX)
+			Repeats = 1;
+	}
+	BlockCount = (Lead + SampleCount + (Repeats - 1) * LoopLength + VAG_BLOCK_SAMPLES - 1) / VAG_BLOCK_SAMPLES;
+	Padding = BlockCount * VAG_BLOCK_SAMPLES - (Lead + SampleCount + (Repeats - 1) * LoopLength);
+	Stream = (short *)malloc(BlockCount * VAG_BLOCK_SAMPLES * sizeof(short));
+	if (Stream == NULL)
+	{
+		puts("Can't allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	memset(Stream, 0x00, Lead * sizeof(short));
+	memcpy(&Stream[Lead], Samples, SampleCount * sizeof(short));
+	for (ulong s = Lead + SampleCount; s < BlockCount * VAG_BLOCK_SAMPLES; s++)
+		Stream[s] = Looped ? Samples[LoopStart + (s - Lead - SampleCount) % LoopLength] : 0;
+	free(Samples);
+	if (Looped == true)
+	{
+		printf("Looped sound, loop starts at block #%u \n", (uint)((Lead + LoopStart) / VAG_BLOCK_SAMPLES + 1));
+		if (Repeats > 1)
+			printf("Loop is repeated %u times to end at block boundary \n", (uint)Repeats);
+		if (Padding > 0)
+			printf("Warning: loop is too long to be repeated, it becomes %u samples longer. \n", (uint)Padding);
+	}
+
+	// Encode: zero block in front (like in PS2 VAGs), sound blocks, end block for unlooped sound
+	AudioDataSize = (1 + BlockCount + (Looped ? 0 : 1)) * VAG_BLOCK_SIZE;
+	AudioData = (uchar *)malloc(AudioDataSize);
+	if (AudioData == NULL)
+	{
+		puts("Can't allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	memset(AudioData, 0x00, AudioDataSize);
+	for (ulong b = 0; b < BlockCount; b++)
+	{
+		uchar Flags = 0;
+
+		if (Looped == true)
+		{
+			ulong LoopBlock = (Lead + LoopStart) / VAG_BLOCK_SAMPLES;
+
+			if (b >= LoopBlock)
+				Flags |= VAG_FLAG_LOOP_REPEAT;
+			if (b == LoopBlock)
+				Flags |= VAG_FLAG_LOOP_START;
+			if (b == BlockCount - 1)
+				Flags |= VAG_FLAG_LOOP_END;
+		}
+		else if (b == BlockCount - 1)
+		{
+			Flags = VAG_FLAG_LOOP_END;
+		}
+
+		ADPCMEncodeBlock(&Stream[b * VAG_BLOCK_SAMPLES], Flags, &Hist1, &Hist2, &AudioData[(1 + b) * VAG_BLOCK_SIZE]);
+	}
+	free(Stream);
+	if (Looped == false)
+	{
+		// End block: SPU stops here
+		memset(&AudioData[AudioDataSize - VAG_BLOCK_SIZE + 2], 0x77, VAG_BLOCK_SIZE - 2);
+		AudioData[AudioDataSize - VAG_BLOCK_SIZE + 1] = VAG_FLAG_LOOP_END | VAG_FLAG_LOOP_REPEAT | VAG_FLAG_LOOP_START;
+	}
+
+	// Write VAG with header (the same header as PatchVAG makes)
+	FileGetFullName(FileName, cOutFile, sizeof(cOutFile));
+	if (strlen(cOutFile) + strlen(".vag") >= sizeof(cOutFile))
+	{
+		puts("Path is too long ...");
+		free(AudioData);
+		return false;
+	}
+	strcat(cOutFile, ".vag");
+	SafeFileOpen(&ptrOutFile, cOutFile, "wb");
+	FileGetName(FileName, cNewVAGName, sizeof(cNewVAGName), false);
+	VAGHeader.Update(AudioDataSize, cNewVAGName);
+	VAGHeader.SamplingF = SamplingF;
+	VAGHeader.SwapEndian();
+	FileWriteBlock(&ptrOutFile, &VAGHeader, sizeof(sVAGHeader));
+	FileWriteBlock(&ptrOutFile, AudioData, AudioDataSize);
+	fclose(ptrOutFile);
+
+	printf("Encoded %u blocks into %s \n", (uint)BlockCount, cOutFile);
+	if (SamplingF != 44100)
+		puts("Warning: PS2 HL supports only 1 channel 44100 Hz VAG music.");
+
+	free(AudioData);
+
+	puts("Done \n");
+
+	return true;
+}
+
+void ADPCMDecodeBlock(const uchar * Block, int * Hist1, int * Hist2, short * Samples)	// Decode 16 byte block into 28 samples
+{
+	int Filter = Block[0] >> 4;
+	int Shift = Block[0] & 0x0F;
+	int Coef1, Coef2;
+
+	// Broken blocks: SPU treats unknown filters as filter 0
+	if (Filter >= ADPCM_FILTERS)
+		Filter = 0;
+	Coef1 = ADPCMFilter[Filter][0];
+	Coef2 = ADPCMFilter[Filter][1];
+
+	for (int i = 0; i < VAG_BLOCK_SAMPLES; i++)
+	{
+		int Nibble = (Block[2 + i / 2] >> ((i & 1) * 4)) & 0x0F;
+		int Decoded = ADPCMClamp(((short)(Nibble << 12) >> Shift) + ((*Hist1 * Coef1 + *Hist2 * Coef2 + 32) >> 6));
+
+		Samples[i] = Decoded;
+		*Hist2 = *Hist1;
+		*Hist1 = Decoded;
+	}
+}
+
+bool ADPCMBlockIsEmpty(const uchar * Block)	// Check if block is filled with zeroes
+{
+	for (int i = 0; i < VAG_BLOCK_SIZE; i++)
+		if (Block[i] != 0x00)
+			return false;
+
+	return true;
+}
+
+static bool VAGOpen(const char * FileName, FILE ** ptrFile, ulong * SamplingF)
+{
+	sVAGHeader VAGHeader;
+	uchar VAGType;
+
+	SafeFileOpen(ptrFile, FileName, "rb");
+	VAGHeader.UpdateFromFile(ptrFile);
+	VAGHeader.SwapEndian();
+	VAGType = VAGHeader.CheckType();
+
+	// Seek to ADPCM data
+	if (VAGType == VAG_NORMAL || VAGType == VAG_UNSUPPORTED)
+	{
+		*SamplingF = VAGHeader.SamplingF;
+		fseek(*ptrFile, sizeof(sVAGHeader), SEEK_SET);
+	}
+	else if (VAGType == VAG_PS2)
+	{
+		*SamplingF = 44100;
+		fseek(*ptrFile, 0, SEEK_SET);
+	}
+	else
+	{
+		fclose(*ptrFile);
+		return false;
+	}
+
+	return true;
+}
+
+static bool VAGNextBlock(FILE ** ptrFile, ulong * BlockNum, int * Hist1, int * Hist2, short * Samples, uchar * Flags)
+{
+	uchar Block[VAG_BLOCK_SIZE];
+
+	while (fread(Block, VAG_BLOCK_SIZE, 1, *ptrFile) == 1)
+	{
+		// Stop at end block
+		if (Block[1] == (VAG_FLAG_LOOP_END | VAG_FLAG_LOOP_REPEAT | VAG_FLAG_LOOP_START))
+			return false;
+
+		// Skip silent block in front
+		if ((*BlockNum)++ == 0 && ADPCMBlockIsEmpty(Block) == true)
+			continue;
+
+		ADPCMDecodeBlock(Block, Hist1, Hist2, Samples);
+		*Flags = Block[1];
+		return true;
+	}
+
+	return false;
+}
+
+bool DecodeVAG(const char * FileName)	// Decode VAG (normal or PS2 HL format) to 16 bit PCM WAV
+{
+	FILE * ptrInFile;		// Input file stream
+	FILE * ptrOutFile;		// Output file stream
+
+	sNormalWAVHeader WAVHeader;
+	ulong WAVHeaderSize = sizeof(sRIFF) + sizeof(sWAVEFMT) + sizeof(sDATA);
+	sLOOP LoopChunk;
+	char cOutFile[PATH_LEN];
+	char cName[PATH_LEN];
+
+	short Samples[VAG_BLOCK_SAMPLES];
+	ulong SamplingF;
+	ulong BlockNum = 0;
+	ulong SampleCount = 0;
+	ulong LoopStart = PS2_WAV_NOLOOP;
+	uchar Flags;
+	int Hist1 = 0;
+	int Hist2 = 0;
+
+	// Open VAG
+	if (VAGOpen(FileName, &ptrInFile, &SamplingF) == false)
+	{
+		puts("Incorrect VAG music file ...");
+		return false;
+	}
+
+	// Create output file: "dec-" + name + ".wav"
+	FileGetPath(FileName, cOutFile, sizeof(cOutFile));
+	FileGetName(FileName, cName, sizeof(cName), false);
+	if (strlen(cOutFile) + strlen("dec-") + strlen(cName) + strlen(".wav") >= sizeof(cOutFile))
+	{
+		puts("Path is too long ...");
+		fclose(ptrInFile);
+		return false;
+	}
+	strcat(cOutFile, "dec-");
+	strcat(cOutFile, cName);
+	strcat(cOutFile, ".wav");
+	SafeFileOpen(&ptrOutFile, cOutFile, "wb");
+
+	// Reserve space for header, decode block by block
+	memset(&WAVHeader, 0x00, sizeof(WAVHeader));
+	FileWriteBlock(&ptrOutFile, &WAVHeader, WAVHeaderSize);
+	while (VAGNextBlock(&ptrInFile, &BlockNum, &Hist1, &Hist2, Samples, &Flags) == true)
+	{
+		if ((Flags & VAG_FLAG_LOOP_START) && LoopStart == PS2_WAV_NOLOOP)
+			LoopStart = SampleCount;
+
+		fwrite(Samples, sizeof(Samples), 1, ptrOutFile);
+		SampleCount += VAG_BLOCK_SAMPLES;
+
+		// Loop end without repeat: SPU stops here
+		if ((Flags & VAG_FLAG_LOOP_END) && !(Flags & VAG_FLAG_LOOP_REPEAT))
+			break;
+	}
+	fclose(ptrInFile);
+
+	// Loop chunk (the same as PatchWAV makes)
+	if (LoopStart != PS2_WAV_NOLOOP)
+	{
+		printf("Looped sound detected, start sample: %u \n", (uint)LoopStart);
+		LoopChunk.Init(SampleCount * sizeof(short), LoopStart);
+		FileWriteBlock(&ptrOutFile, &LoopChunk, sizeof(sLOOP));
+	}
+
+	// Header
+	WAVHeader.RiffChunk.RiffSignature = 0x46464952;
+	WAVHeader.RiffChunk.RiffSize = WAVHeaderSize - sizeof(sRIFF) + SampleCount * sizeof(short) + (LoopStart != PS2_WAV_NOLOOP ? sizeof(sLOOP) : 0);
+	WAVHeader.WaveChunk.WaveSignature = 0x45564157;
+	WAVHeader.WaveChunk.FmtSignature = 0x20746d66;
+	WAVHeader.WaveChunk.FmtSize = 16;		// 16 for PCM
+	WAVHeader.WaveChunk.Format = 1;			// 1 for PCM
+	WAVHeader.WaveChunk.Channels = 1;
+	WAVHeader.WaveChunk.SamplingF = SamplingF;
+	WAVHeader.WaveChunk.ByteRate = SamplingF * sizeof(short);
+	WAVHeader.WaveChunk.BytesPerSample = sizeof(short);
+	WAVHeader.WaveChunk.BitsPerSample = 16;
+	WAVHeader.DataChunk.DataSignature = 0x61746164;
+	WAVHeader.DataChunk.DataSize = SampleCount * sizeof(short);
+	FileWriteBlock(&ptrOutFile, &WAVHeader, 0, WAVHeaderSize);
+	fclose(ptrOutFile);
+
+	printf("Decoded %u samples into %s \n", (uint)SampleCount, cOutFile);
+
+	puts("Done \n");
+
+	return true;
+}
+
+bool CompareVAG(const char * WAVName, const char * VAGName)	// Report quality of VAG encoding against source WAV
+{
+	FILE * ptrInFile;		// VAG file stream
+
+	short * Source;
+	ulong SourceCount;
+	ulong SourceF;
+	bool Looped;
+	ulong LoopStart;
+	ulong Lead;
+
+	short Samples[VAG_BLOCK_SAMPLES];
+	ulong SamplingF;
+	ulong BlockNum = 0;
+	ulong Position = 0;		// Decoded sample position
+	ulong Compared = 0;
+	uchar Flags;
+	int Hist1 = 0;
+	int Hist2 = 0;
+
+	double Signal = 0;
+	double Noise = 0;
+	int Peak = 0;
+
+	// Load source and open VAG
+	Source = LoadWAVSamples(WAVName, &SourceCount, &SourceF, &Looped, &LoopStart);
+	if (Source == NULL)
+	{
+		puts("Bad WAV file ...");
+		return false;
+	}
+	if (VAGOpen(VAGName, &ptrInFile, &SamplingF) == false)
+	{
+		puts("Incorrect VAG music file ...");
+		free(Source);
+		return false;
+	}
+	if (SamplingF != SourceF)
+		printf("Warning: sampling frequency mismatch, WAV: %u, VAG: %u \n", (uint)SourceF, (uint)SamplingF);
+
+	// Encoder puts silence in front of looped sounds
+	Lead = ADPCMLoopLead(Looped, LoopStart);
+
+	// Decode block by block and compare
+	while (Compared < SourceCount && VAGNextBlock(&ptrInFile, &BlockNum, &Hist1, &Hist2, Samples, &Flags) == true)
+	{
+		for (int i = 0; i < VAG_BLOCK_SAMPLES; i++, Position++)
+		{
+			if (Position < Lead || Position - Lead >= SourceCount)
+				continue;
+
+			int Diff = Samples[i] - Source[Position - Lead];
+
+			Signal += (double)Source[Position - Lead] * Source[Position - Lead];
+			Noise += (double)Diff * Diff;
+			if (Diff < 0)
+				Diff = -Diff;
+			if (Diff > Peak)
+				Peak = Diff;
+			Compared++;
+		}
+	}
+	fclose(ptrInFile);
+	free(Source);
+
+	// Report
+	printf("Compared samples: %u of %u \n", (uint)Compared, (uint)SourceCount);
+	if (Compared < SourceCount)
+		puts("Warning: VAG is shorter than WAV.");
+	if (Noise == 0)
+		printf("SNR: lossless, peak error: 0 \n");
+	else if (Signal == 0)
+		printf("SNR: source is silent, peak error: %i \n", Peak);
+	else
+		printf("SNR: %.2f dB, peak error: %i (%.2f%% of full scale) \n", 10.0 * log10(Signal / Noise), Peak, Peak * 100.0 / 32768.0);
+
+	return true;
+}
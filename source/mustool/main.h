@@ -17,7 +17,7 @@
 #include <ctype.h>		// tolower()
 
 ////////// Definitions //////////
-#define PROG_TITLE "\nPS2 HL music tool v1.23\n"
+#define PROG_TITLE "\nPS2 HL music tool v1.28\n"
 #define PROG_INFO "\
 Developed by supadupaplex, 2017-2021\n\
 License: BSD-3-Clause (check out license.txt)\n\
@@ -31,6 +31,18 @@ How to use:\n\
 \t\tmustool unpatch [filename]\n\
 \tc) Check *.VAG\\*.WAV audio file:\n\
 \t\tmustool test [filename]\n\
+\td) Encode 8\\16-bit PCM *.WAV to *.VAG:\n\
+\t\tmustool encode [filename]\n\
+\te) Decode *.VAG to 16-bit PCM *.WAV (\"dec-\" is added to name):\n\
+\t\tmustool decode [filename]\n\
+\tf) Compare *.VAG with source *.WAV (SNR and peak error):\n\
+\t\tmustool compare [wav_filename] [vag_filename]\n\
+\tg) Convert any PCM *.WAV to 8-bit mono WAV (11025\\22050\\44100 Hz):\n\
+\t\tmustool convert [filename] [sampling frequency]\n\
+\th) Convert all *.WAV in folder so they fit into budget:\n\
+\t\tmustool plan [folder] [budget in KB]\n\
+\ti) Trim silence from 8-bit *.WAV\\*.VAG file or all of them in folder:\n\
+\t\tmustool trim [filename or folder] [threshold 0-127]\n\
 \n\
 For more info check out readme.txt\n\
 "
@@ -42,6 +54,12 @@ For more info check out readme.txt\n\
 #define WAV_UNSUPPORTED 2
 #define UNKNOWN_FILE -1
 #define PS2_WAV_NOLOOP 0xFFFFFFFF
+#define VAG_BLOCK_SIZE 16			// PS-ADPCM block: filter/shift, flags, 14 bytes of 4-bit samples
+#define VAG_BLOCK_SAMPLES 28		// Samples in PS-ADPCM block
+#define VAG_UNROLL_MAX 0x20000		// Max samples added to make loop length a multiple of block
+#define VAG_FLAG_LOOP_END 1			// Block flags: last block of sound/loop
+#define VAG_FLAG_LOOP_REPEAT 2		//				block is inside of loop
+#define VAG_FLAG_LOOP_START 4		//				loop starts from this block
 
 ////////// Typedefs //////////
 #include "types.h"
@@ -49,6 +67,9 @@ For more info check out readme.txt\n\
 ////////// Functions //////////
 #include "fops.h"
 
+// Stored size planner
+#include "sizeplan.h"
+
 ////////// Structures //////////
 
 // VAG music file header
@@ -138,6 +159,14 @@ struct sWAVEFMT
 	ushort BitsPerSample;	// Bits per sample for each channel (8, 16, etc)
 };
 
+// Chunk header
+#pragma pack(1)				// Eliminate unwanted 0x00 bytes
+struct sCHUNK
+{
+	ulong ID;				// Chunk signature
+	ulong Size;				// Chunk size (without this header)
+};
+
 // "data" chunk
 #pragma pack(1)				// Eliminate unwanted 0x00 bytes
 struct sDATA
@@ -235,83 +264,95 @@ union uWAVHeader
 
 	void UpdateFromNormal(FILE ** ptrFile)	// Update header from PC file
 	{
+		sCHUNK Chunk;
+		ulong FileEnd = FileSize(ptrFile);
+		ulong Position;
+		ulong CueStart = PS2_WAV_NOLOOP;
+
 		// Clear struct (if some chunks are missing then zeroes would not pass ChechType())
 		memset(this, 0x00, sizeof(sNormalWAVHeader));
-
-		// Find all teh chunks
-		int Current = 0;
-		uchar Temp[3];
 		Normal.Looped = false;				// Loop check
 		Normal.LoopStart = PS2_WAV_NOLOOP;	// Loop start
-		while (Current != EOF)
+
+		// Check RIFF and WAVE signatures
+		if (FileEnd < sizeof(sRIFF) + sizeof(ulong))
+			return;
+		FileReadBlock(ptrFile, &this->Normal.RiffChunk, 0, sizeof(sRIFF));
+		FileReadBlock(ptrFile, &this->Normal.WaveChunk.WaveSignature, sizeof(sRIFF), sizeof(ulong));
+		if (this->Normal.RiffChunk.RiffSignature != 0x46464952 || this->Normal.WaveChunk.WaveSignature != 0x45564157)
+			return;
+
+		// Walk through chunks (chunk data is padded to even size)
+		for (Position = sizeof(sRIFF) + sizeof(ulong); Position + sizeof(sCHUNK) <= FileEnd; Position += sizeof(sCHUNK) + Chunk.Size + (Chunk.Size & 1))
 		{
-			// Check first letters
-			Current = fgetc(*ptrFile);
+			FileReadBlock(ptrFile, &Chunk, Position, sizeof(sCHUNK));
+			if (Chunk.Size > FileEnd - Position - sizeof(sCHUNK))
+				Chunk.Size = FileEnd - Position - sizeof(sCHUNK);
 
-			if (Current == 'R')
+			if (Chunk.ID == 0x20746d66 && Chunk.Size >= 16)		// "fmt "
 			{
-				// Check other letters
-				fread(Temp, sizeof(Temp), 1, *ptrFile);
-				if (Temp[0] == 'I' && Temp[1] == 'F' && Temp[2] == 'F')
-				{
-					// Load chunk
-					this->Normal.RiffChunk.RiffSignature = 0x46464952;
-					fread(&this->Normal.RiffChunk.RiffSize, sizeof(sRIFF) - 4, 1, *ptrFile);
-				}
+				this->Normal.WaveChunk.FmtSignature = Chunk.ID;
+				this->Normal.WaveChunk.FmtSize = Chunk.Size;
+				FileReadBlock(ptrFile, &this->Normal.WaveChunk.Format, Position + sizeof(sCHUNK), sizeof(sWAVEFMT) - 3 * sizeof(ulong));
 			}
-			if (Current == 'W')
+			else if (Chunk.ID == 0x61746164)						// "data", main data fields are updated only once
 			{
-				// Check other letters
-				fread(Temp, sizeof(Temp), 1, *ptrFile);
-				if (Temp[0] == 'A' && Temp[1] == 'V' && Temp[2] == 'E')
+				if (this->Normal.DataChunk.DataSignature == 0)
 				{
-					// Load chunk
-					this->Normal.WaveChunk.WaveSignature = 0x45564157;
-					fread(&this->Normal.WaveChunk.FmtSignature, sizeof(sWAVEFMT) - 4, 1, *ptrFile);
+					this->Normal.DataChunk.DataSignature = Chunk.ID;
+					this->Normal.DataChunk.DataSize = Chunk.Size;
+					this->Normal.DataOffset = Position + sizeof(sCHUNK);
 				}
 			}
-			if (Current == 'd')
+			else if (Chunk.ID == 0x6C706D73 && Chunk.Size >= 9 * sizeof(ulong) + 6 * sizeof(ulong))		// "smpl" with sample loops
 			{
-				// Check other letters
-				fread(Temp, sizeof(Temp), 1, *ptrFile);
-				if (Temp[0] == 'a' && Temp[1] == 't' && Temp[2] == 'a')
+				ulong Sampler[9 + 6];	// Sampler fields (7 - number of loops), first loop (2 - loop start)
+
+				FileReadBlock(ptrFile, Sampler, Position + sizeof(sCHUNK), sizeof(Sampler));
+				if (Sampler[7] > 0)
 				{
-					// Update main data fields only once
-					if (this->Normal.DataChunk.DataSignature == 0)
-					{
-						// Load chunk
-						this->Normal.DataChunk.DataSignature = 0x61746164;
-						fread(&this->Normal.DataChunk.DataSize, sizeof(sDATA) - 4, 1, *ptrFile);
-						Normal.DataOffset = ftell(*ptrFile);
-					}
-					else if (this->Normal.LoopStart == PS2_WAV_NOLOOP)
-					{
-						// Fetch loop start second time
-						ulong SomeData[3];
-						fread(&SomeData, sizeof(SomeData), 1, *ptrFile);
-						if (SomeData[0] == 0 && SomeData[1] == 0)
-							Normal.LoopStart = SomeData[2];
-					}
+					Normal.Looped = true;
+					Normal.LoopStart = Sampler[9 + 2];
 				}
 			}
+			else if (Chunk.ID == 0x20657563 && Chunk.Size >= 7 * sizeof(ulong))		// "cue "
+			{
+				ulong Cue[7];			// Number of points, first point (5 - sample offset)
 
-			if (Current == 'm' || Current == 'M')
+				FileReadBlock(ptrFile, Cue, Position + sizeof(sCHUNK), sizeof(Cue));
+				if (Cue[0] > 0 && Cue[3] == 0x61746164 && Cue[4] == 0)
+					CueStart = Cue[6];
+			}
+			else if (Chunk.ID == 0x5453494C && Chunk.Size >= sizeof(ulong))		// "LIST"
 			{
-				// Check other letters
-				fread(Temp, sizeof(Temp), 1, *ptrFile);
-				if ((Temp[0] == 'a' && Temp[1] == 'r' && Temp[2] == 'k')
-					|| (Temp[0] == 'A' && Temp[1] == 'R' && Temp[2] == 'K'))
+				ulong ListType;
+
+				// Look for "ltxt" with "mark" purpose in "adtl" list (cue marks loop start)
+				FileReadBlock(ptrFile, &ListType, Position + sizeof(sCHUNK), sizeof(ulong));
+				if (ListType != 0x6C746461)
+					continue;
+				for (ulong Sub = sizeof(ulong); Sub + sizeof(sCHUNK) <= Chunk.Size; )
 				{
-					// Set loop flag
-					Normal.Looped = true;
+					sCHUNK SubChunk;
+					ulong Purpose;
+
+					FileReadBlock(ptrFile, &SubChunk, Position + sizeof(sCHUNK) + Sub, sizeof(sCHUNK));
+					if (SubChunk.ID == 0x7478746C && SubChunk.Size >= 3 * sizeof(ulong))		// "ltxt"
+					{
+						FileReadBlock(ptrFile, &Purpose, Position + 2 * sizeof(sCHUNK) + Sub + 2 * sizeof(ulong), sizeof(ulong));
+						if (Purpose == 0x6B72616D || Purpose == 0x4B52414D)		// "mark" or "MARK"
+							Normal.Looped = true;
+					}
+					if (SubChunk.Size > Chunk.Size)
+						break;
+					Sub += sizeof(sCHUNK) + SubChunk.Size + (SubChunk.Size & 1);
 				}
 			}
 		}
 
-		// If loop start is missing then assume that is is 0
-		if (Normal.Looped == true)
-			if (Normal.LoopStart == PS2_WAV_NOLOOP)
-				Normal.LoopStart = 0;
+		// Loop start from cue, if it is missing then assume that is is 0
+		if (Normal.Looped == true && Normal.LoopStart == PS2_WAV_NOLOOP)
+			Normal.LoopStart = (CueStart != PS2_WAV_NOLOOP) ? CueStart : 0;
 	}
 
 	void ConvertToNormal()
@@ -402,4 +443,28 @@ union uWAVHeader
 	}
 };
 
+////////// Functions //////////
+
+// PS-ADPCM (adpcm.cpp)
+bool EncodeVAG(const char * FileName);		// Encode PCM WAV to VAG (normal format)
+bool DecodeVAG(const char * FileName);		// Decode VAG to 16 bit PCM WAV
+bool CompareVAG(const char * WAVName, const char * VAGName);	// Report quality of VAG encoding against source WAV
+short * LoadWAVSamples(const char * FileName, ulong * SampleCount, ulong * SamplingF, bool * Looped, ulong * LoopStart);	// Load PCM WAV as 16 bit mono samples
+void ADPCMDecodeBlock(const uchar * Block, int * Hist1, int * Hist2, short * Samples);	// Decode 16 byte block into 28 samples
+bool ADPCMBlockIsEmpty(const uchar * Block);											// Check if block is filled with zeroes
+
+// Checking and writing (mustool.cpp)
+uchar CheckVAG(const char * FileName, bool PrintInfo);		// Check VAG audio file type
+uchar CheckWAV(const char * FileName, bool PrintInfo);		// Check WAV audio file type
+void WriteNormalWAV(FILE ** ptrOutFile, uWAVHeader * WAVHeader, const uchar * AudioData);	// Write normal WAV (header from ConvertToNormal(), 8 bit unsigned audio data and loop chunk)
+
+// PS2 HL WAV conversion (wavconv.cpp)
+short * ResampleSamples(const short * Samples, ulong Count, ulong OldF, ulong NewF, ulong * NewCount);	// Change sampling frequency of 16 bit mono sound
+uchar * ReduceSamples(const short * Samples, ulong Count);												// Reduce 16 bit sound to 8 bit unsigned (dithered and noise shaped)
+bool ConvertWAV(const char * FileName, ulong NewF);														// Convert any PCM WAV to 8 bit mono WAV with given sampling frequency
+void PlanSounds(const char * Dir, ulong Budget);														// Convert all WAVs in folder with sampling frequencies that fit into budget
+
+// Silence trimming (trim.cpp)
+void TrimSounds(const char * Path, int Threshold);		// Trim silence from PS2 HL WAV/VAG file or all of them in folder
+
 #endif // MAIN_H
@@ -1,2 +1,2 @@
-OBJS=$(COMOBJ)/fops.o $(OBJDIR)/mustool.o
+OBJS=$(COMOBJ)/fops.o $(COMOBJ)/resample.o $(COMOBJ)/sizeplan.o $(OBJDIR)/adpcm.o $(OBJDIR)/wavconv.o $(OBJDIR)/trim.o $(OBJDIR)/mustool.o
 LIBS=
@@ -12,10 +12,8 @@
 ////////// Functions //////////
 void PatchVAG(const char * FileName);						// Add header to VAG file (normal format)
 void UnpatchVAG(const char * FileName);						// Remove header from VAG file (PS2 HL music format)
-uchar CheckVAG(const char * FileName, bool PrintInfo);		// Check VAG audio file type
 void UnpatchWAV(const char * FileName);						// Remove header from WAV file
 void PatchWAV(const char * FileName);						// Add header to WAV file
-uchar CheckWAV(const char * FileName, bool PrintInfo);		// Check WAV audio file type
 
 
 void UnpatchVAG(const char * FileName)		// Remove header from VAG file (PS2 HL music format)
@@ -304,10 +302,24 @@ void PatchWAV(const char * FileName)	// Add header to WAV file
 	for (ulong Byte = 0; Byte < AudioDataSize; Byte++)
 		AudioData[Byte] += 0x80;
 
+	// Write header, audio data and loop
+	WriteNormalWAV(&ptrOutFile, &WAVHeader, AudioData);
+
+	// Free memory
+	free(AudioData);
+
+	// Close output file
+	fclose(ptrOutFile);
+
+	puts("Done \n");
+}
+
+void WriteNormalWAV(FILE ** ptrOutFile, uWAVHeader * WAVHeader, const uchar * AudioData)	// Write normal WAV (header from ConvertToNormal(), 8 bit unsigned audio data and loop chunk)
+{
 	// Check if looped
-	bool Spacer;
+	bool Spacer = false;
 	sLOOP * LoopChunk = NULL;
-	if (WAVHeader.Normal.Looped == true)
+	if (WAVHeader->Normal.Looped == true)
 	{
 		LoopChunk = (sLOOP *) malloc(sizeof(sLOOP));
 		if (LoopChunk == NULL)
@@ -315,29 +327,21 @@ void PatchWAV(const char * FileName)	// Add header to WAV file
 			puts("Can't allocate memory ...");
 			exit(EXIT_FAILURE);
 		}
-		LoopChunk->Init(WAVHeader.Normal.DataChunk.DataSize, WAVHeader.Normal.LoopStart);
-		WAVHeader.Normal.RiffChunk.RiffSize += sizeof(sLOOP);
-		Spacer = WAVHeader.Normal.DataChunk.DataSize % 2;
+		LoopChunk->Init(WAVHeader->Normal.DataChunk.DataSize, WAVHeader->Normal.LoopStart);
+		WAVHeader->Normal.RiffChunk.RiffSize += sizeof(sLOOP);
+		Spacer = WAVHeader->Normal.DataChunk.DataSize % 2;
 	}
 
 	// Write header and audio data
-	FileWriteBlock(&ptrOutFile, &WAVHeader, WAVHeader.Normal.DataOffset);	// DataOffset = size of WAV header
-	FileWriteBlock(&ptrOutFile, AudioData, AudioDataSize);
+	FileWriteBlock(ptrOutFile, WAVHeader, WAVHeader->Normal.DataOffset);	// DataOffset = size of WAV header
+	FileWriteBlock(ptrOutFile, AudioData, WAVHeader->Normal.DataChunk.DataSize);
 	if (LoopChunk != NULL)
 	{
 		if (Spacer)
-			fputc(0x00, ptrOutFile);
-		FileWriteBlock(&ptrOutFile, LoopChunk, sizeof(sLOOP));
+			fputc(0x00, *ptrOutFile);
+		FileWriteBlock(ptrOutFile, LoopChunk, sizeof(sLOOP));
 		free(LoopChunk);
 	}
-
-	// Free memory
-	free(AudioData);
-
-	// Close output file
-	fclose(ptrOutFile);
-
-	puts("Done \n");
 }
 
 uchar CheckWAV(const char * FileName, bool PrintInfo)	// Check WAV audio file type
@@ -509,6 +513,30 @@ int main(int argc, char * argv[])
 				puts("Wrong file extension ...");
 			}
 		}
+		else if (!strcmp(argv[1], "encode") == true)
+		{
+			if (!strcmp(".wav", cFileExtension))
+			{
+				if (EncodeVAG(argv[2]) == false)
+					puts("Can't encode WAV ...");
+			}
+			else
+			{
+				puts("Wrong file extension ...");
+			}
+		}
+		else if (!strcmp(argv[1], "decode") == true)
+		{
+			if (!strcmp(".vag", cFileExtension))
+			{
+				if (DecodeVAG(argv[2]) == false)
+					puts("Can't decode VAG ...");
+			}
+			else
+			{
+				puts("Wrong file extension ...");
+			}
+		}
 		else if (!strcmp(argv[1], "test") == true)
 		{
 			if (!strcmp(".vag", cFileExtension))
@@ -529,6 +557,39 @@ int main(int argc, char * argv[])
 			puts("Wrong arguments ...");
 		}
 	}
+	else if (argc == 4 && !strcmp(argv[1], "compare") == true)
+	{
+		printf("\nComparing files: %s, %s\n", argv[2], argv[3]);
+		CompareVAG(argv[2], argv[3]);
+	}
+	else if (argc == 4 && !strcmp(argv[1], "convert") == true)
+	{
+		ulong NewF = atoi(argv[3]);
+
+		printf("\nProcessing file: %s\n", argv[2]);
+		if (NewF != 11025 && NewF != 22050 && NewF != 44100)
+			puts("Sampling frequency should be 11025, 22050 or 44100 ...");
+		else if (ConvertWAV(argv[2], NewF) == false)
+			puts("Can't convert WAV ...");
+	}
+	else if (argc == 4 && !strcmp(argv[1], "plan") == true)
+	{
+		if (CheckDir(argv[2]) == false)
+			puts("Folder required ...");
+		else if (atoi(argv[3]) <= 0)
+			puts("Wrong budget ...");
+		else
+			PlanSounds(argv[2], atoi(argv[3]) * 1024);
+	}
+	else if (argc == 4 && !strcmp(argv[1], "trim") == true)
+	{
+		int Threshold = atoi(argv[3]);
+
+		if (Threshold < 0 || Threshold > 127)
+			puts("Threshold should be from 0 to 127 ...");
+		else
+			TrimSounds(argv[2], Threshold);
+	}
 	else
 	{
 		puts("Can't recognise arguments ...");
@@ -0,0 +1,383 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains silence trimming for sounds that PS2 HL can use:
+// 8-bit mono WAVs and VAGs (both in normal and PS2 formats). Samples that
+// are not louder than threshold are cut from the start and from the end.
+// Looped sounds keep loop start valid: start is trimmed up to loop start and
+// end is kept because it is a part of the loop. VAGs are trimmed by whole
+// blocks (blocks stay as they are, no reencoding), so loop start stays on
+// block boundary. Blocks after loop end are never played and are removed
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Structures //////////
+
+// Saved bytes in folder
+struct sTrimDir
+{
+	char Path[PATH_LEN];
+	uint Files;
+	ulong Saved;
+};
+
+////////// Functions //////////
+static bool TrimWAV(const char * FileName, int Threshold, ulong * Saved);		// Trim silence from 8 bit mono WAV (normal or PS2 format)
+static bool TrimVAG(const char * FileName, int Threshold, ulong * Saved);		// Trim silent blocks and blocks after loop end from VAG (normal or PS2 format)
+static bool TrimFile(const char * FileName, int Threshold, ulong * Saved);		// Trim WAV or VAG (by extension)
+
+static bool TrimWAV(const char * FileName, int Threshold, ulong * Saved)
+{
+	FILE * ptrInFile;		// Input file stream
+	FILE * ptrOutFile;		// Output file stream
+
+	uWAVHeader WAVHeader;	// WAV file header
+	uchar WAVType;
+	uchar * AudioData;		// Audio data pointer (8 bit unsigned)
+	ulong DataOffset;
+	ulong DataSize;
+	ulong NewSize;
+	ulong OldFileSize;
+	ulong NewFileSize;
+	bool Looped;
+	ulong Lead = 0;			// Silent samples in front
+	ulong Tail = 0;			// Silent samples at the end
+
+	*Saved = 0;
+
+	// Check type
+	WAVType = CheckWAV(FileName, false);
+	if (WAVType == WAV_UNSUPPORTED)
+	{
+		puts("8-bit mono WAV required (use \"convert\" first) ...");
+		return false;
+	}
+	else if (WAVType != WAV_NORMAL && WAVType != WAV_PS2)
+	{
+		puts("Bad WAV file ...");
+		return false;
+	}
+
+	// Read header (as PS2 one) and audio data
+	SafeFileOpen(&ptrInFile, FileName, "rb");
+	OldFileSize = FileSize(&ptrInFile);
+	if (WAVType == WAV_NORMAL)
+	{
+		WAVHeader.UpdateFromNormal(&ptrInFile);
+		DataOffset = WAVHeader.Normal.DataOffset;
+		WAVHeader.ConvertToPS2();
+	}
+	else
+	{
+		WAVHeader.UpdateFromPS2(&ptrInFile);
+		DataOffset = sizeof(sPS2WAVHeader);
+	}
+	DataSize = WAVHeader.PS2.DataSize;
+	AudioData = (uchar *)malloc(DataSize + 16);
+	if (AudioData == NULL)
+	{
+		puts("Can't allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	FileReadBlock(&ptrInFile, AudioData, DataOffset, DataSize);
+	fclose(ptrInFile);
+
+	// PS2 audio data is signed
+	if (WAVType == WAV_PS2)
+		for (ulong Byte = 0; Byte < DataSize; Byte++)
+			AudioData[Byte] += 0x80;
+
+	// Find silence (looped sound: up to loop start only, the end is a part of the loop)
+	Looped = WAVHeader.PS2.LoopStart != PS2_WAV_NOLOOP;
+	while (Lead < DataSize && abs(AudioData[Lead] - 0x80) <= Threshold && (Looped == false || Lead < WAVHeader.PS2.LoopStart))
+		Lead++;
+	if (Looped == false)
+		while (Lead + Tail < DataSize && abs(AudioData[DataSize - 1 - Tail] - 0x80) <= Threshold)
+			Tail++;
+	if (Lead + Tail >= DataSize && DataSize > 0)
+	{
+		// Silent sound, keep one sample
+		Lead = DataSize - 1;
+		Tail = 0;
+	}
+	if (Lead == 0 && Tail == 0)
+	{
+		puts("Nothing to trim.");
+		free(AudioData);
+		return true;
+	}
+
+	// Update header
+	NewSize = DataSize - Lead - Tail;
+	WAVHeader.PS2.DataSize = NewSize;
+	if (Looped == true)
+	{
+		WAVHeader.PS2.LoopStart -= Lead;
+		printf("Looped sound, new start sample: %u \n", (uint)WAVHeader.PS2.LoopStart);
+	}
+
+	// Write output file (same as input)
+	SafeFileOpen(&ptrOutFile, FileName, "wb");
+	if (WAVType == WAV_NORMAL)
+	{
+		WAVHeader.ConvertToNormal();
+		WriteNormalWAV(&ptrOutFile, &WAVHeader, &AudioData[Lead]);
+	}
+	else
+	{
+		// Audio data should be aligned within 16-byte blocks (as UnpatchWAV does)
+		ulong AlignedSize = NewSize + 16 - (NewSize + sizeof(sPS2WAVHeader)) % 16;
+
+		for (ulong Byte = Lead; Byte < Lead + NewSize; Byte++)
+			AudioData[Byte] += 0x80;
+		memset(&AudioData[Lead + NewSize], 0x00, AlignedSize - NewSize);
+		FileWriteBlock(&ptrOutFile, &WAVHeader, sizeof(sPS2WAVHeader));
+		FileWriteBlock(&ptrOutFile, &AudioData[Lead], AlignedSize);
+	}
+	NewFileSize = ftell(ptrOutFile);
+	fclose(ptrOutFile);
+	free(AudioData);
+
+	*Saved = OldFileSize > NewFileSize ? OldFileSize - NewFileSize : 0;
+	printf("Trimmed samples: %u in front, %u at the end, saved %u bytes \n", (uint)Lead, (uint)Tail, (uint)*Saved);
+
+	return true;
+}
+
+static bool TrimVAG(const char * FileName, int Threshold, ulong * Saved)
+{
+	FILE * ptrInFile;		// Input file stream
+	FILE * ptrOutFile;		// Output file stream
+
+	sVAGHeader VAGHeader;	// VAG file header
+	uchar VAGType;
+	uchar * Blocks;			// ADPCM blocks
+	bool * Silent;			// Block is not louder than threshold
+	ulong DataOffset;
+	ulong BlockCount;
+	ulong OldFileSize;
+	ulong NewFileSize;
+	short Samples[VAG_BLOCK_SAMPLES];
+	int Hist1 = 0;
+	int Hist2 = 0;
+
+	ulong First;			// First sound block (zero block in front is kept)
+	ulong End;				// Block after last played block
+	ulong LoopBlock;		// Loop start block
+	bool Looped = false;
+	bool Terminator = false;	// End block after sound (unlooped sounds)
+	ulong Lead = 0;			// Silent blocks in front
+	ulong Tail = 0;			// Silent blocks at the end
+	ulong Dead;				// Blocks after the end
+	ulong NewCount = 0;
+
+	*Saved = 0;
+
+	// Check type
+	VAGType = CheckVAG(FileName, false);
+	if (VAGType == VAG_NORMAL || VAGType == VAG_UNSUPPORTED)
+		DataOffset = sizeof(sVAGHeader);
+	else if (VAGType == VAG_PS2)
+		DataOffset = 0;
+	else
+	{
+		puts("Incorrect VAG music file ...");
+		return false;
+	}
+
+	// Read header and blocks
+	SafeFileOpen(&ptrInFile, FileName, "rb");
+	OldFileSize = FileSize(&ptrInFile);
+	VAGHeader.UpdateFromFile(&ptrInFile);
+	VAGHeader.SwapEndian();
+	BlockCount = (OldFileSize - DataOffset) / VAG_BLOCK_SIZE;
+	Blocks = (uchar *)malloc(BlockCount * VAG_BLOCK_SIZE + 1);
+	Silent = (bool *)malloc(BlockCount + 1);
+	if (Blocks == NULL || Silent == NULL)
+	{
+		puts("Can't allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	FileReadBlock(&ptrInFile, Blocks, DataOffset, BlockCount * VAG_BLOCK_SIZE);
+	fclose(ptrInFile);
+
+	// Decode blocks up to the end (end block or loop end)
+	First = (BlockCount > 0 && ADPCMBlockIsEmpty(Blocks) == true) ? 1 : 0;
+	End = BlockCount;
+	LoopBlock = BlockCount;
+	for (ulong b = First; b < BlockCount; b++)
+	{
+		uchar Flags = Blocks[b * VAG_BLOCK_SIZE + 1];
+
+		if (Flags == (VAG_FLAG_LOOP_END | VAG_FLAG_LOOP_REPEAT | VAG_FLAG_LOOP_START))
+		{
+			End = b;
+			Terminator = true;
+			break;
+		}
+
+		ADPCMDecodeBlock(&Blocks[b * VAG_BLOCK_SIZE], &Hist1, &Hist2, Samples);
+		Silent[b] = true;
+		for (int i = 0; i < VAG_BLOCK_SAMPLES; i++)
+			if (abs(Samples[i]) > Threshold * 256)
+				Silent[b] = false;
+
+		if ((Flags & VAG_FLAG_LOOP_START) && LoopBlock == BlockCount)
+			LoopBlock = b;
+		if (Flags & VAG_FLAG_LOOP_END)
+		{
+			End = b + 1;
+			Looped = (Flags & VAG_FLAG_LOOP_REPEAT) != 0;
+			Terminator = Looped == false && End < BlockCount && Blocks[End * VAG_BLOCK_SIZE + 1] == (VAG_FLAG_LOOP_END | VAG_FLAG_LOOP_REPEAT | VAG_FLAG_LOOP_START);
+			break;
+		}
+	}
+	if (Looped == false)
+		LoopBlock = End;
+	else if (LoopBlock == BlockCount)
+		LoopBlock = First;		// Loop without start flag repeats whole sound
+
+	// Find silent blocks (looped sound: up to loop start only, the end is a part of the loop)
+	while (First + Lead + 1 < End && First + Lead < LoopBlock && Silent[First + Lead] == true)
+		Lead++;
+	if (Looped == false)
+		while (First + Lead + Tail + 1 < End && Silent[End - Tail - 1] == true)
+			Tail++;
+	Dead = BlockCount - End - (Terminator ? 1 : 0);
+	if (Lead == 0 && Tail == 0 && Dead == 0 && (OldFileSize - DataOffset) % VAG_BLOCK_SIZE == 0)
+	{
+		puts("Nothing to trim.");
+		free(Blocks);
+		free(Silent);
+		return true;
+	}
+
+	// Pack kept blocks: zero block, sound, end block
+	if (First == 1)
+		NewCount++;
+	if (End > First)
+	{
+		memmove(&Blocks[NewCount * VAG_BLOCK_SIZE], &Blocks[(First + Lead) * VAG_BLOCK_SIZE], (End - Tail - First - Lead) * VAG_BLOCK_SIZE);
+		NewCount += End - Tail - First - Lead;
+
+		// Last block keeps flags of the old last block
+		Blocks[(NewCount - 1) * VAG_BLOCK_SIZE + 1] = Blocks[(End - 1) * VAG_BLOCK_SIZE + 1];
+	}
+	if (Terminator == true)
+	{
+		memmove(&Blocks[NewCount * VAG_BLOCK_SIZE], &Blocks[End * VAG_BLOCK_SIZE], VAG_BLOCK_SIZE);
+		NewCount++;
+	}
+	if (Looped == true)
+		printf("Looped sound, loop starts at block #%u \n", (uint)(LoopBlock - First - Lead + 1));
+
+	// Write output file (same as input, header is kept)
+	SafeFileOpen(&ptrOutFile, FileName, "wb");
+	if (DataOffset != 0)
+	{
+		VAGHeader.DataSize = NewCount * VAG_BLOCK_SIZE;
+		VAGHeader.SwapEndian();
+		FileWriteBlock(&ptrOutFile, &VAGHeader, sizeof(sVAGHeader));
+	}
+	FileWriteBlock(&ptrOutFile, Blocks, NewCount * VAG_BLOCK_SIZE);
+	NewFileSize = ftell(ptrOutFile);
+	fclose(ptrOutFile);
+	free(Blocks);
+	free(Silent);
+
+	*Saved = OldFileSize > NewFileSize ? OldFileSize - NewFileSize : 0;
+	printf("Trimmed blocks: %u in front, %u at the end, %u after loop end, saved %u bytes \n", (uint)Lead, (uint)Tail, (uint)Dead, (uint)*Saved);
+
+	return true;
+}
+
+static bool TrimFile(const char * FileName, int Threshold, ulong * Saved)
+{
+	char Extension[5];
+
+	FileGetExtension(FileName, Extension, sizeof(Extension));
+	if (!strcmp(Extension, ".wav"))
+		return TrimWAV(FileName, Threshold, Saved);
+	else if (!strcmp(Extension, ".vag"))
+		return TrimVAG(FileName, Threshold, Saved);
+
+	*Saved = 0;
+	return false;
+}
+
+void TrimSounds(const char * Path, int Threshold)	// Trim silence from PS2 HL WAV/VAG file or all of them in folder
+{
+	sTrimDir * Dirs = NULL;
+	uint DirCount = 0;
+	ulong Total = 0;
+	ulong Saved;
+	const char * FileName;
+	char Extension[5];
+	char FileDir[PATH_LEN];
+
+	// Single file
+	if (CheckDir(Path) == false)
+	{
+		printf("\nProcessing file: %s\n", Path);
+		if (TrimFile(Path, Threshold, &Saved) == false)
+			puts("Can't trim file ...");
+		puts("Done \n");
+		return;
+	}
+
+	// All WAVs and VAGs in folder (including subfolders)
+	DirIterInit(Path);
+	while ((FileName = DirIterGet()) != NULL)
+	{
+		uint d;
+
+		FileGetExtension(FileName, Extension, sizeof(Extension));
+		if ((strcmp(Extension, ".wav") && strcmp(Extension, ".vag")) || strlen(FileName) >= PATH_LEN)
+			continue;
+
+		printf("Processing file: %s \n", FileName);
+		if (TrimFile(FileName, Threshold, &Saved) == false)
+			continue;
+
+		// Count saved bytes for folder of the file
+		FileGetPath(FileName, FileDir, sizeof(FileDir));
+		for (d = 0; d < DirCount; d++)
+			if (!strcmp(Dirs[d].Path, FileDir))
+				break;
+		if (d == DirCount)
+		{
+			Dirs = (sTrimDir *)realloc(Dirs, (DirCount + 1) * sizeof(sTrimDir));
+			if (Dirs == NULL)
+			{
+				puts("Can't allocate memory ...");
+				exit(EXIT_FAILURE);
+			}
+			strcpy(Dirs[d].Path, FileDir);
+			Dirs[d].Files = 0;
+			Dirs[d].Saved = 0;
+			DirCount++;
+		}
+		Dirs[d].Files++;
+		Dirs[d].Saved += Saved;
+		Total += Saved;
+	}
+	DirIterClose();
+	if (DirCount == 0)
+	{
+		puts("No sounds found.");
+		return;
+	}
+
+	// Report
+	puts("");
+	for (uint d = 0; d < DirCount; d++)
+		printf("%s: %u files, saved %u bytes \n", Dirs[d].Path, Dirs[d].Files, (uint)Dirs[d].Saved);
+	printf("Total saved: %u bytes \n", (uint)Total);
+	free(Dirs);
+
+	puts("Done \n");
+}
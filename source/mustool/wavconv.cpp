@@ -0,0 +1,356 @@
+// Author:	supadupaplex
+// License:	BSD-3-Clause (check out license.txt)
+
+//
+// This file contains conversion of any PCM WAV to format that PS2 HL can
+// use (8-bit mono 11025/22050/44100 Hz). Channels are mixed, sampling
+// frequency is changed with polyphase windowed sinc filter (filter taps
+// for every phase are computed once) and samples are reduced to 8 bits
+// with TPDF dither, quantization noise is shaped towards high frequencies.
+// Sound folders can be fitted into byte budget with the same size planner
+// that is used for sprites and decals: every lower sampling frequency is
+// rated by error of going down and back up
+//
+
+////////// Includes //////////
+#include "util.h"
+#include "main.h"
+
+////////// Definitions //////////
+#define SINC_HALF_TAPS 16			// Filter taps on each side of sample (at full bandwidth)
+#define SINC_MAX_PHASES 4096		// Filter phases limit (odd ratios are approximated)
+#define SINC_CUTOFF 0.95			// Cutoff relative to lower Nyquist frequency
+
+// Sampling frequencies that PS2 HL supports (from best)
+static const ulong PS2Rates[] = { 44100, 22050, 11025 };
+#define PS2_RATE_COUNT (sizeof(PS2Rates) / sizeof(PS2Rates[0]))
+
+////////// Functions //////////
+static ulong GreatestCommonDivisor(ulong A, ulong B);															// Greatest common divisor
+static uint FirstPS2Rate(ulong SamplingF);																		// Index of lowest PS2 rate that keeps whole sound
+static double ResampleError(const short * Samples, ulong Count, ulong OldF, ulong NewF);						// Squared error of resampling sound down and back up
+
+static ulong GreatestCommonDivisor(ulong A, ulong B)
+{
+	while (B != 0)
+	{
+		ulong T = A % B;
+		A = B;
+		B = T;
+	}
+
+	return A;
+}
+
+short * ResampleSamples(const short * Samples, ulong Count, ulong OldF, ulong NewF, ulong * NewCount)	// Change sampling frequency of 16 bit mono sound
+{
+	ulong Divisor = GreatestCommonDivisor(OldF, NewF);
+	ulong Up = NewF / Divisor;		// Output sample is at Up-th parts of input sample
+	ulong Down = OldF / Divisor;
+	ulong Phases = Up > SINC_MAX_PHASES ? SINC_MAX_PHASES : Up;
+	double Cutoff = SINC_CUTOFF * (NewF < OldF ? (double)NewF / OldF : 1.0);
+	int HalfTaps = (int)ceil(SINC_HALF_TAPS / Cutoff);
+	int Taps = HalfTaps * 2;
+	float * Filter;
+	short * Output;
+
+	// Allocate memory
+	*NewCount = (ulong)((double)Count * NewF / OldF);
+	Output = (short *)malloc(*NewCount * sizeof(short) + 1);
+	Filter = (float *)malloc(Phases * Taps * sizeof(float));
+	if (Output == NULL || Filter == NULL)
+	{
+		puts("Can't allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+
+	// Filter table: Blackman windowed sinc for every phase, normalized to keep volume
+	for (ulong p = 0; p < Phases; p++)
+	{
+		double Fraction = (double)p / Phases;
+		double Sum = 0;
+
+		for (int t = 0; t < Taps; t++)
+		{
+			double X = (t - HalfTaps + 1) - Fraction;		// Distance from output sample
+			double W = 0.42 + 0.5 * cos(M_PI * X / HalfTaps) + 0.08 * cos(2 * M_PI * X / HalfTaps);
+			double S = (X == 0) ? 1.0 : sin(M_PI * Cutoff * X) / (M_PI * Cutoff * X);
+
+			if (fabs(X) >= HalfTaps)
+				W = 0;
+			Filter[p * Taps + t] = S * W;
+			Sum += S * W;
+		}
+		for (int t = 0; t < Taps; t++)
+			Filter[p * Taps + t] /= Sum;
+	}
+
+	// Filter (samples outside of sound are silent)
+	ulong Position = 0;		// Input sample before output sample
+	ulong Phase = 0;		// Position between input samples (in Up-th parts)
+	for (ulong n = 0; n < *NewCount; n++)
+	{
+		const float * Coefs = &Filter[(Phases == Up ? Phase : (ulong)((double)Phase * Phases / Up)) * Taps];
+		long First = (long)Position - HalfTaps + 1;
+		double Acc = 0;
+
+		if (First >= 0 && First + Taps <= (long)Count)
+		{
+			for (int t = 0; t < Taps; t++)
+				Acc += Samples[First + t] * Coefs[t];
+		}
+		else
+		{
+			for (int t = 0; t < Taps; t++)
+				if (First + t >= 0 && First + t < (long)Count)
+					Acc += Samples[First + t] * Coefs[t];
+		}
+
+		Acc = floor(Acc + 0.5);
+		Output[n] = Acc > 32767 ? 32767 : (Acc < -32768 ? -32768 : (short)Acc);
+
+		// Next output sample
+		Position += Down / Up;
+		Phase += Down % Up;
+		if (Phase >= Up)
+		{
+			Phase -= Up;
+			Position++;
+		}
+	}
+
+	free(Filter);
+
+	return Output;
+}
+
+uchar * ReduceSamples(const short * Samples, ulong Count)	// Reduce 16 bit sound to 8 bit unsigned (dithered and noise shaped)
+{
+	uchar * Output;
+	bool Exact = true;
+	ulong Random = 0x12345678;		// Fixed seed: same input gives same output
+	double Error1 = 0;				// Quantization errors of previous samples
+	double Error2 = 0;
+
+	Output = (uchar *)malloc(Count + 1);
+	if (Output == NULL)
+	{
+		puts("Can't allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+
+	// 8 bit sources don't need dither
+	for (ulong s = 0; s < Count && Exact == true; s++)
+		if (Samples[s] & 0xFF)
+			Exact = false;
+	if (Exact == true)
+	{
+		for (ulong s = 0; s < Count; s++)
+			Output[s] = (Samples[s] >> 8) + 0x80;
+		return Output;
+	}
+
+	for (ulong s = 0; s < Count; s++)
+	{
+		// Error feedback (2 * E(z^-1) - E(z^-2)) moves noise to high frequencies
+		double Value = Samples[s] / 256.0 - (2 * Error1 - Error2);
+
+		// TPDF dither: sum of two uniform values, +-1 LSB
+		Random = Random * 1103515245 + 12345;
+		double Dither = ((Random >> 8) & 0xFFFF) / 65536.0;
+		Random = Random * 1103515245 + 12345;
+		Dither -= ((Random >> 8) & 0xFFFF) / 65536.0;
+
+		double Quantized = floor(Value + Dither + 0.5);
+		if (Quantized > 127)
+			Quantized = 127;
+		else if (Quantized < -128)
+			Quantized = -128;
+
+		// Clipped samples would make feedback grow, keep error in one LSB
+		Error2 = Error1;
+		Error1 = Quantized - Value;
+		if (Error1 > 1)
+			Error1 = 1;
+		else if (Error1 < -1)
+			Error1 = -1;
+
+		Output[s] = (int)Quantized + 0x80;
+	}
+
+	return Output;
+}
+
+bool ConvertWAV(const char * FileName, ulong NewF)	// Convert any PCM WAV to 8 bit mono WAV with given sampling frequency
+{
+	FILE * ptrOutFile;		// Output file stream
+
+	uWAVHeader WAVHeader;	// WAV file header
+	short * Samples;
+	short * Resampled;
+	uchar * AudioData;
+	ulong SampleCount;
+	ulong NewCount;
+	ulong SamplingF;
+	bool Looped;
+	ulong LoopStart;
+
+	// Load samples (mixed to mono)
+	Samples = LoadWAVSamples(FileName, &SampleCount, &SamplingF, &Looped, &LoopStart);
+	if (Samples == NULL)
+		return false;
+	printf("Samples: %u, Sampling frequency: %u -> %u \n", (uint)SampleCount, (uint)SamplingF, (uint)NewF);
+
+	// Resample
+	if (SamplingF != NewF)
+	{
+		Resampled = ResampleSamples(Samples, SampleCount, SamplingF, NewF, &NewCount);
+		free(Samples);
+		Samples = Resampled;
+		if (Looped == true)
+		{
+			LoopStart = (ulong)floor((double)LoopStart * NewF / SamplingF + 0.5);
+			if (LoopStart >= NewCount)
+				LoopStart = NewCount > 0 ? NewCount - 1 : 0;
+		}
+		SampleCount = NewCount;
+	}
+	if (Looped == true)
+		printf("Looped sound, start sample: %u \n", (uint)LoopStart);
+
+	// Reduce to 8 bits
+	AudioData = ReduceSamples(Samples, SampleCount);
+	free(Samples);
+
+	// Make header in the same way as PatchWAV does
+	memset(&WAVHeader, 0x00, sizeof(WAVHeader));
+	WAVHeader.PS2.DataSize = SampleCount;
+	WAVHeader.PS2.LoopStart = Looped ? LoopStart : PS2_WAV_NOLOOP;
+	WAVHeader.PS2.SamplingF = NewF;
+	WAVHeader.PS2.Magic1 = 1;
+	WAVHeader.ConvertToNormal();
+
+	// Write output file (same as input)
+	SafeFileOpen(&ptrOutFile, FileName, "wb");
+	WriteNormalWAV(&ptrOutFile, &WAVHeader, AudioData);
+	fclose(ptrOutFile);
+	free(AudioData);
+
+	puts("Done \n");
+
+	return true;
+}
+
+static uint FirstPS2Rate(ulong SamplingF)
+{
+	uint r = 0;
+
+	while (r + 1 < PS2_RATE_COUNT && PS2Rates[r + 1] >= SamplingF)
+		r++;
+
+	return r;
+}
+
+static double ResampleError(const short * Samples, ulong Count, ulong OldF, ulong NewF)
+{
+	short * Stored;
+	short * Restored;
+	ulong StoredCount;
+	ulong RestoredCount;
+	double Error = 0;
+
+	if (NewF >= OldF)
+		return 0;
+
+	Stored = ResampleSamples(Samples, Count, OldF, NewF, &StoredCount);
+	Restored = ResampleSamples(Stored, StoredCount, NewF, OldF, &RestoredCount);
+	for (ulong s = 0; s < Count && s < RestoredCount; s++)
+	{
+		double Diff = Restored[s] - Samples[s];
+		Error += Diff * Diff;
+	}
+
+	free(Stored);
+	free(Restored);
+
+	return Error;
+}
+
+void PlanSounds(const char * Dir, ulong Budget)	// Convert all WAVs in folder with sampling frequencies that fit into budget
+{
+	char (* Files)[PATH_LEN] = NULL;
+	sPlanAsset * Assets = NULL;
+	uint * FirstRates = NULL;
+	uint Count = 0;
+	ulong Total;
+	const char * Path;
+	char Extension[5];
+
+	// Rate sounds (folder is searched including subfolders)
+	DirIterInit(Dir);
+	while ((Path = DirIterGet()) != NULL)
+	{
+		short * Samples;
+		ulong SampleCount;
+		ulong SamplingF;
+		bool Looped;
+		ulong LoopStart;
+
+		FileGetExtension(Path, Extension, sizeof(Extension));
+		if (strcmp(Extension, ".wav") || strlen(Path) >= PATH_LEN)
+			continue;
+
+		Samples = LoadWAVSamples(Path, &SampleCount, &SamplingF, &Looped, &LoopStart);
+		if (Samples == NULL)
+		{
+			printf("%s: PCM WAV required ... \n", Path);
+			continue;
+		}
+
+		Files = (char (*)[PATH_LEN])realloc(Files, (Count + 1) * PATH_LEN);
+		Assets = (sPlanAsset *)realloc(Assets, (Count + 1) * sizeof(sPlanAsset));
+		FirstRates = (uint *)realloc(FirstRates, (Count + 1) * sizeof(uint));
+		if (Files == NULL || Assets == NULL || FirstRates == NULL)
+		{
+			puts("Can't allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		strcpy(Files[Count], Path);
+
+		// Every level is next lower sampling frequency, size is as after "unpatch"
+		FirstRates[Count] = FirstPS2Rate(SamplingF);
+		Assets[Count].Initialize();
+		for (uint r = FirstRates[Count]; r < PS2_RATE_COUNT; r++)
+		{
+			ulong DataSize = (ulong)((double)SampleCount * PS2Rates[r] / SamplingF);
+
+			Assets[Count].AddLevel(sizeof(sPS2WAVHeader) + DataSize + 16 - (DataSize + sizeof(sPS2WAVHeader)) % 16, ResampleError(Samples, SampleCount, SamplingF, PS2Rates[r]));
+		}
+		free(Samples);
+		Count++;
+	}
+	DirIterClose();
+	if (Count == 0)
+	{
+		puts("No sounds found.");
+		return;
+	}
+
+	// Pick sampling frequencies
+	if (PlanBudget(Assets, Count, Budget, &Total) == false)
+		printf("Budget can't be reached, lowest sampling frequencies are used \n");
+	for (uint i = 0; i < Count; i++)
+		printf("%s: %u Hz, %u bytes \n", Files[i], (uint)PS2Rates[FirstRates[i] + Assets[i].Level], (uint)Assets[i].Size[Assets[i].Level]);
+	printf("Planned: %u bytes, budget: %u bytes \n\n", (uint)Total, (uint)Budget);
+
+	// Convert
+	for (uint i = 0; i < Count; i++)
+	{
+		printf("Processing file: %s \n", Files[i]);
+		ConvertWAV(Files[i], PS2Rates[FirstRates[i] + Assets[i].Level]);
+	}
+
+	free(Files);
+	free(Assets);
+	free(FirstRates);
+}
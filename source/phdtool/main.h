@@ -17,7 +17,7 @@
 #include <ctype.h>		// tolower()
 
 ////////// Definitions //////////
-#define PROG_TITLE "\nPS2 HL decal (PHD) tool v1.3\n"
+#define PROG_TITLE "\nPS2 HL decal (PHD) tool v1.33\n"
 #define PROG_INFO "\
 Developed by supadupaplex, 2017-2021\n\
 License: BSD-3-Clause (check out license.txt)\n\
@@ -27,6 +27,8 @@ How to use:\n\
 1) Windows explorer - drag and drop PS2 HL Decal or PNG file on phdtool.exe\n\
 2) Command line/Batch - phdtool [file_name]\n\
 Optional: convert to PNG - phdtool topng [phd_file_name]\n\
+Optional: fit folder into budget - phdtool plan [folder] [budget in KB]\n\
+Optional: build decal PAK from folder or WAD3 - phdtool pak [folder or wad]\n\
 \n\
 For more info check out readme.txt\n\
 "
@@ -39,6 +41,9 @@ For more info check out readme.txt\n\
 #define PSI_INDEXED 2
 #define PSI_RGBA 5
 
+#define PAK_SEG_SIZE 0x800		// DECALS.PAK segment size (PS2 HL likes everything to be alligned)
+#define WAD_MIPTEX 0x43			// WAD3 lump type: texture with MIPs
+
 ////////// Zlib stuff //////////
 #include "zlib.h"
 #include <assert.h>
@@ -54,6 +59,18 @@ For more info check out readme.txt\n\
 // PNG Functions
 #include "pngtool.h"
 
+// Resampling
+#include "resample.h"
+
+// MIPs
+#include "mipmap.h"
+
+// Palette conversion
+#include "palette.h"
+
+// Stored size planner
+#include "sizeplan.h"
+
 ////////// Structures //////////
 
 // PS2 HL Decal header
@@ -189,4 +206,96 @@ struct sBMPHeader
 	}
 };
 
+// PS2 PAK header
+#pragma pack(1)
+struct sPAKHeader
+{
+	char Signature[4];		// "PACK" - signature
+	ulong TableOffset;		// Offset of file table (in bytes)
+	ulong TableSize;		// Size of file table (in bytes)
+
+	void Update(ulong NewTableOffset, ulong NewTableSize)
+	{
+		this->Signature[0] = 'P';
+		this->Signature[1] = 'A';
+		this->Signature[2] = 'C';
+		this->Signature[3] = 'K';
+		this->TableOffset = NewTableOffset;
+		this->TableSize = NewTableSize;
+	}
+};
+
+// PS2 PAK file table entry
+#pragma pack(1)
+struct sPAKFileEntry
+{
+	char FileName[56];			// File name
+	ulong FileOffset;			// File offset (in bytes)
+	ulong FileSize;				// File size (in bytes)
+
+	void Update(const char * NewFileName, ulong NewFileOffset, ulong NewFileSize)
+	{
+		memset(this, 0x00, sizeof(sPAKFileEntry));
+
+		snprintf(this->FileName, sizeof(FileName), "%s", NewFileName);
+		this->FileOffset = NewFileOffset;
+		this->FileSize = NewFileSize;
+	}
+};
+
+// WAD3 header
+#pragma pack(1)
+struct sWADHeader
+{
+	char Signature[4];		// "WAD3" signature
+	ulong LumpCount;		// Number of lumps
+	ulong TableOffset;		// Offset of lump table
+
+	void UpdateFromFile(FILE ** ptrFile)
+	{
+		FileReadBlock(ptrFile, this, 0, sizeof(sWADHeader));
+	}
+
+	bool Check()
+	{
+		if (this->Signature[0] == 'W' && this->Signature[1] == 'A' && this->Signature[2] == 'D' && this->Signature[3] == '3')
+			return true;
+		else
+			return false;
+	}
+};
+
+// WAD3 lump table entry
+#pragma pack(1)
+struct sWADLump
+{
+	ulong Offset;			// Lump offset
+	ulong DiskSize;			// Stored size
+	ulong Size;				// Uncompressed size
+	uchar Type;				// Lump type
+	uchar Compression;		// = 0 (no compression)
+	ushort Padding;
+	char Name[16];			// Lump name (may be not null terminated)
+
+	void UpdateFromFile(FILE ** ptrFile, ulong Address)
+	{
+		FileReadBlock(ptrFile, this, Address, sizeof(sWADLump));
+	}
+};
+
+// WAD3 texture header
+#pragma pack(1)
+struct sWADMipTex
+{
+	char Name[16];			// Texture name
+	ulong Width;			// Texture width (in pixels)
+	ulong Height;			// Texture height (in pixels)
+	ulong Offsets[4];		// Offsets of 4 MIPs (from start of this header), 8 bit palette follows the last one
+
+	void UpdateFromFile(FILE ** ptrFile, ulong Address)
+	{
+		FileReadBlock(ptrFile, this, Address, sizeof(sWADMipTex));
+	}
+};
+
 #endif // MAIN_H
@@ -1,2 +1,2 @@
-OBJS=$(COMOBJ)/fops.o $(COMOBJ)/pngtool.o $(OBJDIR)/phdtool.o
+OBJS=$(COMOBJ)/fops.o $(COMOBJ)/pngtool.o $(COMOBJ)/resample.o $(COMOBJ)/palmatch.o $(COMOBJ)/mipmap.o $(COMOBJ)/palette.o $(COMOBJ)/sizeplan.o $(OBJDIR)/phdtool.o
 LIBS=-L$(COMOBJ) -lz
@@ -10,102 +10,69 @@
 #include "main.h"
 
 ////////// Functions //////////
-bool ConvertPNGtoPHD(const char * FileName);
+bool ConvertPNGtoPHD(const char * FileName, uint Level);
 bool ConvertPHDtoPNG(const char * FileName);
 uint PSIProperSize(uint Size);
+uint PSIPlannedSize(uint Size, uint Level);
 void ScaleBitmap(uchar ** Bitmap, ulong * BitmapSize, uint OldWidth, uint OldHeight, uint NewWidth, uint NewHeight, bool Linear);
-int BilinearPixel(uchar * Bitmap, int Width, int Height, int NewWidth, int NewHeight, int nx, int ny);
-uchar LinFilter(uchar PxBegin, uchar PxEnd, float Ratio);
-uchar CreateMIPs(uchar ** Bitmap, ulong * BitmapSize, uint Width, uint Height);
 void PaletteFix(uchar * RGBAPalette, ulong RGBAPaletteSize, bool MulDiv);
-bool ConvertBMPtoPHD(const char * FileName, bool Linear);
+bool ConvertBMPtoPHD(const char * FileName, bool Linear, uint Level);
 bool ConvertPHDtoBMP(const char * FileName, bool Linear);
 void ConvertDecalPalette(uchar * RGBAPalette, ulong RGBAPaletteSize, bool ToBMP);
 void PaletteSwapRedAndGreen(uchar * RGBAPalette, ulong RGBAPaletteSize);
 void FlipBitmap(uchar ** Bitmap, ulong * BitmapSize, uint Width, uint Height);
+bool PlanDecal(const char * FileName, sPlanAsset * Asset);
+void PlanDecals(const char * Dir, ulong Budget);
+bool LoadBMPDecal(const char * FileName, uchar ** Bitmap, ulong * BitmapSize, uchar ** RGBAPalette, ulong * RGBAPaletteSize, uint * Width, uint * Height);
+bool LoadPNGDecal(const char * FileName, uchar ** Bitmap, ulong * BitmapSize, uchar ** RGBAPalette, ulong * RGBAPaletteSize, uint * Width, uint * Height);
+bool LoadWADDecal(FILE ** ptrWAD, const sWADLump * Lump, uchar ** Bitmap, ulong * BitmapSize, uchar ** RGBAPalette, ulong * RGBAPaletteSize, uint * Width, uint * Height);
+uchar * CreatePHD(uchar ** Bitmap, ulong * BitmapSize, uchar * RGBAPalette, ulong RGBAPaletteSize, uint Width, uint Height, const char * TexName, bool Linear, uint Level, ulong * PHDSize);
+void BuildDecalPAK(const char * Source);
 
 
-bool ConvertPNGtoPHD(const char * FileName)
+bool ConvertPNGtoPHD(const char * FileName, uint Level)
 {
-	FILE *ptrInputF;						// Input file
 	FILE *ptrOutputF;						// Output file
 
-	sPNGHeader PNGHeader;
-	sPHDHeader PHDHeader;
-	sPSIHeader PSIHeader;
-	uchar MIPCount;
-
-	sPNGData * PNGPalette;
-	sPNGData * PNGBitmap;
-	uchar BytesPerPixel;
-
-	char OutFile[PATH_LEN];
-	char TexName[64];
-
-	// Open file
-	SafeFileOpen(&ptrInputF, FileName, "rb");
-
-	// Read PNG header
-	PNGHeader.UpdateFromFile(&ptrInputF);
-	PNGHeader.SwapEndian();
-
-	// Check PNG header
-	if (PNGHeader.CheckType() == PNG_INDEXED)
-	{
-		printf("8-bit PNG \nParameters - Width: %i, Height: %i \n", PNGHeader.Width, PNGHeader.Height);
-		BytesPerPixel = 1;
-
-		// Prepare PSI palette
-		PNGPalette = PNGReadPalette(&ptrInputF);
-		PaletteFix(PNGPalette->Data, PNGPalette->DataSize, false);
-
-		// Prepare PSI bitmap
-		PNGBitmap = PNGReadBitmap(&ptrInputF, PNGHeader.Width, PNGHeader.Height, BytesPerPixel, PNGHeader.BitDepth);
-
-		// Resize bitmap to proper size
-		uint OriginalWidth = PNGHeader.Width;
-		uint OriginalHeight = PNGHeader.Height;
-		PNGHeader.Update(PSIProperSize(OriginalWidth), PSIProperSize(OriginalHeight), PNG_INDEXED);
-		ScaleBitmap(&PNGBitmap->Data, &PNGBitmap->DataSize, OriginalWidth, OriginalHeight, PSIProperSize(OriginalWidth), PSIProperSize(OriginalHeight), false);
-
-		// Create MIPs
-		MIPCount = CreateMIPs(&PNGBitmap->Data, &PNGBitmap->DataSize, PNGHeader.Width, PNGHeader.Height);
-
-		// Create output file
-		FileGetFullName(FileName, OutFile, sizeof(OutFile));
-		SafeFileOpen(&ptrOutputF, OutFile, "wb");
-
-		// Write PHD header
-		PHDHeader.Update();
-		FileWriteBlock(&ptrOutputF, &PHDHeader, sizeof(sPHDHeader));
+	uchar * RawBitmap;
+	ulong RawBitmapSize;
 
-		// Write PSI header
-		FileGetName(FileName, TexName, sizeof(TexName), false);
-		PSIHeader.Update(TexName, PNGHeader.Width, PNGHeader.Height, PSI_INDEXED, MIPCount);
-		PSIHeader.UpdateUpscaleTaget(OriginalWidth, OriginalHeight);
-		FileWriteBlock(&ptrOutputF, &PSIHeader, sizeof(sPSIHeader));
+	uchar * RGBAPalette;
+	ulong RGBAPaletteSize;
 
-		// Write PSI data
-		FileWriteBlock(&ptrOutputF, PNGPalette->Data, PNGPalette->DataSize);
-		FileWriteBlock(&ptrOutputF, PNGBitmap->Data, PNGBitmap->DataSize);
+	uint Width;
+	uint Height;
 
-		// Free memory
-		free(PNGBitmap->Data);
-		free(PNGPalette->Data);
+	uchar * PHD;
+	ulong PHDSize;
 
-		// Close files
-		fclose(ptrOutputF);
+	char OutFile[PATH_LEN];
+	char TexName[64];
 
-		puts("Done\n\n");
-	}
-	else
+	// Load PNG
+	if (LoadPNGDecal(FileName, &RawBitmap, &RawBitmapSize, &RGBAPalette, &RGBAPaletteSize, &Width, &Height) == false)
 	{
 		puts("8 bit PNG reqired ...");
 		return false;
 	}
+	printf("8-bit PNG \nParameters - Width: %i, Height: %i \n", Width, Height);
 
-	// Close files
-	fclose(ptrInputF);
+	// Convert (nearest resize - PNG palette is arbitrary)
+	FileGetName(FileName, TexName, sizeof(TexName), false);
+	PHD = CreatePHD(&RawBitmap, &RawBitmapSize, RGBAPalette, RGBAPaletteSize, Width, Height, TexName, false, Level, &PHDSize);
+
+	// Write output file
+	FileGetFullName(FileName, OutFile, sizeof(OutFile));
+	SafeFileOpen(&ptrOutputF, OutFile, "wb");
+	FileWriteBlock(&ptrOutputF, PHD, PHDSize);
+	fclose(ptrOutputF);
+
+	// Free memory
+	free(PHD);
+	free(RawBitmap);
+	free(RGBAPalette);
+
+	puts("Done\n\n");
 
 	return true;
 }
@@ -237,6 +204,13 @@ uint PSIProperSize(uint Size)	// Function returns closest proper dimension. PS2
 	}
 }
 
+uint PSIPlannedSize(uint Size, uint Level)	// Proper dimension lowered by size plan level (every level halves it)
+{
+	uint NewSize = PSIProperSize(Size) >> Level;
+
+	return NewSize < PSI_MIN_DIMENSION ? PSI_MIN_DIMENSION : NewSize;
+}
+
 void ScaleBitmap(uchar ** Bitmap, ulong * BitmapSize, uint OldWidth, uint OldHeight, uint NewWidth, uint NewHeight, bool Linear)
 {
 	uchar * NewBitmap;
@@ -254,28 +228,11 @@ void ScaleBitmap(uchar ** Bitmap, ulong * BitmapSize, uint OldWidth, uint OldHei
 	}
 
 	// Resize bitmap
-	if (Linear)
+	// Linear works only with BMP decals (palette is alpha ramp, so indices can be filtered), nearest always works
+	if (ResampleBitmap(*Bitmap, OldWidth, OldHeight, NewBitmap, NewWidth, NewHeight, 1, Linear ? RESAMPLE_BILINEAR : RESAMPLE_NEAREST) == false)
 	{
-		// Linear, works only with BMP decals
-		uchar * pPixel = NewBitmap;
-		for (uint NewY = 0; NewY < NewHeight; NewY++)
-			for (uint NewX = 0; NewX < NewWidth; NewX++)
-			{
-				*pPixel = BilinearPixel(*Bitmap, OldWidth, OldHeight, NewWidth, NewHeight, NewX, NewY);
-				pPixel++;
-			}
-	}
-	else
-	{
-		// Nearest, always works
-		for (uint NewY = 0; NewY < NewHeight; NewY++)
-			for (uint NewX = 0; NewX < NewWidth; NewX++)
-			{
-				uint OldY = (uint)round((double)NewY / (NewHeight - 1) * (OldHeight - 1));
-				uint OldX = (uint)round((double)NewX / (NewWidth - 1) * (OldWidth - 1));
-
-				NewBitmap[(NewWidth * NewY) + NewX] = (*Bitmap)[(OldWidth * OldY) + OldX];
-			}
+		UTIL_WAIT_KEY("Unable to resize bitmap ...");
+		exit(EXIT_FAILURE);
 	}
 
 	// Destroy old bitmap
@@ -288,248 +245,57 @@ void ScaleBitmap(uchar ** Bitmap, ulong * BitmapSize, uint OldWidth, uint OldHei
 	*BitmapSize = NewWidth * NewHeight;
 }
 
-// Args:
-// PxBegin [		/Ratio/  ] PxEnd; ratio is between 0.0 and 1.0
-// return - filtered value
-uchar LinFilter(uchar PxBegin, uchar PxEnd, float Ratio)
-{
-	// Check ratio
-	if (Ratio <= 0)
-		return PxBegin;
-	if (Ratio >= 1)
-		return PxEnd;
-
-	// Get result
-	return (uchar) roundf( Ratio*((float)PxEnd-(float)PxBegin) + (float)PxBegin );
-}
-
-// Args:
-// Bitmap, Width, Height - original bitmap pointer and dimensions
-// Width, Height - new bitmap dimensions
-// nx, ny - new bitmap pixel coordinates
-// return - index of new bitmap pixel
-#define CAP_VAL(VAL, MIN, MAX)	{ if (VAL > (MAX)) VAL = (MAX); else if (VAL < (MIN)) VAL = (MIN); }
-int BilinearPixel(uchar * Bitmap, int Width, int Height, int NewWidth, int NewHeight, int nx, int ny)
-{
-	// Calculate sample coordinates
-	float PxSzX = (float)Width / (float)NewWidth;
-	float PxSzY = (float)Height / (float)NewHeight;
-	float CoordX = PxSzX * ((float)nx + 0.5) - 0.5;
-	float CoordY = PxSzY * ((float)ny + 0.5) - 0.5;
-	CAP_VAL(CoordX, 0, Width-1);
-	CAP_VAL(CoordY, 0, Height-1);
-
-	// Collect pixels for filter
-	float RatioX, RatioY, IntX, IntY;
-	int Left, Top, Right, Bottom;
-	RatioX = modff(CoordX, &IntX);
-	RatioY = modff(CoordY, &IntY);
-	Right = Left = (int)IntX;
-	Bottom = Top = (int)IntY;
-	Right++;
-	Bottom++;
-	CAP_VAL(Right, 0, Width-1);
-	CAP_VAL(Bottom, 0, Height-1);
-
-	// Apply linear filter
-	uchar hSampleTop, hSampleBot;
-	int BaseTop = Width * Top;
-	int BaseBot = Width * Bottom;
-	hSampleTop = LinFilter(*(Bitmap+BaseTop+Left), *(Bitmap+BaseTop+Right), RatioX);
-	hSampleBot = LinFilter(*(Bitmap+BaseBot+Left), *(Bitmap+BaseBot+Right), RatioX);
-	return LinFilter(hSampleTop, hSampleBot, RatioY);
-}
-
-uchar CreateMIPs(uchar ** Bitmap, ulong * BitmapSize, uint Width, uint Height)			// Create MIPs for decal. Function overrides old bitmap and returns MIP count.
-{
-	uint a;
-	uint b;
-	uchar MIPCount;
-	ulong MIPSize;
-	uchar * NewBitmap;
-	ulong NewBitmapSize;
-	uchar * OldBitmap = *Bitmap;
-
-	// Check how many MIPs needed
-	a = Width;
-	b = Height;
-	MIPCount = 0;
-	MIPSize = 0;
-	while (a > 8 && b > 8)		// At least one side of smallest MIP should be less or equal 8
-	{
-		a /= 2;
-		b /= 2;
-		MIPSize += (a * b);
-		MIPCount++;
-	}
-
-	// Allocate memory for new bitmap
-	NewBitmapSize = *BitmapSize + MIPSize;
-	NewBitmap = (uchar *)malloc(NewBitmapSize);
-
-	// Actual MIP creation work
-	ulong Offset = 0;
-	for (int CurrentMIP = 0; CurrentMIP <= MIPCount; CurrentMIP++)
-	{
-		uint MIPWidth = Width >> CurrentMIP;
-		uint MIPHeight = Height >> CurrentMIP;
-
-		// Create MIP
-		for (int NewY = 0; NewY < MIPHeight; NewY++)
-		{
-			for (int NewX = 0; NewX < MIPWidth; NewX++)
-			{
-				int OldX = (int)round((double)NewX / (MIPWidth - 1) * (Width - 1));
-				int OldY = (int)round((double)NewY / (MIPHeight - 1) * (Height - 1));
-
-				NewBitmap[Offset + (MIPWidth * NewY) + NewX] = OldBitmap[(Width * OldY) + OldX];
-			}
-		}
-
-		// Calculate offset of new MIP
-		Offset += MIPHeight * MIPWidth;
-	}
-
-
-	// Destroy old bitmap
-	free(OldBitmap);
-
-	// Save pointer to new bitmap
-	*Bitmap = NewBitmap;
-	*BitmapSize = NewBitmapSize;
-
-	return MIPCount;
-}
-
 void PaletteFix(uchar * RGBAPalette, ulong RGBAPaletteSize,  bool MulDiv)			// Fix/unfix color table
 {
-	uchar Remainder;
-	uchar Temp;
-
-	// Reformat color table
-	uint PaletteElementSize = 4;
-	for (ulong i = 0; i < RGBAPaletteSize; i++)
-	{
-		Remainder = i % (0x20 * PaletteElementSize);
-
-		if (((0x10 * PaletteElementSize) <= Remainder) && (Remainder < (0x18 * PaletteElementSize)))
-		{
-			Temp = RGBAPalette[i];
-			RGBAPalette[i] = RGBAPalette[i - (0x08 * PaletteElementSize)];
-			RGBAPalette[i - (0x08 * PaletteElementSize)] = Temp;
-		}
-	}
-
-	// Multiply/Divide color table elements
-	for (ulong i = 0; i < RGBAPaletteSize; i++)
-	{
-		if (MulDiv == true)
-			RGBAPalette[i] *= 2;
-		else
-			RGBAPalette[i] /= 2;
-	}
+	if (MulDiv == true)
+		PaletteTranscode(RGBAPalette, RGBAPaletteSize, 4, PAL_SWIZZLE | PAL_COLOR_MUL | PAL_ALPHA_MUL);
+	else
+		PaletteTranscode(RGBAPalette, RGBAPaletteSize, 4, PAL_SWIZZLE | PAL_COLOR_DIV | PAL_ALPHA_DIV);
 }
 
-bool ConvertBMPtoPHD(const char * FileName, bool Linear)
+bool ConvertBMPtoPHD(const char * FileName, bool Linear, uint Level)
 {
-	FILE *ptrInputF;						// Input file
 	FILE *ptrOutputF;						// Output file
 
-	sBMPHeader BMPHeader;
-	sPHDHeader PHDHeader;
-	sPSIHeader PSIHeader;
-	uchar MIPCount;
-
 	uchar * RawBitmap;
 	ulong RawBitmapSize;
 
 	uchar * RGBAPalette;
 	ulong RGBAPaletteSize;
 
-	char OutFile[PATH_LEN];
-	char TexName[64];
-
-	// Open file
-	SafeFileOpen(&ptrInputF, FileName, "rb");
-
-	// Read BMP header
-	BMPHeader.UpdateFromFile(&ptrInputF);
+	uint Width;
+	uint Height;
 
-	// Check BMP header
-	if (BMPHeader.Check() == true)
-	{
-		printf("8-bit BMP \nParameters - Width: %i, Height: %i \n", BMPHeader.Width, BMPHeader.Height);
+	uchar * PHD;
+	ulong PHDSize;
 
-		// Prepare PSI palette
-		RGBAPaletteSize = 0x400;
-		RGBAPalette = (uchar *)malloc(RGBAPaletteSize);
-		if (RGBAPalette == NULL)
-		{
-			puts("Unable to allocate memory! \n");
-			exit(EXIT_FAILURE);
-		}
-		FileReadBlock(&ptrInputF, RGBAPalette, sizeof(sBMPHeader), RGBAPaletteSize);
-		PaletteSwapRedAndGreen(RGBAPalette, RGBAPaletteSize);
-
-		// Prepare PSI bitmap
-		RawBitmapSize = BMPHeader.Height * BMPHeader.Width;
-		RawBitmap = (uchar *)malloc(RawBitmapSize);
-		if (RawBitmap == NULL)
-		{
-			puts("Unable to allocate memory! \n");
-			exit(EXIT_FAILURE);
-		}
-		FileReadBlock(&ptrInputF, RawBitmap, sizeof(sBMPHeader) + RGBAPaletteSize, RawBitmapSize);
-		FlipBitmap(&RawBitmap, &RawBitmapSize, BMPHeader.Width, BMPHeader.Height);
-
-		// Fix palette
-		ConvertDecalPalette(RGBAPalette, RGBAPaletteSize, false);
-		PaletteFix(RGBAPalette, RGBAPaletteSize, false);
-
-		// Resize bitmap to proper size
-		uint OriginalWidth = BMPHeader.Width;
-		uint OriginalHeight = BMPHeader.Height;
-		BMPHeader.Update(PSIProperSize(OriginalWidth), PSIProperSize(OriginalHeight));
-		ScaleBitmap(&RawBitmap, &RawBitmapSize, OriginalWidth, OriginalHeight, PSIProperSize(OriginalWidth), PSIProperSize(OriginalHeight), Linear);
-
-		// Create MIPs
-		MIPCount = CreateMIPs(&RawBitmap, &RawBitmapSize, BMPHeader.Width, BMPHeader.Height);
-
-		// Create output file
-		FileGetFullName(FileName, OutFile, sizeof(OutFile));
-		SafeFileOpen(&ptrOutputF, OutFile, "wb");
-
-		// Write PHD header
-		PHDHeader.Update();
-		FileWriteBlock(&ptrOutputF, &PHDHeader, sizeof(sPHDHeader));
-
-		// Write PSI header
-		FileGetName(FileName, TexName, sizeof(TexName), false);
-		PSIHeader.Update(TexName, BMPHeader.Width, BMPHeader.Height, PSI_INDEXED, MIPCount);
-		PSIHeader.UpdateUpscaleTaget(OriginalWidth, OriginalHeight);
-		FileWriteBlock(&ptrOutputF, &PSIHeader, sizeof(sPSIHeader));
-
-		// Write PSI data
-		FileWriteBlock(&ptrOutputF, RGBAPalette, RGBAPaletteSize);
-		FileWriteBlock(&ptrOutputF, RawBitmap, RawBitmapSize);
-
-		// Free memory
-		free(RGBAPalette);
-		free(RawBitmap);
-
-		// Close files
-		fclose(ptrOutputF);
+	char OutFile[PATH_LEN];
+	char TexName[64];
 
-		puts("Done\n\n");
-	}
-	else
+	// Load BMP
+	if (LoadBMPDecal(FileName, &RawBitmap, &RawBitmapSize, &RGBAPalette, &RGBAPaletteSize, &Width, &Height) == false)
 	{
 		puts("8 bit BMP reqired ...");
 		return false;
 	}
+	printf("8-bit BMP \nParameters - Width: %i, Height: %i \n", Width, Height);
 
-	// Close files
-	fclose(ptrInputF);
+	// Convert
+	FileGetName(FileName, TexName, sizeof(TexName), false);
+	PHD = CreatePHD(&RawBitmap, &RawBitmapSize, RGBAPalette, RGBAPaletteSize, Width, Height, TexName, Linear, Level, &PHDSize);
+
+	// Write output file
+	FileGetFullName(FileName, OutFile, sizeof(OutFile));
+	SafeFileOpen(&ptrOutputF, OutFile, "wb");
+	FileWriteBlock(&ptrOutputF, PHD, PHDSize);
+	fclose(ptrOutputF);
+
+	// Free memory
+	free(PHD);
+	free(RGBAPalette);
+	free(RawBitmap);
+
+	puts("Done\n\n");
 
 	return true;
 }
@@ -711,16 +477,439 @@ void ConvertDecalPalette(uchar * RGBAPalette, ulong RGBAPaletteSize, bool ToBMP)
 
 void PaletteSwapRedAndGreen(uchar * RGBAPalette, ulong RGBAPaletteSize)
 {
-	uchar Temp;
+	PaletteTranscode(RGBAPalette, EIGHT_BIT_PALETTE_ELEMENTS_COUNT * 4, 4, PAL_SWAP_RB);
+}
 
-	uchar PaletteElementSize = 4;
-	for (uint Element = 0; Element < EIGHT_BIT_PALETTE_ELEMENTS_COUNT; Element++)
+bool LoadBMPDecal(const char * FileName, uchar ** Bitmap, ulong * BitmapSize, uchar ** RGBAPalette, ulong * RGBAPaletteSize, uint * Width, uint * Height)	// Load 8 bit BMP decal: top-down bitmap and PHD-like palette (in original order)
+{
+	FILE *ptrInputF;						// Input file
+	sBMPHeader BMPHeader;
+
+	// Open file and check BMP header
+	SafeFileOpen(&ptrInputF, FileName, "rb");
+	BMPHeader.UpdateFromFile(&ptrInputF);
+	if (BMPHeader.Check() == false)
+	{
+		fclose(ptrInputF);
+		return false;
+	}
+	*Width = BMPHeader.Width;
+	*Height = BMPHeader.Height;
+
+	// Prepare PSI palette
+	*RGBAPaletteSize = 0x400;
+	*RGBAPalette = (uchar *)malloc(*RGBAPaletteSize);
+	if (*RGBAPalette == NULL)
 	{
-		// Swap 1-st and 3-rd bytes in color table element
-		Temp = RGBAPalette[Element * PaletteElementSize];
-		RGBAPalette[Element * PaletteElementSize] = RGBAPalette[Element * PaletteElementSize + 2];
-		RGBAPalette[Element * PaletteElementSize + 2] = Temp;
+		puts("Unable to allocate memory! \n");
+		exit(EXIT_FAILURE);
 	}
+	FileReadBlock(&ptrInputF, *RGBAPalette, sizeof(sBMPHeader), *RGBAPaletteSize);
+	PaletteSwapRedAndGreen(*RGBAPalette, *RGBAPaletteSize);
+
+	// Prepare PSI bitmap
+	*BitmapSize = (*Height) * (*Width);
+	*Bitmap = (uchar *)malloc(*BitmapSize);
+	if (*Bitmap == NULL)
+	{
+		puts("Unable to allocate memory! \n");
+		exit(EXIT_FAILURE);
+	}
+	FileReadBlock(&ptrInputF, *Bitmap, sizeof(sBMPHeader) + *RGBAPaletteSize, *BitmapSize);
+	FlipBitmap(Bitmap, BitmapSize, *Width, *Height);
+	fclose(ptrInputF);
+
+	// Fix palette
+	ConvertDecalPalette(*RGBAPalette, *RGBAPaletteSize, false);
+
+	return true;
+}
+
+bool LoadPNGDecal(const char * FileName, uchar ** Bitmap, ulong * BitmapSize, uchar ** RGBAPalette, ulong * RGBAPaletteSize, uint * Width, uint * Height)	// Load 8 bit PNG decal: bitmap and palette (in original order)
+{
+	FILE *ptrInputF;						// Input file
+	sPNGHeader PNGHeader;
+	sPNGData * PNGPalette;
+	sPNGData * PNGBitmap;
+
+	// Open file and check PNG header
+	SafeFileOpen(&ptrInputF, FileName, "rb");
+	PNGHeader.UpdateFromFile(&ptrInputF);
+	PNGHeader.SwapEndian();
+	if (PNGHeader.CheckType() != PNG_INDEXED)
+	{
+		fclose(ptrInputF);
+		return false;
+	}
+	*Width = PNGHeader.Width;
+	*Height = PNGHeader.Height;
+
+	// Prepare PSI palette and bitmap
+	PNGPalette = PNGReadPalette(&ptrInputF);
+	PNGBitmap = PNGReadBitmap(&ptrInputF, PNGHeader.Width, PNGHeader.Height, 1, PNGHeader.BitDepth);
+	fclose(ptrInputF);
+
+	*RGBAPalette = PNGPalette->Data;
+	*RGBAPaletteSize = PNGPalette->DataSize;
+	*Bitmap = PNGBitmap->Data;
+	*BitmapSize = PNGBitmap->DataSize;
+	free(PNGPalette);
+	free(PNGBitmap);
+
+	return true;
+}
+
+bool LoadWADDecal(FILE ** ptrWAD, const sWADLump * Lump, uchar ** Bitmap, ulong * BitmapSize, uchar ** RGBAPalette, ulong * RGBAPaletteSize, uint * Width, uint * Height)	// Load decal from WAD3 lump: bitmap and PHD-like palette (in original order)
+{
+	sWADMipTex MipTex;
+	uchar RGBPalette[EIGHT_BIT_PALETTE_ELEMENTS_COUNT * 3];
+	ulong PaletteOffset;
+
+	// Check lump
+	if (Lump->Type != WAD_MIPTEX || Lump->Compression != 0 || Lump->DiskSize < sizeof(sWADMipTex))
+		return false;
+	MipTex.UpdateFromFile(ptrWAD, Lump->Offset);
+	PaletteOffset = MipTex.Offsets[3] + (MipTex.Width / 8) * (MipTex.Height / 8) + sizeof(ushort);
+	if (MipTex.Width == 0 || MipTex.Height == 0 || MipTex.Offsets[0] + MipTex.Width * MipTex.Height > Lump->DiskSize || PaletteOffset + sizeof(RGBPalette) > Lump->DiskSize)
+		return false;
+	*Width = MipTex.Width;
+	*Height = MipTex.Height;
+
+	// Prepare PSI bitmap (biggest MIP, WAD bitmaps are stored top-down already)
+	*BitmapSize = (*Height) * (*Width);
+	*Bitmap = (uchar *)malloc(*BitmapSize);
+	if (*Bitmap == NULL)
+	{
+		puts("Unable to allocate memory! \n");
+		exit(EXIT_FAILURE);
+	}
+	FileReadBlock(ptrWAD, *Bitmap, Lump->Offset + MipTex.Offsets[0], *BitmapSize);
+
+	// Prepare PSI palette (24 bit palette follows the smallest MIP)
+	*RGBAPaletteSize = 0x400;
+	*RGBAPalette = (uchar *)malloc(*RGBAPaletteSize);
+	if (*RGBAPalette == NULL)
+	{
+		puts("Unable to allocate memory! \n");
+		exit(EXIT_FAILURE);
+	}
+	FileReadBlock(ptrWAD, RGBPalette, Lump->Offset + PaletteOffset, sizeof(RGBPalette));
+	for (uint i = 0; i < EIGHT_BIT_PALETTE_ELEMENTS_COUNT; i++)
+	{
+		(*RGBAPalette)[i * 4 + 0] = RGBPalette[i * 3 + 0];
+		(*RGBAPalette)[i * 4 + 1] = RGBPalette[i * 3 + 1];
+		(*RGBAPalette)[i * 4 + 2] = RGBPalette[i * 3 + 2];
+		(*RGBAPalette)[i * 4 + 3] = 0x00;
+	}
+
+	// Fix palette (the same layout as in BMP decals: index is alpha, the last entry is decal color)
+	ConvertDecalPalette(*RGBAPalette, *RGBAPaletteSize, false);
+
+	return true;
+}
+
+uchar * CreatePHD(uchar ** Bitmap, ulong * BitmapSize, uchar * RGBAPalette, ulong RGBAPaletteSize, uint Width, uint Height, const char * TexName, bool Linear, uint Level, ulong * PHDSize)	// Convert loaded decal to PHD in memory
+{
+	sPHDHeader PHDHeader;
+	sPSIHeader PSIHeader;
+	uchar MIPCount;
+	uchar * PHD;
+
+	uint NewWidth = PSIPlannedSize(Width, Level);
+	uint NewHeight = PSIPlannedSize(Height, Level);
+
+	// Resize bitmap to proper size
+	ScaleBitmap(Bitmap, BitmapSize, Width, Height, NewWidth, NewHeight, Linear);
+
+	// Create MIPs (palette should be in original order)
+	MIPCount = MIPCreateIndexed(Bitmap, BitmapSize, NewWidth, NewHeight, RGBAPalette, RGBAPaletteSize, PSI_MIN_DIMENSION, MIP_FILTER_GAMMA);
+	PaletteFix(RGBAPalette, RGBAPaletteSize, false);
+
+	// Prepare headers
+	PHDHeader.Update();
+	PSIHeader.Update(TexName, NewWidth, NewHeight, PSI_INDEXED, MIPCount);
+	PSIHeader.UpdateUpscaleTaget(Width, Height);
+
+	// Assemble PHD
+	*PHDSize = sizeof(sPHDHeader) + sizeof(sPSIHeader) + RGBAPaletteSize + *BitmapSize;
+	PHD = (uchar *)malloc(*PHDSize);
+	if (PHD == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(PHD, &PHDHeader, sizeof(sPHDHeader));
+	memcpy(PHD + sizeof(sPHDHeader), &PSIHeader, sizeof(sPSIHeader));
+	memcpy(PHD + sizeof(sPHDHeader) + sizeof(sPSIHeader), RGBAPalette, RGBAPaletteSize);
+	memcpy(PHD + sizeof(sPHDHeader) + sizeof(sPSIHeader) + RGBAPaletteSize, *Bitmap, *BitmapSize);
+
+	return PHD;
+}
+
+void BuildDecalPAK(const char * Source)	// Convert all decals from folder of BMP/PNG or from WAD3 and pack them into PAK without intermediate files
+{
+	FILE *ptrInputF = NULL;					// Input WAD
+	FILE *ptrOutputF;						// Output PAK
+
+	sWADHeader WADHeader;
+	sWADLump WADLump;
+	sPAKHeader PAKHeader;
+	sPAKFileEntry * Table = NULL;
+	uint Count = 0;
+	ulong Offset;
+	bool FromWAD;
+
+	uchar * RawBitmap;
+	ulong RawBitmapSize;
+	uchar * RGBAPalette;
+	ulong RGBAPaletteSize;
+	uint Width;
+	uint Height;
+	bool Linear;
+	bool Loaded;
+
+	uchar * PHD;
+	ulong PHDSize;
+	uchar Padding[PAK_SEG_SIZE];
+
+	const char * Path;
+	char Extension[5];
+	char Name[PATH_LEN];
+	char TexName[64];
+	char OutFile[PATH_LEN];
+
+	// Open source
+	FromWAD = !CheckDir(Source);
+	if (FromWAD == true)
+	{
+		SafeFileOpen(&ptrInputF, Source, "rb");
+		WADHeader.UpdateFromFile(&ptrInputF);
+		if (WADHeader.Check() == false)
+		{
+			puts("Folder or WAD3 file required ... \n");
+			fclose(ptrInputF);
+			return;
+		}
+		FileGetFullName(Source, OutFile, sizeof(OutFile));
+	}
+	else
+	{
+		snprintf(OutFile, sizeof(OutFile), "%s", Source);
+		DirIterInit(Source);
+	}
+	if (strlen(OutFile) + strlen(".PAK") >= sizeof(OutFile))
+	{
+		puts("Path is too long ... \n");
+		if (FromWAD == true)
+			fclose(ptrInputF);
+		else
+			DirIterClose();
+		return;
+	}
+	strcat(OutFile, ".PAK");
+
+	// Reserve space for PAK header, file table is written after data
+	memset(Padding, 0x00, sizeof(Padding));
+	SafeFileOpen(&ptrOutputF, OutFile, "wb");
+	FileWriteBlock(&ptrOutputF, Padding, PAK_SEG_SIZE);
+	Offset = PAK_SEG_SIZE;
+
+	// Convert decals one by one and stream them into PAK
+	for (uint i = 0; ; i++)
+	{
+		if (FromWAD == true)
+		{
+			if (i >= WADHeader.LumpCount)
+				break;
+
+			WADLump.UpdateFromFile(&ptrInputF, WADHeader.TableOffset + i * sizeof(sWADLump));
+			snprintf(Name, sizeof(Name), "%.*s", (int)sizeof(WADLump.Name), WADLump.Name);
+			Linear = true;
+			Loaded = LoadWADDecal(&ptrInputF, &WADLump, &RawBitmap, &RawBitmapSize, &RGBAPalette, &RGBAPaletteSize, &Width, &Height);
+		}
+		else
+		{
+			if ((Path = DirIterGet()) == NULL)
+				break;
+
+			FileGetExtension(Path, Extension, sizeof(Extension));
+			if (strcmp(Extension, ".bmp") && strcmp(Extension, ".png"))
+				continue;
+
+			// PAK name is path inside folder without extension (as if decals were converted in place and folder was packed)
+			snprintf(Name, sizeof(Name), "%s", Path + strlen(Source) + 1);
+			Name[strlen(Name) - strlen(Extension)] = '\0';
+			PatchSlashes(Name, sizeof(Name), false);
+			Linear = !strcmp(Extension, ".bmp");
+			if (Linear == true)
+				Loaded = LoadBMPDecal(Path, &RawBitmap, &RawBitmapSize, &RGBAPalette, &RGBAPaletteSize, &Width, &Height);
+			else
+				Loaded = LoadPNGDecal(Path, &RawBitmap, &RawBitmapSize, &RGBAPalette, &RGBAPaletteSize, &Width, &Height);
+		}
+		if (Loaded == false)
+		{
+			printf("%s: 8 bit decal required ... \n", Name);
+			continue;
+		}
+		if (strlen(Name) >= sizeof(Table[0].FileName))
+		{
+			printf("%s: name is too long ... \n", Name);
+			free(RawBitmap);
+			free(RGBAPalette);
+			continue;
+		}
+
+		// Convert
+		FileGetName(Name, TexName, sizeof(TexName), false);
+		PHD = CreatePHD(&RawBitmap, &RawBitmapSize, RGBAPalette, RGBAPaletteSize, Width, Height, TexName, Linear, 0, &PHDSize);
+		printf("Packing decal #%u: %s \nParameters - Width: %i, Height: %i, Size: %i \n", Count + 1, Name, Width, Height, (int)PHDSize);
+
+		// Write aligned data
+		FileWriteBlock(&ptrOutputF, PHD, PHDSize);
+		if (PHDSize % PAK_SEG_SIZE)
+			FileWriteBlock(&ptrOutputF, Padding, PAK_SEG_SIZE - PHDSize % PAK_SEG_SIZE);
+
+		// Add file entry
+		Table = (sPAKFileEntry *)realloc(Table, (Count + 1) * sizeof(sPAKFileEntry));
+		if (Table == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		Table[Count].Update(Name, Offset, PHDSize);
+		Offset += (PHDSize + PAK_SEG_SIZE - 1) / PAK_SEG_SIZE * PAK_SEG_SIZE;
+		Count++;
+
+		// Free memory
+		free(PHD);
+		free(RawBitmap);
+		free(RGBAPalette);
+	}
+	if (FromWAD == true)
+		fclose(ptrInputF);
+	else
+		DirIterClose();
+
+	// Write file table and header
+	PAKHeader.Update(Offset, Count * sizeof(sPAKFileEntry));
+	if (Count > 0)
+		FileWriteBlock(&ptrOutputF, Table, Count * sizeof(sPAKFileEntry));
+	FileWriteBlock(&ptrOutputF, &PAKHeader, 0, sizeof(sPAKHeader));
+	fclose(ptrOutputF);
+	free(Table);
+
+	printf("\n%u decal(s) are packed into %s \n\n", Count, OutFile);
+}
+
+bool PlanDecal(const char * FileName, sPlanAsset * Asset)	// Rate stored sizes of BMP/PNG decal for size plan
+{
+	char Extension[5];
+	uchar * RawBitmap;
+	ulong RawBitmapSize;
+	uchar * RGBAPalette;
+	ulong RGBAPaletteSize;
+	uint Width;
+	uint Height;
+	bool Loaded;
+
+	// Load bitmap and palette in the same way as conversion does
+	FileGetExtension(FileName, Extension, sizeof(Extension));
+	if (!strcmp(Extension, ".png"))
+		Loaded = LoadPNGDecal(FileName, &RawBitmap, &RawBitmapSize, &RGBAPalette, &RGBAPaletteSize, &Width, &Height);
+	else
+		Loaded = LoadBMPDecal(FileName, &RawBitmap, &RawBitmapSize, &RGBAPalette, &RGBAPaletteSize, &Width, &Height);
+	if (Loaded == false)
+		return false;
+
+	// Decal as it looks in game
+	uchar * RGBA = (uchar *)malloc(Width * Height * 4);
+	if (RGBA == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	for (ulong p = 0; p < Width * Height; p++)
+		memcpy(&RGBA[p * 4], &RGBAPalette[RawBitmap[p] * 4], 4);
+
+	// Rate every level until both sides are minimal
+	Asset->Initialize();
+	for (uint l = 0; l < PLAN_MAX_LEVELS; l++)
+	{
+		uint NewWidth = PSIPlannedSize(Width, l);
+		uint NewHeight = PSIPlannedSize(Height, l);
+		ulong MIPSize;
+
+		if (l > 0 && NewWidth == PSIPlannedSize(Width, l - 1) && NewHeight == PSIPlannedSize(Height, l - 1))
+			break;
+
+		MIPCount(NewWidth, NewHeight, PSI_MIN_DIMENSION, &MIPSize);
+		Asset->AddLevel(sizeof(sPHDHeader) + sizeof(sPSIHeader) + EIGHT_BIT_PALETTE_ELEMENTS_COUNT * 4 + NewWidth * NewHeight + MIPSize, PlanImageError(RGBA, Width, Height, NewWidth, NewHeight));
+	}
+
+	free(RGBA);
+	free(RawBitmap);
+	free(RGBAPalette);
+
+	return true;
+}
+
+void PlanDecals(const char * Dir, ulong Budget)	// Convert all BMP/PNG decals in folder with stored sizes that fit into budget
+{
+	char (* Files)[PATH_LEN] = NULL;
+	sPlanAsset * Assets = NULL;
+	uint Count = 0;
+	ulong Total;
+	const char * Path;
+	char Extension[5];
+
+	// Rate decals (folder is searched including subfolders)
+	DirIterInit(Dir);
+	while ((Path = DirIterGet()) != NULL)
+	{
+		FileGetExtension(Path, Extension, sizeof(Extension));
+		if ((strcmp(Extension, ".bmp") && strcmp(Extension, ".png")) || strlen(Path) >= PATH_LEN)
+			continue;
+
+		Files = (char (*)[PATH_LEN])realloc(Files, (Count + 1) * PATH_LEN);
+		Assets = (sPlanAsset *)realloc(Assets, (Count + 1) * sizeof(sPlanAsset));
+		if (Files == NULL || Assets == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		strcpy(Files[Count], Path);
+		if (PlanDecal(Files[Count], &Assets[Count]) == true)
+			Count++;
+		else
+			printf("%s: 8 bit image required ... \n", Path);
+	}
+	DirIterClose();
+	if (Count == 0)
+	{
+		puts("No decals found.");
+		return;
+	}
+
+	// Pick sizes
+	if (PlanBudget(Assets, Count, Budget, &Total) == false)
+		printf("Budget can't be reached, smallest sizes are used \n");
+	for (uint i = 0; i < Count; i++)
+		printf("%s: level %u, %u bytes \n", Files[i], Assets[i].Level, (uint)Assets[i].Size[Assets[i].Level]);
+	printf("Planned: %u bytes, budget: %u bytes \n\n", (uint)Total, (uint)Budget);
+
+	// Convert
+	for (uint i = 0; i < Count; i++)
+	{
+		printf("Processing file: %s \n", Files[i]);
+		FileGetExtension(Files[i], Extension, sizeof(Extension));
+		if (!strcmp(Extension, ".png"))
+			ConvertPNGtoPHD(Files[i], Assets[i].Level);
+		else
+			ConvertBMPtoPHD(Files[i], true, Assets[i].Level);
+	}
+
+	free(Files);
+	free(Assets);
 }
 
 int main(int argc, char * argv[])
@@ -744,14 +933,14 @@ int main(int argc, char * argv[])
 		printf("Processing file: %s \n", argv[1]);
 		if (!strcmp(Extension, ".png"))				// Convert PNG to PS2 HL Decal
 		{
-			if (ConvertPNGtoPHD(argv[1]) == true)
+			if (ConvertPNGtoPHD(argv[1], 0) == true)
 				return 0;
 			else
 				puts("Can't convert decal ... \n");
 		}
 		else if (!strcmp(Extension, ".bmp"))		// Convert BMP to PS2 HL Decal
 		{
-			if (ConvertBMPtoPHD(argv[1], true) == true)
+			if (ConvertBMPtoPHD(argv[1], true, 0) == true)
 				return 0;
 			else
 				puts("Can't convert decal ... \n");
@@ -775,11 +964,28 @@ int main(int argc, char * argv[])
 			else
 				puts("Can't convert decal ... \n");
 		}
+		else if (!strcmp(argv[1], "pak"))
+		{
+			BuildDecalPAK(argv[2]);								// Convert decals and pack them into PAK
+			return 0;
+		}
 		else
 		{
 			puts("Wrong arguments ... \n");
 		}
 	}
+	else if (argc == 4 && !strcmp(argv[1], "plan"))
+	{
+		if (CheckDir(argv[2]) == false)
+			puts("Folder required ... \n");
+		else if (atoi(argv[3]) <= 0)
+			puts("Wrong budget ... \n");
+		else
+		{
+			PlanDecals(argv[2], atoi(argv[3]) * 1024);
+			return 0;
+		}
+	}
 	else
 	{
 		puts("Too many arguments ... \n");
@@ -10,14 +10,14 @@
 
 ////////// Includes //////////
 #include <stdio.h>		// puts(), printf(), snprintf()
-#include <string.h>		// strcpy(), strcat(), strlen(), strncpy()
+#include <string.h>		// strcpy(), strcat(), strlen(), strncpy(), strchr()
 #include <malloc.h>		// malloc(), free()
-#include <stdlib.h>		// exit()
+#include <stdlib.h>		// exit(), strtoul()
 #include <math.h>		// floor(), ceil()
 #include <ctype.h>		// tolower()
 
 ////////// Definitions //////////
-#define PROG_TITLE "\nPS2 HL image tool v1.21\n\n"
+#define PROG_TITLE "\nPS2 HL image tool v1.24\n\n"
 #define PROG_INFO "\
 Developed by supadupaplex, 2017-2021\n\
 License: BSD-3-Clause (check out license.txt)\n\
@@ -25,7 +25,8 @@ Zlib library is used to perform deflate/inflate operations\n\
 \n\
 How to use:\n\
 1) Windows explorer - drag and drop image file on psitool.exe\n\
-2) Command line/Batch - psitool [image_file_name]\n\
+2) Command line/Batch - psitool (mip) (quant|dither) [image_file_name]\n\
+3) Convert all fonts (*.INF + *.PNG) in folder - psitool fonts [folder]\n\
 \n\
 For more info check out readme.txt \n\
 "
@@ -34,6 +35,7 @@ For more info check out readme.txt \n\
 #define PSI_UNKNOWN 0
 #define PSI_INDEXED 2
 #define PSI_RGBA 5
+#define PSI_MIN_DIMENSION 8
 
 ////////// Zlib stuff //////////
 #include "zlib.h"
@@ -50,6 +52,15 @@ For more info check out readme.txt \n\
 // PNG Functions
 #include "pngtool.h"
 
+// MIPs
+#include "mipmap.h"
+
+// Color reduction
+#include "quantize.h"
+
+// Palette conversion
+#include "palette.h"
+
 ////////// Structures //////////
 
 // *.psi image header
@@ -58,7 +69,7 @@ struct sPSIHeader
 {
 	char Name[16];		// Internal name
 	uchar Magic[3];		// Filled with zeroes in most cases
-	uchar LODCount;		// Number of MIPs (used in decals only)
+	uchar LODCount;		// Number of MIPs (used in decals, optional for other images)
 	ulong Type;			// 2 - 8 bit indexed bitmap, 5 - 32 bit RGBA bitmap
 	ushort Width1;		// Texture width (in pixels)
 	ushort Height1;		// Textre Height (in pixels)
@@ -101,6 +112,7 @@ struct sPSIHeader
 #define PSF_BMP_H 256
 #define PSF_BMP_SZ (PSF_BMP_W * PSF_BMP_H)
 #define PSF_PLTE_SZ (256 * 4)
+#define PSF_SYM_H 25
 #define PSF_SZ (sizeof(sPSFHeader) + PSF_BMP_SZ + PSF_PLTE_SZ)
 #pragma pack(1)
 struct sPSFSymEntry
@@ -138,45 +150,103 @@ struct sPSFHeader
 		return false;
 	}
 
-	void ReadSymbols(FILE ** ptrFile)
+	bool ReadSymbols(FILE ** ptrFile)
 	{
-		char Buf[128];
-		int Line;
-		unsigned int s, x, y, w;
+		char * Text;
+		char * Pos;
+		char * End;
+		ulong TextSize;
+		bool Defined[PSF_SYMBOLS];
+		bool Good = true;
+		unsigned long Value[4];
 
 		// (Re)init self
 		Init();
+		memset(Defined, 0x00, sizeof(Defined));
+
+		// Read whole table at once
+		TextSize = FileSize(ptrFile);
+		UTIL_MALLOC(char *, Text, TextSize + 1, exit(EXIT_FAILURE));
+		FileReadBlock(ptrFile, Text, 0, TextSize);
+		Text[TextSize] = '\0';
 
-		// Read symbols
-		Line = 0;
-		while (!feof(*ptrFile))
+		// Parse lines: "code X Y width", everything after '#' is comment
+		Pos = Text;
+		for (int Line = 1; *Pos != '\0'; Line++)
 		{
-			// Get line
-			fgets(Buf, sizeof(Buf), *ptrFile);
+			char * LineEnd = strchr(Pos, '\n');
+			char * Comment;
+			int v;
 
-			// Skip empty lines
-			if (Buf[0] == '\0' || Buf[0] == '#')
-				continue;
+			if (LineEnd != NULL)
+				*LineEnd = '\0';
+			if ((Comment = strchr(Pos, '#')) != NULL)
+				*Comment = '\0';
 
-			// Read symbol
-			s = x = y = w = 256;
-			sscanf(Buf, "%u %u %u %u ", &s, &x, &y, &w);
-			UTIL_MSG_DEBUG("Read symbol: %u %u %u %u\n", s, x, y, w);
+			// Read values (empty lines are skipped)
+			for (v = 0; v < 4; v++)
+			{
+				Value[v] = strtoul(Pos, &End, 10);
+				if (End == Pos)
+					break;
+				Pos = End;
+			}
+			while (*Pos == ' ' || *Pos == '\t' || *Pos == '\r')
+				Pos++;
+			if (v == 0 && *Pos == '\0')
+			{
+				Pos = (LineEnd != NULL) ? LineEnd + 1 : Pos;
+				continue;
+			}
+			UTIL_MSG_DEBUG("Read symbol: %lu %lu %lu %lu\n", Value[0], Value[1], Value[2], Value[3]);
 
 			// Check
-			if (s > 255 || x > 255 || y > 255 || w > 255)
+			if (v < 4 || *Pos != '\0' || Value[0] > 255 || Value[1] > 255 || Value[2] > 255 || Value[3] > 255)
 			{
-				UTIL_MSG_ERR("Bad line %d: \"%s\"\n", Line, Buf);
-				continue;
+				UTIL_MSG_ERR("Bad line %d", Line);
+				Good = false;
+			}
+			else if (Defined[Value[0]] == true)
+			{
+				UTIL_MSG_ERR("Line %d: symbol %lu is already defined", Line, Value[0]);
+				Good = false;
 			}
+			else
+			{
+				// Add symbol
+				Symbols[Value[0]].PosX = Value[1];
+				Symbols[Value[0]].PosY = Value[2];
+				Symbols[Value[0]].Width = Value[3];
+				Defined[Value[0]] = true;
+			}
+
+			Pos = (LineEnd != NULL) ? LineEnd + 1 : Pos + strlen(Pos);
+		}
+		free(Text);
 
-			// Add symbol
-			Symbols[s].PosX = x;
-			Symbols[s].PosY = y;
-			Symbols[s].Width = w;
+		return Good;
+	}
+
+	bool CheckSymbols()
+	{
+		bool Good = true;
 
-			Line++;
+		// Every symbol should be inside of bitmap
+		for (int s = 0; s < PSF_SYMBOLS; s++)
+		{
+			if (Symbols[s].Null != 0)
+			{
+				UTIL_MSG_ERR("Symbol %d: bad entry", s);
+				Good = false;
+			}
+			else if (Symbols[s].PosX + Symbols[s].Width > PSF_BMP_W || Symbols[s].PosY + PSF_SYM_H > PSF_BMP_H)
+			{
+				UTIL_MSG_ERR("Symbol %d: %dx%d at %d,%d is out of %dx%d bitmap", s, Symbols[s].Width, PSF_SYM_H, Symbols[s].PosX, Symbols[s].PosY, PSF_BMP_W, PSF_BMP_H);
+				Good = false;
+			}
 		}
+
+		return Good;
 	}
 
 	void WriteSymbols(FILE ** ptrFile)
@@ -1,2 +1,2 @@
-OBJS=$(COMOBJ)/fops.o $(COMOBJ)/pngtool.o $(OBJDIR)/psitool.o
+OBJS=$(COMOBJ)/fops.o $(COMOBJ)/pngtool.o $(COMOBJ)/palmatch.o $(COMOBJ)/mipmap.o $(COMOBJ)/quantize.o $(COMOBJ)/palette.o $(OBJDIR)/psitool.o
 LIBS=-L$(COMOBJ) -lz
@@ -10,12 +10,15 @@
 #include "main.h"
 
 ////////// Functions //////////
-bool ConvertPNGtoPSI(const char * FileName);
+bool ConvertPNGtoPSI(const char * FileName, bool MIPs, bool Quantize, bool Dither);
 bool ConvertPSItoPNG(const char * FileName);
 void PatchRGBAPalette(uchar * RGBAPalette, ulong RGBAPaletteSize, bool MulDiv);
 void WierdRGBAPalette(uchar * RGBAPalette, ulong RGBAPaletteSize, bool MulDiv);
+bool ConvertPSFtoPNG(const char * FileName);
+bool ConvertPNGtoPSF(const char * FileName);
+bool ConvertFonts(const char * Dir);
 
-bool ConvertPNGtoPSI(const char * FileName)
+bool ConvertPNGtoPSI(const char * FileName, bool MIPs, bool Quantize, bool Dither)
 {
 	FILE *ptrInputF;						// Input file
 	FILE *ptrOutputF;						// Output file
@@ -26,6 +29,12 @@ bool ConvertPNGtoPSI(const char * FileName)
 	sPNGData * PNGPalette;
 	sPNGData * PNGBitmap;
 	uchar BytesPerPixel;
+	uchar LODCount = 0;
+	bool Indexed = false;
+
+	uchar * RGBAPalette;
+	uchar * IndexedBitmap;
+	double PSNR;
 
 	char OutFile[PATH_LEN];
 	char TexName[64];
@@ -54,29 +63,73 @@ bool ConvertPNGtoPSI(const char * FileName)
 
 		// Prepare PSI data
 		PNGBitmap = PNGReadBitmap(&ptrInputF, PNGHeader.Width, PNGHeader.Height, BytesPerPixel, PNGHeader.BitDepth);
-		for (ulong i = 0; i < PNGBitmap->DataSize; i++)			// Divide PNG bitmap bytes by 2 to match PSI
-			PNGBitmap->Data[i] /= 2;
+		if (Quantize == true)
+		{
+			// Reduce colors (bitmap is already converted to 32-bit)
+			UTIL_MALLOC(uchar *, RGBAPalette, 0x400, exit(EXIT_FAILURE));
+			UTIL_MALLOC(uchar *, IndexedBitmap, PNGHeader.Width * PNGHeader.Height, exit(EXIT_FAILURE));
+			if (QuantizeBitmap(PNGBitmap->Data, PNGHeader.Width, PNGHeader.Height, 4, RGBAPalette, IndexedBitmap, Dither) == false)
+			{
+				free(RGBAPalette);
+				free(IndexedBitmap);
+				free(PNGBitmap->Data);
+				free(PNGBitmap);
+				fclose(ptrInputF);
+				UTIL_ERR("Can't reduce colors ...\n", return false);
+			}
+			PSNR = QuantizePSNR(PNGBitmap->Data, PNGHeader.Width, PNGHeader.Height, 4, RGBAPalette, IndexedBitmap);
+			UTIL_MSG("Converted to 8-bit%s \n", Dither ? " with dithering" : "");
+			if (PSNR == QUANT_PSNR_LOSSLESS)
+			{
+				UTIL_MSG("PSNR: lossless \n");
+			}
+			else
+			{
+				UTIL_MSG("PSNR: %.2f dB \n", PSNR);
+			}
 
-		// Create output file
-		FileGetFullName(FileName, OutFile, sizeof(OutFile));
-		strcat(OutFile, ".psi");
-		SafeFileOpen(&ptrOutputF, OutFile, "wb");
+			// Continue as with 8-bit PNG
+			free(PNGBitmap->Data);
+			PNGBitmap->Data = IndexedBitmap;
+			PNGBitmap->DataSize = PNGHeader.Width * PNGHeader.Height;
+			UTIL_MALLOC(sPNGData *, PNGPalette, sizeof(sPNGData), exit(EXIT_FAILURE));
+			PNGPalette->Data = RGBAPalette;
+			PNGPalette->DataSize = 0x400;
+			Indexed = true;
+		}
+		else
+		{
+			if (MIPs == true)
+			{
+				LODCount = MIPCreateRGBA(&PNGBitmap->Data, &PNGBitmap->DataSize, PNGHeader.Width, PNGHeader.Height, PSI_MIN_DIMENSION, MIP_FILTER_GAMMA);
+				UTIL_MSG("MIPs: %i \n", LODCount);
+			}
+			for (ulong i = 0; i < PNGBitmap->DataSize; i++)			// Divide PNG bitmap bytes by 2 to match PSI
+				PNGBitmap->Data[i] /= 2;
 
-		// Write PSI header
-		FileGetName(FileName, TexName, sizeof(TexName), false);
-		PSIHeader.Update(TexName, PNGHeader.Width, PNGHeader.Height, PSI_RGBA);
-		FileWriteBlock(&ptrOutputF, &PSIHeader, sizeof(sPSIHeader));
+			// Create output file
+			FileGetFullName(FileName, OutFile, sizeof(OutFile));
+			strcat(OutFile, ".psi");
+			SafeFileOpen(&ptrOutputF, OutFile, "wb");
 
-		// Write PSI data
-		FileWriteBlock(&ptrOutputF, PNGBitmap->Data, PNGBitmap->DataSize);
+			// Write PSI header
+			FileGetName(FileName, TexName, sizeof(TexName), false);
+			PSIHeader.Update(TexName, PNGHeader.Width, PNGHeader.Height, PSI_RGBA);
+			PSIHeader.LODCount = LODCount;
+			FileWriteBlock(&ptrOutputF, &PSIHeader, sizeof(sPSIHeader));
 
-		// Free memory
-		free(PNGBitmap->Data);
+			// Write PSI data
+			FileWriteBlock(&ptrOutputF, PNGBitmap->Data, PNGBitmap->DataSize);
 
-		// Close files
-		fclose(ptrOutputF);
+			// Free memory
+			free(PNGBitmap->Data);
+			free(PNGBitmap);
 
-		UTIL_MSG("Done\n\n");
+			// Close files
+			fclose(ptrOutputF);
+
+			UTIL_MSG("Done\n\n");
+		}
 	}
 	else if (PNGHeader.CheckType() == PNG_INDEXED)
 	{
@@ -85,10 +138,41 @@ bool ConvertPNGtoPSI(const char * FileName)
 
 		// Prepare PSI palette
 		PNGPalette = PNGReadPalette(&ptrInputF);
-		PatchRGBAPalette(PNGPalette->Data, PNGPalette->DataSize, false);
 
 		// Prepare PSI bitmap
 		PNGBitmap = PNGReadBitmap(&ptrInputF, PNGHeader.Width, PNGHeader.Height, BytesPerPixel, PNGHeader.BitDepth);
+		Indexed = true;
+	}
+	else
+	{
+		fclose(ptrInputF);
+		UTIL_ERR("Unsupported PNG ...\n", return false);
+	}
+
+	// 8-bit PSI (from 8-bit PNG or from reduced colors)
+	if (Indexed == true)
+	{
+		// MIPs are made before palette is patched
+		if (MIPs == true)
+		{
+			LODCount = MIPCreateIndexed(&PNGBitmap->Data, &PNGBitmap->DataSize, PNGHeader.Width, PNGHeader.Height, PNGPalette->Data, PNGPalette->DataSize, PSI_MIN_DIMENSION, MIP_FILTER_GAMMA);
+			UTIL_MSG("MIPs: %i \n", LODCount);
+		}
+		if (Quantize == true && BytesPerPixel != 1)
+		{
+			// Palette can outweigh savings on small images
+			long Saved = (long)(PNGBitmap->DataSize * 3) - 0x400;
+
+			if (Saved > 0)
+			{
+				UTIL_MSG("VRAM: %u -> %u bytes (%li bytes saved) \n", (uint)(PNGBitmap->DataSize * 4), (uint)(PNGBitmap->DataSize + 0x400), Saved);
+			}
+			else
+			{
+				UTIL_MSG("VRAM: %u -> %u bytes (%li bytes more) \n", (uint)(PNGBitmap->DataSize * 4), (uint)(PNGBitmap->DataSize + 0x400), -Saved);
+			}
+		}
+		PatchRGBAPalette(PNGPalette->Data, PNGPalette->DataSize, false);
 
 		// Create output file
 		FileGetFullName(FileName, OutFile, sizeof(OutFile));
@@ -98,6 +182,7 @@ bool ConvertPNGtoPSI(const char * FileName)
 		// Write PSI header
 		FileGetName(FileName, TexName, sizeof(TexName), false);
 		PSIHeader.Update(TexName, PNGHeader.Width, PNGHeader.Height, PSI_INDEXED);
+		PSIHeader.LODCount = LODCount;
 		FileWriteBlock(&ptrOutputF, &PSIHeader, sizeof(sPSIHeader));
 
 		// Write PSI data
@@ -107,16 +192,14 @@ bool ConvertPNGtoPSI(const char * FileName)
 		// Free memory
 		free(PNGBitmap->Data);
 		free(PNGPalette->Data);
+		free(PNGBitmap);
+		free(PNGPalette);
 
 		// Close files
 		fclose(ptrOutputF);
 
 		UTIL_MSG("Done\n\n");
 	}
-	else
-	{
-		UTIL_ERR("Unsupported PNG ...\n", return false);
-	}
 
 	// Close files
 	fclose(ptrInputF);
@@ -246,59 +329,10 @@ bool ConvertPSItoPNG(const char * FileName)
 
 void PatchRGBAPalette(uchar * RGBAPalette, ulong RGBAPaletteSize, bool MulDiv)			// Patch color table.
 {
-	uchar Remainder;
-	uchar Temp;
-
-	// Reformat color table
-	uint PaletteElementSize = 4;
-	for (ulong i = 0; i < RGBAPaletteSize; i++)
-	{
-		Remainder = i % (0x20 * PaletteElementSize);
-
-		if (((0x10 * PaletteElementSize) <= Remainder) && (Remainder < (0x18 * PaletteElementSize)))
-		{
-			Temp = RGBAPalette[i];
-			RGBAPalette[i] = RGBAPalette[i - (0x08 * PaletteElementSize)];
-			RGBAPalette[i - (0x08 * PaletteElementSize)] = Temp;
-		}
-	}
-
-	// Multiply/Divide color table elements
-	for (ulong i = 0; i < RGBAPaletteSize; i++)
-	{
-		if ((i + 1) % PaletteElementSize == 0)	// Alpha
-		{
-			if (MulDiv == true)
-			{
-				if (RGBAPalette[i] > 0x7F)
-					RGBAPalette[i] = 0x7F;
-
-				RGBAPalette[i] *= 2;
-			}
-			else
-			{
-				RGBAPalette[i] /= 2;
-
-				if (RGBAPalette[i] == 0x7F)
-					RGBAPalette[i] = 0x80;
-			}
-
-			// Black out transparent pixels to avoid possible artifacts
-			if (RGBAPalette[i] == 0x00)
-			{
-				RGBAPalette[i - 1] = 0;
-				RGBAPalette[i - 2] = 0;
-				RGBAPalette[i - 3] = 0;
-			}
-		}
-		else									// RGB
-		{
-			if (MulDiv == true)
-				RGBAPalette[i] *= 2;
-			else
-				RGBAPalette[i] /= 2;
-		}
-	}
+	if (MulDiv == true)
+		PaletteTranscode(RGBAPalette, RGBAPaletteSize, 4, PAL_SWIZZLE | PAL_COLOR_MUL | PAL_ALPHA_MUL | PAL_ALPHA_PS2 | PAL_CLEAR_INVISIBLE);
+	else
+		PaletteTranscode(RGBAPalette, RGBAPaletteSize, 4, PAL_SWIZZLE | PAL_COLOR_DIV | PAL_ALPHA_DIV | PAL_ALPHA_PS2 | PAL_CLEAR_INVISIBLE);
 }
 
 // Palette fix for alphafont.psf
@@ -343,6 +377,8 @@ bool ConvertPSFtoPNG(const char * FileName)
 	// Read and check PSF Header
 	if (!PSFHeader.UpdateFromFile(&ptrInputF))
 		UTIL_ERR("Bad font!", return false);
+	if (PSFHeader.CheckSymbols() == false)
+		UTIL_MSG("Warning: symbol table has errors \n");
 
 	UTIL_MSG("Font with %dx%d bitmap \n", PSF_BMP_W, PSF_BMP_H);
 	BytesPerPixel = 1;
@@ -416,16 +452,24 @@ bool ConvertPNGtoPSF(const char * FileName)
 	sPNGData * PNGPalette;
 	sPNGData * PNGBitmap;
 	uchar BytesPerPixel;
+	bool Good;
 
 	char NameBuf[PATH_LEN];
 
-	// Open .inf
-	SafeFileOpen(&ptrInputINF, FileName, "r");
+	// Read and check symbol table
+	SafeFileOpen(&ptrInputINF, FileName, "rb");
+	Good = PSFHeader.ReadSymbols(&ptrInputINF);
+	Good = PSFHeader.CheckSymbols() && Good;
+	fclose(ptrInputINF);
+	if (Good == false)
+		UTIL_ERR("Bad symbol table...", return false);
 
 	// Open .png
 	FileGetFullName(FileName, NameBuf, sizeof(NameBuf));
 	strcat(NameBuf, ".png");
-	SafeFileOpen(&ptrInputPNG, NameBuf, "rb");
+	ptrInputPNG = fopen(NameBuf, "rb");
+	if (ptrInputPNG == NULL)
+		UTIL_ERR("Can't open font bitmap...", return false);
 
 	// Read PNG header
 	PNGHeader.UpdateFromFile(&ptrInputPNG);
@@ -433,29 +477,28 @@ bool ConvertPNGtoPSF(const char * FileName)
 
 	// Check PNG header
 	if (PNGHeader.CheckType() != PNG_INDEXED)
-		UTIL_ERR("Indexed PNG required...", return false);
+		UTIL_ERR("Indexed PNG required...", fclose(ptrInputPNG); return false);
 	if (PNGHeader.Width != PSF_BMP_W || PNGHeader.Height != PSF_BMP_H)
-		UTIL_ERR("Bad PNG size...", return false);
+		UTIL_ERR("Bad PNG size...", fclose(ptrInputPNG); return false);
 
 	UTIL_MSG("Converting font...\n");
 
-	// Prepare palette
-	PNGPalette = PNGReadPalette(&ptrInputPNG);
+	// Prepare palette and bitmap (PNG is read once)
+	BytesPerPixel = 1;
+	Good = PNGReadImage(&ptrInputPNG, PNGHeader.Width, PNGHeader.Height, BytesPerPixel, PNGHeader.BitDepth, &PNGPalette, &PNGBitmap);
+	fclose(ptrInputPNG);
+	if (Good == false)
+		UTIL_ERR("Can't read palette or bitmap...", return false);
 	PatchRGBAPalette(PNGPalette->Data, PNGPalette->DataSize, false);
 	if (strstr(FileName, "alphafont"))
 		WierdRGBAPalette(PNGPalette->Data, PNGPalette->DataSize, false);
 
-	// Prepare bitmap
-	BytesPerPixel = 1;
-	PNGBitmap = PNGReadBitmap(&ptrInputPNG, PNGHeader.Width, PNGHeader.Height, BytesPerPixel, PNGHeader.BitDepth);
-
 	// Create output file
 	FileGetFullName(FileName, NameBuf, sizeof(NameBuf));
 	strcat(NameBuf, ".psf");
 	SafeFileOpen(&ptrOutputF, NameBuf, "wb");
 
 	// Write PSF header
-	PSFHeader.ReadSymbols(&ptrInputINF);
 	FileWriteBlock(&ptrOutputF, &PSFHeader, sizeof(sPSFHeader));
 
 	// Write PSF bitmap and palette
@@ -464,11 +507,11 @@ bool ConvertPNGtoPSF(const char * FileName)
 
 	// Free memory
 	free(PNGBitmap->Data);
+	free(PNGBitmap);
 	free(PNGPalette->Data);
+	free(PNGPalette);
 
-	// Close files
-	fclose(ptrInputPNG);
-	fclose(ptrInputINF);
+	// Close file
 	fclose(ptrOutputF);
 
 	UTIL_MSG("Done\n\n");
@@ -476,6 +519,38 @@ bool ConvertPNGtoPSF(const char * FileName)
 	return true;
 }
 
+bool ConvertFonts(const char * Dir)		// Convert all fonts (*.inf + *.png) in folder and subfolders to *.psf
+{
+	const char * Path;
+	char Extension[5];
+	uint Converted = 0;
+	uint Failed = 0;
+
+	DirIterInit(Dir);
+	while ((Path = DirIterGet()) != NULL)
+	{
+		FileGetExtension(Path, Extension, sizeof(Extension));
+		if (strcmp(Extension, ".inf"))
+			continue;
+
+		UTIL_MSG("Processing file: %s \n", Path);
+		if (ConvertPNGtoPSF(Path) == true)
+		{
+			Converted++;
+		}
+		else
+		{
+			UTIL_MSG_ERR("Can't convert font ... \n");
+			Failed++;
+		}
+	}
+	DirIterClose();
+
+	UTIL_MSG("Fonts converted: %u, failed: %u \n", Converted, Failed);
+
+	return Converted > 0 && Failed == 0;
+}
+
 int main(int argc, char * argv[])
 {
 	char Extension[5];
@@ -497,7 +572,7 @@ int main(int argc, char * argv[])
 		UTIL_MSG("Processing file: %s \n", argv[1]);
 		if (!strcmp(Extension, ".png"))				// Convert PNG to PSI
 		{
-			if (ConvertPNGtoPSI(argv[1]) == true)
+			if (ConvertPNGtoPSI(argv[1], false, false, false) == true)
 				return 0;
 			else
 				UTIL_MSG_ERR("Can't convert image ... \n");
@@ -528,6 +603,51 @@ int main(int argc, char * argv[])
 			UTIL_MSG_ERR("Wrong file extension ... \n");
 		}
 	}
+	else if (argc == 3 && !strcmp(argv[1], "fonts"))
+	{
+		if (CheckDir(argv[2]) == false)
+		{
+			UTIL_MSG_ERR("Folder required ... \n");
+		}
+		else if (ConvertFonts(argv[2]) == true)
+		{
+			return 0;
+		}
+	}
+	else if (argc <= 5)
+	{
+		bool MIPs = false;
+		bool Quantize = false;
+		bool Dither = false;
+		bool BadArgs = false;
+
+		// Options for PNG to PSI conversion
+		for (int a = 1; a < argc - 1; a++)
+		{
+			if (!strcmp(argv[a], "mip"))
+				MIPs = true;
+			else if (!strcmp(argv[a], "quant"))
+				Quantize = true;
+			else if (!strcmp(argv[a], "dither"))
+				Quantize = Dither = true;
+			else
+				BadArgs = true;
+		}
+
+		FileGetExtension(argv[argc - 1], Extension, sizeof(Extension));
+		if (BadArgs == false && !strcmp(Extension, ".png"))
+		{
+			UTIL_MSG("Processing file: %s \n", argv[argc - 1]);
+			if (ConvertPNGtoPSI(argv[argc - 1], MIPs, Quantize, Dither) == true)
+				return 0;
+			else
+				UTIL_MSG_ERR("Can't convert image ... \n");
+		}
+		else
+		{
+			UTIL_MSG_ERR("Wrong arguments ... \n");
+		}
+	}
 	else
 	{
 		UTIL_MSG_ERR("Too many arguments ... \n");
@@ -17,7 +17,7 @@
 #include <ctype.h>	// tolower()
 
 ////////// Definitions //////////
-#define PROG_TITLE "\nPS2 HL Sprite Tool v1.32\n"
+#define PROG_TITLE "\nPS2 HL Sprite Tool v1.36\n"
 #define PROG_INFO "\
 Developed by supadupaplex, 2017-2021\n\
 License: BSD-3-Clause (check out license.txt)\n\
@@ -25,6 +25,7 @@ License: BSD-3-Clause (check out license.txt)\n\
 How to use:\n\
 1) Windows explorer - drag and drop sprite file on sprtool.exe\n\
 2) Command line\\Batch - sprtool (noresize/lin) [file_name]\n\
+3) Fit folder into budget - sprtool plan [folder] [budget in KB] (lin)\n\
 \n\
 For more info check out readme.txt\n\
 "
@@ -44,6 +45,10 @@ enum eSPZFormat { SPZ_ADDITIVE = 0, SPZ_INDEXALPHA = 1, SPZ_ALPHATEST = 2 };
 
 ////////// Functions //////////
 #include "fops.h"
+#include "palmatch.h"
+#include "resample.h"
+#include "palette.h"
+#include "sizeplan.h"
 
 ////////// Structures //////////
 
@@ -350,31 +355,12 @@ struct sTexture
 	
 	void PaletteReformat(uint PaletteElementSize)			// Peposition palette table elements. Used for SPZ to SPR and SPR to SPZ conversions.
 	{
-		uchar Remainder;
-		uchar Temp;
-
-		for (ulong i = 0; i < this->PaletteSize; i++)
-		{
-			Remainder = i % (0x20 * PaletteElementSize);
-
-			if (((0x10 * PaletteElementSize) <= Remainder) && (Remainder < (0x18 * PaletteElementSize)))
-			{
-				Temp = this->Palette[i];
-				this->Palette[i] = this->Palette[i - (0x08 * PaletteElementSize)];
-				this->Palette[i - (0x08 * PaletteElementSize)] = Temp;
-			}
-		}
+		PaletteTranscode(this->Palette, this->PaletteSize, PaletteElementSize, PAL_SWIZZLE);
 	}
 
 	void PaletteMulDiv(bool Multiply)						// Multiply (true) or divide (false) color table entries by 2. Multiply - convert *.SPZ to *.SPR, divide - convert *.SPR to *.SPZ 
 	{														// !!! Apply this function to palete with removed alpha !!!
-		for (ulong i = 0; i < this->PaletteSize; i++)
-		{
-			if (Multiply == true)
-				this->Palette[i] = this->Palette[i] * 2;
-			else
-				this->Palette[i] = this->Palette[i] / 2;
-		}
+		PaletteTranscode(this->Palette, this->PaletteSize, SPR_PALETTE_ELEMENT_SIZE, Multiply ? PAL_COLOR_MUL : PAL_COLOR_DIV);
 	}
 
 	void PaletteRemoveAlpha()	// Convert palette to SPR format
@@ -546,15 +532,11 @@ struct sTexture
 		}
 
 		// Resize bitmap
-		for (uint NewY = 0; NewY < NewHeight; NewY++)
-			for (uint NewX = 0; NewX < NewWidth; NewX++)
-			{
-				uint OldY = (uint)round((double)NewY / (NewHeight - 1) * (this->Height - 1));
-				uint OldX = (uint)round((double)NewX / (NewWidth - 1) * (this->Width - 1));
-
-				NewBitmap[(NewWidth * NewY) + NewX] = this->Bitmap[(this->Width * OldY) + OldX];
-			}
-
+		if (ResampleBitmap(this->Bitmap, this->Width, this->Height, NewBitmap, NewWidth, NewHeight, 1, RESAMPLE_NEAREST) == false)
+		{
+			UTIL_WAIT_KEY("Unable to resize bitmap ...");
+			exit(EXIT_FAILURE);
+		}
 
 		// Destroy old bitmap
 		free(this->Bitmap);
@@ -628,14 +610,7 @@ struct sTexture
 
 	void PaletteSwapRedAndGreen(uint ElementSize)		// Needed for SPR\SPZ to BMP conversion and vice versa.
 	{
-		uchar Temp;
-
-		for (uint Element = 0; Element < EIGHT_BIT_PALETTE_ELEMENTS_COUNT; Element++)	// Swap 1-st and 3-rd bytes in element
-		{
-			Temp = this->Palette[Element * ElementSize];
-			this->Palette[Element * ElementSize] = this->Palette[Element * ElementSize + 2];
-			this->Palette[Element * ElementSize + 2] = Temp;
-		}
+		PaletteTranscode(this->Palette, EIGHT_BIT_PALETTE_ELEMENTS_COUNT * ElementSize, ElementSize, PAL_SWAP_RB);
 	}
 	
 		void Rename(const char * NewName)
@@ -773,7 +748,7 @@ struct sTexture
 		return Index;
 	}
 
-	void LinearResize(short NewWidth, short NewHeight)			// Smooth linear resize
+	void LinearResize(short NewWidth, short NewHeight, sPaletteMatcher * SharedMatcher)	// Smooth linear resize (SharedMatcher - matcher of this palette shared by frames, NULL - make own)
 	{
 		ulong * NewRGBABitmap;
 
@@ -815,21 +790,45 @@ struct sTexture
 		//puts("Converting back to 8-bit indexed format ...");
 
 		// Reindex with existing palette //
-		for (uint Y = 0; Y < Height; Y++)
+		sPaletteMatcher * Matcher = SharedMatcher;
+		bool MatcherReady = true;
+		if (SharedMatcher == NULL)
 		{
-			ulong LineOffset = Y * Width;
-
-			for (uint X = 0; X < Width; X++)
+			Matcher = (sPaletteMatcher *)malloc(sizeof(sPaletteMatcher));
+			if (Matcher == NULL)
+			{
+				UTIL_WAIT_KEY("Unable to allocate memory ...");
+				exit(EXIT_FAILURE);
+			}
+			MatcherReady = Matcher->Init(Palette, PaletteSize);
+		}
+		if (MatcherReady == false)
+		{
+			// Same as FindClosestColor() for bad palette
+			if (Palette != NULL)
+				puts("Unknown color format");
+			memset(Bitmap, 0x00, BitmapSize);
+		}
+		else
+		{
+			for (uint Y = 0; Y < Height; Y++)
 			{
-				// Convert RGBA pixel to index
-				sRGBAPixel Px;
-				memcpy(&Px, &NewRGBABitmap[LineOffset + X], sizeof(Px));
-				uchar Index = FindClosestColor(&Px);
+				ulong LineOffset = Y * Width;
+
+				for (uint X = 0; X < Width; X++)
+				{
+					// Convert RGBA pixel to index
+					sRGBAPixel Px;
+					memcpy(&Px, &NewRGBABitmap[LineOffset + X], sizeof(Px));
+					uchar Index = Matcher->Find(Px.R, Px.G, Px.B, Px.A);
 
-				// Write index to bitmap
-				Bitmap[LineOffset + X] = Index;
+					// Write index to bitmap
+					Bitmap[LineOffset + X] = Index;
+				}
 			}
 		}
+		if (SharedMatcher == NULL)
+			free(Matcher);
 
 		// Free memory
 		free(NewRGBABitmap);
@@ -1,2 +1,2 @@
-OBJS=$(COMOBJ)/fops.o $(OBJDIR)/sprtool.o
+OBJS=$(COMOBJ)/fops.o $(COMOBJ)/palmatch.o $(COMOBJ)/resample.o $(COMOBJ)/palette.o $(COMOBJ)/sizeplan.o $(OBJDIR)/sprtool.o
 LIBS=
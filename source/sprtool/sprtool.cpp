@@ -11,8 +11,13 @@
 
 ////////// Functions //////////
 void ConvertSPZToSPR(const char * cFile, bool Resize, bool Linear);
-void ConvertSPRToSPZ(const char * cFile, bool Linear);
+void ConvertSPRToSPZ(const char * cFile, bool Linear, uint Level);
+ulong FrameHash(const sTexture * Texture, const sSPZFrameHeader * Header);
+int * FindDuplicateFrames(const sTexture * Textures, const sSPZFrameHeader * Headers, int FrameCount);
 uint PSIProperSize(uint Size);
+uint PSIPlannedSize(uint Size, uint Level);
+bool PlanSprite(const char * cFile, sPlanAsset * Asset);
+void PlanSprites(const char * cDir, ulong Budget, bool Linear);
 
 void ConvertSPZToSPR(const char * cFile, bool Resize, bool Linear)
 {
@@ -61,12 +66,23 @@ void ConvertSPZToSPR(const char * cFile, bool Resize, bool Linear)
 
 	// Load frames from *.spz file
 	Textures = (sTexture *)malloc(sizeof(sTexture) * SPZHeader.FrameCount);
+	if (Textures == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
 	uint BitmapOffset;
 	uint BitmapSize;
 	uint PaletteOffset;
 	uint PaletteSize;
 	uint MaxWidth = SPZFrameHeaders[0].Width;
 	uint MaxHeight = SPZFrameHeaders[0].Height;
+	bool * SharedPalette = (bool *)malloc(sizeof(bool) * SPZHeader.FrameCount);		// Frame uses palette of 1-st frame
+	if (SharedPalette == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
 	for (int i = 0; i < SPZHeader.FrameCount; i++)
 	{
 		// Load frame
@@ -77,15 +93,47 @@ void ConvertSPZToSPR(const char * cFile, bool Resize, bool Linear)
 
 		Textures[i].Initialize();
 		Textures[i].UpdateFromFile(&ptrSPZ, BitmapOffset, BitmapSize, PaletteOffset, PaletteSize, SPZFrameHeaders[i].Name, SPZFrameHeaders[i].Width, SPZFrameHeaders[i].Height);
+	}
 
-		// Convert palette (brfore Linear resize)
-		Textures[i].PaletteReformat(SPZ_PALETTE_ELEMENT_SIZE);
+	// Every frame has a copy of palette, usually all of them are the same, so the first one is converted and shared
+	// (going backwards, so the first palette is compared before it's converted)
+	for (int i = SPZHeader.FrameCount - 1; i >= 0; i--)
+	{
+		SharedPalette[i] = i > 0 && !memcmp(Textures[i].Palette, Textures[0].Palette, Textures[0].PaletteSize);
+		if (SharedPalette[i] == true)
+		{
+			free(Textures[i].Palette);
+			Textures[i].Palette = Textures[0].Palette;
+		}
+		else
+		{
+			// Convert palette (brfore Linear resize)
+			Textures[i].PaletteReformat(SPZ_PALETTE_ELEMENT_SIZE);
+		}
+	}
 
-		// Resize frame to it's original size (if specified)
+	// Resize frames to their original sizes (if specified)
+	sPaletteMatcher * Matcher = NULL;		// Matcher of 1-st palette (its cache is shared by frames)
+	if (Resize == true && Linear)
+	{
+		Matcher = (sPaletteMatcher *)malloc(sizeof(sPaletteMatcher));
+		if (Matcher == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		if (Matcher->Init(Textures[0].Palette, Textures[0].PaletteSize) == false)
+		{
+			free(Matcher);
+			Matcher = NULL;
+		}
+	}
+	for (int i = 0; i < SPZHeader.FrameCount; i++)
+	{
 		if (Resize == true)
 		{
 			if (Linear)
-				Textures[i].LinearResize(SPZFrameHeaders[i].UpWidth, SPZFrameHeaders[i].UpHeight);
+				Textures[i].LinearResize(SPZFrameHeaders[i].UpWidth, SPZFrameHeaders[i].UpHeight, (i == 0 || SharedPalette[i] == true) ? Matcher : NULL);
 			else
 				Textures[i].NearestResize(SPZFrameHeaders[i].UpWidth, SPZFrameHeaders[i].UpHeight);
 		}
@@ -96,6 +144,7 @@ void ConvertSPZToSPR(const char * cFile, bool Resize, bool Linear)
 		if (Textures[i].Height > MaxHeight)
 			MaxHeight = Textures[i].Height;
 	}
+	free(Matcher);
 
 	// Create new *.spr file
 	FileGetFullName(cFile, cOutputFileName, sizeof(cOutputFileName));
@@ -151,32 +200,56 @@ void ConvertSPZToSPR(const char * cFile, bool Resize, bool Linear)
 		SPRType = SPR_VP_PARALLEL;
 	}
 
-	// Convert frames to appropriate format
+	// Convert palette to appropriate format (palette of 1-st frame is sprite palette, others aren't written)
+	for (int i = 1; i < SPZHeader.FrameCount; i++)
+	{
+		if (SharedPalette[i] == false)
+			free(Textures[i].Palette);
+		Textures[i].Palette = NULL;
+	}
+	Textures[0].PaletteRemoveAlpha();
+	Textures[0].PaletteMulDiv(true);
+	if (SPRFormat == SPR_INDEXALPHA)
+		Textures[0].PalettePatchIAColors(SPR_PALETTE_ELEMENT_SIZE, true);
+
+	// Assemble file in memory and write it at once
+	ulong OutputSize = sizeof(sSPRHeader) + Textures[0].PaletteSize;
 	for (int i = 0; i < SPZHeader.FrameCount; i++)
+		OutputSize += sizeof(sSPRFrameHeader) + Textures[i].BitmapSize;
+	uchar * Output = (uchar *)malloc(OutputSize);
+	if (Output == NULL)
 	{
-		Textures[i].PaletteRemoveAlpha();
-		Textures[i].PaletteMulDiv(true);
-		if (SPRFormat == SPR_INDEXALPHA)
-			Textures[i].PalettePatchIAColors(SPR_PALETTE_ELEMENT_SIZE, true);
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
 	}
 
-	// Write header
+	// Header
 	SPRHeader.Update(MaxWidth, MaxHeight, SPZHeader.FrameCount, SPRType, SPRFormat);
-	FileWriteBlock(&ptrSPR, &SPRHeader, sizeof(sSPRHeader));
-	
-	// Write palette (taking palette from 1-st textre as sprite palette)
-	FileWriteBlock(&ptrSPR, Textures[0].Palette, Textures[0].PaletteSize);
+	memcpy(Output, &SPRHeader, sizeof(sSPRHeader));
+	ulong OutputOffset = sizeof(sSPRHeader);
+
+	// Palette (taking palette from 1-st textre as sprite palette)
+	memcpy(&Output[OutputOffset], Textures[0].Palette, Textures[0].PaletteSize);
+	OutputOffset += Textures[0].PaletteSize;
 
-	// Write frames
+	// Frames
 	for (int i = 0; i < SPZHeader.FrameCount; i++)
 	{
-		SPRFrameHeader.Update(Textures[i].Width, Textures[i].Height);			// Write header
-		FileWriteBlock(&ptrSPR, &SPRFrameHeader, sizeof(sSPRFrameHeader));
+		SPRFrameHeader.Update(Textures[i].Width, Textures[i].Height);
+		memcpy(&Output[OutputOffset], &SPRFrameHeader, sizeof(sSPRFrameHeader));
+		OutputOffset += sizeof(sSPRFrameHeader);
 
-		FileWriteBlock(&ptrSPR, Textures[i].Bitmap, Textures[i].BitmapSize);	// Write bitmap
+		memcpy(&Output[OutputOffset], Textures[i].Bitmap, Textures[i].BitmapSize);
+		OutputOffset += Textures[i].BitmapSize;
 	}
+	FileWriteBlock(&ptrSPR, Output, OutputSize);
 
 	// Free memory
+	for (int i = 0; i < SPZHeader.FrameCount; i++)
+		free(Textures[i].Bitmap);
+	free(Textures[0].Palette);
+	free(Output);
+	free(SharedPalette);
 	free(SPZFrameHeaders);
 	free(SPZFrameTable);
 	free(Textures);
@@ -186,7 +259,7 @@ void ConvertSPZToSPR(const char * cFile, bool Resize, bool Linear)
 	fclose(ptrSPR);
 }
 
-void ConvertSPRToSPZ(const char * cFile, bool Linear)
+void ConvertSPRToSPZ(const char * cFile, bool Linear, uint Level)
 {
 	FILE * ptrSPZ;
 	FILE * ptrSPR;
@@ -197,11 +270,14 @@ void ConvertSPRToSPZ(const char * cFile, bool Linear)
 
 	sSPZHeader SPZHeader;
 	sSPZFrameTableEntry SPZFrameTableEntry;
-	sSPZFrameHeader SPZFrameHeader;
+	sSPZFrameHeader * SPZFrameHeaders;
 	eSPZType SPZType;
 	eSPZFormat SPZFormat;
 
 	sTexture * Textures;
+	int * FrameAliases;						// Number of first identical frame for every frame
+	ulong * FrameOffsets;
+	ulong SavedBytes = 0;
 
 	// Open *.spr file
 	SafeFileOpen(&ptrSPR, cFile, "rb");
@@ -313,38 +389,42 @@ void ConvertSPRToSPZ(const char * cFile, bool Linear)
 	}
 
 	// Convert frames to appropriate format
-	for (int i = 0; i < SPRHeader.FrameCount; i++)
+	SPZFrameHeaders = (sSPZFrameHeader *)malloc(sizeof(sSPZFrameHeader) * SPRHeader.FrameCount);
+	if (SPZFrameHeaders == NULL)
 	{
-		Textures[i].PaletteMulDiv(false);
-		Textures[i].PaletteAddSPZAlpha(SPZFormat);
-		if (SPZFormat == SPZ_INDEXALPHA)
-			Textures[i].PalettePatchIAColors(SPZ_PALETTE_ELEMENT_SIZE, false);
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
 	}
 
-	// Write header
-	SPZHeader.Update(SPRHeader.FrameCount, SPZType);
-	FileWriteBlock(&ptrSPZ, &SPZHeader, sizeof(sSPZHeader));
-
-	// Write frame table
-	FrameOffset = sizeof(sSPZHeader) + sizeof(sSPZFrameTableEntry) * SPRHeader.FrameCount;
-	if ((SPRHeader.FrameCount % 2) == 0)		// Make sure that first frame starts from new 16-byte block (PS2 version likes everything to be aligned)
-		FrameOffset += 8;
-	for (int i = 0; i < SPRHeader.FrameCount; i++)
+	// Sprite palette is the same for all frames, so it's converted once and shared
+	Textures[0].PaletteMulDiv(false);
+	Textures[0].PaletteAddSPZAlpha(SPZFormat);
+	if (SPZFormat == SPZ_INDEXALPHA)
+		Textures[0].PalettePatchIAColors(SPZ_PALETTE_ELEMENT_SIZE, false);
+	for (uint i = 1; i < SPRHeader.FrameCount; i++)
 	{
-		// Write frame table entry to file
-		SPZFrameTableEntry.Update(FrameOffset);
-		FileWriteBlock(&ptrSPZ, &SPZFrameTableEntry, sizeof(sSPZFrameTableEntry));
-
-		// Calculate offset for next frame (with resizing in mind)
-		FrameOffset += sizeof(sSPZFrameHeader) + EIGHT_BIT_PALETTE_ELEMENTS_COUNT * SPZ_PALETTE_ELEMENT_SIZE + PSIProperSize(Textures[i].Width) * PSIProperSize(Textures[i].Height);
+		free(Textures[i].Palette);
+		Textures[i].Palette = Textures[0].Palette;
+		Textures[i].PaletteSize = Textures[0].PaletteSize;
 	}
 
-	// Add 8 blank bytes if table has even number of elements (PS2 version likes everything to be alligned within 16-byte sized sectors)
-	if ((SPRHeader.FrameCount % 2) == 0)
-		for (int i = 0; i < 8; i++)
-			fputc(0x00, ptrSPZ);
+	// Colors of all resized frames are matched by one matcher (its cache is shared)
+	sPaletteMatcher * Matcher = NULL;
+	if (Linear)
+	{
+		Matcher = (sPaletteMatcher *)malloc(sizeof(sPaletteMatcher));
+		if (Matcher == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		if (Matcher->Init(Textures[0].Palette, Textures[0].PaletteSize) == false)
+		{
+			free(Matcher);
+			Matcher = NULL;
+		}
+	}
 
-	// Write frames
 	uint OriginalHeight;
 	uint OriginalWidth;
 	for (int i = 0; i < SPRHeader.FrameCount; i++)
@@ -353,27 +433,83 @@ void ConvertSPRToSPZ(const char * cFile, bool Linear)
 		OriginalWidth = Textures[i].Width;
 		OriginalHeight = Textures[i].Height;
 		if (Linear)
-			Textures[i].LinearResize(PSIProperSize(OriginalWidth), PSIProperSize(OriginalHeight));
+			Textures[i].LinearResize(PSIPlannedSize(OriginalWidth, Level), PSIPlannedSize(OriginalHeight, Level), Matcher);
 		else
-			Textures[i].NearestResize(PSIProperSize(OriginalWidth), PSIProperSize(OriginalHeight));
+			Textures[i].NearestResize(PSIPlannedSize(OriginalWidth, Level), PSIPlannedSize(OriginalHeight, Level));
 
-		// Convert palette (after linear resize)
-		Textures[i].PaletteReformat(SPZ_PALETTE_ELEMENT_SIZE);
+		SPZFrameHeaders[i].Update(Textures[i].Name, Textures[i].Width, Textures[i].Height);
+		SPZFrameHeaders[i].UpdateUpscaleTarget(OriginalWidth, OriginalHeight);
+	}
+	free(Matcher);
 
-		// Write header
-		SPZFrameHeader.Update(Textures[i].Name, Textures[i].Width, Textures[i].Height);
-		SPZFrameHeader.UpdateUpscaleTarget(OriginalWidth, OriginalHeight);
-		FileWriteBlock(&ptrSPZ, &SPZFrameHeader, sizeof(sSPZFrameHeader));
+	// Convert palette (after linear resize)
+	Textures[0].PaletteReformat(SPZ_PALETTE_ELEMENT_SIZE);
 
-		// Write palette
-		FileWriteBlock(&ptrSPZ, Textures[i].Palette, Textures[i].PaletteSize);
+	// Find repeated frames (they would point to the first copy)
+	FrameAliases = FindDuplicateFrames(Textures, SPZFrameHeaders, SPRHeader.FrameCount);
 
-		// Write bitmap
-		FileWriteBlock(&ptrSPZ, Textures[i].Bitmap, Textures[i].BitmapSize);
+	// Frame table (repeated frames point to the first copy)
+	FrameOffsets = (ulong *)malloc(sizeof(ulong) * SPRHeader.FrameCount);
+	if (FrameOffsets == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
 	}
+	FrameOffset = sizeof(sSPZHeader) + sizeof(sSPZFrameTableEntry) * SPRHeader.FrameCount;
+	if ((SPRHeader.FrameCount % 2) == 0)		// Make sure that first frame starts from new 16-byte block (PS2 version likes everything to be aligned)
+		FrameOffset += 8;
+	for (int i = 0; i < SPRHeader.FrameCount; i++)
+	{
+		if (FrameAliases[i] != i)
+		{
+			FrameOffsets[i] = FrameOffsets[FrameAliases[i]];
+			SavedBytes += sizeof(sSPZFrameHeader) + Textures[i].PaletteSize + Textures[i].BitmapSize;
+			printf("Frame #%i is same as #%i \n", i + 1, FrameAliases[i] + 1);
+		}
+		else
+		{
+			FrameOffsets[i] = FrameOffset;
+
+			// Calculate offset for next frame
+			FrameOffset += sizeof(sSPZFrameHeader) + Textures[i].PaletteSize + Textures[i].BitmapSize;
+		}
+	}
+	if (SavedBytes > 0)
+		printf("Repeated frames: %u bytes saved \n", (uint)SavedBytes);
+
+	// Assemble file in memory and write it at once (8 blank bytes after table with even number of elements are left as zeroes)
+	uchar * Output = (uchar *)calloc(FrameOffset, 1);
+	if (Output == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	SPZHeader.Update(SPRHeader.FrameCount, SPZType);
+	memcpy(Output, &SPZHeader, sizeof(sSPZHeader));
+	for (int i = 0; i < SPRHeader.FrameCount; i++)
+	{
+		// Frame table entry
+		SPZFrameTableEntry.Update(FrameOffsets[i]);
+		memcpy(&Output[sizeof(sSPZHeader) + i * sizeof(sSPZFrameTableEntry)], &SPZFrameTableEntry, sizeof(sSPZFrameTableEntry));
+		if (FrameAliases[i] != i)
+			continue;
+
+		// Frame: header, palette and bitmap
+		memcpy(&Output[FrameOffsets[i]], &SPZFrameHeaders[i], sizeof(sSPZFrameHeader));
+		memcpy(&Output[FrameOffsets[i] + sizeof(sSPZFrameHeader)], Textures[i].Palette, Textures[i].PaletteSize);
+		memcpy(&Output[FrameOffsets[i] + sizeof(sSPZFrameHeader) + Textures[i].PaletteSize], Textures[i].Bitmap, Textures[i].BitmapSize);
+	}
+	FileWriteBlock(&ptrSPZ, Output, FrameOffset);
 
 	// Free memory
+	for (uint i = 0; i < SPRHeader.FrameCount; i++)
+		free(Textures[i].Bitmap);
+	free(Textures[0].Palette);
+	free(Output);
 	free(SPRFrameHeaders);
+	free(SPZFrameHeaders);
+	free(FrameAliases);
+	free(FrameOffsets);
 	free(Textures);
 
 	// Close files
@@ -381,6 +517,59 @@ void ConvertSPRToSPZ(const char * cFile, bool Linear)
 	fclose(ptrSPZ);
 }
 
+ulong FrameHash(const sTexture * Texture, const sSPZFrameHeader * Header)	// FNV-1a hash of SPZ frame (internal name is ignored)
+{
+	ulong Hash = 2166136261U;
+	const uchar * Blocks[3] = { (const uchar *)&Header->LODCount, Texture->Palette, Texture->Bitmap };
+	ulong Sizes[3] = { sizeof(sSPZFrameHeader) - sizeof(Header->Name), Texture->PaletteSize, Texture->BitmapSize };
+
+	for (int b = 0; b < 3; b++)
+		for (ulong i = 0; i < Sizes[b]; i++)
+		{
+			Hash ^= Blocks[b][i];
+			Hash *= 16777619;
+		}
+
+	return Hash & 0xFFFFFFFF;
+}
+
+int * FindDuplicateFrames(const sTexture * Textures, const sSPZFrameHeader * Headers, int FrameCount)	// Returns number of first identical frame for every frame (must be freed)
+{
+	int * Aliases;
+	ulong * Hashes;
+
+	Aliases = (int *)malloc(sizeof(int) * FrameCount);
+	Hashes = (ulong *)malloc(sizeof(ulong) * FrameCount);
+	if (Aliases == NULL || Hashes == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < FrameCount; i++)
+	{
+		Hashes[i] = FrameHash(&Textures[i], &Headers[i]);
+		Aliases[i] = i;
+
+		// Frames with same hash are compared byte by byte
+		for (int j = 0; j < i; j++)
+		{
+			if (Aliases[j] != j || Hashes[j] != Hashes[i] || Textures[j].PaletteSize != Textures[i].PaletteSize || Textures[j].BitmapSize != Textures[i].BitmapSize)
+				continue;
+			if (memcmp(&Headers[j].LODCount, &Headers[i].LODCount, sizeof(sSPZFrameHeader) - sizeof(Headers[i].Name)) ||
+				memcmp(Textures[j].Palette, Textures[i].Palette, Textures[i].PaletteSize) ||
+				memcmp(Textures[j].Bitmap, Textures[i].Bitmap, Textures[i].BitmapSize))
+				continue;
+
+			Aliases[i] = j;
+			break;
+		}
+	}
+
+	free(Hashes);
+	return Aliases;
+}
+
 uint PSIProperSize(uint Size)	// Function returns closest proper dimension. PS2 HL proper PSI dimensions: 16 (min), 32, 64, 128, 256, 512, ...
 {
 	uint CurrentSize;
@@ -404,6 +593,172 @@ uint PSIProperSize(uint Size)	// Function returns closest proper dimension. PS2
 	}
 }
 
+uint PSIPlannedSize(uint Size, uint Level)	// Proper dimension lowered by size plan level (every level halves it)
+{
+	uint NewSize = PSIProperSize(Size) >> Level;
+
+	return NewSize < PSI_MIN_DIMENSION ? PSI_MIN_DIMENSION : NewSize;
+}
+
+bool PlanSprite(const char * cFile, sPlanAsset * Asset)	// Rate stored sizes of *.spr frames for size plan
+{
+	FILE * ptrSPR;
+	sSPRHeader SPRHeader;
+	sSPRFrameHeader SPRFrameHeader;
+	uchar Palette[EIGHT_BIT_PALETTE_ELEMENTS_COUNT * SPR_PALETTE_ELEMENT_SIZE];
+	ulong Sizes[PLAN_MAX_LEVELS];
+	double Errors[PLAN_MAX_LEVELS];
+	uint LevelCount = 1;
+
+	// Open *.spr file
+	SafeFileOpen(&ptrSPR, cFile, "rb");
+	SPRHeader.UpdateFromFile(&ptrSPR);
+	if (SPRHeader.CheckSignature() == false || SPRHeader.FrameCount == 0)
+	{
+		fclose(ptrSPR);
+		return false;
+	}
+	FileReadBlock(&ptrSPR, Palette, sizeof(sSPRHeader), sizeof(Palette));
+
+	// Header and frame table don't depend on frame sizes
+	for (uint l = 0; l < PLAN_MAX_LEVELS; l++)
+	{
+		Sizes[l] = sizeof(sSPZHeader) + sizeof(sSPZFrameTableEntry) * SPRHeader.FrameCount + ((SPRHeader.FrameCount % 2) == 0 ? 8 : 0);
+		Errors[l] = 0;
+	}
+
+	ulong * Hashes = (ulong *)malloc(sizeof(ulong) * SPRHeader.FrameCount);
+	if (Hashes == NULL)
+	{
+		UTIL_WAIT_KEY("Unable to allocate memory ...");
+		exit(EXIT_FAILURE);
+	}
+	ulong FrameOffset = sizeof(sSPRHeader) + sizeof(Palette);
+	for (uint i = 0; i < SPRHeader.FrameCount; i++)
+	{
+		uchar * Bitmap;
+		uchar * RGBA;
+		bool Repeated = false;
+
+		SPRFrameHeader.UpdateFromFile(&ptrSPR, FrameOffset);
+		ulong PixelCount = SPRFrameHeader.Width * SPRFrameHeader.Height;
+		Bitmap = (uchar *)malloc(PixelCount);
+		RGBA = (uchar *)malloc(PixelCount * 4);
+		if (Bitmap == NULL || RGBA == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		FileReadBlock(&ptrSPR, Bitmap, FrameOffset + sizeof(sSPRFrameHeader), PixelCount);
+		FrameOffset += sizeof(sSPRFrameHeader) + PixelCount;
+
+		// Repeated frames are stored once (estimate by hash, frames are compared only during conversion)
+		Hashes[i] = 2166136261U ^ SPRFrameHeader.Width ^ (SPRFrameHeader.Height << 16);
+		for (ulong p = 0; p < PixelCount; p++)
+			Hashes[i] = ((Hashes[i] ^ Bitmap[p]) * 16777619) & 0xFFFFFFFF;
+		for (uint j = 0; j < i && Repeated == false; j++)
+			Repeated = Hashes[j] == Hashes[i];
+		if (Repeated == true)
+		{
+			free(Bitmap);
+			free(RGBA);
+			continue;
+		}
+
+		// Frame as it looks in game: indexalpha - last color with index as alpha, alphatest - last color is transparent
+		for (ulong p = 0; p < PixelCount; p++)
+		{
+			uint Color = SPRHeader.Format == SPR_INDEXALPHA ? EIGHT_BIT_PALETTE_ELEMENTS_COUNT - 1 : Bitmap[p];
+
+			memcpy(&RGBA[p * 4], &Palette[Color * SPR_PALETTE_ELEMENT_SIZE], SPR_PALETTE_ELEMENT_SIZE);
+			if (SPRHeader.Format == SPR_INDEXALPHA)
+				RGBA[p * 4 + 3] = Bitmap[p];
+			else if (SPRHeader.Format == SPR_ALPHATEST && Bitmap[p] == EIGHT_BIT_PALETTE_ELEMENTS_COUNT - 1)
+				RGBA[p * 4 + 3] = 0x00;
+			else
+				RGBA[p * 4 + 3] = 0xFF;
+		}
+
+		// Rate every level (levels that don't change any frame are dropped)
+		for (uint l = 0; l < PLAN_MAX_LEVELS; l++)
+		{
+			uint Width = PSIPlannedSize(SPRFrameHeader.Width, l);
+			uint Height = PSIPlannedSize(SPRFrameHeader.Height, l);
+
+			Sizes[l] += sizeof(sSPZFrameHeader) + EIGHT_BIT_PALETTE_ELEMENTS_COUNT * SPZ_PALETTE_ELEMENT_SIZE + Width * Height;
+			Errors[l] += PlanImageError(RGBA, SPRFrameHeader.Width, SPRFrameHeader.Height, Width, Height);
+			if (l > 0 && l + 1 > LevelCount && (Width != PSIPlannedSize(SPRFrameHeader.Width, l - 1) || Height != PSIPlannedSize(SPRFrameHeader.Height, l - 1)))
+				LevelCount = l + 1;
+		}
+
+		free(Bitmap);
+		free(RGBA);
+	}
+	free(Hashes);
+	fclose(ptrSPR);
+
+	Asset->Initialize();
+	for (uint l = 0; l < LevelCount; l++)
+		Asset->AddLevel(Sizes[l], Errors[l]);
+
+	return true;
+}
+
+void PlanSprites(const char * cDir, ulong Budget, bool Linear)	// Convert all *.spr in folder with stored sizes that fit into budget
+{
+	char (* Files)[PATH_LEN] = NULL;
+	sPlanAsset * Assets = NULL;
+	uint Count = 0;
+	ulong Total;
+	const char * Path;
+	char Extension[5];
+
+	// Rate sprites (folder is searched including subfolders)
+	DirIterInit(cDir);
+	while ((Path = DirIterGet()) != NULL)
+	{
+		FileGetExtension(Path, Extension, sizeof(Extension));
+		if (strcmp(Extension, ".spr") || strlen(Path) >= PATH_LEN)
+			continue;
+
+		Files = (char (*)[PATH_LEN])realloc(Files, (Count + 1) * PATH_LEN);
+		Assets = (sPlanAsset *)realloc(Assets, (Count + 1) * sizeof(sPlanAsset));
+		if (Files == NULL || Assets == NULL)
+		{
+			UTIL_WAIT_KEY("Unable to allocate memory ...");
+			exit(EXIT_FAILURE);
+		}
+		strcpy(Files[Count], Path);
+		if (PlanSprite(Files[Count], &Assets[Count]) == true)
+			Count++;
+		else
+			printf("%s: incorrect file ... \n", Path);
+	}
+	DirIterClose();
+	if (Count == 0)
+	{
+		puts("No sprites found.");
+		return;
+	}
+
+	// Pick sizes
+	if (PlanBudget(Assets, Count, Budget, &Total) == false)
+		printf("Budget can't be reached, smallest sizes are used \n");
+	for (uint i = 0; i < Count; i++)
+		printf("%s: level %u, %u bytes \n", Files[i], Assets[i].Level, (uint)Assets[i].Size[Assets[i].Level]);
+	printf("Planned: %u bytes, budget: %u bytes \n\n", (uint)Total, (uint)Budget);
+
+	// Convert
+	for (uint i = 0; i < Count; i++)
+	{
+		printf("Proccessing file: %s \n", Files[i]);
+		ConvertSPRToSPZ(Files[i], Linear, Assets[i].Level);
+	}
+
+	free(Files);
+	free(Assets);
+}
+
 int main(int argc, char * argv[])
 {
 	puts(PROG_TITLE);
@@ -421,7 +776,7 @@ int main(int argc, char * argv[])
 		if (!strcmp(Extension, ".spr") == true)
 		{
 			printf("Proccessing file: %s \n", argv[1]);
-			ConvertSPRToSPZ(argv[1], false);
+			ConvertSPRToSPZ(argv[1], false, 0);
 			puts("Done! \n");
 			return 0;
 		}
@@ -472,7 +827,7 @@ int main(int argc, char * argv[])
 			{
 				printf("Proccessing file: %s \n", argv[2]);
 				puts("Linear resize mode ...");
-				ConvertSPRToSPZ(argv[2], true);
+				ConvertSPRToSPZ(argv[2], true, 0);
 				puts("Done! \n");
 				return 0;
 			}
@@ -486,6 +841,21 @@ int main(int argc, char * argv[])
 			puts("Bad arguments! \n");
 		}
 	}
+	else if ((argc == 4 || argc == 5) && !strcmp(argv[1], "plan"))
+	{
+		if (CheckDir(argv[2]) == false)
+			puts("Folder required.");
+		else if (atoi(argv[3]) <= 0)
+			puts("Wrong budget.");
+		else if (argc == 5 && strcmp(argv[4], "lin"))
+			puts("Bad arguments! \n");
+		else
+		{
+			PlanSprites(argv[2], atoi(argv[3]) * 1024, argc == 5);
+			puts("Done! \n");
+			return 0;
+		}
+	}
 	else
 	{
 		puts("Wrong command line parameters.");